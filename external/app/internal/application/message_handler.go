@@ -46,8 +46,21 @@ func (mh *MessageHandler) HandleMessage(payload []byte) error {
 		chunk = &domain.AudioChunk{Key: key, IsEnd: true}
 		log.Printf("Received end marker for session %d", sessionID)
 	default: // Data chunk
-		chunk = &domain.AudioChunk{Key: key, Data: data}
-		log.Printf("Received data chunk %d for session %d (%d bytes)", chunkType, sessionID, len(data))
+		header, audio, err := domain.ParseAudioPacket(data)
+		if err != nil {
+			return fmt.Errorf("invalid audio packet for session %d: %w", sessionID, err)
+		}
+		pcm, err := header.DecodePCM(audio)
+		if err != nil {
+			return fmt.Errorf("failed to decode chunk %d for session %d: %w", chunkType, sessionID, err)
+		}
+		chunk = &domain.AudioChunk{
+			Key:         key,
+			Data:        pcm,
+			Sequence:    header.Sequence,
+			HasSequence: header.Version > 0,
+		}
+		log.Printf("Received data chunk %d for session %d (%d bytes, codec %d)", chunkType, sessionID, len(data), header.Codec)
 	}
 
 	// Use assembler to handle the chunk
@@ -58,8 +71,8 @@ func (mh *MessageHandler) HandleMessage(payload []byte) error {
 
 	// If stream is complete, process it
 	if stream != nil {
-		log.Printf("Stream %d complete (%d chunks, %.2f seconds)",
-			sessionID, len(stream.Chunks), stream.GetDuration())
+		log.Printf("Stream %d complete (%d chunks, %d lost, %.2f seconds)",
+			sessionID, len(stream.Chunks), stream.LostChunks, stream.GetDuration())
 
 		// Process the complete audio stream
 		if err := mh.audioProcessor.ProcessAudio(stream); err != nil {
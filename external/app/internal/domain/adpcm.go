@@ -0,0 +1,75 @@
+package domain
+
+var imaStepTable = [89]int32{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+}
+
+var imaIndexTable = [16]int32{
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8,
+}
+
+// DecodeIMAADPCM decodes IMA ADPCM nibbles (low nibble first) into 16-bit little-endian PCM,
+// starting from the predictor and step index the encoder had before the first sample
+func DecodeIMAADPCM(data []byte, samples int, predictor int16, stepIndex uint8) []byte {
+	if samples > len(data)*2 {
+		samples = len(data) * 2
+	}
+
+	pred := int32(predictor)
+	index := int32(stepIndex)
+	if index > 88 {
+		index = 88
+	}
+
+	pcm := make([]byte, samples*2)
+	for i := 0; i < samples; i++ {
+		code := data[i>>1]
+		if i&1 == 1 {
+			code >>= 4
+		}
+		code &= 0x0F
+
+		step := imaStepTable[index]
+		diff := step >> 3
+		if code&4 != 0 {
+			diff += step
+		}
+		if code&2 != 0 {
+			diff += step >> 1
+		}
+		if code&1 != 0 {
+			diff += step >> 2
+		}
+		if code&8 != 0 {
+			pred -= diff
+		} else {
+			pred += diff
+		}
+		if pred > 32767 {
+			pred = 32767
+		} else if pred < -32768 {
+			pred = -32768
+		}
+
+		index += imaIndexTable[code]
+		if index < 0 {
+			index = 0
+		} else if index > 88 {
+			index = 88
+		}
+
+		pcm[2*i] = byte(pred)
+		pcm[2*i+1] = byte(pred >> 8)
+	}
+
+	return pcm
+}
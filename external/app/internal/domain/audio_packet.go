@@ -0,0 +1,119 @@
+package domain
+
+import (
+	"encoding/binary"
+	"fmt"
+)
+
+// Audio codecs carried in the packet header
+const (
+	AudioCodecPCM16    = 0
+	AudioCodecIMAADPCM = 1
+)
+
+// AudioPacketHeaderSize is the size of the header that follows the 4-byte key
+const AudioPacketHeaderSize = 16
+
+// AudioPacketMagic opens every packet header
+const AudioPacketMagic = "PAUD"
+
+const audioPacketVersion = 2
+
+// Offset of the CRC, it covers every header byte before it
+const audioPacketCRCOffset = 14
+
+// AudioPacketHeader describes the audio that follows the key in an MQTT payload
+type AudioPacketHeader struct {
+	Version   uint8
+	Codec     uint8
+	Sequence  uint16
+	Samples   uint16
+	Predictor int16
+	StepIndex uint8
+}
+
+// ParseAudioPacket splits the data after the key into header and audio.
+// Only a full header with the magic, a sane header size and a matching CRC
+// is taken as one; anything else comes from older firmware and is raw PCM16,
+// so raw audio that happens to start like a header is not misread.
+func ParseAudioPacket(data []byte) (*AudioPacketHeader, []byte, error) {
+	if !hasAudioPacketHeader(data) {
+		return &AudioPacketHeader{
+			Codec:   AudioCodecPCM16,
+			Samples: uint16(len(data) / 2),
+		}, data, nil
+	}
+
+	header := &AudioPacketHeader{
+		Version:   data[4],
+		Codec:     data[6],
+		StepIndex: data[7],
+		Sequence:  binary.LittleEndian.Uint16(data[8:10]),
+		Samples:   binary.LittleEndian.Uint16(data[10:12]),
+		Predictor: int16(binary.LittleEndian.Uint16(data[12:14])),
+	}
+	if header.Version != audioPacketVersion {
+		return nil, nil, fmt.Errorf("unsupported audio packet version %d", header.Version)
+	}
+
+	// A later version may grow the header, the audio starts after it
+	return header, data[data[5]:], nil
+}
+
+// EncodeAudioPacketHeader writes the header the firmware puts before the audio
+func EncodeAudioPacketHeader(h *AudioPacketHeader) []byte {
+	data := make([]byte, AudioPacketHeaderSize)
+	copy(data, AudioPacketMagic)
+	data[4] = h.Version
+	data[5] = AudioPacketHeaderSize
+	data[6] = h.Codec
+	data[7] = h.StepIndex
+	binary.LittleEndian.PutUint16(data[8:10], h.Sequence)
+	binary.LittleEndian.PutUint16(data[10:12], h.Samples)
+	binary.LittleEndian.PutUint16(data[12:14], uint16(h.Predictor))
+	binary.LittleEndian.PutUint16(data[14:16], crc16CCITT(data[:audioPacketCRCOffset]))
+	return data
+}
+
+func hasAudioPacketHeader(data []byte) bool {
+	if len(data) < AudioPacketHeaderSize || string(data[:4]) != AudioPacketMagic {
+		return false
+	}
+	size := int(data[5])
+	if size < AudioPacketHeaderSize || size > len(data) {
+		return false
+	}
+	crc := binary.LittleEndian.Uint16(data[audioPacketCRCOffset:])
+	return crc == crc16CCITT(data[:audioPacketCRCOffset])
+}
+
+// crc16CCITT is CRC-16/CCITT-FALSE, as computed by the firmware
+func crc16CCITT(data []byte) uint16 {
+	crc := uint16(0xFFFF)
+	for _, b := range data {
+		crc ^= uint16(b) << 8
+		for bit := 0; bit < 8; bit++ {
+			if crc&0x8000 != 0 {
+				crc = crc<<1 ^ 0x1021
+			} else {
+				crc <<= 1
+			}
+		}
+	}
+	return crc
+}
+
+// DecodePCM returns the audio as 16-bit little-endian PCM
+func (h *AudioPacketHeader) DecodePCM(audio []byte) ([]byte, error) {
+	switch h.Codec {
+	case AudioCodecPCM16:
+		return audio[:len(audio)&^1], nil
+	case AudioCodecIMAADPCM:
+		if len(audio)*2 < int(h.Samples) {
+			return nil, fmt.Errorf("ADPCM chunk truncated: %d bytes for %d samples", len(audio), h.Samples)
+		}
+		return DecodeIMAADPCM(audio, int(h.Samples), h.Predictor, h.StepIndex), nil
+	default:
+		return nil, fmt.Errorf("unsupported audio codec %d", h.Codec)
+	}
+}
@@ -0,0 +1,290 @@
+package domain
+
+import (
+	"bytes"
+	"encoding/binary"
+	"math"
+	"testing"
+)
+
+// Vectors from the firmware encoder (src/app/audio/adpcm.cpp and audiopacket.h), test/test_adpcm checks the same bytes
+var (
+	goldenPCM    = []int16{0, 5653, 8883, 6905, 3179, -1806, -6972, -7359, -4050, 134, 5755, 8905, 6836, 3052, -1931, -7037}
+	goldenADPCM  = []byte{0x7f, 0x77, 0xf1, 0xcf, 0x32, 0x15, 0xa9, 0xbc}
+	goldenPCMOut = []int16{1141, 1340, 1770, 2695, 3092, 1288, -2585, -7566, -4218, 42, 6130, 8561, 6352, 3004, -2475, -7631}
+	goldenHeader = []byte{
+		'P', 'A', 'U', 'D', 0x02, 0x10, 0x01, 0x14,
+		0x07, 0x00, 0x10, 0x00, 0xd2, 0x04, 0x8f, 0x76,
+	}
+)
+
+// encodeIMAADPCM mirrors ImaAdpcm::encode in the firmware and returns the state the next chunk starts from
+func encodeIMAADPCM(pcm []int16, predictor int16, stepIndex uint8) ([]byte, int16, uint8) {
+	out := make([]byte, (len(pcm)+1)/2)
+	pred := int32(predictor)
+	index := int32(stepIndex)
+	for i, sample := range pcm {
+		step := imaStepTable[index]
+		diff := int32(sample) - pred
+		var code byte
+		if diff < 0 {
+			code = 8
+			diff = -diff
+		}
+		delta := step >> 3
+		if diff >= step {
+			code |= 4
+			diff -= step
+			delta += step
+		}
+		step >>= 1
+		if diff >= step {
+			code |= 2
+			diff -= step
+			delta += step
+		}
+		step >>= 1
+		if diff >= step {
+			code |= 1
+			delta += step
+		}
+		if code&8 != 0 {
+			pred -= delta
+		} else {
+			pred += delta
+		}
+		if pred > 32767 {
+			pred = 32767
+		} else if pred < -32768 {
+			pred = -32768
+		}
+		index += imaIndexTable[code]
+		if index < 0 {
+			index = 0
+		} else if index > 88 {
+			index = 88
+		}
+		out[i>>1] |= code << (4 * uint(i&1))
+	}
+	return out, int16(pred), uint8(index)
+}
+
+func pcmBytes(samples []int16) []byte {
+	data := make([]byte, len(samples)*2)
+	for i, s := range samples {
+		binary.LittleEndian.PutUint16(data[2*i:], uint16(s))
+	}
+	return data
+}
+
+func pcmSamples(data []byte) []int16 {
+	samples := make([]int16, len(data)/2)
+	for i := range samples {
+		samples[i] = int16(binary.LittleEndian.Uint16(data[2*i:]))
+	}
+	return samples
+}
+
+func TestCRC16MatchesCCITTFalse(t *testing.T) {
+	if crc := crc16CCITT([]byte("123456789")); crc != 0x29B1 {
+		t.Fatalf("crc16CCITT check value = %#04x, want 0x29b1", crc)
+	}
+}
+
+func TestEncodeHeaderMatchesFirmware(t *testing.T) {
+	header := EncodeAudioPacketHeader(&AudioPacketHeader{
+		Version:   2,
+		Codec:     AudioCodecIMAADPCM,
+		Sequence:  7,
+		Samples:   16,
+		Predictor: 1234,
+		StepIndex: 20,
+	})
+	if !bytes.Equal(header, goldenHeader) {
+		t.Fatalf("header = % x, want % x", header, goldenHeader)
+	}
+}
+
+func TestParseFirmwarePacket(t *testing.T) {
+	packet := append(append([]byte{}, goldenHeader...), goldenADPCM...)
+	header, audio, err := ParseAudioPacket(packet)
+	if err != nil {
+		t.Fatal(err)
+	}
+	want := AudioPacketHeader{Version: 2, Codec: AudioCodecIMAADPCM, Sequence: 7, Samples: 16, Predictor: 1234, StepIndex: 20}
+	if *header != want {
+		t.Fatalf("header = %+v, want %+v", *header, want)
+	}
+	pcm, err := header.DecodePCM(audio)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if got := pcmSamples(pcm); !equalSamples(got, goldenPCMOut) {
+		t.Fatalf("decoded %v, want %v", got, goldenPCMOut)
+	}
+}
+
+func TestEncoderMatchesFirmware(t *testing.T) {
+	if got, _, _ := encodeIMAADPCM(goldenPCM, 1234, 20); !bytes.Equal(got, goldenADPCM) {
+		t.Fatalf("encoded % x, want % x", got, goldenADPCM)
+	}
+}
+
+func TestRawPCMIsNotMistakenForHeader(t *testing.T) {
+	cases := map[string][]byte{
+		// 0x4150 is "PA" little-endian, the old two-byte magic
+		"old magic": pcmBytes([]int16{0x4150, 2, 3, 4, 5, 6, 7, 8, 9, 10}),
+		"short":     []byte("PAUD"),
+		"bad crc": func() []byte {
+			data := append(append([]byte{}, goldenHeader...), goldenADPCM...)
+			data[15] ^= 0x01
+			return data
+		}(),
+		"bad size": func() []byte {
+			data := append([]byte{}, goldenHeader...)
+			data[5] = 64
+			binary.LittleEndian.PutUint16(data[14:], crc16CCITT(data[:14]))
+			return data
+		}(),
+	}
+	for name, data := range cases {
+		header, audio, err := ParseAudioPacket(data)
+		if err != nil {
+			t.Fatalf("%s: %v", name, err)
+		}
+		if header.Codec != AudioCodecPCM16 || !bytes.Equal(audio, data) {
+			t.Fatalf("%s: parsed as codec %d with %d bytes, want raw PCM", name, header.Codec, len(audio))
+		}
+	}
+}
+
+func TestLongerHeaderIsSkipped(t *testing.T) {
+	data := append([]byte{}, goldenHeader...)
+	data[5] = AudioPacketHeaderSize + 4
+	binary.LittleEndian.PutUint16(data[14:], crc16CCITT(data[:14]))
+	data = append(data, 0xAA, 0xBB, 0xCC, 0xDD)
+	data = append(data, goldenADPCM...)
+
+	_, audio, err := ParseAudioPacket(data)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(audio, goldenADPCM) {
+		t.Fatalf("audio = % x, want % x", audio, goldenADPCM)
+	}
+}
+
+func TestUnknownVersionIsRejected(t *testing.T) {
+	header := EncodeAudioPacketHeader(&AudioPacketHeader{Version: 3, Codec: AudioCodecIMAADPCM})
+	if _, _, err := ParseAudioPacket(header); err == nil {
+		t.Fatal("version 3 accepted")
+	}
+}
+
+func TestTruncatedADPCMIsRejected(t *testing.T) {
+	header := &AudioPacketHeader{Version: 2, Codec: AudioCodecIMAADPCM, Samples: 32}
+	if _, err := header.DecodePCM(goldenADPCM); err == nil {
+		t.Fatal("8 bytes accepted for 32 samples")
+	}
+}
+
+// Speech-like test signal: a gliding harmonic tone with a syllable envelope
+func speechLike(samples, rate int) []int16 {
+	out := make([]int16, samples)
+	phase := 0.0
+	for i := range out {
+		t := float64(i) / float64(rate)
+		f0 := 140 + 40*math.Sin(2*math.Pi*0.7*t)
+		phase += 2 * math.Pi * f0 / float64(rate)
+		envelope := 0.5 + 0.5*math.Sin(2*math.Pi*4*t)
+		value := 0.0
+		for h := 1; h <= 8; h++ {
+			value += math.Sin(float64(h)*phase) / float64(h)
+		}
+		out[i] = int16(6000 * envelope * value)
+	}
+	return out
+}
+
+func snr(reference, decoded []int16) float64 {
+	var signal, noise float64
+	for i := range reference {
+		s := float64(reference[i])
+		d := s - float64(decoded[i])
+		signal += s * s
+		noise += d * d
+	}
+	return 10 * math.Log10(signal/noise)
+}
+
+func TestADPCMRoundTripSNR(t *testing.T) {
+	const rate = 16000
+	const chunk = 512
+	signal := speechLike(10*rate, rate)
+
+	// Chunk by chunk as the firmware publishes, each packet decoded on its own
+	decoded := make([]int16, 0, len(signal))
+	var predictor int16
+	var stepIndex uint8
+	for seq := 0; seq*chunk < len(signal); seq++ {
+		end := (seq + 1) * chunk
+		if end > len(signal) {
+			end = len(signal)
+		}
+		samples := signal[seq*chunk : end]
+		header := EncodeAudioPacketHeader(&AudioPacketHeader{
+			Version:   2,
+			Codec:     AudioCodecIMAADPCM,
+			Sequence:  uint16(seq),
+			Samples:   uint16(len(samples)),
+			Predictor: predictor,
+			StepIndex: stepIndex,
+		})
+		encoded, nextPredictor, nextStepIndex := encodeIMAADPCM(samples, predictor, stepIndex)
+
+		parsed, audio, err := ParseAudioPacket(append(header, encoded...))
+		if err != nil {
+			t.Fatal(err)
+		}
+		if parsed.Sequence != uint16(seq) {
+			t.Fatalf("sequence %d, want %d", parsed.Sequence, seq)
+		}
+		pcm, err := parsed.DecodePCM(audio)
+		if err != nil {
+			t.Fatal(err)
+		}
+		decoded = append(decoded, pcmSamples(pcm)...)
+		predictor, stepIndex = nextPredictor, nextStepIndex
+	}
+
+	if len(decoded) != len(signal) {
+		t.Fatalf("decoded %d samples, want %d", len(decoded), len(signal))
+	}
+	if got := snr(signal, decoded); got < 25 {
+		t.Fatalf("SNR %.1f dB, want at least 25 dB", got)
+	} else {
+		t.Logf("SNR %.1f dB over %d samples", got, len(signal))
+	}
+}
+
+func equalSamples(a, b []int16) bool {
+	if len(a) != len(b) {
+		return false
+	}
+	for i := range a {
+		if a[i] != b[i] {
+			return false
+		}
+	}
+	return true
+}
+
+func BenchmarkDecodeIMAADPCM(b *testing.B) {
+	signal := speechLike(16000, 16000)
+	encoded, _, _ := encodeIMAADPCM(signal, 0, 0)
+	b.SetBytes(int64(len(signal) * 2))
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		DecodeIMAADPCM(encoded, len(signal), 0, 0)
+	}
+}
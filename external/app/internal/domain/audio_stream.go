@@ -8,10 +8,12 @@ import (
 
 // AudioChunk represents a chunk of audio data with metadata
 type AudioChunk struct {
-	Key     uint32
-	Data    []byte
-	IsStart bool
-	IsEnd   bool
+	Key         uint32
+	Data        []byte
+	IsStart     bool
+	IsEnd       bool
+	Sequence    uint16
+	HasSequence bool
 }
 
 // AudioStream represents a complete audio stream session
@@ -21,6 +23,9 @@ type AudioStream struct {
 	buffer     *bytes.Buffer
 	Volume     float64
 	LastUpdate time.Time
+	LostChunks int
+	nextSeq    uint16
+	seqStarted bool
 }
 
 // NewAudioStream creates a new audio stream
@@ -39,6 +44,14 @@ func (as *AudioStream) AddChunk(chunk *AudioChunk) error {
 	as.LastUpdate = time.Now() // Update last update time
 	as.Chunks = append(as.Chunks, chunk)
 
+	if chunk.HasSequence {
+		if as.seqStarted && chunk.Sequence != as.nextSeq {
+			as.LostChunks += int(chunk.Sequence - as.nextSeq)
+		}
+		as.nextSeq = chunk.Sequence + 1
+		as.seqStarted = true
+	}
+
 	if chunk.IsStart {
 		as.buffer.Reset()
 	} else if chunk.IsEnd {
@@ -13,6 +13,8 @@
 #define MQTT_CLIENT_ID "pio-assistant"
 #define MQTT_TOPIC_AUDIO "pioassistant/audio"
 #define MQTT_TOPIC_STT "pioassistant/stt"
+// uplink audio codec: 1 = IMA-ADPCM (4 bits/sample), 0 = raw PCM16
+#define MQTT_AUDIO_ADPCM 1
 
 // analog microphone
 #define MIC_AR   GPIO_NUM_39
@@ -24,6 +26,61 @@
 #define SPEAKER_BIT_DEPTH I2S_DATA_BIT_WIDTH_16BIT
 #define SPEAKER_CHANNELS I2S_SLOT_MODE_MONO    
 #define SPEAKER_VOLUME 1.0f
+// realtime session audio rate, the speaker clock follows it while a session is open
+#define STS_SAMPLE_RATE 24000
+
+// realtime session client: 1 = in-tree WebSocket client, audio deltas are decoded straight
+// into the speaker and uplink audio written straight into frames, 0 = aiSts from esp32-gpt.
+// The in-tree client is host tested only, switch it on once it has run on a device
+#define REALTIME_CLIENT 0
+// open TLS to the realtime API while the VAD hears speech, so a wake word that follows only
+// sends the upgrade; an unused connection is closed after the idle budget
+#define REALTIME_PRECONNECT 1
+#define REALTIME_PRECONNECT_IDLE_MS 8000
+#define REALTIME_PRECONNECT_INTERVAL_MS 2000
+// TCP connect and TLS handshake limit of a preconnect each, it runs on the shared network worker
+#define REALTIME_PRECONNECT_TIMEOUT_MS 2000
+
+// realtime uplink source: 1 = AFE output (AEC/NS), 0 = raw microphone
+#define MIC_UPLINK_AFE 1
+// AFE output kept for readers, also bounds the audio after the wake word that is
+// replayed into a new session while it connects (32000 = 2 s)
+#define AFE_TAP_HISTORY_SAMPLES 32000
+// uplink DTX: silence longer than the hangover is not sent, the hangover must
+// outlast the server VAD silence window so turns still end
+#define UPLINK_DTX 1
+#define UPLINK_DTX_HANGOVER_MS 1200
+#define UPLINK_DTX_ONSET_MS 200
+#define UPLINK_DTX_KEEPALIVE_MS 1000
+// replayed onset padding is silence to the VAD and must not restart suppression; the replay
+// starts on an AFE frame (32 ms), so it can run up to two frames past the onset
+static_assert(UPLINK_DTX_ONSET_MS < UPLINK_DTX_HANGOVER_MS, "UPLINK_DTX_ONSET_MS must stay below UPLINK_DTX_HANGOVER_MS");
+static_assert(UPLINK_DTX_ONSET_MS + 64 <= UPLINK_DTX_HANGOVER_MS, "UPLINK_DTX_HANGOVER_MS must cover the frame-aligned onset replay");
+
+// uplink packetization: audio per realtime append message, adapted between min and max
+// from the send time and the backlog, speech end always flushes
+#define UPLINK_PACKETIZE 1
+#define UPLINK_FRAME_MIN_MS 20
+#define UPLINK_FRAME_MAX_MS 200
+#define UPLINK_FRAME_START_MS 60
+#define UPLINK_FRAME_STEP_MS 20
+
+// recording endpointer on the AFE VAD: stops capture after the hangover, drops silence outside the padding
+#define REC_ENDPOINT 1
+#define REC_ENDPOINT_HANGOVER_MS 900
+#define REC_ENDPOINT_PRE_PAD_MS 300
+#define REC_ENDPOINT_POST_PAD_MS 300
+#define REC_ENDPOINT_NO_SPEECH_MS 6000
+
+// button and wake word: 0 = realtime session, 1 = record the request, transcribe it and prompt the LLM
+#define VOICE_RECORD_MODE 0
+// recorded requests: 1 = upload to STT while recording, 0 = write a WAV and transcribe it afterwards
+#define STT_STREAM 1
+
+// streaming speech-to-text, any OpenAI-compatible multipart endpoint (e.g. external/whisper at http://<host>:8000/transcribe)
+#define STT_STREAM_URL "https://api.openai.com/v1/audio/transcriptions"
+#define STT_STREAM_MODEL "gpt-4o-mini-transcribe"
+#define STT_STREAM_LANGUAGE "id"
 
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
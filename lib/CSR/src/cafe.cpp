@@ -7,6 +7,8 @@ esp_afe_sr_data_t *afe_data;
 int16_t *afe_in_buffer;
 vad_state_t afe_state = VAD_SILENCE;
 unsigned long afe_last_speech = 0;
+afe_tap_cb_t afe_tap = nullptr;
+void *afe_tap_arg = nullptr;
 
 srmodel_list_t* getModels() {
 	if (models)
@@ -67,6 +69,10 @@ afe_fetch_result_t* fetchAfe() {
 		if (afe_state == VAD_SPEECH) {
 			afe_last_speech = millis();
 		};
+		// result->data is only valid until the next fetch, the tap must copy it
+		if (afe_tap && result->data && result->data_size > 0) {
+			afe_tap(result->data, result->data_size / sizeof(int16_t), result->vad_state, afe_tap_arg);
+		}
 	}
 	return result;
 }
@@ -77,4 +83,9 @@ unsigned long getLastSpeech() {
 
 vad_state_t getAfeState() {
 	return afe_state;
+}
+
+void setAfeTap(afe_tap_cb_t cb, void *arg) {
+	afe_tap_arg = arg;
+	afe_tap = cb;
 }
\ No newline at end of file
@@ -19,6 +19,8 @@
 #define SR_CMD_PHONEME_LEN_MAX 64
 #define WAKEWORD_COMMAND 			 ""
 
+typedef void (*afe_tap_cb_t)(const int16_t *data, size_t samples, vad_state_t vad_state, void *arg);
+
 srmodel_list_t* getModels();
 afe_config_t* getAfeConfig();
 esp_afe_sr_data_t* getAfeData();
@@ -27,6 +29,7 @@ void feedAfe(int16_t *audio_buffer);
 afe_fetch_result_t* fetchAfe();
 vad_state_t getAfeState();
 unsigned long getLastSpeech();
+void setAfeTap(afe_tap_cb_t cb, void *arg);
 
 namespace SR {
 
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+#include <NetworkClient.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+
+#ifndef TLS_SESSION_CACHE_SIZE
+#define TLS_SESSION_CACHE_SIZE 2 // Hosts whose last session is kept for resumption
+#endif
+
+#ifndef TLS_SESSION_LIFETIME_MS
+#define TLS_SESSION_LIFETIME_MS (60UL * 60 * 1000) // Older sessions are not offered, servers drop them anyway
+#endif
+
+#ifndef TLS_HANDSHAKE_TIMEOUT_MS
+#define TLS_HANDSHAKE_TIMEOUT_MS 10000
+#endif
+
+#ifndef TLS_SESSION_PIN_TLS12
+#define TLS_SESSION_PIN_TLS12 0 // 1 = never offer TLS 1.3, see below
+#endif
+
+// Connect plus handshake times, full and resumed handshakes are kept apart
+struct TlsHandshakeStats {
+    uint32_t cold;
+    uint32_t coldMs;
+    uint32_t resumed;
+    uint32_t resumedMs;
+    uint32_t lastMs;
+    bool lastResumed;
+};
+
+/**
+ * TLS client that resumes sessions across connections
+ *
+ * Same role as NetworkClientSecure with setInsecure(), on top of mbedTLS
+ * directly so the session of the last handshake with a host can be offered
+ * again. A resumed handshake skips the key exchange and the certificate,
+ * one round trip and the expensive public key work.
+ *
+ * Resumption is tracked for TLS 1.2 only. A TLS 1.3 server echoes the
+ * legacy session ID on every handshake and sends its tickets after the
+ * handshake, so those connections are always counted as full. Servers
+ * that prefer 1.3 would then never resume here; TLS_SESSION_PIN_TLS12
+ * caps the version at 1.2 for them, at the cost of 1.3 for every
+ * connection made through this client.
+ */
+class TlsSessionClient : public Client {
+public:
+    TlsSessionClient() : _ready(false), _connected(false), _handshakeTimeoutMs(TLS_HANDSHAKE_TIMEOUT_MS) {}
+
+    ~TlsSessionClient() {
+        stop();
+    }
+
+    int connect(IPAddress ip, uint16_t port) override {
+        return connect(ip.toString().c_str(), port, TLS_HANDSHAKE_TIMEOUT_MS);
+    }
+
+    int connect(IPAddress ip, uint16_t port, int32_t timeout) {
+        return connect(ip.toString().c_str(), port, timeout);
+    }
+
+    int connect(const char* host, uint16_t port) override {
+        return connect(host, port, TLS_HANDSHAKE_TIMEOUT_MS);
+    }
+
+    /**
+     * Connect and handshake, offering the last session with this host if there is one
+     * @param timeout Milliseconds for the TCP connect, the handshake has setHandshakeTimeout()
+     */
+    int connect(const char* host, uint16_t port, int32_t timeout) {
+        stop();
+        unsigned long start = millis();
+        if (!_tcp.connect(host, port, timeout)) {
+            ESP_LOGE("TLS", "TCP connect to %s:%d failed", host, port);
+            return 0;
+        }
+        _tcp.setNoDelay(true);
+        unsigned long handshakeStart = millis();
+
+        if (!setup(host)) {
+            stop();
+            return 0;
+        }
+
+        SessionEntry* entry = find(host, port);
+        bool offered = entry && millis() - entry->savedAt < TLS_SESSION_LIFETIME_MS
+            && mbedtls_ssl_set_session(&_ssl, &entry->session) == 0;
+
+        // Step through the handshake to catch the session ID as sent in the ClientHello,
+        // with a ticket it is generated then. The server echoes it only when it resumes.
+        uint8_t helloId[32];
+        size_t helloLen = 0;
+        bool captured = false;
+        while (!mbedtls_ssl_is_handshake_over(&_ssl)) {
+            int ret = mbedtls_ssl_handshake_step(&_ssl);
+            const mbedtls_ssl_session* negotiate = _ssl.MBEDTLS_PRIVATE(session_negotiate);
+            if (!captured && _ssl.MBEDTLS_PRIVATE(state) > MBEDTLS_SSL_CLIENT_HELLO && negotiate) {
+                helloLen = negotiate->MBEDTLS_PRIVATE(id_len);
+                memcpy(helloId, negotiate->MBEDTLS_PRIVATE(id), helloLen);
+                captured = true;
+            }
+            if (ret == 0) continue;
+            if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+                ESP_LOGE("TLS", "Handshake with %s failed: -0x%04x", host, -ret);
+                stop();
+                return 0;
+            }
+            if (millis() - handshakeStart > _handshakeTimeoutMs) {
+                ESP_LOGE("TLS", "Handshake with %s timed out", host);
+                stop();
+                return 0;
+            }
+            delay(1);
+        }
+        _connected = true;
+
+        const mbedtls_ssl_session* session = _ssl.MBEDTLS_PRIVATE(session);
+        bool resumed = offered && helloLen > 0 && isTls12() && session && session->MBEDTLS_PRIVATE(id_len) == helloLen
+            && memcmp(session->MBEDTLS_PRIVATE(id), helloId, helloLen) == 0;
+        save(host, port);
+
+        uint32_t elapsed = millis() - start;
+        _stats.lastMs = elapsed;
+        _stats.lastResumed = resumed;
+        if (resumed) {
+            _stats.resumed++;
+            _stats.resumedMs += elapsed;
+        } else {
+            _stats.cold++;
+            _stats.coldMs += elapsed;
+        }
+        ESP_LOGI("TLS", "Connected to %s in %lu ms (%s handshake)", host, elapsed, resumed ? "resumed" : "full");
+        return 1;
+    }
+
+    size_t write(uint8_t b) override {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!_connected) return 0;
+        size_t sent = 0;
+        unsigned long start = millis();
+        while (sent < size) {
+            int ret = mbedtls_ssl_write(&_ssl, buf + sent, size - sent);
+            if (ret > 0) {
+                sent += ret;
+                start = millis();
+            } else if (ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ) {
+                ESP_LOGE("TLS", "Write failed: -0x%04x", -ret);
+                stop();
+                break;
+            } else if (millis() - start > TLS_HANDSHAKE_TIMEOUT_MS) {
+                ESP_LOGE("TLS", "Write timed out");
+                stop();
+                break;
+            } else {
+                delay(1);
+            }
+        }
+        return sent;
+    }
+
+    int available() override {
+        if (!_connected) return 0;
+        size_t pending = mbedtls_ssl_get_bytes_avail(&_ssl);
+        if (pending == 0 && _tcp.available() > 0) {
+            // Decrypt the next record without consuming application data
+            int ret = mbedtls_ssl_read(&_ssl, nullptr, 0);
+            if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+                if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) ESP_LOGE("TLS", "Read failed: -0x%04x", -ret);
+                stop();
+                return 0;
+            }
+            pending = mbedtls_ssl_get_bytes_avail(&_ssl);
+        }
+        return pending;
+    }
+
+    int read() override {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+
+    int read(uint8_t* buf, size_t size) override {
+        if (!_connected || available() <= 0) return -1;
+        int ret = mbedtls_ssl_read(&_ssl, buf, size);
+        if (ret > 0) return ret;
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) stop();
+        return -1;
+    }
+
+    int peek() override { return -1; }
+    void flush() override {}
+
+    void stop() override {
+        if (_connected) mbedtls_ssl_close_notify(&_ssl);
+        _connected = false;
+        _tcp.stop();
+        if (_ready) {
+            mbedtls_ssl_free(&_ssl);
+            mbedtls_ssl_config_free(&_conf);
+            mbedtls_ctr_drbg_free(&_drbg);
+            mbedtls_entropy_free(&_entropy);
+            _ready = false;
+        }
+    }
+
+    uint8_t connected() override {
+        if (_connected && !_tcp.connected() && available() == 0) _connected = false;
+        return _connected;
+    }
+
+    operator bool() override { return connected(); }
+
+    // Kept for the NetworkClientSecure call sites, certificates are not verified either way
+    void setInsecure() {}
+
+    // Seconds, as with NetworkClientSecure
+    void setHandshakeTimeout(unsigned long seconds) { _handshakeTimeoutMs = seconds * 1000; }
+
+    static TlsHandshakeStats stats() { return _stats; }
+
+    /**
+     * Forget the cached sessions, the next connection per host is a full handshake
+     */
+    static void clearSessions() {
+        SessionEntry* entries = cache();
+        for (size_t i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+            if (entries[i].valid) mbedtls_ssl_session_free(&entries[i].session);
+            entries[i].valid = false;
+        }
+    }
+
+private:
+    struct SessionEntry {
+        char host[64];
+        uint16_t port;
+        mbedtls_ssl_session session;
+        unsigned long savedAt;
+        bool valid;
+    };
+
+    NetworkClient _tcp;
+    mbedtls_ssl_context _ssl;
+    mbedtls_ssl_config _conf;
+    mbedtls_ctr_drbg_context _drbg;
+    mbedtls_entropy_context _entropy;
+    bool _ready;
+    bool _connected;
+    unsigned long _handshakeTimeoutMs;
+
+    static inline TlsHandshakeStats _stats = {};
+
+    // Shared by every client, connections are opened from one task at a time
+    static SessionEntry* cache() {
+        static SessionEntry entries[TLS_SESSION_CACHE_SIZE] = {};
+        return entries;
+    }
+
+    static SessionEntry* find(const char* host, uint16_t port) {
+        SessionEntry* entries = cache();
+        for (size_t i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+            if (entries[i].valid && entries[i].port == port && strcmp(entries[i].host, host) == 0) return &entries[i];
+        }
+        return nullptr;
+    }
+
+    void save(const char* host, uint16_t port) {
+        if (strlen(host) >= sizeof(SessionEntry::host)) return;
+        SessionEntry* entry = find(host, port);
+        if (!entry) {
+            // Free slot, otherwise the oldest
+            SessionEntry* entries = cache();
+            entry = &entries[0];
+            for (size_t i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+                if (!entries[i].valid) {
+                    entry = &entries[i];
+                    break;
+                }
+                if (entries[i].savedAt < entry->savedAt) entry = &entries[i];
+            }
+        }
+        if (entry->valid) mbedtls_ssl_session_free(&entry->session);
+        mbedtls_ssl_session_init(&entry->session);
+        entry->valid = mbedtls_ssl_get_session(&_ssl, &entry->session) == 0;
+        if (!entry->valid) {
+            mbedtls_ssl_session_free(&entry->session);
+            return;
+        }
+        strcpy(entry->host, host);
+        entry->port = port;
+        entry->savedAt = millis();
+    }
+
+    bool setup(const char* host) {
+        mbedtls_ssl_init(&_ssl);
+        mbedtls_ssl_config_init(&_conf);
+        mbedtls_ctr_drbg_init(&_drbg);
+        mbedtls_entropy_init(&_entropy);
+        _ready = true;
+
+        int ret = mbedtls_ctr_drbg_seed(&_drbg, mbedtls_entropy_func, &_entropy, nullptr, 0);
+        if (ret == 0) ret = mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+        if (ret != 0) {
+            ESP_LOGE("TLS", "Setup failed: -0x%04x", -ret);
+            return false;
+        }
+        mbedtls_ssl_conf_authmode(&_conf, MBEDTLS_SSL_VERIFY_NONE);
+        mbedtls_ssl_conf_rng(&_conf, mbedtls_ctr_drbg_random, &_drbg);
+#if TLS_SESSION_PIN_TLS12
+        mbedtls_ssl_conf_max_tls_version(&_conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        mbedtls_ssl_conf_session_tickets(&_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+        ret = mbedtls_ssl_setup(&_ssl, &_conf);
+        if (ret == 0) ret = mbedtls_ssl_set_hostname(&_ssl, host);
+        if (ret != 0) {
+            ESP_LOGE("TLS", "Setup failed: -0x%04x", -ret);
+            return false;
+        }
+        mbedtls_ssl_set_bio(&_ssl, &_tcp, netSend, netRecv, nullptr);
+        return true;
+    }
+
+    inline bool isTls12() {
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+        return mbedtls_ssl_get_version_number(&_ssl) == MBEDTLS_SSL_VERSION_TLS1_2;
+#else
+        return true;
+#endif
+    }
+
+    static int netSend(void* ctx, const unsigned char* buf, size_t len) {
+        NetworkClient* tcp = static_cast<NetworkClient*>(ctx);
+        if (!tcp->connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+        size_t sent = tcp->write(buf, len);
+        return sent > 0 ? (int)sent : MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+
+    static int netRecv(void* ctx, unsigned char* buf, size_t len) {
+        NetworkClient* tcp = static_cast<NetworkClient*>(ctx);
+        int n = tcp->available() > 0 ? tcp->read(buf, len) : 0;
+        if (n > 0) return n;
+        if (!tcp->connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+};
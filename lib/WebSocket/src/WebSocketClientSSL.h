@@ -1,16 +1,108 @@
 #pragma once
 
-#include <WiFiClientSecure.h>
 #include <Arduino.h>
 #include <base64.h>
+#include <esp_heap_caps.h>
+
+#ifndef WSS_TLS_SESSION_RESUME
+// 1 = TlsSessionClient, resumes TLS sessions across connections. Off until it has been
+// built against the core's mbedTLS 3.x and measured on the device; on loopback a resumed
+// handshake takes half to three quarters the time of a full one (tools/tls_resume_bench.py).
+#define WSS_TLS_SESSION_RESUME 0
+#endif
+
+#if WSS_TLS_SESSION_RESUME
+#include "TlsSessionClient.h"
+typedef TlsSessionClient WssTransport;
+#else
+#include <NetworkClientSecure.h>
+typedef NetworkClientSecure WssTransport;
+#endif
+
+#ifndef WSS_TX_BUFFER_SIZE
+#define WSS_TX_BUFFER_SIZE 2048 // Payload bytes per socket write, multiple of 4
+#endif
+
+#ifndef WSS_PRECONNECT_IDLE_MS
+#define WSS_PRECONNECT_IDLE_MS 8000 // A pre-opened connection nobody upgraded is closed after this
+#endif
+
+#ifndef WSS_PRECONNECT_TIMEOUT_MS
+#define WSS_PRECONNECT_TIMEOUT_MS 3000 // TCP connect and again TLS handshake of a preconnect
+#endif
+
+#ifndef WSS_HANDSHAKE_TIMEOUT_S
+#if WSS_TLS_SESSION_RESUME
+#define WSS_HANDSHAKE_TIMEOUT_S (TLS_HANDSHAKE_TIMEOUT_MS / 1000)
+#else
+#define WSS_HANDSHAKE_TIMEOUT_S 120 // TLS handshake of connect(), the NetworkClientSecure default
+#endif
+#endif
+
+#ifndef WSS_RX_MAX_MESSAGE
+#define WSS_RX_MAX_MESSAGE (1024 * 1024) // Largest reassembled message, bigger ones close the connection
+#endif
+
+#ifndef WSS_RX_CHUNK
+#define WSS_RX_CHUNK 1024 // Payload bytes per fragment callback when messages are streamed
+#endif
+
+static_assert(WSS_TX_BUFFER_SIZE % 4 == 0, "WSS_TX_BUFFER_SIZE must keep payload words aligned");
+
+enum WS_OPCODE {
+    WS_OPCODE_CONTINUATION = 0x0,
+    WS_OPCODE_TEXT = 0x1,
+    WS_OPCODE_BINARY = 0x2,
+    WS_OPCODE_CLOSE = 0x8,
+    WS_OPCODE_PING = 0x9,
+    WS_OPCODE_PONG = 0xA
+};
+
+// Complete message, data stays valid until the next poll()
+typedef void (*ws_message_cb_t)(uint8_t opcode, const uint8_t* data, size_t len, void* arg);
+
+// Part of a message as it arrives, first on its first call and last once it is complete
+typedef void (*ws_fragment_cb_t)(uint8_t opcode, const uint8_t* data, size_t len, bool first, bool last, void* arg);
+
+// One piece of a scatter/gather payload
+struct WsSlice {
+    const uint8_t* data;
+    size_t len;
+};
 
 // Simple WebSocket client using SSL for ESP32
 class WebSocketClientSSL {
 public:
-    WebSocketClientSSL() : connected(false), _auth(nullptr) {}
+    WebSocketClientSSL() : connected(false), _auth(nullptr), _rx(nullptr), _rxCapacity(0), _onMessage(nullptr), _onMessageArg(nullptr),
+        _onFragment(nullptr), _onFragmentArg(nullptr), _pongPending(false), _tx(nullptr), _txPos(0), _txStart(0), _frameLeft(0), _inFrame(false) {
+        resetReceive();
+    }
 
     ~WebSocketClientSSL() {
         disconnect();
+        if (_tx) heap_caps_free(_tx);
+        if (_rx) heap_caps_free(_rx);
+    }
+
+    /**
+     * Receive complete text and binary messages from poll()
+     * @param callback Called with the reassembled payload, NUL terminated past len
+     * @param arg Passed to callback
+     */
+    void onMessage(ws_message_cb_t callback, void* arg = nullptr) {
+        _onMessage = callback;
+        _onMessageArg = arg;
+    }
+
+    /**
+     * Stream text and binary payloads instead of reassembling them, memory use
+     * then stays at WSS_RX_CHUNK whatever the message size and onMessage() is not called
+     * @param callback Called with each piece as it is read, nullptr to reassemble again
+     * @param arg Passed to callback
+     */
+    void onFragment(ws_fragment_cb_t callback, void* arg = nullptr) {
+        _onFragment = callback;
+        _onFragmentArg = arg;
     }
 
     void setAuthorization(const char* auth) {
@@ -18,136 +110,291 @@ public:
     }
 
     bool connect(const char* host, uint16_t port, const char* path = "/") {
+        expirePreconnect();
+        bool warm = _preconnected && this->host == host && this->port == port && client.connected();
+        _preconnected = false;
+
         this->host = host;
         this->port = port;
         this->path = path;
 
-        client.setInsecure(); // Skip certificate verification for demo
+        if (warm) {
+            _preconnectsUsed++;
+            ESP_LOGI("WSS", "Using connection opened %lu ms ago", millis() - _preconnectTime);
+        } else {
+            client.setInsecure(); // Skip certificate verification for demo
 
-        if (!client.connect(host, port)) {
-            ESP_LOGE("WSS", "Fail to connect to GPT");
-            return false;
+            if (!client.connect(host, port)) {
+                ESP_LOGE("WSS", "Fail to connect to GPT");
+                return false;
+            }
         }
 
         return performHandshake();
     }
 
+    /**
+     * Open the TLS connection before it is needed, e.g. when the VAD reports
+     * speech, so connect() only has to send the upgrade
+     * @param idleMs Budget after which an unused connection is closed again
+     * @param timeoutMs Limit for the TCP connect and for the TLS handshake each,
+     *                  shorter than connect() uses since nobody is waiting for this one
+     * @return true if a connection is open and waiting
+     */
+    bool preconnect(const char* host, uint16_t port, uint32_t idleMs = WSS_PRECONNECT_IDLE_MS,
+        uint32_t timeoutMs = WSS_PRECONNECT_TIMEOUT_MS) {
+        if (connected) return false;
+        if (_preconnected && this->host == host && this->port == port && client.connected()) {
+            // Still speech, keep the one we have a little longer
+            _preconnectTime = millis();
+            _preconnectBudget = idleMs;
+            return true;
+        }
+        expirePreconnect();
+
+        client.setInsecure();
+        client.setHandshakeTimeout((timeoutMs + 999) / 1000);
+        bool ok = client.connect(host, port, (int32_t)timeoutMs);
+        client.setHandshakeTimeout(WSS_HANDSHAKE_TIMEOUT_S);
+        if (!ok) {
+            ESP_LOGW("WSS", "Preconnect to %s gave up within %lu ms", host, timeoutMs);
+            return false;
+        }
+        this->host = host;
+        this->port = port;
+        _preconnected = true;
+        _preconnectTime = millis();
+        _preconnectBudget = idleMs;
+        return true;
+    }
+
+    /**
+     * Close a pre-opened connection whose budget ran out, call it periodically
+     */
+    void expirePreconnect() {
+        if (!_preconnected) return;
+        if (millis() - _preconnectTime < _preconnectBudget && client.connected()) return;
+        client.stop();
+        _preconnected = false;
+        _preconnectsExpired++;
+    }
+
+    inline uint32_t preconnectsUsed() const { return _preconnectsUsed; }
+    inline uint32_t preconnectsExpired() const { return _preconnectsExpired; }
+
     void disconnect() {
         if (connected) {
             client.stop();
             connected = false;
         }
+        resetReceive();
     }
 
     bool sendMessage(const String& message) {
-        if (!connected) return false;
+        return sendFrame((const uint8_t*)message.c_str(), message.length(), WS_OPCODE_TEXT);
+    }
+
+    bool sendBinary(const uint8_t* data, size_t len) {
+        return sendFrame(data, len, WS_OPCODE_BINARY);
+    }
+
+    bool sendFrame(const uint8_t* data, size_t len, uint8_t opcode) {
+        WsSlice slice = {data, len};
+        return sendFrame(&slice, 1, opcode);
+    }
+
+    /**
+     * Send one frame whose payload is the concatenation of several buffers
+     * @param slices Payload pieces, in order
+     * @param count Number of pieces
+     * @param opcode WS_OPCODE_TEXT, WS_OPCODE_BINARY, ...
+     */
+    bool sendFrame(const WsSlice* slices, size_t count, uint8_t opcode) {
+        size_t len = 0;
+        for (size_t i = 0; i < count; i++) len += slices[i].len;
+        if (!beginFrame(len, opcode)) return false;
+        for (size_t i = 0; i < count; i++) {
+            if (!write(slices[i].data, slices[i].len)) return false;
+        }
+        return endFrame();
+    }
 
-        size_t len = message.length();
-        uint8_t frame[message.length() + 14]; // Max header size with mask
-        frame[0] = 0x81; // Text frame
+    /**
+     * Start a frame of a known payload length, the payload follows through write()
+     * and is masked into a small reusable buffer instead of being copied whole
+     * @param len Total payload bytes that will be written
+     * @param opcode WS_OPCODE_TEXT, WS_OPCODE_BINARY, ...
+     * @param fin false when more continuation frames follow
+     */
+    bool beginFrame(size_t len, uint8_t opcode = WS_OPCODE_TEXT, bool fin = true) {
+        if (!connected) return false;
+        if (_inFrame) {
+            ESP_LOGE("WSS", "Frame started before the previous one ended");
+            return false;
+        }
+        if (!_tx) {
+            _tx = (uint8_t*)heap_caps_malloc(WSS_TX_HEADROOM + WSS_TX_BUFFER_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+            if (!_tx) {
+                ESP_LOGE("WSS", "Failed to allocate TX buffer");
+                return false;
+            }
+        }
 
-        size_t headerSize = 6; // 2 + 4 mask
+        // The header ends where the payload starts, at a word boundary of the buffer
+        uint8_t header[14];
+        size_t headerSize = 2;
+        header[0] = (fin ? 0x80 : 0x00) | (opcode & 0x0F);
         if (len < 126) {
-            frame[1] = len | 0x80; // Set MASK bit
+            header[1] = len | 0x80; // Set MASK bit
         } else if (len <= 65535) {
-            frame[1] = 126 | 0x80;
-            frame[2] = (len >> 8) & 0xFF;
-            frame[3] = len & 0xFF;
-            headerSize = 8;
+            header[1] = 126 | 0x80;
+            header[2] = (len >> 8) & 0xFF;
+            header[3] = len & 0xFF;
+            headerSize = 4;
         } else {
-            frame[1] = 127 | 0x80;
-            frame[2] = 0; frame[3] = 0; frame[4] = 0; frame[5] = 0;
-            frame[6] = (len >> 24) & 0xFF;
-            frame[7] = (len >> 16) & 0xFF;
-            frame[8] = (len >> 8) & 0xFF;
-            frame[9] = len & 0xFF;
-            headerSize = 14;
+            header[1] = 127 | 0x80;
+            uint64_t len64 = len;
+            for (int i = 0; i < 8; i++) {
+                header[2 + i] = (len64 >> (56 - i * 8)) & 0xFF;
+            }
+            headerSize = 10;
         }
 
         // Generate random mask key
-        uint8_t maskKey[4];
         for (int i = 0; i < 4; i++) {
-            maskKey[i] = random(0, 256);
+            _maskKey[i] = random(0, 256);
         }
-        memcpy(&frame[headerSize - 4], maskKey, 4);
+        memcpy(&header[headerSize], _maskKey, 4);
+        headerSize += 4;
+
+        _txStart = WSS_TX_HEADROOM - headerSize;
+        memcpy(_tx + _txStart, header, headerSize);
+        _txPos = WSS_TX_HEADROOM;
+        _frameLeft = len;
+        _inFrame = true;
+        return true;
+    }
 
-        // Copy and mask payload
-        uint8_t* payload = &frame[headerSize];
-        memcpy(payload, message.c_str(), len);
-        for (size_t i = 0; i < len; i++) {
-            payload[i] ^= maskKey[i % 4];
+    /**
+     * Append payload bytes to the current frame
+     * @return false if the socket failed or more than the announced length was written
+     */
+    bool write(const uint8_t* data, size_t len) {
+        if (!_inFrame) return false;
+        if (len > _frameLeft) {
+            ESP_LOGE("WSS", "Frame payload longer than announced: %d > %d", len, _frameLeft);
+            abortFrame();
+            return false;
         }
 
-        client.write(frame, headerSize + len);
+        while (len > 0) {
+            size_t room = WSS_TX_HEADROOM + WSS_TX_BUFFER_SIZE - _txPos;
+            size_t n = len < room ? len : room;
+            memcpy(_tx + _txPos, data, n);
+            mask(_txPos, n);
+            _txPos += n;
+            _frameLeft -= n;
+            data += n;
+            len -= n;
+            if (_txPos == WSS_TX_HEADROOM + WSS_TX_BUFFER_SIZE && !flush()) return false;
+        }
         return true;
     }
 
-    uint8_t* receiveMessage() {
-        if (!connected || !client.available()) return nullptr;
-
-        uint8_t header[2];
-        client.readBytes(header, 2);
-
-        uint8_t opcode = header[0] & 0x0F;
-        uint8_t lenByte = header[1] & 0x7F;
-        bool masked = (header[1] & 0x80) != 0;
-        size_t len = lenByte;
+    bool write(const char* data, size_t len) {
+        return write((const uint8_t*)data, len);
+    }
 
-        if (lenByte == 126) {
-            uint8_t ext[2];
-            client.readBytes(ext, 2);
-            len = (ext[0] << 8) | ext[1];
-        } else if (lenByte == 127) {
-            uint8_t ext[8];
-            client.readBytes(ext, 8);
-            len = 0;
-            for (int i = 0; i < 8; i++) {
-                len = (len << 8) | ext[i];
-            }
+    /**
+     * Send what is left of the current frame
+     * @return false if fewer bytes than announced were written, the connection is then closed
+     */
+    bool endFrame() {
+        if (!_inFrame) return false;
+        if (_frameLeft > 0) {
+            ESP_LOGE("WSS", "Frame ended %d bytes short", _frameLeft);
+            abortFrame();
+            return false;
         }
+        bool ok = flush();
+        _inFrame = false;
+        if (ok && _pongPending) sendPong();
+        return ok;
+    }
 
-        uint8_t maskKey[4] = {0};
-        if (masked) {
-            client.readBytes(maskKey, 4);
+    /**
+     * Consume whatever the socket already holds, never waits for more.
+     * Pings are answered, a close is echoed and ends the connection.
+     * @return true if a complete text or binary message was delivered, it stays
+     *         available through messageData() until the next call
+     */
+    bool poll() {
+        if (!connected) return false;
+        if (_rxDelivered) {
+            // The previous message was handed out, its buffer may be reused now
+            _rxDelivered = false;
+            _rxLen = 0;
         }
 
-        if (opcode != 1) return nullptr; // Not text
-
-        uint8_t* message = (uint8_t*) heap_caps_malloc(len+1, MALLOC_CAP_SPIRAM);
-        size_t read = 0;
-        size_t length = len-1;
-        unsigned long startTime = millis();
-        while(len > 0) {
-            if (millis() - startTime > 5000) {
+        while (connected) {
+            int available = client.available();
+            if (available <= 0) return false;
+
+            switch (_rxState) {
+            case RX_HEADER:
+            case RX_EXTENDED: {
+                int n = client.read(_rxHeader + _rxHave, _rxNeed - _rxHave);
+                if (n <= 0) return false;
+                _rxHave += n;
+                if (_rxHave == _rxNeed) {
+                    if (!parseHeader()) return false;
+                    if (_rxState == RX_PAYLOAD && _rxFrameLen == 0 && endOfFrame()) return true;
+                }
                 break;
             }
-            if (!client.available()) {
-                delay(1);
-                continue;
-            }
-            int c = client.read(message+read, len - read);
-            if (c > 0) {
-                read+=c;
-                len-=c;
-                startTime = millis();
-            } else {
+            case RX_PAYLOAD: {
+                bool control = _rxFrameOpcode >= WS_OPCODE_CLOSE;
+                bool streamed = !control && _onFragment;
+                uint8_t* dst = control ? _rxControl + _rxFramePos : streamed ? _rx : _rx + _rxLen + _rxFramePos;
+                size_t left = _rxFrameLen - _rxFramePos;
+                size_t n = (size_t)available < left ? available : left;
+                if (streamed && n > WSS_RX_CHUNK) n = WSS_RX_CHUNK;
+                int got = client.read(dst, n);
+                if (got <= 0) return false;
+                if (_rxMasked) {
+                    for (int i = 0; i < got; i++) dst[i] ^= _rxMaskKey[(_rxFramePos + i) & 3];
+                }
+                _rxFramePos += got;
+                if (streamed) {
+                    _onFragment(_rxOpcode, dst, got, _rxFirst, false, _onFragmentArg);
+                    _rxFirst = false;
+                }
+                if (_rxFramePos == _rxFrameLen && endOfFrame()) return true;
                 break;
             }
-            taskYIELD();
+            }
         }
+        return false;
+    }
 
-        if (length != read){ 
-            ESP_LOGE("WSS", "not match. content-length=%d read=%d", length, read);
-            heap_caps_free(message);
-            return nullptr;
-        }
+    inline const uint8_t* messageData() const { return _rx; }
+    inline size_t messageLength() const { return _rxDelivered ? _rxLen : 0; }
+    inline uint8_t messageOpcode() const { return _rxDeliveredOpcode; }
 
-        if (masked) {
-            for(int i=0; i<read; i++)
-                message[i] ^= maskKey[i % 4];
-        }
+    /**
+     * Poll once for a text message
+     * @return NUL terminated copy the caller frees with heap_caps_free, nullptr if none is complete yet
+     */
+    uint8_t* receiveMessage() {
+        if (!poll() || _rxDeliveredOpcode != WS_OPCODE_TEXT) return nullptr;
 
-        message[len+1] = '\0';
+        uint8_t* message = (uint8_t*) heap_caps_malloc(_rxLen + 1, MALLOC_CAP_SPIRAM);
+        if (!message) {
+            ESP_LOGE("WSS", "Failed to allocate %d bytes for a message", _rxLen + 1);
+            return nullptr;
+        }
+        memcpy(message, _rx, _rxLen);
+        message[_rxLen] = '\0';
         return message;
     }
 
@@ -156,17 +403,244 @@ public:
     }
 
 private:
-    WiFiClientSecure client;
+    WssTransport client;
     String host;
     uint16_t port;
     String path;
     const char* _auth;
     bool connected;
 
-    struct headers {
+    bool _preconnected = false;
+    unsigned long _preconnectTime = 0;
+    uint32_t _preconnectBudget = 0;
+    uint32_t _preconnectsUsed = 0;
+    uint32_t _preconnectsExpired = 0;
 
+    enum RX_STATE {
+        RX_HEADER = 0, // First two bytes
+        RX_EXTENDED,   // Extended length and mask key
+        RX_PAYLOAD
     };
 
+    uint8_t* _rx;
+    size_t _rxCapacity;
+    size_t _rxLen;           // Reassembled payload of the current message
+    uint8_t _rxOpcode;       // Opcode of the message being reassembled, 0 when none
+    bool _rxDelivered;
+    uint8_t _rxDeliveredOpcode;
+    RX_STATE _rxState;
+    uint8_t _rxHeader[14];
+    size_t _rxHave;
+    size_t _rxNeed;
+    uint8_t _rxFrameOpcode;
+    bool _rxFin;
+    bool _rxMasked;
+    uint8_t _rxMaskKey[4];
+    size_t _rxFrameLen;
+    size_t _rxFramePos;
+    uint8_t _rxControl[125];
+    ws_message_cb_t _onMessage;
+    void* _onMessageArg;
+    ws_fragment_cb_t _onFragment;
+    void* _onFragmentArg;
+    bool _rxFirst;
+    bool _pongPending;
+    uint8_t _pongPayload[125];
+    size_t _pongLen;
+
+    inline void resetReceive() {
+        _rxLen = 0;
+        _rxOpcode = 0;
+        _rxFirst = false;
+        _rxDelivered = false;
+        _rxDeliveredOpcode = 0;
+        _rxState = RX_HEADER;
+        _rxHave = 0;
+        _rxNeed = 2;
+        _pongPending = false;
+    }
+
+    // All _rxNeed header bytes are in, work out what follows
+    bool parseHeader() {
+        if (_rxState == RX_HEADER) {
+            _rxFin = (_rxHeader[0] & 0x80) != 0;
+            _rxFrameOpcode = _rxHeader[0] & 0x0F;
+            _rxMasked = (_rxHeader[1] & 0x80) != 0;
+            uint8_t lenByte = _rxHeader[1] & 0x7F;
+            size_t extra = (lenByte == 126 ? 2 : lenByte == 127 ? 8 : 0) + (_rxMasked ? 4 : 0);
+            if (extra > 0) {
+                _rxState = RX_EXTENDED;
+                _rxNeed += extra;
+                return true;
+            }
+        }
+
+        uint8_t lenByte = _rxHeader[1] & 0x7F;
+        uint64_t len = lenByte;
+        size_t pos = 2;
+        if (lenByte == 126) {
+            len = (_rxHeader[2] << 8) | _rxHeader[3];
+            pos = 4;
+        } else if (lenByte == 127) {
+            len = 0;
+            for (int i = 0; i < 8; i++) {
+                len = (len << 8) | _rxHeader[2 + i];
+            }
+            pos = 10;
+        }
+        if (_rxMasked) memcpy(_rxMaskKey, _rxHeader + pos, 4);
+
+        bool control = _rxFrameOpcode >= WS_OPCODE_CLOSE;
+        if (control) {
+            if (!_rxFin || len > sizeof(_rxControl)) return protocolError(1002, "invalid control frame");
+        } else if (_rxFrameOpcode == WS_OPCODE_CONTINUATION) {
+            if (_rxOpcode == 0) return protocolError(1002, "continuation without a message");
+        } else if (_rxFrameOpcode == WS_OPCODE_TEXT || _rxFrameOpcode == WS_OPCODE_BINARY) {
+            if (_rxOpcode != 0) return protocolError(1002, "new message inside a fragmented one");
+            _rxOpcode = _rxFrameOpcode;
+            _rxFirst = true;
+        } else {
+            return protocolError(1002, "unknown opcode");
+        }
+
+        if (!control && _onFragment) {
+            if (!reserve(WSS_RX_CHUNK)) return protocolError(1009, "out of memory");
+        } else if (!control) {
+            if (_rxLen + len > WSS_RX_MAX_MESSAGE) return protocolError(1009, "message too big");
+            if (!reserve(_rxLen + len + 1)) return protocolError(1009, "out of memory");
+        }
+
+        _rxFrameLen = len;
+        _rxFramePos = 0;
+        _rxState = RX_PAYLOAD;
+        return true;
+    }
+
+    /**
+     * A frame's payload is complete
+     * @return true if that completed a data message
+     */
+    bool endOfFrame() {
+        _rxState = RX_HEADER;
+        _rxHave = 0;
+        _rxNeed = 2;
+
+        switch (_rxFrameOpcode) {
+        case WS_OPCODE_PING:
+            memcpy(_pongPayload, _rxControl, _rxFrameLen);
+            _pongLen = _rxFrameLen;
+            _pongPending = true;
+            if (!_inFrame) sendPong();
+            return false;
+        case WS_OPCODE_PONG:
+            return false;
+        case WS_OPCODE_CLOSE: {
+            uint16_t code = _rxFrameLen >= 2 ? (_rxControl[0] << 8) | _rxControl[1] : 1005;
+            ESP_LOGI("WSS", "Server closed the connection: %d", code);
+            if (!_inFrame) sendFrame(_rxControl, _rxFrameLen >= 2 ? 2 : 0, WS_OPCODE_CLOSE);
+            disconnect();
+            return false;
+        }
+        default:
+            break;
+        }
+
+        if (_onFragment) {
+            if (!_rxFin) return false;
+            _onFragment(_rxOpcode, _rx, 0, _rxFirst, true, _onFragmentArg);
+            _rxDelivered = true;
+            _rxDeliveredOpcode = _rxOpcode;
+            _rxOpcode = 0;
+            return true;
+        }
+
+        _rxLen += _rxFrameLen;
+        if (!_rxFin) return false;
+
+        _rx[_rxLen] = '\0';
+        _rxDelivered = true;
+        _rxDeliveredOpcode = _rxOpcode;
+        _rxOpcode = 0;
+        if (_onMessage) _onMessage(_rxDeliveredOpcode, _rx, _rxLen, _onMessageArg);
+        return true;
+    }
+
+    bool reserve(size_t size) {
+        if (size <= _rxCapacity) return true;
+        size_t capacity = _rxCapacity ? _rxCapacity : 1024;
+        while (capacity < size) capacity *= 2;
+        uint8_t* rx = (uint8_t*)heap_caps_realloc(_rx, capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+        if (!rx) return false;
+        _rx = rx;
+        _rxCapacity = capacity;
+        return true;
+    }
+
+    void sendPong() {
+        _pongPending = false;
+        sendFrame(_pongPayload, _pongLen, WS_OPCODE_PONG);
+    }
+
+    bool protocolError(uint16_t code, const char* reason) {
+        ESP_LOGE("WSS", "Closing connection: %s", reason);
+        if (!_inFrame) {
+            uint8_t payload[2] = {(uint8_t)(code >> 8), (uint8_t)(code & 0xFF)};
+            sendFrame(payload, 2, WS_OPCODE_CLOSE);
+        }
+        disconnect();
+        return false;
+    }
+
+    // Room for the longest header in front of the payload, keeps payload words aligned
+    static const size_t WSS_TX_HEADROOM = 16;
+
+    uint8_t* _tx;
+    size_t _txPos;
+    size_t _txStart;
+    size_t _frameLeft;
+    bool _inFrame;
+    uint8_t _maskKey[4];
+
+    // Payload byte i sits at buffer offset i (mod 4), so whole words take the key as is
+    inline void mask(size_t pos, size_t len) {
+        uint8_t* p = _tx + pos;
+        while (len > 0 && ((uintptr_t)p & 3)) {
+            *p++ ^= _maskKey[pos++ & 3];
+            len--;
+        }
+        uint32_t key;
+        memcpy(&key, _maskKey, 4);
+        uint32_t* words = (uint32_t*)p;
+        size_t count = len >> 2;
+        for (size_t i = 0; i < count; i++) {
+            words[i] ^= key;
+        }
+        p += count << 2;
+        pos += count << 2;
+        for (len &= 3; len > 0; len--) {
+            *p++ ^= _maskKey[pos++ & 3];
+        }
+    }
+
+    inline bool flush() {
+        size_t size = _txPos - _txStart;
+        if (size > 0 && client.write(_tx + _txStart, size) != size) {
+            ESP_LOGE("WSS", "Socket write failed");
+            abortFrame();
+            return false;
+        }
+        _txStart = 0;
+        _txPos = 0;
+        return true;
+    }
+
+    // A partly sent frame cannot be recovered, drop the connection
+    inline void abortFrame() {
+        _inFrame = false;
+        _frameLeft = 0;
+        disconnect();
+    }
+
     bool performHandshake() {
         String key = generateKey();
         String request = "GET " + path + " HTTP/1.1\r\n";
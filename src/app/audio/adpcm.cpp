@@ -0,0 +1,101 @@
+#include "adpcm.h"
+
+namespace {
+
+const int16_t STEP_TABLE[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+const int8_t INDEX_TABLE[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+inline int32_t clampSample(int32_t value) {
+    if (value > 32767) return 32767;
+    if (value < -32768) return -32768;
+    return value;
+}
+
+inline int32_t clampIndex(int32_t index) {
+    if (index < 0) return 0;
+    if (index > 88) return 88;
+    return index;
+}
+
+// Apply one nibble to the predictor, shared by both directions so they never drift apart
+inline void step(uint8_t code, int32_t& predictor, int32_t& index) {
+    int32_t s = STEP_TABLE[index];
+    int32_t diff = s >> 3;
+    if (code & 4) diff += s;
+    if (code & 2) diff += s >> 1;
+    if (code & 1) diff += s >> 2;
+    predictor = clampSample((code & 8) ? predictor - diff : predictor + diff);
+    index = clampIndex(index + INDEX_TABLE[code]);
+}
+
+inline uint8_t encodeSample(int32_t sample, int32_t& predictor, int32_t& index) {
+    int32_t s = STEP_TABLE[index];
+    int32_t diff = sample - predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= s) { code |= 4; diff -= s; }
+    s >>= 1;
+    if (diff >= s) { code |= 2; diff -= s; }
+    s >>= 1;
+    if (diff >= s) { code |= 1; }
+
+    step(code, predictor, index);
+    return code;
+}
+
+} // namespace
+
+size_t ImaAdpcm::encode(const int16_t* in, size_t samples, uint8_t* out, State& state) {
+    if (!in || !out || samples == 0) return 0;
+
+    int32_t predictor = state.predictor;
+    int32_t index = clampIndex(state.index);
+
+    size_t pairs = samples / 2;
+    for (size_t i = 0; i < pairs; i++) {
+        uint8_t lo = encodeSample(in[2 * i], predictor, index);
+        uint8_t hi = encodeSample(in[2 * i + 1], predictor, index);
+        out[i] = lo | (hi << 4);
+    }
+    if (samples & 1) {
+        out[pairs] = encodeSample(in[samples - 1], predictor, index);
+    }
+
+    state.predictor = (int16_t)predictor;
+    state.index = (uint8_t)index;
+    return encodedSize(samples);
+}
+
+size_t ImaAdpcm::decode(const uint8_t* in, size_t samples, int16_t* out, State& state) {
+    if (!in || !out || samples == 0) return 0;
+
+    int32_t predictor = state.predictor;
+    int32_t index = clampIndex(state.index);
+
+    for (size_t i = 0; i < samples; i++) {
+        uint8_t code = (i & 1) ? (in[i >> 1] >> 4) : (in[i >> 1] & 0x0F);
+        step(code, predictor, index);
+        out[i] = (int16_t)predictor;
+    }
+
+    state.predictor = (int16_t)predictor;
+    state.index = (uint8_t)index;
+    return samples;
+}
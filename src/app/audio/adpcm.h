@@ -0,0 +1,52 @@
+#ifndef IMA_ADPCM_H
+#define IMA_ADPCM_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * IMA/DVI ADPCM, 4 bits per int16 sample.
+ *
+ * Nibbles are packed low nibble first, as in IMA ADPCM WAV files. The codec
+ * state is carried across calls so a stream can be encoded chunk by chunk;
+ * a decoder that starts from the state the encoder had before a chunk
+ * reproduces that chunk on its own.
+ */
+class ImaAdpcm {
+public:
+    struct State {
+        int16_t predictor;
+        uint8_t index;
+    };
+
+    static State initialState() { return State{0, 0}; }
+
+    /**
+     * Bytes needed to encode a number of samples
+     */
+    static size_t encodedSize(size_t samples) { return (samples + 1) / 2; }
+
+    /**
+     * Encode samples
+     *
+     * @param in Input samples
+     * @param samples Number of samples
+     * @param out Receives encodedSize(samples) bytes, an odd count leaves the last high nibble zero
+     * @param state Codec state, updated
+     * @return Number of bytes written
+     */
+    static size_t encode(const int16_t* in, size_t samples, uint8_t* out, State& state);
+
+    /**
+     * Decode samples
+     *
+     * @param in Encoded bytes
+     * @param samples Number of samples to decode, in holds encodedSize(samples) bytes
+     * @param out Receives samples
+     * @param state Codec state, updated
+     * @return Number of samples written
+     */
+    static size_t decode(const uint8_t* in, size_t samples, int16_t* out, State& state);
+};
+
+#endif // IMA_ADPCM_H
@@ -0,0 +1,137 @@
+#pragma once
+#include <Arduino.h>
+#include <csr.h>
+#include "pcmring.h"
+
+/**
+ * History of AFE output (AEC/NS processed, 16kHz mono) with per-frame VAD
+ *
+ * Frames are appended by the SR detect task through setAfeTap(). Audio goes
+ * into a PcmRing so every reader keeps its own cursor, frame metadata lives
+ * in a parallel ring indexed by stream position.
+ */
+class AfeTap {
+public:
+	struct FrameInfo {
+		vad_state_t vad;
+		unsigned long timestamp;
+	};
+
+	class Reader {
+	public:
+		Reader(): _tap(nullptr) {}
+
+		/**
+		 * Copy samples from at most one AFE frame
+		 * @param out Destination buffer
+		 * @param maxSamples Capacity of out in samples
+		 * @param info Optional, receives VAD state and capture time of that frame
+		 * @return Number of samples copied
+		 */
+		inline size_t read(int16_t* out, size_t maxSamples, FrameInfo* info = nullptr) {
+			if (!_tap) return 0;
+
+			// Stop at the frame boundary so one VAD state covers the whole chunk
+			size_t frame = _tap->_frameSamples;
+			size_t left = frame - (_pcm.position() % frame);
+			if (maxSamples > left) maxSamples = left;
+
+			size_t count = _pcm.read(out, maxSamples);
+			if (count > 0 && info) {
+				*info = _tap->frameAt(_pcm.position() - count);
+			}
+			return count;
+		}
+
+		inline bool wait(TickType_t timeout, size_t minSamples = 1) { return _pcm.wait(timeout, minSamples); }
+		inline size_t available() const { return _pcm.available(); }
+		inline void sync() { _pcm.sync(); }
+		inline size_t rewind(size_t samples) { return _pcm.rewind(samples); }
+		inline bool attached() const { return _tap != nullptr; }
+		inline uint32_t overruns() const { return _pcm.overruns(); }
+		inline uint32_t dropped() const { return _pcm.dropped(); }
+		inline uint32_t position() const { return _pcm.position(); }
+
+	private:
+		friend class AfeTap;
+		AfeTap* _tap;
+		PcmRing::Reader _pcm;
+	};
+
+	AfeTap(): _frameSamples(0), _frames(nullptr), _frameCount(0) {}
+	~AfeTap() {
+		if (_frames) heap_caps_free(_frames);
+	}
+
+	/**
+	 * Allocate the history once
+	 * @param frameSamples AFE fetch chunk size in samples
+	 * @param historySamples Minimum history to keep in samples
+	 * @return true if ready
+	 */
+	inline bool init(size_t frameSamples, size_t historySamples) {
+		if (_frames) return true;
+		if (frameSamples == 0 || !_ring.init(historySamples)) return false;
+
+		_frameSamples = frameSamples;
+		_frameCount = _ring.capacity() / frameSamples + 2;
+		_frames = (FrameInfo*)heap_caps_calloc(_frameCount, sizeof(FrameInfo), MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+		if (!_frames) {
+			ESP_LOGE("AfeTap", "Failed to allocate frame info");
+			return false;
+		}
+
+		ESP_LOGI("AfeTap", "AFE tap ready: %d samples/frame, %d samples history", _frameSamples, _ring.capacity());
+		return true;
+	}
+
+	/**
+	 * Append one fetched AFE frame, only called from the SR detect task
+	 */
+	inline void push(const int16_t* data, size_t samples, vad_state_t vad) {
+		if (!_frames || !data || samples == 0) return;
+
+		// Metadata first, the ring's release store publishes both
+		FrameInfo& info = _frames[frameIndex(_ring.written())];
+		info.vad = vad;
+		info.timestamp = millis();
+		_ring.write(data, samples);
+	}
+
+	/**
+	 * Create a reader positioned at the newest frame
+	 */
+	inline Reader reader() {
+		Reader r;
+		r._tap = this;
+		r._pcm = _ring.reader();
+		return r;
+	}
+
+	inline size_t frameSamples() const { return _frameSamples; }
+	inline uint32_t position() const { return _ring.written(); }
+	inline bool isReady() const { return _frames != nullptr; }
+
+	/**
+	 * Callback for setAfeTap()
+	 */
+	static void afeCallback(const int16_t* data, size_t samples, vad_state_t vad, void* arg) {
+		static_cast<AfeTap*>(arg)->push(data, samples, vad);
+	}
+
+private:
+	PcmRing _ring;
+	size_t _frameSamples;
+	FrameInfo* _frames;
+	size_t _frameCount;
+
+	inline size_t frameIndex(uint32_t position) const {
+		return (position / _frameSamples) % _frameCount;
+	}
+
+	inline FrameInfo frameAt(uint32_t position) const {
+		return _frames[frameIndex(position)];
+	}
+};
+
+extern AfeTap afeTap;
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "adpcm.h"
+
+#define AUDIO_PACKET_MAGIC "PAUD"
+#define AUDIO_PACKET_VERSION 2
+
+enum AUDIO_PACKET_CODEC : uint8_t {
+	AUDIO_PACKET_CODEC_PCM16 = 0,
+	AUDIO_PACKET_CODEC_IMA_ADPCM = 1
+};
+
+/**
+ * Header between the key and the audio, little-endian.
+ * ADPCM chunks carry the codec state they start from, so every chunk
+ * decodes on its own and a lost chunk only costs its own samples.
+ * The magic, header size and CRC together keep raw PCM from older
+ * firmware from being mistaken for a header. The server side parses it
+ * in external/app/internal/domain/audio_packet.go, both test against the
+ * same golden bytes.
+ */
+struct __attribute__((packed)) AudioPacketHeader {
+	char magic[4];
+	uint8_t version;
+	uint8_t headerSize;
+	uint8_t codec;
+	uint8_t stepIndex;
+	uint16_t sequence;
+	uint16_t samples;
+	int16_t predictor;
+	uint16_t crc;         // CRC-16/CCITT-FALSE of the bytes before it
+};
+
+static_assert(sizeof(AudioPacketHeader) == 16, "AudioPacketHeader must stay packed");
+
+inline uint16_t crc16Ccitt(const uint8_t* data, size_t size) {
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < size; i++) {
+		crc ^= (uint16_t)data[i] << 8;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+/**
+ * Build the header of one chunk
+ * @param codec AUDIO_PACKET_CODEC
+ * @param sequence Chunk number within the stream
+ * @param samples Samples in the chunk
+ * @param state Codec state the chunk starts from, ignored by PCM16 decoders
+ */
+inline AudioPacketHeader audioPacketHeader(uint8_t codec, uint16_t sequence, uint16_t samples, const ImaAdpcm::State& state) {
+	AudioPacketHeader header = {
+		.magic = {AUDIO_PACKET_MAGIC[0], AUDIO_PACKET_MAGIC[1], AUDIO_PACKET_MAGIC[2], AUDIO_PACKET_MAGIC[3]},
+		.version = AUDIO_PACKET_VERSION,
+		.headerSize = sizeof(AudioPacketHeader),
+		.codec = codec,
+		.stepIndex = state.index,
+		.sequence = sequence,
+		.samples = samples,
+		.predictor = state.predictor,
+		.crc = 0
+	};
+	header.crc = crc16Ccitt((const uint8_t*)&header, offsetof(AudioPacketHeader, crc));
+	return header;
+}
@@ -1,4 +1,5 @@
 #include "converter.h"
+#include "dsp.h"
 #include <cmath>
 #include <algorithm>
 #include <cstring>
@@ -26,7 +27,7 @@ int AudioBufferConverter::convert(uint32_t inputKhz, uint32_t outputKhz,
 
     // If same sample rate, just copy
     if (inputKhz == outputKhz) {
-        memcpy(bufferOut, bufferIn, lenIn * sizeof(int16_t));
+        AudioDsp::applyGain(bufferIn, bufferOut, lenIn, AudioDsp::gain(volume));
         return lenIn;
     }
 
@@ -46,9 +47,10 @@ int AudioBufferConverter::convert(uint32_t inputKhz, uint32_t outputKhz,
         // Linear interpolation
         float fraction = inputIndex - static_cast<float>(indexLow);
         bufferOut[i] = interpolate(bufferIn[indexLow], bufferIn[indexHigh], fraction);
-        if (volume != 1.0f) {
-            bufferOut[i] = std::max(-32768.0f, std::min(32767.0f, bufferOut[i] * volume));
-        }
+    }
+
+    if (volume != 1.0f) {
+        AudioDsp::applyGain(bufferOut, bufferOut, expectedOutputSize, AudioDsp::gain(volume));
     }
 
     return expectedOutputSize;
@@ -9,6 +9,9 @@ public:
     /**
      * Convert audio buffer from one sample rate to another using linear interpolation
      *
+     * Each call maps the buffer's endpoints onto each other, so it is only meant for
+     * standalone clips. Continuous streams should use AudioResampler instead.
+     *
      * @param inputKhz Input sample rate in kHz (e.g., 16 for 16kHz)
      * @param outputKhz Output sample rate in kHz (e.g., 24 for 24kHz)
      * @param bufferIn Input buffer (16-bit PCM samples)
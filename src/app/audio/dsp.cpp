@@ -0,0 +1,105 @@
+#include "dsp.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(ESP_PLATFORM) && defined(__has_include)
+#if __has_include(<dsps_mulc.h>)
+#include <dsps_mulc.h>
+#define AUDIO_DSP_HAS_ESP_DSP 1
+#endif
+#endif
+
+#ifndef AUDIO_DSP_HAS_ESP_DSP
+#define AUDIO_DSP_HAS_ESP_DSP 0
+#endif
+
+AudioDsp::Gain AudioDsp::gain(float value) {
+    if (!(value > 0.0f)) {
+        return Gain{0, 15};
+    }
+
+    // Largest shift that still fits the multiplier in int16
+    int shift = 15;
+    while (shift > 0 && value * (float)(1L << shift) > 32767.0f) {
+        --shift;
+    }
+
+    long mul = lroundf(value * (float)(1L << shift));
+    if (mul > 32767) mul = 32767;
+    return Gain{(int16_t)mul, (uint8_t)shift};
+}
+
+void AudioDsp::applyGain(const int16_t* in, int16_t* out, size_t samples, Gain g) {
+    if (!in || !out || samples == 0) return;
+
+    if (isUnity(g)) {
+        if (in != out) memmove(out, in, samples * sizeof(int16_t));
+        return;
+    }
+
+#if AUDIO_DSP_HAS_ESP_DSP
+    // esp-dsp computes (in * C) >> 15 only, so just pure Q15 attenuation goes
+    // to the SIMD kernel; it truncates where the scalar path rounds (1 LSB)
+    if (g.shift == 15) {
+        if (dsps_mulc_s16(in, out, (int)samples, g.mul, 1, 1) == ESP_OK) {
+            return;
+        }
+    }
+#endif
+
+    const int32_t mul = g.mul;
+    const uint8_t shift = g.shift;
+    const int32_t round = shift ? (1 << (shift - 1)) : 0;
+    for (size_t i = 0; i < samples; ++i) {
+        out[i] = saturate(((int32_t)in[i] * mul + round) >> shift);
+    }
+}
+
+void AudioDsp::mix(int16_t* dst, const int16_t* src, size_t samples, Gain g) {
+    if (!dst || !src || samples == 0 || g.mul == 0) return;
+
+    if (isUnity(g)) {
+        for (size_t i = 0; i < samples; ++i) {
+            dst[i] = saturate((int32_t)dst[i] + src[i]);
+        }
+        return;
+    }
+
+    const int32_t mul = g.mul;
+    const uint8_t shift = g.shift;
+    const int32_t round = shift ? (1 << (shift - 1)) : 0;
+    for (size_t i = 0; i < samples; ++i) {
+        dst[i] = saturate((int32_t)dst[i] + (((int32_t)src[i] * mul + round) >> shift));
+    }
+}
+
+size_t AudioDsp::stereoToMono(const int16_t* in, int16_t* out, size_t frames) {
+    if (!in || !out) return 0;
+
+    // Average never exceeds the int16 range, no saturation needed
+    for (size_t i = 0; i < frames; ++i) {
+        out[i] = (int16_t)(((int32_t)in[2 * i] + in[2 * i + 1]) >> 1);
+    }
+    return frames;
+}
+
+void AudioDsp::toInt32(const int16_t* in, int32_t* out, size_t samples, uint8_t shift) {
+    if (!in || !out) return;
+
+    // Walk backwards so an int16 buffer can be widened in place
+    for (size_t i = samples; i > 0; --i) {
+        out[i - 1] = (int32_t)in[i - 1] << shift;
+    }
+}
+
+void AudioDsp::toInt16(const int32_t* in, int16_t* out, size_t samples, uint8_t shift) {
+    if (!in || !out) return;
+
+    const int64_t round = shift ? ((int64_t)1 << (shift - 1)) : 0;
+    for (size_t i = 0; i < samples; ++i) {
+        int64_t value = ((int64_t)in[i] + round) >> shift;
+        if (value > 32767) value = 32767;
+        else if (value < -32768) value = -32768;
+        out[i] = (int16_t)value;
+    }
+}
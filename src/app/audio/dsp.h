@@ -0,0 +1,84 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Fixed-point int16 PCM kernels shared by the speaker, recorder, converter and MP3 paths.
+ *
+ * All kernels saturate instead of wrapping and accept in == out for in-place use.
+ * On ESP32-S3 builds with esp-dsp available, attenuating gains run on the
+ * optimized dsps_mulc_s16 kernel; everything else is a portable scalar path.
+ */
+class AudioDsp {
+public:
+    /**
+     * Fixed-point gain: value = mul / 2^shift
+     *
+     * The shift is chosen as large as possible so mul keeps 15 bits of precision,
+     * gains below 1.0 are plain Q15 (shift = 15), 15x is {30720, 11}.
+     */
+    struct Gain {
+        int16_t mul;
+        uint8_t shift;
+    };
+
+    /**
+     * Convert a float multiplier to a fixed-point gain
+     *
+     * @param value Multiplier (0.0 = silent, 1.0 = unity, > 1.0 amplifies and saturates)
+     * @return Gain usable by applyGain() and mix()
+     */
+    static Gain gain(float value);
+
+    static bool isUnity(Gain g) { return g.mul == (int32_t)(1L << g.shift); }
+
+    /**
+     * Multiply samples by a gain with saturation
+     *
+     * @param in Input samples
+     * @param out Output samples (may equal in)
+     * @param samples Number of samples
+     * @param g Gain from gain()
+     */
+    static void applyGain(const int16_t* in, int16_t* out, size_t samples, Gain g);
+
+    /**
+     * Mix a source into a destination with gain: dst = sat(dst + src * g)
+     *
+     * @param dst Accumulator samples, updated in place
+     * @param src Source samples
+     * @param samples Number of samples
+     * @param g Gain applied to src
+     */
+    static void mix(int16_t* dst, const int16_t* src, size_t samples, Gain g);
+
+    /**
+     * Average interleaved stereo frames down to mono
+     *
+     * @param in Interleaved L/R samples
+     * @param out Mono output (may equal in)
+     * @param frames Number of stereo frames (in holds frames * 2 samples)
+     * @return Number of mono samples written
+     */
+    static size_t stereoToMono(const int16_t* in, int16_t* out, size_t frames);
+
+    /**
+     * Widen int16 samples to int32, left-aligned by shift (16 = full-scale 32-bit)
+     */
+    static void toInt32(const int16_t* in, int32_t* out, size_t samples, uint8_t shift = 16);
+
+    /**
+     * Narrow int32 samples to int16 with rounding and saturation
+     */
+    static void toInt16(const int32_t* in, int16_t* out, size_t samples, uint8_t shift = 16);
+
+    static inline int16_t saturate(int32_t value) {
+        if (value > 32767) return 32767;
+        if (value < -32768) return -32768;
+        return (int16_t)value;
+    }
+};
+
+#endif // AUDIO_DSP_H
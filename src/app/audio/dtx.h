@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include <csr.h>
+
+/**
+ * Discontinuous transmission for the realtime uplink
+ *
+ * Every chunk read from the capture history is classified by its VAD
+ * state. Silence keeps being sent for the hangover, after that it is
+ * dropped. Since the VAD reports speech a little after it starts, the
+ * first speech chunk after suppression asks the caller to step the reader
+ * back by the onset padding and read again. The step lands on an AFE frame
+ * boundary, so replayed audio starts where a frame starts and every
+ * replayed chunk still carries one frame's VAD state.
+ */
+class UplinkDtx {
+public:
+	enum ACTION {
+		DTX_SEND = 0,  // Resample and send the chunk
+		DTX_SUPPRESS,  // Drop the chunk
+		DTX_REPLAY     // Rewind the reader by replaySamples() and read again
+	};
+
+	struct Config {
+		uint32_t hangoverSamples; // Silence still sent after speech
+		uint32_t onsetSamples;    // Padding replayed ahead of speech, less than the hangover
+		uint32_t frameSamples;    // AFE frame, replays start on one; 0 or 1 for unframed audio
+	};
+
+	UplinkDtx(): _config{19200, 3200, 512} { reset(); }
+
+	inline void init(const Config& config) {
+		_config = config;
+		if (_config.frameSamples == 0) _config.frameSamples = 1;
+		reset();
+	}
+
+	/**
+	 * Start a new session, nothing suppressed
+	 */
+	inline void reset() {
+		_suppressing = false;
+		_silenceRun = 0;
+		_replay = 0;
+	}
+
+	/**
+	 * Classify the chunk just read
+	 * @param vad VAD state of the chunk
+	 * @param samples Samples in the chunk
+	 * @param position Reader position after the chunk
+	 */
+	inline ACTION next(vad_state_t vad, size_t samples, uint32_t position) {
+		if (vad == VAD_SPEECH) {
+			_silenceRun = 0;
+			if (_suppressing) {
+				_suppressing = false;
+				// Back to the start of this chunk's frame, then whole frames covering the onset
+				uint32_t frame = _config.frameSamples;
+				uint32_t start = (position - samples) / frame * frame;
+				uint32_t onset = (_config.onsetSamples + frame - 1) / frame * frame;
+				start = start > onset ? start - onset : 0;
+				_replay = position - start;
+				return DTX_REPLAY;
+			}
+			return DTX_SEND;
+		}
+
+		_silenceRun += samples;
+		if (!_suppressing && _silenceRun >= _config.hangoverSamples) _suppressing = true;
+		return _suppressing ? DTX_SUPPRESS : DTX_SEND;
+	}
+
+	// Of the last DTX_REPLAY, includes the chunk that triggered it
+	inline size_t replaySamples() const { return _replay; }
+	inline bool suppressing() const { return _suppressing; }
+
+private:
+	Config _config;
+	bool _suppressing;
+	size_t _silenceRun;
+	size_t _replay;
+};
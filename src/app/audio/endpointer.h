@@ -0,0 +1,186 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+enum ENDPOINT_STATE {
+	ENDPOINT_STATE_WAITING = 0, // No speech yet, audio is only kept as pre-padding
+	ENDPOINT_STATE_SPEECH,      // Inside an utterance
+	ENDPOINT_STATE_TRAILING,    // Silence after speech, within the hangover
+	ENDPOINT_STATE_END          // Utterance finished, capture should stop
+};
+
+typedef void (*endpoint_sink_t)(const int16_t* samples, size_t count, void* arg);
+
+/**
+ * VAD endpointer for recorded utterances
+ *
+ * Fed frame by frame with the AFE VAD decision. Leading silence is held in a
+ * small pre-padding ring and only released when speech starts, silence after
+ * speech passes for postPadMs and is then held back the same way. Once silence
+ * lasts hangoverMs, or no speech arrives within noSpeechMs, the utterance ends.
+ * Pauses inside an utterance shrink to at most postPadMs + prePadMs.
+ */
+class Endpointer {
+public:
+	struct Config {
+		uint32_t sampleRate;
+		uint32_t hangoverMs;  // Silence that ends an utterance, 0 never ends on silence
+		uint32_t prePadMs;    // Audio kept before speech starts
+		uint32_t postPadMs;   // Audio kept after speech stops
+		uint32_t noSpeechMs;  // Give up when nothing was said, 0 waits forever
+	};
+
+	Endpointer(): _config{16000, 0, 0, 0, 0}, _pad(nullptr), _padCapacity(0), _prePad(0), _postPad(0), _hangover(0), _noSpeech(0) { reset(); }
+	~Endpointer() {
+		if (_pad) heap_caps_free(_pad);
+	}
+
+	/**
+	 * Apply a configuration and allocate the pre-padding ring once
+	 * @return true if ready
+	 */
+	inline bool init(const Config& config) {
+		size_t capacity = msToSamples(config.prePadMs, config.sampleRate);
+		if (capacity > _padCapacity) {
+			int16_t* pad = (int16_t*)heap_caps_realloc(_pad, capacity * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+			if (!pad) {
+				ESP_LOGE("Endpointer", "Failed to allocate %d samples of padding", capacity);
+				return false;
+			}
+			_pad = pad;
+			_padCapacity = capacity;
+		}
+		_config = config;
+		_prePad = capacity;
+		_postPad = msToSamples(config.postPadMs, config.sampleRate);
+		_hangover = msToSamples(config.hangoverMs, config.sampleRate);
+		_noSpeech = msToSamples(config.noSpeechMs, config.sampleRate);
+		reset();
+		return true;
+	}
+
+	/**
+	 * Start a new utterance
+	 */
+	inline void reset() {
+		_state = ENDPOINT_STATE_WAITING;
+		_padHead = 0;
+		_padCount = 0;
+		_silence = 0;
+		_total = 0;
+		_kept = 0;
+		_speechEnd = 0;
+	}
+
+	/**
+	 * Process one frame, kept audio goes to the sink in order
+	 * @param samples Frame samples
+	 * @param count Number of samples
+	 * @param speech VAD decision for this frame
+	 * @param sink Receives every sample that should be recorded
+	 * @param arg Passed to sink
+	 * @return State after this frame
+	 */
+	inline ENDPOINT_STATE process(const int16_t* samples, size_t count, bool speech, endpoint_sink_t sink, void* arg) {
+		if (_state == ENDPOINT_STATE_END || !samples || count == 0) return _state;
+		_total += count;
+
+		if (speech) {
+			if (_state != ENDPOINT_STATE_SPEECH) {
+				flushPad(sink, arg);
+				_state = ENDPOINT_STATE_SPEECH;
+			}
+			_silence = 0;
+			emit(samples, count, sink, arg);
+			_speechEnd = _total;
+			return _state;
+		}
+
+		if (_state == ENDPOINT_STATE_WAITING) {
+			hold(samples, count);
+			if (_noSpeech > 0 && _total >= _noSpeech) _state = ENDPOINT_STATE_END;
+			return _state;
+		}
+
+		// Silence after speech: pass the post-padding, hold the rest as pre-padding
+		_state = ENDPOINT_STATE_TRAILING;
+		if (_silence < _postPad) {
+			size_t n = _postPad - _silence;
+			if (n > count) n = count;
+			emit(samples, n, sink, arg);
+			if (n < count) hold(samples + n, count - n);
+		} else {
+			hold(samples, count);
+		}
+		_silence += count;
+
+		if (_hangover > 0 && _silence >= _hangover) _state = ENDPOINT_STATE_END;
+		return _state;
+	}
+
+	inline ENDPOINT_STATE state() const { return _state; }
+	inline bool heardSpeech() const { return _speechEnd > 0; }
+
+	// Samples seen, samples passed on
+	inline uint32_t totalSamples() const { return _total; }
+	inline uint32_t keptSamples() const { return _kept; }
+
+	/**
+	 * Milliseconds between the last speech frame and the most recent frame
+	 */
+	inline uint32_t sinceSpeechMs() const {
+		if (!_speechEnd) return 0;
+		return (uint32_t)((uint64_t)(_total - _speechEnd) * 1000 / _config.sampleRate);
+	}
+
+private:
+	Config _config;
+	int16_t* _pad;
+	size_t _padCapacity;
+	size_t _prePad;
+	size_t _padHead;
+	size_t _padCount;
+	size_t _postPad;
+	size_t _hangover;
+	size_t _noSpeech;
+	size_t _silence;
+	ENDPOINT_STATE _state;
+	uint32_t _total;
+	uint32_t _kept;
+	uint32_t _speechEnd;
+
+	static inline size_t msToSamples(uint32_t ms, uint32_t rate) {
+		return (size_t)((uint64_t)ms * rate / 1000);
+	}
+
+	inline void emit(const int16_t* samples, size_t count, endpoint_sink_t sink, void* arg) {
+		if (count == 0) return;
+		_kept += count;
+		if (sink) sink(samples, count, arg);
+	}
+
+	// Keep only the newest _prePad samples
+	inline void hold(const int16_t* samples, size_t count) {
+		if (_prePad == 0) return;
+		if (count >= _prePad) {
+			samples += count - _prePad;
+			count = _prePad;
+		}
+		for (size_t i = 0; i < count; i++) {
+			_pad[_padHead] = samples[i];
+			if (++_padHead == _prePad) _padHead = 0;
+		}
+		_padCount += count;
+		if (_padCount > _prePad) _padCount = _prePad;
+	}
+
+	inline void flushPad(endpoint_sink_t sink, void* arg) {
+		if (_padCount == 0) return;
+		size_t start = (_padHead + _prePad - _padCount) % _prePad;
+		size_t first = _prePad - start;
+		if (first > _padCount) first = _padCount;
+		emit(_pad + start, first, sink, arg);
+		emit(_pad, _padCount - first, sink, arg);
+		_padCount = 0;
+	}
+};
@@ -3,6 +3,7 @@
 #include <I2SMicrophone.h>
 #include <AnalogMicrophone.h>
 #include <PDMMicrophone.h>
+#include "pcmring.h"
 
 enum MIC_HW {
 	MIC_ANALOG = 0,
@@ -37,13 +38,11 @@ public:
 		}
 	}
 
-	struct Cache {
-		int16_t *lastSample = nullptr;
-		size_t lastSampleLen = 0;
-		unsigned long lastSampleTime = 0;
-	};
+	static const size_t RING_SAMPLES = 16000; // ~1s of 16kHz history shared by all readers
 
 	inline void init() {
+		_ring.init(RING_SAMPLES);
+
 		switch (this->micType) {
 		case MIC_ANALOG:
 			amic = new AnalogMicrophone(MIC_OUT, MIC_GAIN, MIC_AR);
@@ -126,19 +125,9 @@ public:
 			break;
 		}
 
-		if (lastSampleLen > 0 && lastSampleLen <= 16000) {
-			delete[] lastSample;
-			lastSample = nullptr;
-			lastSampleLen = 0;
-			lastSampleTime = 0;
-		}
-
-		if (*bytes_read == 0 || len > 16000) return ret;
-		lastSample = (int16_t*) heap_caps_malloc(len, MALLOC_CAP_SPIRAM);
-		if (lastSample) {
-			memcpy(lastSample, out, len);
-			lastSampleLen = len;
-			lastSampleTime = millis();
+		// Publish to every reader, the SR feed task is the only writer
+		if (ret == ESP_OK && *bytes_read > 0) {
+			_ring.write(reinterpret_cast<const int16_t*>(out), *bytes_read / sizeof(int16_t));
 		}
 
 		return ret;
@@ -166,8 +155,11 @@ public:
 		return 0;
 	}
 
-	inline Cache getCache() const {
-		return Cache{lastSample, lastSampleLen, lastSampleTime};
+	/**
+	 * Independent cursor over the captured stream, starting at the newest sample
+	 */
+	inline PcmRing::Reader reader() {
+		return _ring.reader();
 	}
 
 private:
@@ -175,9 +167,7 @@ private:
 	I2SMicrophone* imic;
 	AnalogMicrophone* amic;
 	PDMMicrophone* pmic;
-	int16_t* lastSample;
-	size_t lastSampleLen;
-	unsigned long lastSampleTime;
+	PcmRing _ring;
 };
 
 extern Microphone* microphone;
\ No newline at end of file
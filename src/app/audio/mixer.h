@@ -0,0 +1,492 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include "I2SSpeaker.h"
+#include "dsp.h"
+#include "resampler.h"
+
+enum AUDIO_CHANNEL {
+	AUDIO_CHANNEL_VOICE = 0,
+	AUDIO_CHANNEL_EARCON,
+	AUDIO_CHANNEL_MUSIC,
+	AUDIO_CHANNEL_MAX
+};
+
+/**
+ * One mixer input: a PSRAM jitter buffer with its own start watermark
+ *
+ * Producers copy PCM in and return, only the mixer task reads. Playback of
+ * a channel starts once it holds the watermark, re-buffers after an
+ * underrun and finishes quietly when drained. Sources at another rate
+ * than the output are resampled on the way in.
+ */
+class AudioChannel {
+public:
+	static const size_t SCRATCH_SAMPLES = 512;
+
+	struct Config {
+		size_t capacitySamples;
+		size_t startSamples;
+		float gain;
+		uint8_t priority; // Higher priority channels duck lower ones while playing
+		float duck;       // Gain factor applied while ducked
+	};
+
+	AudioChannel(): _buffer(nullptr), _capacity(0), _startSamples(0), _head(0), _tail(0),
+		_draining(false), _discard(false), _playing(false), _gain(1.0f), _level(1.0f), _priority(0), _duck(1.0f),
+		_underruns(0), _overruns(0), _dropped(0), _space(nullptr), _data(nullptr), _lock(nullptr),
+		_rate(0), _mark(0), _fenced(false), _scratch(nullptr) {}
+
+	/**
+	 * Allocate the jitter buffer once
+	 * @param config Channel configuration
+	 * @param data Mixer event group, DATA_BIT is raised on every write
+	 * @param rate Output sample rate
+	 * @return true if ready
+	 */
+	inline bool init(const Config& config, EventGroupHandle_t data, uint32_t rate) {
+		if (_buffer) return true;
+		_buffer = (int16_t*)heap_caps_malloc(config.capacitySamples * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+		_scratch = (int16_t*)heap_caps_malloc(SCRATCH_SAMPLES * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+		_space = xEventGroupCreate();
+		_lock = xSemaphoreCreateMutex();
+		if (!_buffer || !_scratch || !_space || !_lock || config.capacitySamples == 0) {
+			ESP_LOGE("AudioChannel", "Failed to allocate %d samples", config.capacitySamples);
+			return false;
+		}
+
+		_data = data;
+		_rate = rate;
+		_capacity = config.capacitySamples;
+		_startSamples = config.startSamples < _capacity ? config.startSamples : _capacity / 2;
+		_gain = _level = config.gain;
+		_priority = config.priority;
+		_duck = config.duck;
+		return true;
+	}
+
+	/**
+	 * Queue samples, may be called from several producer tasks
+	 * @param samples Input samples, left untouched
+	 * @param count Number of samples
+	 * @param gain Gain applied while queuing
+	 * @param timeout Ticks to wait for space when the buffer is full, 0 never blocks
+	 * @param rate Sample rate of samples, 0 when already at the output rate
+	 * @return Number of input samples queued, the rest is dropped and counted as overrun
+	 */
+	inline size_t write(const int16_t* samples, size_t count, AudioDsp::Gain gain, TickType_t timeout = 0, uint32_t rate = 0) {
+		if (!_buffer || !samples || count == 0) return 0;
+
+		xSemaphoreTake(_lock, portMAX_DELAY);
+		TickType_t start = xTaskGetTickCount();
+		size_t queued = 0;
+		if (rate == 0 || rate == _rate) {
+			queued = push(samples, count, gain, start, timeout);
+		} else {
+			if (!_resampler.isReady() || _resampler.inputRate() != rate || _resampler.outputRate() != _rate) {
+				_resampler.init(rate, _rate);
+			}
+			while (queued < count) {
+				size_t used = 0;
+				size_t out = _resampler.process(samples + queued, count - queued, _scratch, SCRATCH_SAMPLES, &used);
+				size_t pushed = push(_scratch, out, gain, start, timeout);
+				queued += used;
+				if (pushed < out) {
+					queued -= (out - pushed) * rate / _rate;
+					break;
+				}
+				if (used == 0) break;
+			}
+		}
+		xSemaphoreGive(_lock);
+
+		if (queued < count) {
+			_overruns++;
+			_dropped += count - queued;
+			ESP_LOGW("AudioChannel", "Overrun, dropped %d samples (total %u)", count - queued, _overruns);
+		}
+		return queued;
+	}
+
+	/**
+	 * End of stream: play what is buffered even below the watermark
+	 */
+	inline void drain() {
+		if (!_buffer) return;
+		_draining.store(true);
+		xEventGroupSetBits(_data, DATA_BIT);
+	}
+
+	/**
+	 * Drop everything still buffered
+	 */
+	inline void discard() {
+		if (!_buffer) return;
+		_discard.store(true);
+		xEventGroupSetBits(_data, DATA_BIT);
+	}
+
+	inline void setGain(float gain) { _gain = gain; }
+	inline float getGain() const { return _gain; }
+	inline size_t buffered() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+	inline bool isReady() const { return _buffer != nullptr; }
+	inline bool isPlaying() const { return _playing; }
+	inline uint8_t priority() const { return _priority; }
+	inline uint32_t underruns() const { return _underruns; }
+	inline uint32_t overruns() const { return _overruns; }
+	inline uint32_t dropped() const { return _dropped; }
+	inline uint32_t sampleRate() const { return _rate; }
+
+private:
+	friend class AudioMixer;
+	static const EventBits_t DATA_BIT = BIT0;
+	static const EventBits_t SPACE_BIT = BIT0;
+
+	int16_t* _buffer;
+	size_t _capacity;
+	size_t _startSamples;
+	std::atomic<uint32_t> _head; // Total samples queued, producers under _lock
+	std::atomic<uint32_t> _tail; // Total samples mixed, mixer task only
+	std::atomic<bool> _draining;
+	std::atomic<bool> _discard;
+	volatile bool _playing;
+	volatile float _gain;
+	float _level; // Gain currently applied, ramps toward _gain or the ducked gain
+	uint8_t _priority;
+	float _duck;
+	volatile uint32_t _underruns;
+	volatile uint32_t _overruns;
+	volatile uint32_t _dropped;
+	EventGroupHandle_t _space;
+	EventGroupHandle_t _data;
+	SemaphoreHandle_t _lock;
+	volatile uint32_t _rate; // Rate of newly queued audio
+	std::atomic<uint32_t> _mark; // Samples before it were queued at the previous rate
+	std::atomic<bool> _fenced;
+	int16_t* _scratch;
+	AudioResampler _resampler;
+
+	// Producer side, lock held: copy into the ring, waiting for space until the deadline
+	inline size_t push(const int16_t* samples, size_t count, AudioDsp::Gain gain, TickType_t start, TickType_t timeout) {
+		size_t queued = 0;
+		while (queued < count) {
+			uint32_t head = _head.load(std::memory_order_relaxed);
+			size_t space = _capacity - (head - _tail.load(std::memory_order_acquire));
+			if (space == 0) {
+				TickType_t elapsed = xTaskGetTickCount() - start;
+				if (elapsed >= timeout) break;
+				xEventGroupWaitBits(_space, SPACE_BIT, pdTRUE, pdFALSE, timeout - elapsed);
+				continue;
+			}
+
+			size_t n = count - queued;
+			if (n > space) n = space;
+			size_t offset = head % _capacity;
+			size_t first = _capacity - offset;
+			if (first > n) first = n;
+			AudioDsp::applyGain(samples + queued, _buffer + offset, first, gain);
+			if (n > first) {
+				AudioDsp::applyGain(samples + queued + first, _buffer, n - first, gain);
+			}
+
+			_head.store(head + n, std::memory_order_release);
+			xEventGroupSetBits(_data, DATA_BIT);
+			queued += n;
+		}
+		return queued;
+	}
+
+	// Producers switch to the new rate now, the mixer only plays up to the fence until its clock follows
+	inline void setRate(uint32_t rate) {
+		xSemaphoreTake(_lock, portMAX_DELAY);
+		_rate = rate;
+		_mark.store(_head.load(std::memory_order_relaxed));
+		_fenced.store(true);
+		xSemaphoreGive(_lock);
+	}
+
+	// Mixer side, after the clock switch: drop what is left of the old rate
+	inline void unfence() {
+		uint32_t mark = _mark.load();
+		uint32_t tail = _tail.load(std::memory_order_relaxed);
+		if ((int32_t)(mark - tail) > 0) {
+			_tail.store(mark, std::memory_order_release);
+			xEventGroupSetBits(_space, SPACE_BIT);
+		}
+		_fenced.store(false);
+		_playing = false;
+		_level = 0.0f;
+	}
+
+	inline size_t readable() const {
+		if (!_fenced.load()) return buffered();
+		int32_t left = (int32_t)(_mark.load() - _tail.load(std::memory_order_relaxed));
+		return left > 0 ? (size_t)left : 0;
+	}
+
+	// Mixer side: decide whether the channel takes part in the next block
+	inline bool update() {
+		if (_discard.exchange(false)) {
+			_tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+			_draining.store(false);
+			_playing = false;
+			xEventGroupSetBits(_space, SPACE_BIT);
+		}
+
+		size_t available = readable();
+		if (!_playing) {
+			if (available > 0 && (available >= _startSamples || _draining.load() || _fenced.load())) {
+				_playing = true;
+			} else if (available == 0 && !_fenced.load()) {
+				_draining.store(false);
+			}
+		}
+		return _playing;
+	}
+
+	// Mixer side: copy up to maxSamples, a short read ends or starves the stream
+	inline size_t read(int16_t* out, size_t maxSamples) {
+		size_t available = readable();
+		size_t n = available < maxSamples ? available : maxSamples;
+		if (n > 0) {
+			uint32_t tail = _tail.load(std::memory_order_relaxed);
+			size_t offset = tail % _capacity;
+			size_t first = _capacity - offset;
+			if (first > n) first = n;
+			memcpy(out, _buffer + offset, first * sizeof(int16_t));
+			if (n > first) {
+				memcpy(out + first, _buffer, (n - first) * sizeof(int16_t));
+			}
+			_tail.store(tail + n, std::memory_order_release);
+			xEventGroupSetBits(_space, SPACE_BIT);
+		}
+
+		if (n < maxSamples) {
+			_playing = false;
+			if (!_fenced.load() && !_draining.exchange(false)) {
+				_underruns++;
+				ESP_LOGW("AudioChannel", "Underrun, re-buffering (total %u)", _underruns);
+			}
+		}
+		return n;
+	}
+};
+
+/**
+ * Block-based mixer in front of the I2S speaker
+ *
+ * A dedicated high priority task pulls one block from every playing
+ * channel, applies the channel gain (ramped, and ducked while a higher
+ * priority channel plays) and sums them with the saturating Q15 kernel.
+ * All buffers are allocated once in begin().
+ *
+ * The output clock follows the dominant source: setSampleRate() lets the
+ * audio queued at the old rate finish (or fades it out after a deadline),
+ * then reopens I2S at the new rate through the clock callback. The
+ * callback runs with the output lock held, other tasks using the device
+ * take the same lock so it is never replaced under them.
+ */
+// Reopen I2S at rate, which is set to the rate actually opened when the old clock had to be kept
+typedef I2SSpeaker* (*mixer_clock_cb_t)(uint32_t& rate, void* arg);
+
+class AudioMixer {
+public:
+	static const size_t BLOCK_SAMPLES = 256;
+
+	AudioMixer(): _i2s(nullptr), _mix(nullptr), _block(nullptr), _events(nullptr), _outputLock(nullptr), _task(nullptr), _active(false),
+		_rate(0), _pendingRate(0), _switchStart(0), _switchWait(0), _clock(nullptr), _clockArg(nullptr) {}
+
+	/**
+	 * Allocate the channels and start the mixer task, only once
+	 * @param i2s Started I2S speaker
+	 * @param rate Current I2S sample rate
+	 * @param configs One configuration per AUDIO_CHANNEL
+	 * @param priority Mixer task priority
+	 * @param core Mixer task core
+	 * @param clock Reopens I2S at another rate, nullptr keeps the rate fixed
+	 * @param clockArg Argument for clock
+	 * @return true if running
+	 */
+	inline bool begin(I2SSpeaker* i2s, uint32_t rate, const AudioChannel::Config* configs, UBaseType_t priority, BaseType_t core,
+		mixer_clock_cb_t clock = nullptr, void* clockArg = nullptr) {
+		if (_task) return true;
+		if (!i2s || !configs) return false;
+
+		if (!_events) _events = xEventGroupCreate();
+		if (!_outputLock) _outputLock = xSemaphoreCreateMutex();
+		if (!_mix) _mix = (int16_t*)heap_caps_malloc(BLOCK_SAMPLES * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+		if (!_block) _block = (int16_t*)heap_caps_malloc(BLOCK_SAMPLES * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+		if (!_events || !_outputLock || !_mix || !_block) {
+			ESP_LOGE("AudioMixer", "Failed to allocate mix buffers");
+			return false;
+		}
+		for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+			if (!_channels[i].init(configs[i], _events, rate)) return false;
+		}
+
+		_i2s = i2s;
+		_rate = _pendingRate = rate;
+		_clock = clock;
+		_clockArg = clockArg;
+		BaseType_t ret = xTaskCreatePinnedToCoreWithCaps(mixerTask, "mixerTask", 1024 * 3, this, priority, &_task, core, MALLOC_CAP_INTERNAL);
+		if (ret != pdPASS) {
+			ESP_LOGE("AudioMixer", "Failed to create mixer task");
+			_task = nullptr;
+			return false;
+		}
+
+		ESP_LOGI("AudioMixer", "Mixer ready: %d channels, %d samples per block", AUDIO_CHANNEL_MAX, BLOCK_SAMPLES);
+		return true;
+	}
+
+	inline AudioChannel& channel(AUDIO_CHANNEL id) { return _channels[id < AUDIO_CHANNEL_MAX ? id : AUDIO_CHANNEL_VOICE]; }
+	inline bool isRunning() const { return _task != nullptr; }
+
+	/**
+	 * Hold the output device against a clock switch, pair with unlockOutput()
+	 */
+	inline void lockOutput() {
+		if (_outputLock) xSemaphoreTake(_outputLock, portMAX_DELAY);
+	}
+
+	inline void unlockOutput() {
+		if (_outputLock) xSemaphoreGive(_outputLock);
+	}
+
+	/**
+	 * Rate new audio is queued at, the I2S clock follows once the old audio is out
+	 */
+	inline uint32_t sampleRate() const { return _pendingRate; }
+
+	/**
+	 * Switch the output clock
+	 * @param rate New sample rate
+	 * @param waitMs How long audio queued at the old rate may keep playing before it is faded out
+	 */
+	inline void setSampleRate(uint32_t rate, uint32_t waitMs) {
+		if (!_task || !_clock || rate == 0 || rate == _pendingRate) return;
+		for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+			_channels[i].setRate(rate);
+		}
+		_switchStart = millis();
+		_switchWait = waitMs;
+		_pendingRate = rate;
+		xEventGroupSetBits(_events, AudioChannel::DATA_BIT);
+	}
+
+private:
+	// Per block gain step, a full fade takes about 8 blocks
+	static constexpr float RAMP_STEP = 0.125f;
+
+	I2SSpeaker* _i2s;
+	AudioChannel _channels[AUDIO_CHANNEL_MAX];
+	int16_t* _mix;
+	int16_t* _block;
+	EventGroupHandle_t _events;
+	SemaphoreHandle_t _outputLock;
+	TaskHandle_t _task;
+	bool _active;
+	uint32_t _rate;
+	volatile uint32_t _pendingRate;
+	volatile unsigned long _switchStart;
+	volatile uint32_t _switchWait;
+	mixer_clock_cb_t _clock;
+	void* _clockArg;
+
+	static void mixerTask(void* param) {
+		static_cast<AudioMixer*>(param)->run();
+	}
+
+	inline void run() {
+		for (;;) {
+			int top = -1;
+			for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+				if (_channels[i].update() && _channels[i]._priority > top) top = _channels[i]._priority;
+			}
+
+			if (_pendingRate != _rate && (top < 0 || millis() - _switchStart > _switchWait)) {
+				if (top >= 0) {
+					// Old audio is still playing, fade the last block out instead of cutting it
+					mixBlock(top);
+					for (size_t i = 0; i < BLOCK_SAMPLES; i++) {
+						_mix[i] = (int16_t)((int32_t)_mix[i] * (int32_t)(BLOCK_SAMPLES - i) / (int32_t)BLOCK_SAMPLES);
+					}
+					writeBlock();
+				}
+				switchClock();
+				continue;
+			}
+
+			if (top < 0) {
+				if (_active) {
+					// Everything finished, silence DMA so the last block doesn't loop
+					_active = false;
+					if (_i2s) _i2s->clear();
+				}
+				xEventGroupWaitBits(_events, AudioChannel::DATA_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(20));
+				continue;
+			}
+
+			_active = true;
+			mixBlock(top);
+			writeBlock();
+		}
+	}
+
+	inline void mixBlock(int top) {
+		memset(_mix, 0, BLOCK_SAMPLES * sizeof(int16_t));
+		for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+			AudioChannel& ch = _channels[i];
+			if (!ch._playing) continue;
+
+			float target = ch._gain;
+			if (ch._priority < top) target *= ch._duck;
+			if (ch._level < target) ch._level = std::min(target, ch._level + RAMP_STEP);
+			else if (ch._level > target) ch._level = std::max(target, ch._level - RAMP_STEP);
+
+			size_t n = ch.read(_block, BLOCK_SAMPLES);
+			AudioDsp::mix(_mix, _block, n, AudioDsp::gain(ch._level));
+		}
+	}
+
+	inline void writeBlock() {
+		size_t written = 0;
+		if (!_i2s || _i2s->writeAudioData(_mix, BLOCK_SAMPLES * sizeof(int16_t), &written, portMAX_DELAY) != ESP_OK) {
+			// Channel stopped, don't spin
+			vTaskDelay(pdMS_TO_TICKS(10));
+		}
+	}
+
+	inline void switchClock() {
+		uint32_t rate = _pendingRate;
+		for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+			_channels[i].unfence();
+		}
+		if (_active && _i2s) _i2s->clear();
+		_active = false;
+
+		uint32_t opened = rate;
+		lockOutput();
+		_i2s = _clock(opened, _clockArg);
+		unlockOutput();
+
+		if (!_i2s) {
+			ESP_LOGE("AudioMixer", "Failed to switch output clock to %u Hz, output stopped", rate);
+		} else if (opened != rate) {
+			// The old clock was kept, audio queued for the new one would play at the wrong speed
+			ESP_LOGE("AudioMixer", "Failed to switch output clock to %u Hz, staying at %u Hz", rate, opened);
+			for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+				_channels[i].setRate(opened);
+				_channels[i].unfence();
+			}
+			_pendingRate = opened;
+		} else {
+			ESP_LOGI("AudioMixer", "Output clock switched to %u Hz", rate);
+		}
+		_rate = opened;
+	}
+};
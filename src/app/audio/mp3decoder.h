@@ -3,12 +3,16 @@
 
 #include <Arduino.h>
 #include <MP3Decoder.h>
+#include "dsp.h"
+#include "mpegaudio.h"
 
 // Include the ESP32 Helix MP3 decoder library
 extern "C" {
     #include "mp3dec.h"
 }
 
+typedef void (*mp3_pcm_cb_t)(const int16_t* pcm, size_t samples, int sampleRate, void* arg);
+
 class Mp3Decoder {
 private:
 	// Helix MP3 decoder instance
@@ -50,6 +54,7 @@ public:
 		
 		streamingInitialized = true;
 		streamBufferUsed = 0;
+		streamReadPos = 0;
 		return true;
 	}
 
@@ -59,236 +64,187 @@ public:
 	 */
 	bool isInitialized() const { return streamingInitialized; }
 
+	// Frames decoded since begin()
+	size_t framesDecoded() const { return streamFrames; }
+
+	// Most input held in the window since begin()
+	size_t peakWindow() const { return streamPeak; }
+
 	/**
-	 * Feed MP3 data for streaming decoding
-	 * @param audioData MP3 chunk data
-	 * @param audioSize Size of MP3 chunk in bytes
-	 * @return true if data fed successfully
+	 * Start a new stream, drops any buffered input
+	 * @return true if ready
 	 */
-	inline bool feedData(const uint8_t* audioData, size_t audioSize) {
-		if (!streamingInitialized) {
-			ESP_LOGE("MP3Decoder", "Streaming decoder not initialized");
+	inline bool begin() {
+		if (!init()) {
 			return false;
 		}
-		
-		if (!audioData || audioSize == 0) {
-			ESP_LOGW("MP3Decoder", "No audio data to feed");
-			return true; // Not an error, just no data
+
+		reset();
+		streamStart = millis();
+		firstSampleAt = 0;
+		streamPeak = 0;
+		streamFrames = 0;
+		return true;
+	}
+
+	/**
+	 * Copy an arbitrary network chunk into the input window
+	 * @param audioData MP3 chunk data
+	 * @param audioSize Size of MP3 chunk in bytes
+	 * @return Number of bytes accepted, less than audioSize when the window is full
+	 */
+	inline size_t feed(const uint8_t* audioData, size_t audioSize) {
+		if (!streamingInitialized || !audioData || audioSize == 0) {
+			return 0;
 		}
-		
-		// Check if we need more space in the buffer
-		if (streamBufferUsed + audioSize > streamBufferSize) {
-			ESP_LOGW("MP3Decoder", "Stream buffer full, dropping old data");
-			// For simplicity, we'll drop old data. In a more sophisticated implementation,
-			// you might want to resize the buffer or handle this differently
-			size_t keepSize = streamBufferSize / 2; // Keep half the buffer
-			memmove(streamBuffer, streamBuffer + streamBufferUsed - keepSize, keepSize);
-			streamBufferUsed = keepSize;
+
+		// Slide the unread tail to the front, frames must stay contiguous for Helix
+		if (streamReadPos > 0 && streamBufferSize - streamBufferUsed < audioSize) {
+			size_t remaining = streamBufferUsed - streamReadPos;
+			memmove(streamBuffer, streamBuffer + streamReadPos, remaining);
+			streamBufferUsed = remaining;
+			streamReadPos = 0;
 		}
-		
-		// Copy new data to buffer
+
 		size_t copySize = min(audioSize, streamBufferSize - streamBufferUsed);
 		memcpy(streamBuffer + streamBufferUsed, audioData, copySize);
 		streamBufferUsed += copySize;
-		
-		ESP_LOGD("MP3Decoder", "Fed %d bytes to stream buffer (total: %d/%d)", 
-				copySize, streamBufferUsed, streamBufferSize);
-		
-		return true;
+		if (streamBufferUsed - streamReadPos > streamPeak) {
+			streamPeak = streamBufferUsed - streamReadPos;
+		}
+		return copySize;
 	}
 
 	/**
-	 * Get available decoded PCM data from streaming decoder
-	 * @param pcmBuffer Output buffer for PCM data (allocated by this function)
-	 * @param pcmSize Output number of PCM samples
-	 * @param sampleRate Output sample rate of decoded audio
-	 * @return true if PCM data is available
+	 * Decode the next frame from the input window
+	 * @param pcm Receives mono PCM, valid until the next call
+	 * @param pcmSize Receives the number of samples
+	 * @param sampleRate Receives the frame sample rate
+	 * @param final No more input will follow, decode whatever is left
+	 * @return 1 if a frame was decoded, 0 if more input is needed, -1 when a final stream is exhausted
 	 */
-	inline bool getDecodedPCM(int16_t** pcmBuffer, size_t* pcmSize, int* sampleRate) {
-		if (!streamingInitialized || streamBufferUsed == 0) {
-			return false; // No data available
-		}
-		
-		ESP_LOGD("MP3Decoder", "Attempting to decode %d bytes from stream buffer", streamBufferUsed);
-		
-		if (!ensureDecoderAndBuffer()) {
-			return false;
-		}
-		
-		// Debug: Log first few bytes of buffer to check for valid MP3 data
-		if (streamBufferUsed >= 4) {
-			ESP_LOGD("MP3Decoder", "Buffer start: %02X %02X %02X %02X", 
-					streamBuffer[0], streamBuffer[1], streamBuffer[2], streamBuffer[3]);
+	inline int decodeFrame(const int16_t** pcm, size_t* pcmSize, int* sampleRate, bool final = false) {
+		if (!streamingInitialized || !pcm || !pcmSize || !sampleRate) {
+			return -1;
 		}
-		
-		// Use low-level streaming decode similar to ESP32-speaker
-		std::vector<int16_t> accumulatedPCM;
-		size_t totalSamples = 0;
-		int detectedSampleRate = 0;
-		
-		uint8_t* readPtr = streamBuffer;
-		int bytesLeft = streamBufferUsed;
-		bool firstFrame = true;
-		
-		// Process all available frames in the buffer
-		while (bytesLeft > 0) {
-			// Find the next MP3 frame sync word
-			int offset = MP3FindSyncWord(readPtr, bytesLeft);
-			if (offset < 0) {
-				ESP_LOGD("MP3Decoder", "No more sync words found, %d bytes left", bytesLeft);
-				break; // No more sync words
-			}
-			
-			// Move to the sync word position
-			readPtr += offset;
-			bytesLeft -= offset;
-			
-			if (bytesLeft < 4) {
-				ESP_LOGD("MP3Decoder", "Not enough bytes for frame header");
-				break; // Not enough data for frame
+
+		for (;;) {
+			size_t available = streamBufferUsed - streamReadPos;
+			if (pendingSkip > 0) {
+				size_t drop = min(pendingSkip, available);
+				streamReadPos += drop;
+				pendingSkip -= drop;
+				if (pendingSkip > 0) return final ? -1 : 0;
+				continue;
 			}
-			
-			// Get frame info
-			MP3FrameInfo frameInfo;
-			int result = MP3GetNextFrameInfo(helixDecoder, &frameInfo, readPtr);
-			if (result != 0) {
-				ESP_LOGD("MP3Decoder", "Invalid frame header, skipping byte");
-				// Invalid frame, skip one byte and try again
-				readPtr++;
-				bytesLeft--;
+
+			uint8_t* frame = streamBuffer + streamReadPos;
+			if (!tagChecked) {
+				if (available < MpegAudio::ID3V2_HEADER_SIZE && !final) return 0;
+				tagChecked = true;
+				pendingSkip = MpegAudio::id3v2Size(frame, available);
+				if (pendingSkip > 0) {
+					ESP_LOGD("MP3Decoder", "Skipping %d bytes ID3v2 tag", pendingSkip);
+				}
 				continue;
 			}
-			
-			// Additional validation: check if we have enough data for the frame
-			// Estimate frame size (rough calculation)
-			int estimatedFrameSize = (frameInfo.bitrate * 144000) / (frameInfo.samprate * 8) + 4;
-			if (bytesLeft < estimatedFrameSize) {
-				ESP_LOGD("MP3Decoder", "Not enough data for frame (%d < %d), need more data", bytesLeft, estimatedFrameSize);
-				break; // Need more data
+
+			// Exact frame boundaries, confirmed by the following header
+			MpegFrameHeader header;
+			size_t skipped = 0;
+			int offset = MpegAudio::findFrame(frame, available, &header, final, &skipped);
+			streamReadPos += skipped;
+			if (offset < 0) {
+				return offset == MpegAudio::NEED_MORE ? 0 : -1;
 			}
-			
-			// Update sample rate from first valid frame
-			if (firstFrame) {
-				detectedSampleRate = frameInfo.samprate;
-				firstFrame = false;
-				ESP_LOGD("MP3Decoder", "Detected MP3: %d Hz, %d channels, %d kbps", 
-						frameInfo.samprate, frameInfo.nChans, frameInfo.bitrate);
+			frame = streamBuffer + streamReadPos;
+			available -= skipped;
+
+			uint8_t* readPtr = frame;
+			int bytesLeft = available;
+			int decodeResult = MP3Decode(helixDecoder, &readPtr, &bytesLeft, outputBuffer, 0);
+
+			if (decodeResult == ERR_MP3_MAINDATA_UNDERFLOW) {
+				// Bit reservoir still filling, the frame produced no audio
+				streamReadPos += header.size;
+				continue;
 			}
-			
-			// Try to decode the frame - MP3Decode will handle incomplete frames
-			int decodeResult = MP3Decode(helixDecoder, &readPtr, &bytesLeft, 
-										outputBuffer, 0);
-			
 			if (decodeResult != 0) {
-				if (decodeResult == ERR_MP3_INDATA_UNDERFLOW) {
-					ESP_LOGD("MP3Decoder", "Need more data for frame");
-					break; // Need more data
-				} else if (decodeResult == ERR_MP3_INVALID_HUFFCODES || 
-						   decodeResult == ERR_MP3_INVALID_FRAMEHEADER ||
-						   decodeResult == ERR_MP3_INVALID_SIDEINFO) {
-					// Frame data is corrupted, skip to next sync word
-					ESP_LOGW("MP3Decoder", "Corrupted frame data (error %d), skipping to next sync", decodeResult);
-					
-					// Skip to next potential sync word (look for 0xFF)
-					bool foundSync = false;
-					while (bytesLeft >= 2 && !foundSync) {
-						if (readPtr[0] == 0xFF && (readPtr[1] & 0xE0) == 0xE0) {
-							foundSync = true;
-							break;
-						}
-						readPtr++;
-						bytesLeft--;
-						if (bytesLeft < 2) break; // Prevent underflow
-					}
-					
-					if (!foundSync) {
-						ESP_LOGW("MP3Decoder", "No more sync words found, ending decode");
-						break;
-					}
-					
-					continue;
-				} else {
-					ESP_LOGW("MP3Decoder", "Frame decode error %d, skipping byte", decodeResult);
-					// For other errors, just skip one byte
-					readPtr++;
-					bytesLeft--;
-					continue;
-				}
+				// The frame is known to be whole, drop exactly that frame
+				ESP_LOGW("MP3Decoder", "Frame decode error %d, skipping %d bytes", decodeResult, header.size);
+				streamReadPos += header.size;
+				continue;
 			}
-			
-			// Successfully decoded a frame
-			size_t samplesDecoded = frameInfo.outputSamps;
-			ESP_LOGD("MP3Decoder", "Decoded frame: %d samples", samplesDecoded);
-			
-			// Convert stereo to mono if needed
+			streamReadPos += readPtr - frame;
+
+			MP3FrameInfo frameInfo;
+			MP3GetLastFrameInfo(helixDecoder, &frameInfo);
+			size_t samples = frameInfo.outputSamps;
 			if (frameInfo.nChans == 2) {
-				// Convert stereo to mono by averaging channels
-				for (size_t i = 0; i < samplesDecoded; i += 2) {
-					int16_t left = outputBuffer[i];
-					int16_t right = outputBuffer[i + 1];
-					outputBuffer[i/2] = (left + right) / 2;
-				}
-				samplesDecoded /= 2;
+				samples = AudioDsp::stereoToMono(outputBuffer, outputBuffer, samples / 2);
 			}
-			
-			// Add to accumulated PCM
-			accumulatedPCM.insert(accumulatedPCM.end(), 
-								outputBuffer, 
-								outputBuffer + samplesDecoded);
-			totalSamples += samplesDecoded;
-		}
-		
-		// Remove consumed bytes from buffer
-		size_t bytesConsumed = readPtr - streamBuffer;
-		if (bytesConsumed > 0) {
-			size_t remainingBytes = streamBufferUsed - bytesConsumed;
-			if (remainingBytes > 0) {
-				memmove(streamBuffer, readPtr, remainingBytes);
+
+			streamFrames++;
+			if (firstSampleAt == 0) {
+				firstSampleAt = millis();
+				ESP_LOGI("MP3Decoder", "First frame: %d Hz, %d channels, %d kbps, %lu ms after start",
+						frameInfo.samprate, frameInfo.nChans, frameInfo.bitrate / 1000, firstSampleAt - streamStart);
 			}
-			streamBufferUsed = remainingBytes;
-			ESP_LOGD("MP3Decoder", "Consumed %d bytes, %d bytes remaining in buffer", 
-					bytesConsumed, streamBufferUsed);
+
+			*pcm = outputBuffer;
+			*pcmSize = samples;
+			*sampleRate = frameInfo.samprate;
+			return 1;
 		}
-		
-		if (totalSamples == 0) {
-			ESP_LOGD("MP3Decoder", "No PCM data decoded from %d bytes", streamBufferUsed);
-			return false; // No data decoded
+	}
+
+	/**
+	 * Decode every complete frame in the input window and hand each one to a sink
+	 * @param sink Receives each decoded frame
+	 * @param arg Argument for sink
+	 * @param final No more input will follow, decode whatever is left
+	 * @return Number of samples delivered
+	 */
+	inline size_t decodeAvailable(mp3_pcm_cb_t sink, void* arg, bool final = false) {
+		size_t delivered = 0;
+		const int16_t* pcm = nullptr;
+		size_t samples = 0;
+		int rate = 0;
+		while (decodeFrame(&pcm, &samples, &rate, final) == 1) {
+			if (samples > 0) sink(pcm, samples, rate, arg);
+			delivered += samples;
 		}
-		
-		// Allocate output buffer
-		int16_t* outputBuffer = (int16_t*)heap_caps_malloc(totalSamples * sizeof(int16_t), 
-														  MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
-		if (!outputBuffer) {
-			ESP_LOGE("MP3Decoder", "Failed to allocate output buffer for %d samples", totalSamples);
-			return false;
+		return delivered;
+	}
+
+	/**
+	 * Play a buffered MP3 as if it were arriving from the network, frame by frame
+	 * @param audioData MP3 data
+	 * @param audioSize Size of MP3 data in bytes
+	 * @param sink Receives each decoded frame, playback can start on the first
+	 * @param arg Argument for sink
+	 * @return Number of samples delivered
+	 */
+	inline size_t stream(const uint8_t* audioData, size_t audioSize, mp3_pcm_cb_t sink, void* arg) {
+		if (!audioData || !sink || !begin()) {
+			return 0;
 		}
-		
-		// Copy accumulated data
-		memcpy(outputBuffer, accumulatedPCM.data(), totalSamples * sizeof(int16_t));
-		
-		// Resample if needed
-		int finalSampleRate = detectedSampleRate;
-		int16_t* finalBuffer = outputBuffer;
-		size_t finalSize = totalSamples;
-		
-		if (detectedSampleRate != 16000) {
-			// Resample to 16kHz for speaker
-			if (!resampleTo16kHz(outputBuffer, totalSamples, detectedSampleRate, &finalBuffer, &finalSize)) {
-				ESP_LOGW("MP3Decoder", "Resampling failed, using original %d Hz", detectedSampleRate);
-				finalSampleRate = detectedSampleRate;
-			} else {
-				finalSampleRate = 16000;
-				if (finalBuffer != outputBuffer) {
-					heap_caps_free(outputBuffer);
-				}
+
+		size_t delivered = 0;
+		size_t offset = 0;
+		while (offset < audioSize) {
+			size_t accepted = feed(audioData + offset, audioSize - offset);
+			offset += accepted;
+			delivered += decodeAvailable(sink, arg, offset >= audioSize);
+			if (accepted == 0 && streamReadPos == 0) {
+				ESP_LOGE("MP3Decoder", "Input window stalled, dropping stream");
+				break;
 			}
 		}
-		
-		*pcmBuffer = finalBuffer;
-		*pcmSize = finalSize;
-		*sampleRate = finalSampleRate;
-		
-		return true;
+
+		ESP_LOGI("MP3Decoder", "Stream done: %d frames, %d samples, first sample after %lu ms, peak window %d bytes",
+				streamFrames, delivered, firstSampleAt ? firstSampleAt - streamStart : 0, streamPeak);
+		return delivered;
 	}
 
 	/**
@@ -355,20 +311,27 @@ public:
 	 */
 	inline void reset() {
 		streamBufferUsed = 0;
-		if (streamBuffer) {
-			memset(streamBuffer, 0, streamBufferSize);
-		}
+		streamReadPos = 0;
+		pendingSkip = 0;
+		tagChecked = false;
 	}
 
 private:
 	MP3Decoder mp3Decoder;
 	bool streamingInitialized = false;
 	
-	// Streaming state
+	// Streaming state, a few max-size frames of input is enough
 	uint8_t* streamBuffer = nullptr;
 	size_t streamBufferSize = 0;
 	size_t streamBufferUsed = 0;
-	const size_t STREAM_BUFFER_SIZE = 1024 * 500;
+	size_t streamReadPos = 0;
+	size_t pendingSkip = 0;   // Rest of an ID3v2 tag still to drop
+	bool tagChecked = false;
+	const size_t STREAM_BUFFER_SIZE = 1024 * 16;
+	unsigned long streamStart = 0;
+	unsigned long firstSampleAt = 0;
+	size_t streamPeak = 0;
+	size_t streamFrames = 0;
 
 	/**
 	 * Ensure decoder and output buffer are initialized
@@ -412,52 +375,6 @@ private:
 		return true;
 	}
 
-	/**
-	 * Resample audio from current sample rate to 16kHz
-	 * @param pcmBuffer Input PCM buffer
-	 * @param pcmSize Number of samples in input buffer
-	 * @param currentSampleRate Current sample rate of input
-	 * @param resampledBuffer Output buffer (allocated by this function)
-	 * @param resampledSize Output number of samples
-	 * @return true if resampling successful
-	 */
-	inline bool resampleTo16kHz(const int16_t* pcmBuffer, size_t pcmSize, int currentSampleRate,
-									   int16_t** resampledBuffer, size_t* resampledSize) {
-		// Calculate target samples
-		size_t targetSamples = (pcmSize * 16000LL) / currentSampleRate;  // Use 64-bit to avoid overflow
-
-		// Allocate resampled buffer
-		int16_t* buffer = (int16_t*)heap_caps_malloc(targetSamples * sizeof(int16_t), MALLOC_CAP_SPIRAM);
-		if (!buffer) {
-			ESP_LOGE("MP3Processor", "Failed to allocate resample buffer");
-			return false;
-		}
-
-		// Linear interpolation resampling
-		for (size_t i = 0; i < targetSamples; i++) {
-			float srcPos = (float)i * (float)currentSampleRate / 16000.0f;
-			size_t srcIndex = (size_t)srcPos;
-			float fraction = srcPos - srcIndex;
-
-			if (srcIndex + 1 < pcmSize) {
-				// Linear interpolation between two samples
-				int16_t sample1 = pcmBuffer[srcIndex];
-				int16_t sample2 = pcmBuffer[srcIndex + 1];
-				buffer[i] = (int16_t)(sample1 + fraction * (sample2 - sample1));
-			} else if (srcIndex < pcmSize) {
-				// Last sample
-				buffer[i] = pcmBuffer[srcIndex];
-			} else {
-				// Should not happen
-				buffer[i] = 0;
-			}
-		}
-
-		*resampledBuffer = buffer;
-		*resampledSize = targetSamples;
-		return true;
-	}
-
 	/**
 	 * Convert stereo audio to mono
 	 * @param buffer Input/output buffer (modified in place)
@@ -467,10 +384,7 @@ private:
 		if (!buffer || *size < 2) return;
 
 		// Convert stereo to mono by averaging channels
-		for (size_t i = 0; i < *size / 2; i++) {
-			buffer[i] = (buffer[i * 2] + buffer[i * 2 + 1]) / 2;
-		}
-		*size = *size / 2;
+		*size = AudioDsp::stereoToMono(buffer, buffer, *size / 2);
 	}
 };
 
@@ -0,0 +1,181 @@
+#include "mpegaudio.h"
+#include <cstring>
+
+namespace {
+
+// Bitrates in kbps, index 0 is free format and 15 is invalid
+const uint16_t BITRATES_V1[3][16] = {
+    {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0}, // Layer I
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},    // Layer II
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},     // Layer III
+};
+
+const uint16_t BITRATES_V2[3][16] = {
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0}, // Layer I
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},      // Layer II
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},      // Layer III
+};
+
+const uint32_t SAMPLE_RATES_V1[3] = {44100, 48000, 32000};
+
+} // namespace
+
+bool MpegAudio::parseHeader(const uint8_t* data, MpegFrameHeader* header) {
+    if (!data || data[0] != 0xFF || (data[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+
+    uint8_t versionBits = (data[1] >> 3) & 0x03;
+    uint8_t layerBits = (data[1] >> 1) & 0x03;
+    uint8_t bitrateIndex = (data[2] >> 4) & 0x0F;
+    uint8_t rateIndex = (data[2] >> 2) & 0x03;
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) {
+        return false;
+    }
+    if ((data[3] & 0x03) == 2) {
+        return false; // Reserved emphasis
+    }
+
+    MpegFrameHeader h;
+    h.version = versionBits == 3 ? 10 : (versionBits == 2 ? 20 : 25);
+    h.layer = 4 - layerBits;
+    h.crc = (data[1] & 0x01) == 0;
+    h.padding = (data[2] & 0x02) != 0;
+    h.channels = ((data[3] >> 6) & 0x03) == 3 ? 1 : 2;
+
+    const uint16_t* bitrates = h.version == 10 ? BITRATES_V1[h.layer - 1] : BITRATES_V2[h.layer - 1];
+    h.bitrate = (uint32_t)bitrates[bitrateIndex] * 1000;
+    h.sampleRate = SAMPLE_RATES_V1[rateIndex];
+    if (h.version == 20) h.sampleRate /= 2;
+    else if (h.version == 25) h.sampleRate /= 4;
+
+    uint32_t size;
+    if (h.layer == 1) {
+        h.samples = 384;
+        size = (12 * h.bitrate / h.sampleRate + (h.padding ? 1 : 0)) * 4;
+    } else if (h.layer == 3 && h.version != 10) {
+        // MPEG-2/2.5 Layer III frames carry half the granules
+        h.samples = 576;
+        size = 72 * h.bitrate / h.sampleRate + (h.padding ? 1 : 0);
+    } else {
+        h.samples = 1152;
+        size = 144 * h.bitrate / h.sampleRate + (h.padding ? 1 : 0);
+    }
+    if (size <= HEADER_SIZE || size > 0xFFFF) {
+        return false;
+    }
+    h.size = (uint16_t)size;
+
+    if (header) *header = h;
+    return true;
+}
+
+size_t MpegAudio::id3v2Size(const uint8_t* data, size_t length) {
+    if (!data || length < ID3V2_HEADER_SIZE || memcmp(data, "ID3", 3) != 0) {
+        return 0;
+    }
+    // Version bytes are never 0xFF, size bytes are synchsafe (7 bits each)
+    if (data[3] == 0xFF || data[4] == 0xFF || ((data[6] | data[7] | data[8] | data[9]) & 0x80)) {
+        return 0;
+    }
+
+    size_t size = ((size_t)data[6] << 21) | ((size_t)data[7] << 14) | ((size_t)data[8] << 7) | data[9];
+    size += ID3V2_HEADER_SIZE;
+    if (data[5] & 0x10) {
+        size += ID3V2_HEADER_SIZE; // Footer
+    }
+    return size;
+}
+
+int MpegAudio::findSync(const uint8_t* data, size_t length) {
+    if (!data) return NOT_FOUND;
+
+    size_t i = 0;
+    while (i + 1 < length) {
+        // Skip words without any 0xFF byte
+        while (i + 4 <= length) {
+            uint32_t word;
+            memcpy(&word, data + i, sizeof(word));
+            uint32_t inverted = ~word;
+            if (((inverted - 0x01010101u) & ~inverted & 0x80808080u) != 0) break;
+            i += 4;
+        }
+        if (i + 1 >= length) break;
+
+        if (data[i] == 0xFF && (data[i + 1] & 0xE0) == 0xE0) {
+            return (int)i;
+        }
+        i++;
+    }
+    return NOT_FOUND;
+}
+
+int MpegAudio::findFrame(const uint8_t* data, size_t length, MpegFrameHeader* header, bool final, size_t* skipped) {
+    size_t pos = 0;
+    while (data && pos + HEADER_SIZE <= length) {
+        int sync = findSync(data + pos, length - pos);
+        if (sync < 0) {
+            // A trailing 0xFF may be the start of the next header
+            pos = data[length - 1] == 0xFF ? length - 1 : length;
+            break;
+        }
+        pos += sync;
+        if (pos + HEADER_SIZE > length) break;
+
+        MpegFrameHeader h;
+        if (!parseHeader(data + pos, &h)) {
+            pos++;
+            continue;
+        }
+
+        size_t next = pos + h.size;
+        if (next + HEADER_SIZE > length) {
+            if (!final) {
+                if (skipped) *skipped = pos;
+                return NEED_MORE;
+            }
+            if (next > length) {
+                pos++;
+                continue; // Truncated last frame
+            }
+        } else {
+            MpegFrameHeader following;
+            if (!parseHeader(data + next, &following) || !sameStream(h, following)) {
+                pos++;
+                continue;
+            }
+        }
+
+        if (header) *header = h;
+        if (skipped) *skipped = pos;
+        return (int)pos;
+    }
+
+    if (skipped) *skipped = pos < length ? pos : length;
+    return final ? NOT_FOUND : NEED_MORE;
+}
+
+size_t MpegAudio::buildIndex(const uint8_t* data, size_t length, uint32_t* offsets, size_t maxFrames, uint32_t* totalSamples) {
+    size_t pos = id3v2Size(data, length);
+    size_t frames = 0;
+    uint32_t samples = 0;
+
+    while (pos < length) {
+        MpegFrameHeader h;
+        int offset = findFrame(data + pos, length - pos, &h, true);
+        if (offset < 0) break;
+
+        pos += offset;
+        if (offsets && frames < maxFrames) offsets[frames] = (uint32_t)pos;
+        frames++;
+        samples += h.samples;
+        pos += h.size;
+    }
+
+    if (totalSamples) *totalSamples = samples;
+    return frames;
+}
+
+bool MpegAudio::sameStream(const MpegFrameHeader& a, const MpegFrameHeader& b) {
+    return a.version == b.version && a.layer == b.layer && a.sampleRate == b.sampleRate;
+}
@@ -0,0 +1,94 @@
+#ifndef MPEG_AUDIO_H
+#define MPEG_AUDIO_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Decoded MPEG audio frame header
+ */
+struct MpegFrameHeader {
+    uint8_t version;      // 10 = MPEG-1, 20 = MPEG-2, 25 = MPEG-2.5
+    uint8_t layer;        // 1, 2 or 3
+    bool crc;             // 16-bit CRC follows the header
+    bool padding;         // One extra slot in this frame
+    uint8_t channels;     // 1 or 2
+    uint32_t bitrate;     // Bits per second
+    uint32_t sampleRate;  // Hz
+    uint16_t samples;     // PCM samples per channel in this frame
+    uint16_t size;        // Exact frame size in bytes, header included
+};
+
+/**
+ * MPEG-1/2/2.5 Layer I/II/III frame header parsing and sync search.
+ *
+ * Frame sizes are computed exactly from version, layer, bitrate and padding,
+ * so a stream can be walked frame by frame without handing garbage to the
+ * decoder. A sync candidate only counts when the next header lines up.
+ */
+class MpegAudio {
+public:
+    static const size_t HEADER_SIZE = 4;
+    static const size_t ID3V2_HEADER_SIZE = 10;
+
+    // findFrame() results besides an offset
+    static const int NOT_FOUND = -1;
+    static const int NEED_MORE = -2;
+
+    /**
+     * Parse and validate a 4-byte frame header
+     *
+     * @param data At least 4 bytes
+     * @param header Receives the parsed header, may be nullptr
+     * @return true if the header is valid (free-format bitrate is rejected)
+     */
+    static bool parseHeader(const uint8_t* data, MpegFrameHeader* header);
+
+    /**
+     * Size of an ID3v2 tag at the start of data
+     *
+     * @param data Input bytes
+     * @param length Number of bytes, at least 10 to detect a tag
+     * @return Tag size in bytes including header and footer, 0 if there is none
+     */
+    static size_t id3v2Size(const uint8_t* data, size_t length);
+
+    /**
+     * Find the next 0xFF 0xEx sync pattern, scanning a word at a time
+     *
+     * @param data Input bytes
+     * @param length Number of bytes
+     * @return Offset of the 0xFF byte, or NOT_FOUND
+     */
+    static int findSync(const uint8_t* data, size_t length);
+
+    /**
+     * Find the next frame whose header is valid and followed by a matching header
+     *
+     * @param data Input bytes
+     * @param length Number of bytes
+     * @param header Receives the frame header
+     * @param final No more data follows, accept a last frame without a successor
+     * @param skipped Optional, receives how many leading bytes hold no frame and can be dropped
+     * @return Offset of the frame, NEED_MORE when the frame or its successor is
+     *         still incomplete, or NOT_FOUND in a final buffer
+     */
+    static int findFrame(const uint8_t* data, size_t length, MpegFrameHeader* header, bool final, size_t* skipped = nullptr);
+
+    /**
+     * Record the offset of every frame in a buffer
+     *
+     * @param data Input bytes, an ID3v2 tag at the start is skipped
+     * @param length Number of bytes
+     * @param offsets Receives frame offsets, may be nullptr to only count
+     * @param maxFrames Capacity of offsets
+     * @param totalSamples Optional, receives the PCM samples per channel of all frames
+     * @return Number of frames found
+     */
+    static size_t buildIndex(const uint8_t* data, size_t length, uint32_t* offsets, size_t maxFrames, uint32_t* totalSamples = nullptr);
+
+private:
+    static bool sameStream(const MpegFrameHeader& a, const MpegFrameHeader& b);
+};
+
+#endif // MPEG_AUDIO_H
@@ -0,0 +1,104 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+ * Decides how much uplink audio goes into one realtime message
+ *
+ * The realtime client sends whatever one poll of the fill callback returns
+ * as a single JSON append message, so the frame duration sets the JSON,
+ * WebSocket and TLS record overhead per second of audio. The target grows
+ * while sends are slow or audio backs up behind the sender and shrinks
+ * again once the link keeps up, within [minMs, maxMs]. The end of speech
+ * always flushes so the server sees the turn end without extra delay.
+ */
+class UplinkPacketizer {
+public:
+	struct Config {
+		uint32_t minMs;
+		uint32_t maxMs;
+		uint32_t startMs;
+		uint32_t stepMs;  // Adaptation step per decision
+	};
+
+	UplinkPacketizer(): _config{20, 200, 60, 20} { reset(); }
+
+	inline void init(const Config& config) {
+		_config = config;
+		if (_config.minMs == 0) _config.minMs = 1;
+		if (_config.maxMs < _config.minMs) _config.maxMs = _config.minMs;
+		reset();
+	}
+
+	/**
+	 * Start a new session at the initial target
+	 */
+	inline void reset() {
+		_targetMs = constrain(_config.startMs, _config.minMs, _config.maxMs);
+		_lastEmit = 0;
+		_lastReturn = 0;
+		_sendMs = 0;
+		_messages = 0;
+	}
+
+	/**
+	 * Called at the top of every poll: decide whether to emit now
+	 * @param pendingMs Audio waiting in the capture history
+	 * @param speechEnded Speech just stopped, flush regardless of size
+	 * @param now millis()
+	 * @return true to read and send the pending audio
+	 */
+	inline bool ready(uint32_t pendingMs, bool speechEnded, unsigned long now) {
+		if (_lastEmit == 0) _lastEmit = now;
+		if (pendingMs == 0) return false;
+		if (speechEnded) return true;
+		if (pendingMs >= _targetMs) return true;
+		// Never hold audio longer than the largest frame, even if delivery is lumpy
+		return now - _lastEmit >= _config.maxMs;
+	}
+
+	/**
+	 * Called after a poll returned audio
+	 * @param backlogMs Audio still waiting after this message
+	 * @param now millis()
+	 */
+	inline void emitted(uint32_t backlogMs, unsigned long now) {
+		_messages++;
+		_lastEmit = now;
+		_lastReturn = now;
+		adapt(backlogMs);
+	}
+
+	/**
+	 * Called at the start of a poll that follows a non-empty return: the gap is
+	 * how long the client spent sending that message before polling again
+	 */
+	inline void polled(unsigned long now) {
+		if (_lastReturn == 0) return;
+		uint32_t gap = now - _lastReturn;
+		_lastReturn = 0;
+		// Smooth over a few messages, TLS writes are bursty
+		_sendMs = _sendMs == 0 ? gap : (_sendMs * 3 + gap) / 4;
+	}
+
+	inline uint32_t targetMs() const { return _targetMs; }
+	inline uint32_t sendMs() const { return _sendMs; }
+	inline uint32_t messages() const { return _messages; }
+
+private:
+	Config _config;
+	uint32_t _targetMs;
+	unsigned long _lastEmit;
+	unsigned long _lastReturn;
+	uint32_t _sendMs;
+	uint32_t _messages;
+
+	inline void adapt(uint32_t backlogMs) {
+		// Sending eats a large part of each frame's duration, or audio queues up: larger frames
+		if (_sendMs * 2 > _targetMs || backlogMs > _targetMs * 2) {
+			_targetMs += _config.stepMs;
+		} else if (_sendMs * 4 < _targetMs && backlogMs < _targetMs / 2) {
+			_targetMs = _targetMs > _config.stepMs / 2 ? _targetMs - _config.stepMs / 2 : 0;
+		}
+		_targetMs = constrain(_targetMs, _config.minMs, _config.maxMs);
+	}
+};
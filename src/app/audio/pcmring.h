@@ -0,0 +1,223 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+/**
+ * Preallocated single-writer, multi-reader PCM ring
+ *
+ * The writer never blocks and never waits for readers: it overwrites the
+ * oldest samples. Every Reader owns its own cursor, so each consumer sees
+ * the full stream independently and counts the samples it lost when it
+ * falls more than one ring behind.
+ */
+class PcmRing {
+public:
+	static const size_t CACHE_LINE = 64;
+
+	class Reader {
+	public:
+		Reader(): _ring(nullptr), _cursor(0), _overruns(0), _dropped(0) {}
+
+		/**
+		 * Samples ready to read, may exceed the ring size after an overrun
+		 */
+		inline size_t available() const {
+			if (!_ring) return 0;
+			return _ring->_head.load(std::memory_order_acquire) - _cursor;
+		}
+
+		/**
+		 * Copy the next samples in stream order
+		 * @param out Destination buffer
+		 * @param maxSamples Capacity of out in samples
+		 * @return Number of samples copied
+		 */
+		inline size_t read(int16_t* out, size_t maxSamples) {
+			if (!_ring || !out || maxSamples == 0) return 0;
+
+			for (int attempt = 0; attempt < 3; attempt++) {
+				uint32_t head = _ring->_head.load(std::memory_order_acquire);
+				skipLost(head);
+
+				size_t count = head - _cursor;
+				if (count > maxSamples) count = maxSamples;
+				if (count == 0) return 0;
+
+				_ring->copyOut(_cursor, out, count);
+
+				// The writer may have lapped us while copying
+				uint32_t after = _ring->_head.load(std::memory_order_acquire);
+				if (after - _cursor > _ring->safeWindow()) {
+					skipLost(after);
+					continue;
+				}
+
+				_cursor += count;
+				return count;
+			}
+			return 0;
+		}
+
+		/**
+		 * Block until at least minSamples are available
+		 * @param timeout Ticks to wait
+		 * @return true if data is available
+		 */
+		inline bool wait(TickType_t timeout, size_t minSamples = 1) {
+			if (!_ring) return false;
+			TickType_t start = xTaskGetTickCount();
+			while (available() < minSamples) {
+				TickType_t elapsed = xTaskGetTickCount() - start;
+				if (elapsed >= timeout) return false;
+				xEventGroupWaitBits(_ring->_events, DATA_BIT, pdTRUE, pdFALSE, timeout - elapsed);
+			}
+			return true;
+		}
+
+		/**
+		 * Move the cursor back into history, e.g. to replay audio captured before attaching
+		 * @param samples Samples to step back from the newest sample
+		 * @return Samples actually available, bounded by the ring and what was ever written
+		 */
+		inline size_t rewind(size_t samples) {
+			if (!_ring) return 0;
+			uint32_t head = _ring->_head.load(std::memory_order_acquire);
+			size_t limit = _ring->safeWindow();
+			if (limit > head) limit = head;
+			if (samples > limit) samples = limit;
+			_cursor = head - samples;
+			return samples;
+		}
+
+		/**
+		 * Drop any backlog and continue from the newest sample
+		 */
+		inline void sync() {
+			if (_ring) _cursor = _ring->_head.load(std::memory_order_acquire);
+		}
+
+		inline bool attached() const { return _ring != nullptr; }
+		inline uint32_t overruns() const { return _overruns; }
+		inline uint32_t dropped() const { return _dropped; }
+		inline uint32_t position() const { return _cursor; }
+
+	private:
+		friend class PcmRing;
+		PcmRing* _ring;
+		uint32_t _cursor;
+		uint32_t _overruns;
+		uint32_t _dropped;
+
+		inline void skipLost(uint32_t head) {
+			uint32_t window = _ring->safeWindow();
+			if (head - _cursor > window) {
+				uint32_t oldest = head - window;
+				_dropped += oldest - _cursor;
+				_overruns++;
+				_cursor = oldest;
+			}
+		}
+	};
+
+	PcmRing(): _buffer(nullptr), _capacity(0), _mask(0), _maxWrite(0), _head(0), _events(nullptr) {}
+	~PcmRing() {
+		if (_buffer) heap_caps_free(_buffer);
+		if (_events) vEventGroupDelete(_events);
+	}
+
+	/**
+	 * Allocate the ring once
+	 * @param samples Minimum capacity in samples, rounded up to a power of two
+	 * @return true if allocation succeeded
+	 */
+	inline bool init(size_t samples) {
+		if (_buffer) return true;
+
+		size_t capacity = CACHE_LINE / sizeof(int16_t);
+		while (capacity < samples) capacity <<= 1;
+
+		_buffer = (int16_t*)heap_caps_aligned_alloc(CACHE_LINE, capacity * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+		if (!_buffer) {
+			_buffer = (int16_t*)heap_caps_aligned_alloc(CACHE_LINE, capacity * sizeof(int16_t), MALLOC_CAP_DEFAULT);
+		}
+		_events = xEventGroupCreate();
+		if (!_buffer || !_events) {
+			ESP_LOGE("PcmRing", "Failed to allocate %d samples", capacity);
+			return false;
+		}
+
+		memset(_buffer, 0, capacity * sizeof(int16_t));
+		_capacity = capacity;
+		_mask = capacity - 1;
+		return true;
+	}
+
+	/**
+	 * Append samples, only called from the single producer task
+	 * @param samples Input samples
+	 * @param count Number of samples
+	 */
+	inline void write(const int16_t* samples, size_t count) {
+		if (!_buffer || !samples || count == 0) return;
+		if (count > _capacity / 2) {
+			// Keep at least half a ring readable while a write is in flight
+			samples += count - _capacity / 2;
+			count = _capacity / 2;
+		}
+		if (count > _maxWrite) _maxWrite = count;
+
+		uint32_t head = _head.load(std::memory_order_relaxed);
+		size_t offset = head & _mask;
+		size_t first = _capacity - offset;
+		if (first > count) first = count;
+		memcpy(_buffer + offset, samples, first * sizeof(int16_t));
+		if (count > first) {
+			memcpy(_buffer, samples + first, (count - first) * sizeof(int16_t));
+		}
+
+		_head.store(head + count, std::memory_order_release);
+		xEventGroupSetBits(_events, DATA_BIT);
+	}
+
+	/**
+	 * Create a reader positioned at the newest sample
+	 */
+	inline Reader reader() {
+		Reader r;
+		r._ring = this;
+		r.sync();
+		return r;
+	}
+
+	inline size_t capacity() const { return _capacity; }
+	inline uint32_t written() const { return _head.load(std::memory_order_acquire); }
+	inline bool isReady() const { return _buffer != nullptr; }
+
+private:
+	static const EventBits_t DATA_BIT = BIT0;
+
+	int16_t* _buffer;
+	size_t _capacity;
+	size_t _mask;
+	size_t _maxWrite;
+	std::atomic<uint32_t> _head; // Total samples written, wraps naturally
+	EventGroupHandle_t _events;
+
+	// Samples behind head that cannot be overwritten by a write in progress
+	inline uint32_t safeWindow() const {
+		return _capacity - _maxWrite;
+	}
+
+	inline void copyOut(uint32_t position, int16_t* out, size_t count) const {
+		size_t offset = position & _mask;
+		size_t first = _capacity - offset;
+		if (first > count) first = count;
+		memcpy(out, _buffer + offset, first * sizeof(int16_t));
+		if (count > first) {
+			memcpy(out + first, _buffer, (count - first) * sizeof(int16_t));
+		}
+	}
+};
@@ -0,0 +1,229 @@
+#include "resampler.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#endif
+
+namespace {
+
+const double ROLLOFF = 0.9;     // Passband edge relative to the lower Nyquist
+const double KAISER_BETA = 7.0; // ~70 dB stopband
+
+uint32_t gcd(uint32_t a, uint32_t b) {
+    while (b != 0) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth-order modified Bessel function, used by the Kaiser window
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half = x / 2.0;
+    for (int k = 1; k < 64; ++k) {
+        term *= (half / k) * (half / k);
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+void* allocTable(size_t bytes) {
+#if defined(ESP_PLATFORM)
+    // Small tables are hit for every output sample, keep them out of PSRAM
+    void* ptr = nullptr;
+    if (bytes <= AudioResampler::INTERNAL_TABLE_LIMIT) {
+        ptr = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!ptr) {
+        ptr = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+    }
+    return ptr;
+#else
+    return malloc(bytes);
+#endif
+}
+
+void freeTable(void* ptr) {
+#if defined(ESP_PLATFORM)
+    heap_caps_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+inline int16_t dotQ15(const int16_t* window, const int16_t* coeffs, uint32_t taps) {
+    int32_t acc = 1 << 14; // Rounding
+    for (uint32_t k = 0; k < taps; ++k) {
+        acc += (int32_t)window[k] * coeffs[k];
+    }
+    acc >>= 15;
+    if (acc > 32767) return 32767;
+    if (acc < -32768) return -32768;
+    return (int16_t)acc;
+}
+
+} // namespace
+
+AudioResampler::AudioResampler()
+    : _inputRate(0), _outputRate(0), _up(1), _down(1), _taps(0), _phase(0), _pos(0),
+      _coeffs(nullptr), _history(nullptr), _ready(false) {
+}
+
+AudioResampler::AudioResampler(uint32_t inputRate, uint32_t outputRate)
+    : AudioResampler() {
+    init(inputRate, outputRate);
+}
+
+AudioResampler::~AudioResampler() {
+    release();
+}
+
+bool AudioResampler::init(uint32_t inputRate, uint32_t outputRate) {
+    release();
+    if (inputRate == 0 || outputRate == 0) {
+        return false;
+    }
+
+    uint32_t g = gcd(inputRate, outputRate);
+    _inputRate = inputRate;
+    _outputRate = outputRate;
+    _up = outputRate / g;
+    _down = inputRate / g;
+
+    if (isPassthrough()) {
+        _ready = true;
+        return true;
+    }
+
+    if (_up > MAX_PHASES) {
+        return false; // Ratio too fine-grained for a table-driven filter bank
+    }
+
+    // Keep the anti-aliasing filter equally sharp when decimating
+    uint32_t decimation = (_down + _up - 1) / _up;
+    uint32_t taps = BASE_TAPS * std::max<uint32_t>(1, decimation);
+    _taps = taps < MAX_TAPS ? taps : MAX_TAPS;
+
+    _coeffs = (int16_t*)allocTable(_up * _taps * sizeof(int16_t));
+    _history = (int16_t*)allocTable(2 * _taps * sizeof(int16_t));
+    if (!_coeffs || !_history) {
+        release();
+        return false;
+    }
+
+    designFilter();
+    reset();
+    _ready = true;
+    return true;
+}
+
+void AudioResampler::reset() {
+    _phase = 0;
+    _pos = 0;
+    if (_history) {
+        memset(_history, 0, 2 * _taps * sizeof(int16_t));
+    }
+}
+
+size_t AudioResampler::process(const int16_t* in, size_t inLen, int16_t* out, size_t outCap, size_t* consumed) {
+    if (consumed) *consumed = 0;
+    if (!_ready || !in || !out) {
+        return 0;
+    }
+
+    if (isPassthrough()) {
+        size_t n = std::min(inLen, outCap);
+        memmove(out, in, n * sizeof(int16_t));
+        if (consumed) *consumed = n;
+        return n;
+    }
+
+    const size_t perInput = (_up + _down - 1) / _down;
+    size_t written = 0;
+    size_t i = 0;
+
+    for (; i < inLen; ++i) {
+        if (outCap - written < perInput) {
+            break;
+        }
+
+        // Mirrored write keeps [_pos + 1, _pos + _taps] contiguous, oldest first
+        _history[_pos] = in[i];
+        _history[_pos + _taps] = in[i];
+        const int16_t* window = &_history[_pos + 1];
+        if (++_pos == _taps) {
+            _pos = 0;
+        }
+
+        while (_phase < _up) {
+            out[written++] = dotQ15(window, &_coeffs[_phase * _taps], _taps);
+            _phase += _down;
+        }
+        _phase -= _up;
+    }
+
+    if (consumed) *consumed = i;
+    return written;
+}
+
+size_t AudioResampler::maxOutputSize(size_t inputSamples) const {
+    if (isPassthrough()) {
+        return inputSamples;
+    }
+    return (size_t)(((uint64_t)inputSamples * _up + _down - 1) / _down) + 1;
+}
+
+void AudioResampler::release() {
+    if (_coeffs) {
+        freeTable(_coeffs);
+        _coeffs = nullptr;
+    }
+    if (_history) {
+        freeTable(_history);
+        _history = nullptr;
+    }
+    _ready = false;
+    _up = _down = 1;
+    _taps = 0;
+    _phase = 0;
+    _pos = 0;
+}
+
+void AudioResampler::designFilter() {
+    // Prototype lowpass at the upsampled rate L * Fin, cut below the lower Nyquist
+    const uint32_t length = _up * _taps;
+    const double cutoff = ROLLOFF * 0.5 / std::max(_up, _down);
+    const double center = (length - 1) / 2.0;
+    const double norm = besselI0(KAISER_BETA);
+    float branch[MAX_TAPS];
+
+    for (uint32_t p = 0; p < _up; ++p) {
+        double sum = 0.0;
+        for (uint32_t k = 0; k < _taps; ++k) {
+            double t = (p + k * _up) - center;
+            double x = 2.0 * cutoff * t;
+            double sinc = (t == 0.0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double r = t / (center + 0.5);
+            double window = besselI0(KAISER_BETA * sqrt(std::max(0.0, 1.0 - r * r))) / norm;
+            branch[k] = (float)(2.0 * cutoff * sinc * window);
+            sum += branch[k];
+        }
+
+        // Normalize every branch to unity DC gain so no phase modulates the level
+        double scale = (sum != 0.0) ? 32768.0 / sum : 0.0;
+        for (uint32_t k = 0; k < _taps; ++k) {
+            long q = lround(branch[k] * scale);
+            q = std::max(-32768L, std::min(32767L, q));
+            // Tap k applies to x[n - k]; store reversed to match the oldest-first window
+            _coeffs[p * _taps + (_taps - 1 - k)] = (int16_t)q;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Streaming rational-ratio resampler for 16-bit mono PCM.
+ *
+ * The ratio is reduced to L/M (up/down) and a windowed-sinc prototype is
+ * split into L Q15 polyphase branches once in init(). History and phase are
+ * carried between process() calls, so a stream cut into arbitrary chunks
+ * produces exactly the same output as the whole stream at once.
+ *
+ * Typical ratios: 16k->24k (3/2), 24k->16k (2/3), 22.05k/44.1k <-> 16k.
+ */
+class AudioResampler {
+public:
+    static const uint32_t BASE_TAPS = 16;          // Taps per phase when upsampling
+    static const uint32_t MAX_TAPS = 64;           // Upper bound on taps per phase
+    static const uint32_t MAX_PHASES = 1024;       // Upper bound on L
+    static const size_t INTERNAL_TABLE_LIMIT = 2048; // Tables up to this size stay in internal RAM
+
+    AudioResampler();
+    AudioResampler(uint32_t inputRate, uint32_t outputRate);
+    ~AudioResampler();
+
+    AudioResampler(const AudioResampler&) = delete;
+    AudioResampler& operator=(const AudioResampler&) = delete;
+
+    /**
+     * Build the polyphase filter bank for a rate pair and reset the stream state
+     *
+     * @param inputRate Input sample rate in Hz (e.g., 16000)
+     * @param outputRate Output sample rate in Hz (e.g., 24000)
+     * @return true if the resampler is ready
+     */
+    bool init(uint32_t inputRate, uint32_t outputRate);
+
+    /**
+     * Clear history and phase, e.g. at the start of a new stream
+     */
+    void reset();
+
+    /**
+     * Resample the next chunk of a continuous stream
+     *
+     * Input is consumed sample by sample until it is exhausted or the output
+     * buffer cannot hold the result of one more input sample.
+     *
+     * @param in Input samples
+     * @param inLen Number of input samples
+     * @param out Output buffer
+     * @param outCap Capacity of output buffer in samples
+     * @param consumed Optional, receives the number of input samples consumed
+     * @return Number of samples written to out
+     */
+    size_t process(const int16_t* in, size_t inLen, int16_t* out, size_t outCap, size_t* consumed = nullptr);
+
+    /**
+     * Upper bound of output samples produced by the next process() call
+     *
+     * @param inputSamples Number of input samples
+     * @return Output buffer size in samples that is always large enough
+     */
+    size_t maxOutputSize(size_t inputSamples) const;
+
+    bool isReady() const { return _ready; }
+    bool isPassthrough() const { return _up == _down; }
+    uint32_t inputRate() const { return _inputRate; }
+    uint32_t outputRate() const { return _outputRate; }
+
+private:
+    uint32_t _inputRate;
+    uint32_t _outputRate;
+    uint32_t _up;      // L
+    uint32_t _down;    // M
+    uint32_t _taps;    // Taps per phase
+    uint32_t _phase;   // Position of the next output inside the current input period, [0, L + M)
+    uint32_t _pos;     // Write position inside the history delay line
+    int16_t* _coeffs;  // L x taps, oldest-to-newest order per phase
+    int16_t* _history; // 2 x taps mirrored delay line, always readable as one contiguous window
+    bool _ready;
+
+    void release();
+    void designFilter();
+};
+
+#endif // AUDIO_RESAMPLER_H
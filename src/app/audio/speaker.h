@@ -4,6 +4,9 @@
 #include <Arduino.h>
 #include <app_config.h>
 #include "I2SSpeaker.h"
+#include "dsp.h"
+#include "mixer.h"
+#include "resampler.h"
 #include "note.h"
 #include "music/music.h"
 
@@ -11,12 +14,36 @@
 #define SPEAKER_VOLUME 1.0f
 #endif
 
+#ifndef SPEAKER_BUFFER_MS
+#define SPEAKER_BUFFER_MS 10000 // Jitter buffer of the voice channel
+#endif
+
+#ifndef SPEAKER_START_MS
+#define SPEAKER_START_MS 200 // Voice buffered before playback starts, and again after an underrun
+#endif
+
+#ifndef SPEAKER_MUSIC_GAIN
+#define SPEAKER_MUSIC_GAIN 0.6f
+#endif
+
+#ifndef SPEAKER_DUCK_GAIN
+#define SPEAKER_DUCK_GAIN 0.25f
+#endif
+
+#ifndef SPEAKER_TASK_PRIORITY
+#define SPEAKER_TASK_PRIORITY 10 // Mixer task, the only writer to I2S
+#endif
+
 /**
  * Speaker class for handling I2S audio output
+ *
+ * Owns the I2S device and sets up the mixer in front of it. The jitter
+ * buffers are the AudioChannels in mixer.h, one per channel, and the
+ * AudioMixer task is the dedicated I2S writer that drains them.
  */
 class Speaker {
 public:
-	Speaker() : speaker(nullptr) {}
+	Speaker() : speaker(nullptr), speakerRate(SPEAKER_SAMPLE_RATE) {}
 	~Speaker() {
 		if (speaker) {
 			delete speaker;
@@ -40,6 +67,7 @@ public:
 			ESP_LOGE("SPK", "Failed to initialize speaker: %s", esp_err_to_name(err));
 			return false;
 		}
+		speakerRate = SPEAKER_SAMPLE_RATE;
 
 		ESP_LOGI("SPK", "Speaker initialized successfully");
 		return true;
@@ -49,17 +77,31 @@ public:
 	 * @return true if successful, false otherwise
 	 */
 	inline bool start() {
-		if (!speaker) {
+		// The mixer task may be replacing the device for a clock switch
+		mixer.lockOutput();
+		bool ready = speaker != nullptr;
+		esp_err_t err = ready ? speaker->start() : ESP_OK;
+		mixer.unlockOutput();
+		if (!ready) {
 			ESP_LOGE("SPK", "Speaker not initialized");
 			return false;
 		}
-
-		esp_err_t err = speaker->start();
 		if (err != ESP_OK) {
 			ESP_LOGE("SPK", "Failed to start speaker: %s", esp_err_to_name(err));
 			return false;
 		}
 
+		// Earcons play over speech, speech ducks music
+		const size_t msSamples = SPEAKER_SAMPLE_RATE / 1000;
+		const AudioChannel::Config channels[AUDIO_CHANNEL_MAX] = {
+			/* voice  */ { msSamples * SPEAKER_BUFFER_MS, msSamples * SPEAKER_START_MS, 1.0f, 1, 0.5f },
+			/* earcon */ { msSamples * 1000, 1, 1.0f, 2, 1.0f },
+			/* music  */ { msSamples * 2000, msSamples * 100, SPEAKER_MUSIC_GAIN, 0, SPEAKER_DUCK_GAIN },
+		};
+		if (!mixer.begin(speaker, SPEAKER_SAMPLE_RATE, channels, SPEAKER_TASK_PRIORITY, 1, reopen, this)) {
+			ESP_LOGW("SPK", "Mixer task unavailable, writing to I2S directly");
+		}
+
 		ESP_LOGI("SPK", "Speaker started");
 		return true;
 	}
@@ -69,12 +111,15 @@ public:
 	 * @return true if successful, false otherwise
 	 */
 	inline bool stop(){
-		if (!speaker) {
+		// The mixer task may be replacing the device for a clock switch
+		mixer.lockOutput();
+		bool ready = speaker != nullptr;
+		esp_err_t err = ready ? speaker->stop() : ESP_OK;
+		mixer.unlockOutput();
+		if (!ready) {
 			ESP_LOGE("SPK", "Speaker not initialized");
 			return false;
 		}
-
-		esp_err_t err = speaker->stop();
 		if (err != ESP_OK) {
 			ESP_LOGE("SPK", "Failed to stop speaker: %s", esp_err_to_name(err));
 			return false;
@@ -85,34 +130,79 @@ public:
 	}
 
 	/**
-	 * Write audio samples to the speaker
-	 * @param buffer Buffer containing samples (int16_t)
-	 * @param sampleCount Number of samples to write
-	 * @param samplesWritten Pointer to store actual samples written
-	 * @return true if successful, false otherwise
+	 * Queue audio samples for playback
+	 * @param buffer Buffer containing samples (int16_t), left untouched
+	 * @param sampleCount Size of buffer in bytes
+	 * @param samplesWritten Pointer to store bytes queued
+	 * @param volume Gain applied while queuing
+	 * @param timeout Ticks to wait for space when the jitter buffer is full, 0 never blocks
+	 * @param channel Mixer channel
+	 * @param rate Sample rate of buffer, resampled when the output runs at another rate
+	 * @return true if everything was queued, false otherwise
 	 */
-	inline bool writeSamples(const int16_t* buffer, size_t sampleCount, size_t* samplesWritten, float volume = SPEAKER_VOLUME){
+	inline bool writeSamples(const int16_t* buffer, size_t sampleCount, size_t* samplesWritten, float volume = SPEAKER_VOLUME,
+		TickType_t timeout = portMAX_DELAY, AUDIO_CHANNEL channel = AUDIO_CHANNEL_VOICE, uint32_t rate = SPEAKER_SAMPLE_RATE){
 		if (!speaker) {
 			ESP_LOGE("SPK", "Speaker not initialized");
 			return false;
 		}
 
-		int16_t *buff = (int16_t*)buffer;
-		if (volume != 1.0f)
-			for (size_t i = 0; i < sampleCount / sizeof(int16_t); i++)
-				buff[i] = (int16_t)constrain(buff[i]*volume, -32768, 32767);
+		size_t count = sampleCount / sizeof(int16_t);
+		if (mixer.isRunning()) {
+			size_t queued = mixer.channel(channel).write(buffer, count, AudioDsp::gain(volume), timeout, rate);
+			if (samplesWritten) *samplesWritten = queued * sizeof(int16_t);
+			return queued == count;
+		}
 
-		esp_err_t err = speaker->writeAudioData(buff, sampleCount, samplesWritten, portMAX_DELAY);
-		if (err != ESP_OK) {
-			ESP_LOGE("SPK", "Failed to write samples: %s", esp_err_to_name(err));
+		// No mixer, the clock stays at SPEAKER_SAMPLE_RATE
+		if (samplesWritten) *samplesWritten = 0;
+		if (volume == 1.0f && (rate == 0 || rate == speakerRate)) {
+			esp_err_t err = speaker->writeAudioData((int16_t*)buffer, sampleCount, samplesWritten, portMAX_DELAY);
+			if (err != ESP_OK) {
+				ESP_LOGE("SPK", "Failed to write samples: %s", esp_err_to_name(err));
+				return false;
+			}
+			return true;
+		}
+
+		// Resample and apply the gain in blocks, the caller's buffer stays untouched
+		bool resample = rate != 0 && rate != speakerRate;
+		if (resample && (!directResampler.isReady() || directResampler.inputRate() != rate || directResampler.outputRate() != speakerRate)
+			&& !directResampler.init(rate, speakerRate)) {
+			ESP_LOGE("SPK", "Cannot play %d Hz audio at %d Hz", rate, speakerRate);
 			return false;
 		}
+		AudioDsp::Gain gain = AudioDsp::gain(volume);
+		int16_t block[AudioMixer::BLOCK_SAMPLES];
+		size_t done = 0;
+		while (done < count) {
+			size_t used = count - done;
+			size_t n;
+			if (resample) {
+				n = directResampler.process(buffer + done, count - done, block, AudioMixer::BLOCK_SAMPLES, &used);
+			} else {
+				n = used < AudioMixer::BLOCK_SAMPLES ? used : AudioMixer::BLOCK_SAMPLES;
+				used = n;
+				memcpy(block, buffer + done, n * sizeof(int16_t));
+			}
+			if (used == 0) break;
+			AudioDsp::applyGain(block, block, n, gain);
 
-		return true;
+			size_t written = 0;
+			esp_err_t err = n > 0 ? speaker->writeAudioData(block, n * sizeof(int16_t), &written, portMAX_DELAY) : ESP_OK;
+			if (err != ESP_OK) {
+				ESP_LOGE("SPK", "Failed to write samples: %s", esp_err_to_name(err));
+				return false;
+			}
+			done += used;
+			if (samplesWritten) *samplesWritten = done * sizeof(int16_t);
+		}
+
+		return done == count;
 	}
 
 	/**
-	 * Play a tone
+	 * Play a tone on the earcon channel, mixed over any speech
 	 * @param frequency Frequency in Hz
 	 * @param duration Duration in ms
 	 * @param amplitude Amplitude (0.0 to 1.0)
@@ -124,28 +214,150 @@ public:
 			return -1;
 		}
 
-		bool result = speaker->playTone(frequency, duration, amplitude);
-		speaker->clear();
+		if (!mixer.isRunning()) {
+			bool result = speaker->playTone(frequency, duration, amplitude);
+			speaker->clear();
+			return result;
+		}
 
-		return result;
+		size_t done = queueTone(AUDIO_CHANNEL_EARCON, frequency, duration, amplitude);
+		mixer.channel(AUDIO_CHANNEL_EARCON).drain();
+		return (int)done;
 	}
 
 	/**
-	 * Clear Speaker buffer
-	 *
+	 * Queue a melody on the music channel, blocks only while the channel buffer is full
+	 * @param notes Notes terminated by {0, 0}
+	 * @param amplitude Amplitude (0.0 to 1.0)
+	 * @return Number of samples queued, or -1 on error
+	 */
+	inline int playMelody(const MusicNote* notes, float amplitude = 0.5f) {
+		if (!speaker || !notes || !mixer.isRunning()) {
+			ESP_LOGE("SPK", "Speaker mixer not running");
+			return -1;
+		}
+
+		size_t done = 0;
+		for (; notes->duration > 0; notes++) {
+			done += queueTone(AUDIO_CHANNEL_MUSIC, notes->frequency, notes->duration, notes->frequency > 0 ? amplitude : 0.0f);
+		}
+		mixer.channel(AUDIO_CHANNEL_MUSIC).drain();
+		return (int)done;
+	}
+
+	/**
+	 * Mark the end of a stream, its buffered audio still plays out
+	 * @param channel Mixer channel
 	 * @return ESP_OK if successful, error code otherwise
 	 */
-	inline esp_err_t clear() {
+	inline esp_err_t clear(AUDIO_CHANNEL channel = AUDIO_CHANNEL_VOICE) {
 		if (!speaker) {
 			ESP_LOGE("SPK", "Speaker not initialized");
 			return ESP_FAIL;
 		}
 
+		if (mixer.isRunning()) {
+			mixer.channel(channel).drain();
+			return ESP_OK;
+		}
 		return speaker->clear();
 	}
 
+	/**
+	 * Stop a channel immediately and drop anything still buffered
+	 * @param channel Mixer channel
+	 */
+	inline void discard(AUDIO_CHANNEL channel = AUDIO_CHANNEL_VOICE) {
+		if (mixer.isRunning()) mixer.channel(channel).discard();
+		else if (speaker) speaker->clear();
+	}
+
+	/**
+	 * Run the I2S clock at another rate, e.g. the native rate of a realtime session
+	 * @param rate Sample rate in Hz
+	 * @param waitMs How long audio queued at the old rate may keep playing before it is faded out
+	 */
+	inline void setSampleRate(uint32_t rate, uint32_t waitMs = 300) {
+		if (!mixer.isRunning()) {
+			ESP_LOGW("SPK", "Mixer not running, keeping %d Hz", SPEAKER_SAMPLE_RATE);
+			return;
+		}
+		mixer.setSampleRate(rate, waitMs);
+	}
+
+	inline uint32_t getSampleRate() const { return mixer.isRunning() ? mixer.sampleRate() : SPEAKER_SAMPLE_RATE; }
+
+	inline AudioMixer& getMixer() { return mixer; }
+
 private:
 	I2SSpeaker* speaker;
+	uint32_t speakerRate;
+	AudioMixer mixer;
+	AudioResampler directResampler; // Only while the mixer is not running
+
+	// Create and start a device at a rate, nullptr if the driver refused
+	static I2SSpeaker* open(uint32_t rate) {
+		I2SSpeaker* device = new I2SSpeaker(I2S_SPEAKER_DOUT_PIN, I2S_SPEAKER_BCLK_PIN, I2S_SPEAKER_LRC_PIN, I2S_SPEAKER_PORT);
+		esp_err_t err = device->init(rate, SPEAKER_BIT_DEPTH, SPEAKER_CHANNELS);
+		if (err == ESP_OK) err = device->start();
+		if (err != ESP_OK) {
+			ESP_LOGE("SPK", "Failed to open speaker at %d Hz: %s", rate, esp_err_to_name(err));
+			delete device;
+			return nullptr;
+		}
+		return device;
+	}
+
+	/**
+	 * Clock callback, runs on the mixer task with the old clock idle and the output lock held
+	 *
+	 * The library cannot change the clock of a running device and the port
+	 * is single-use, so the old device goes before the new one is opened.
+	 * If that fails the old rate is opened again and reported back.
+	 */
+	static I2SSpeaker* reopen(uint32_t& rate, void* arg) {
+		Speaker* self = static_cast<Speaker*>(arg);
+		uint32_t previous = self->speakerRate;
+		if (self->speaker) {
+			self->speaker->stop();
+			delete self->speaker;
+			self->speaker = nullptr;
+		}
+
+		I2SSpeaker* device = open(rate);
+		if (!device && rate != previous) {
+			device = open(previous);
+			rate = previous;
+		}
+		if (!device) {
+			ESP_LOGE("SPK", "Speaker lost, no clock could be opened");
+			return nullptr;
+		}
+		self->speaker = device;
+		self->speakerRate = rate;
+		return device;
+	}
+
+	// Synthesize a sine into a channel in mixer-sized blocks
+	inline size_t queueTone(AUDIO_CHANNEL channel, float frequency, uint32_t duration, float amplitude) {
+		int16_t block[AudioMixer::BLOCK_SAMPLES];
+		uint32_t rate = mixer.sampleRate();
+		size_t total = (size_t)rate * duration / 1000;
+		float step = 2.0f * PI * frequency / rate;
+		float level = amplitude * 32767.0f;
+		size_t done = 0;
+		while (done < total) {
+			size_t n = total - done;
+			if (n > AudioMixer::BLOCK_SAMPLES) n = AudioMixer::BLOCK_SAMPLES;
+			for (size_t i = 0; i < n; i++) {
+				block[i] = (int16_t)(level * sinf(step * (done + i)));
+			}
+			size_t queued = mixer.channel(channel).write(block, n, AudioDsp::gain(1.0f), portMAX_DELAY, rate);
+			if (queued == 0) break;
+			done += queued;
+		}
+		return done;
+	}
 };
 
 #endif // SPEAKER_H
\ No newline at end of file
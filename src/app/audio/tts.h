@@ -5,6 +5,9 @@
 
 extern Speaker* speaker;
 
+// PicoTTS always synthesizes 16kHz mono
+#define TTS_SAMPLE_RATE 16000
+
 class TTS {
 public:
 	TTS(){}
@@ -37,7 +40,7 @@ private:
 		}
 
 		size_t written = 0;
-		speaker->writeSamples(samples, count * sizeof(int16_t), &written);
+		speaker->writeSamples(samples, count * sizeof(int16_t), &written, SPEAKER_VOLUME, portMAX_DELAY, AUDIO_CHANNEL_VOICE, TTS_SAMPLE_RATE);
 	}
 	
 	inline static void idle(void){
@@ -1,8 +1,10 @@
 #pragma once
+#include <Arduino.h>
 #include <cstdint>
 #include <FS.h>
 #include <esp_heap_caps.h>
-#include "converter.h"
+#include "resampler.h"
+#include "dsp.h"
 
 typedef struct __attribute__((packed)) {
     // RIFF header
@@ -25,33 +27,163 @@ typedef struct __attribute__((packed)) {
     uint32_t data_size;     // Data size (file_size - 44)
 } wav_hdr;
 
+#ifndef WAV_BLOCK_SIZE
+#define WAV_BLOCK_SIZE (32 * 1024)
+#endif
+
+#ifndef WAV_WRITER_PRIORITY
+#define WAV_WRITER_PRIORITY 1
+#endif
+
+#ifndef WAV_SCRATCH_SAMPLES
+#define WAV_SCRATCH_SAMPLES 512
+#endif
+
+/**
+ * WAV file recorder with a background writer
+ *
+ * Samples are gathered into two PSRAM blocks. The header sits at the start
+ * of the first block, so every flush is a full WAV_BLOCK_SIZE write at a
+ * block-aligned file offset. Full blocks are handed to a low-priority writer
+ * task while the caller keeps filling the other block; the caller only
+ * blocks when flash falls a whole block behind.
+ */
 class WavRecorder {
 private:
+	struct Block {
+		uint8_t index;
+		size_t bytes;
+	};
+
 	FS* _fs = nullptr;
 	File _audioFile;
 	wav_hdr _currentHeader;
 	bool _recording = false;
-	float _volumeGain = 30.0f;
+	AudioDsp::Gain _volumeGain = AudioDsp::gain(30.0f);
 	size_t _recordedBytes = 0;
 	size_t _minFreeSpaceBytes = 1048576;
 	String _filename;
 	uint32_t _inputKhz = 16;  // Default input sample rate
 	uint32_t _outputKhz = 16; // Default output sample rate (no resampling)
 	bool _needsResampling = false;
+	AudioResampler _resampler;
+
+	uint8_t* _blocks[2] = {nullptr, nullptr};
+	int16_t* _scratch = nullptr;
+	QueueHandle_t _freeBlocks = nullptr;
+	QueueHandle_t _fullBlocks = nullptr;
+	TaskHandle_t _writer = nullptr;
+	int _current = -1;  // Block being filled, -1 when none is held
+	size_t _fill = 0;   // Bytes in the current block
+	uint32_t _writeCalls = 0;
+	uint32_t _writeErrors = 0;
+	unsigned long _writeMs = 0;
+
+	// Allocate the blocks, scratch and writer task once, they are reused by every recording
+	inline bool allocate() {
+		if (_writer) return true;
+
+		for (int i = 0; i < 2; i++) {
+			if (!_blocks[i]) _blocks[i] = (uint8_t*)heap_caps_malloc(WAV_BLOCK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+		}
+		if (!_scratch) _scratch = (int16_t*)heap_caps_malloc(WAV_SCRATCH_SAMPLES * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+		if (!_freeBlocks) _freeBlocks = xQueueCreate(2, sizeof(uint8_t));
+		if (!_fullBlocks) _fullBlocks = xQueueCreate(2, sizeof(Block));
+		if (!_blocks[0] || !_blocks[1] || !_scratch || !_freeBlocks || !_fullBlocks) {
+			ESP_LOGE("WAV", "Failed to allocate recorder buffers");
+			return false;
+		}
+
+		for (uint8_t i = 0; i < 2; i++) xQueueSend(_freeBlocks, &i, 0);
+
+		BaseType_t ret = xTaskCreatePinnedToCoreWithCaps(writerTask, "wavWriter", 1024 * 4, this, WAV_WRITER_PRIORITY, &_writer, tskNO_AFFINITY, MALLOC_CAP_INTERNAL);
+		if (ret != pdPASS) {
+			_writer = nullptr;
+			ESP_LOGE("WAV", "Failed to create WAV writer task");
+			return false;
+		}
+		return true;
+	}
+
+	static void writerTask(void* arg) {
+		WavRecorder* self = static_cast<WavRecorder*>(arg);
+		Block block;
+		while (true) {
+			if (xQueueReceive(self->_fullBlocks, &block, portMAX_DELAY) != pdTRUE) continue;
+
+			unsigned long t0 = millis();
+			size_t written = self->_audioFile.write(self->_blocks[block.index], block.bytes);
+			self->_writeMs += millis() - t0;
+			self->_writeCalls++;
+			if (written != block.bytes) {
+				self->_writeErrors++;
+				ESP_LOGE("WAV", "Short write: %d of %d bytes", written, block.bytes);
+			}
+			xQueueSend(self->_freeBlocks, &block.index, portMAX_DELAY);
+		}
+	}
+
+	// Hand the current block to the writer
+	inline void flushBlock() {
+		if (_current < 0) return;
+		if (_fill > 0) {
+			Block block = { (uint8_t)_current, _fill };
+			xQueueSend(_fullBlocks, &block, portMAX_DELAY);
+		} else {
+			uint8_t index = (uint8_t)_current;
+			xQueueSend(_freeBlocks, &index, portMAX_DELAY);
+		}
+		_current = -1;
+		_fill = 0;
+	}
+
+	// Copy samples into the blocks with gain, flushing every full block
+	inline void append(const int16_t* samples, size_t count) {
+		while (count > 0) {
+			if (_current < 0) {
+				uint8_t index;
+				xQueueReceive(_freeBlocks, &index, portMAX_DELAY);
+				_current = index;
+				_fill = 0;
+			}
+
+			size_t room = (WAV_BLOCK_SIZE - _fill) / sizeof(int16_t);
+			size_t n = count < room ? count : room;
+			AudioDsp::applyGain(samples, (int16_t*)(_blocks[_current] + _fill), n, _volumeGain);
+			_fill += n * sizeof(int16_t);
+			_recordedBytes += n * sizeof(int16_t);
+			samples += n;
+			count -= n;
+
+			if (_fill + sizeof(int16_t) > WAV_BLOCK_SIZE) flushBlock();
+		}
+	}
+
+	// Wait until the writer returned both blocks
+	inline void waitIdle() {
+		uint8_t held[2];
+		for (int i = 0; i < 2; i++) xQueueReceive(_freeBlocks, &held[i], portMAX_DELAY);
+		for (int i = 0; i < 2; i++) xQueueSend(_freeBlocks, &held[i], 0);
+	}
 
 public:
 	inline void init(FS& filesystem) { _fs = &filesystem; }
 
-	inline void setVolume(float gain) { _volumeGain = gain; }
+	inline void setVolume(float gain) { _volumeGain = AudioDsp::gain(gain); }
 
 	inline void setMinFreeSpace(size_t bytes) { _minFreeSpaceBytes = bytes; }
 
 	inline bool start(const String& fname, uint32_t khzIn = 16, int32_t khzOut = -1) {
 		if (_recording || !_fs) return false;
+		if (!allocate()) return false;
 		_filename = fname;
 		_inputKhz = khzIn;
 		_outputKhz = (khzOut == -1) ? khzIn : (uint32_t)khzOut; // -1 means no resampling
 		_needsResampling = (khzOut != -1 && khzIn != (uint32_t)khzOut);
+		if (_needsResampling && !_resampler.init(_inputKhz * 1000, _outputKhz * 1000)) {
+			ESP_LOGE("WAV", "Failed to initialize resampler %dkHz -> %dkHz", _inputKhz, _outputKhz);
+			return false;
+		}
 
 		// Create WAV header
 		uint32_t sampleRate = _needsResampling ? (_outputKhz * 1000) : (_inputKhz * 1000);
@@ -77,68 +209,59 @@ public:
 		_currentHeader.data_size = 0;  // Will be updated on stop()
 
 		_audioFile = _fs->open(_filename, "w");
-		if (_audioFile) {
-			size_t written = _audioFile.write((uint8_t*)&_currentHeader, sizeof(wav_hdr));
-			if (written == sizeof(wav_hdr)) {
-				_recording = true;
-				_recordedBytes = 0;
-				return true;
-			} else {
-				ESP_LOGE("WAV", "Failed to write WAV header");
-				_audioFile.close();
-			}
+		if (!_audioFile) {
+			ESP_LOGE("WAV", "Failed to open %s", _filename.c_str());
+			return false;
 		}
-		return false;
+
+		// The header leads the first block and is rewritten in place by stop()
+		uint8_t index;
+		xQueueReceive(_freeBlocks, &index, portMAX_DELAY);
+		_current = index;
+		memcpy(_blocks[_current], &_currentHeader, sizeof(wav_hdr));
+		_fill = sizeof(wav_hdr);
+
+		_recording = true;
+		_recordedBytes = 0;
+		_writeCalls = 0;
+		_writeErrors = 0;
+		_writeMs = 0;
+		return true;
 	}
 
-	inline void processChunk(uint8_t* data, size_t length) {
+	/**
+	 * Queue a chunk of 16-bit samples, data is left untouched
+	 * @param data Samples
+	 * @param length Size of data in bytes
+	 */
+	inline void processChunk(const uint8_t* data, size_t length) {
 		if (!_recording || !data || !_audioFile) return;
 
-		size_t numSamples = length / 2;
-		int16_t* samples = (int16_t*)data;
+		const int16_t* samples = (const int16_t*)data;
+		size_t numSamples = length / sizeof(int16_t);
 
-		// Amplify audio data
-		for (size_t i = 0; i < numSamples; ++i) {
-			int32_t amplified = (int32_t)(samples[i] * _volumeGain);
-			if (amplified > 32767) amplified = 32767;
-			else if (amplified < -32768) amplified = -32768;
-			samples[i] = (int16_t)amplified;
+		if (!_needsResampling) {
+			append(samples, numSamples);
+			return;
 		}
 
-		if (_needsResampling) {
-			// Calculate output buffer size needed
-			size_t outputSamples = AudioBufferConverter::calculateOutputSize(_inputKhz, _outputKhz, numSamples);
-
-			// Allocate temporary buffer for resampled data using PSRAM
-			int16_t* resampledBuffer = (int16_t*)heap_caps_malloc(outputSamples * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
-
-			if (resampledBuffer) {
-				int result = AudioBufferConverter::convert(_inputKhz, _outputKhz,
-					samples, numSamples, resampledBuffer, outputSamples);
-
-				if (result > 0) {
-					// Write resampled data
-					size_t outputBytes = result * 2; // 16-bit samples
-					_audioFile.write((uint8_t*)resampledBuffer, outputBytes);
-					_recordedBytes += outputBytes;
-				}
-				heap_caps_free(resampledBuffer);
-			} else {
-				// Fallback: write original data if allocation failed
-				ESP_LOGW("WAV", "Failed to allocate resampling buffer, writing original data");
-				_audioFile.write(data, length);
-				_recordedBytes += length;
-			}
-		} else {
-			// No resampling needed
-			_audioFile.write(data, length);
-			_recordedBytes += length;
+		// Resample through the fixed scratch, the resampler keeps its state between slices
+		while (numSamples > 0) {
+			size_t consumed = 0;
+			size_t produced = _resampler.process(samples, numSamples, _scratch, WAV_SCRATCH_SAMPLES, &consumed);
+			if (consumed == 0) break;
+			append(_scratch, produced);
+			samples += consumed;
+			numSamples -= consumed;
 		}
 	}
 
 	inline void stop() {
 		if (!_recording) return;
-		
+
+		flushBlock();
+		waitIdle();
+
 		// Update header with final file size
 		_currentHeader.file_size = 36 + _recordedBytes;  // 44 - 8 = 36
 		_currentHeader.data_size = _recordedBytes;
@@ -148,7 +271,8 @@ public:
 		_audioFile.write((uint8_t*)&_currentHeader, sizeof(wav_hdr));
 		_audioFile.close();
 		
-		ESP_LOGI("WAV", "WAV file %s recorded, size: %d bytes", _filename.c_str(), 44 + _recordedBytes);
+		ESP_LOGI("WAV", "WAV file %s recorded, size: %d bytes, %d writes in %lu ms%s", _filename.c_str(), 44 + _recordedBytes,
+			_writeCalls, _writeMs, _writeErrors ? ", with write errors" : "");
 		_recording = false;
 	}
 
@@ -160,4 +284,6 @@ public:
 	inline bool isRecording() { return _recording; }
 
 	inline size_t getRecordedBytes() { return _recordedBytes; }
+
+	inline uint32_t getWriteCalls() { return _writeCalls; }
 };
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "app/callbacks.h"
 #include "app/tasks.h"
 #include <core/datastore.h>
+#include "app/network/SttStream.h"
+
+SttStreamClient sttStream;
 
 bool audioToWavCallback(uint32_t key, uint32_t index, const uint8_t* data, size_t dataSize){
 	if (!data) return pdTRUE;
@@ -37,12 +40,35 @@ bool audioToWavCallback(uint32_t key, uint32_t index, const uint8_t* data, size_
 	return result == pdTRUE;
 }
 
+bool audioSttStreamCallback(uint32_t key, uint32_t index, const uint8_t* data, size_t dataSize) {
+	if (index == 0) {
+		// the transcript goes to the same prompt as the WAV path
+		return sttStream.begin(audioTalkTextCallback);
+	}
+	if (index == (uint32_t)-1) {
+		sttStream.finish();
+		return true;
+	}
+
+	sttStream.write(data, dataSize);
+	return true;
+}
+
 void audioTalkCallback(const String& key) {
 	aiStt.transcribeAudio(key.c_str(), [](const String& filePath, const String& text, const String& usageJson){
 
 #if SAVE_AUDIO == 0
 	LittleFS.remove(filePath);
 #endif
+		audioTalkTextCallback(text);
+	});
+}
+
+void audioTalkTextCallback(const String& text) {
+	if (text.isEmpty()) {
+		ESP_LOGW("AudioTalk", "Empty transcript");
+		return;
+	}
 
 String systemCmd = R"===(
 Your tasks:
@@ -69,12 +95,11 @@ System Information:
 - Last user interaction: {--last_interaction--}ms
 )===";
 
-		systemCmd.replace("{--time--}", timeManager.getCurrentTime());
-		systemCmd.replace("{--last_interaction--}", String(sysActivity->lastUpdate()));
-		ai.setSystemMessage(systemCmd);
-		ai.sendPrompt(text, [](const String &payload, const String &response){
-			// tts.speak(response.c_str());
-			aiCallback(payload, response);
-		});
+	systemCmd.replace("{--time--}", timeManager.getCurrentTime());
+	systemCmd.replace("{--last_interaction--}", String(sysActivity->lastUpdate()));
+	ai.setSystemMessage(systemCmd);
+	ai.sendPrompt(text, [](const String &payload, const String &response){
+		// tts.speak(response.c_str());
+		aiCallback(payload, response);
 	});
 }
\ No newline at end of file
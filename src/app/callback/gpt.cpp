@@ -30,30 +30,14 @@ void aiVoiceCallback(const String& text, const uint8_t* audioData, size_t audioS
 
 	// Check TTS format and decode if necessary
 	if (aiTts.getFormat() == GPTAudioFormat::GPT_MP3) {
-		// Initialize MP3 decoder if needed
-		if (!mp3decoder.isInitialized()) {
-			if (!mp3decoder.init()) {
-				ESP_LOGE("AIVoiceCallback", "Failed to initialize MP3 decoder");
-				// Fallback: try to play as raw data
-				speakerAudioCallback(audioData, audioSize, false);
-				return;
-			}
-		}
-
-		// Decode MP3 to PCM
-		int16_t* pcmBuffer = nullptr;
-		size_t pcmSize = 0;
-		int sampleRate = 0;
+		// Decode frame by frame straight into the speaker, playback starts on the first frame
+		size_t samples = mp3decoder.stream(audioData, audioSize, [](const int16_t* pcm, size_t count, int sampleRate, void* arg) {
+			size_t written = 0;
+			speaker->writeSamples(pcm, count * sizeof(int16_t), &written, SPEAKER_VOLUME, portMAX_DELAY, AUDIO_CHANNEL_VOICE, sampleRate);
+		}, nullptr);
 
-		if (mp3decoder.decodeMP3ToPCM(audioData, audioSize, &pcmBuffer, &pcmSize, &sampleRate)) {
-			ESP_LOGI("AIVoiceCallback", "Decoded MP3 to PCM: %d samples at %d Hz", pcmSize, sampleRate);
-			// Send PCM data to speaker
-			speakerAudioCallback((uint8_t*)pcmBuffer, pcmSize * sizeof(int16_t), false);
-			mp3decoder.freePCMBuffer(pcmBuffer);
-		} else {
+		if (samples == 0) {
 			ESP_LOGE("AIVoiceCallback", "Failed to decode MP3 data");
-			// Fallback: try to play as raw data
-			speakerAudioCallback(audioData, audioSize, false);
 		}
 	} else {
 		// For WAV or PCM, send directly to speaker
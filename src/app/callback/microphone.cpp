@@ -1,7 +1,20 @@
 #include "app/callbacks.h"
-#include <app/audio/converter.h>
+#include <app/audio/resampler.h>
+#include <app/audio/dsp.h>
+#include <app/audio/packetizer.h>
+#include <app/audio/dtx.h>
 #include <esp_heap_caps.h>
 
+#define MIC_UPLINK_GAIN 15.0f
+#define MIC_UPLINK_CHUNK 512 // 16kHz samples per resampler pass
+#define UPLINK_DTX_KEEPALIVE_SAMPLES 480 // 20 ms at 24kHz
+
+// Realtime API expects 24kHz, keeps filter state between callbacks
+static AudioResampler upsampler(16000, STS_SAMPLE_RATE);
+static const AudioDsp::Gain uplinkGain = AudioDsp::gain(MIC_UPLINK_GAIN);
+static UplinkPacketizer packetizer;
+static UplinkDtx dtx;
+
 // I2S fill callback for ESP-SR system
 esp_err_t srAudioCallback(void *arg, void *out, size_t len, size_t *bytes_read, uint32_t timeout_ms) {
     if (microphone) {
@@ -11,6 +24,38 @@ esp_err_t srAudioCallback(void *arg, void *out, size_t len, size_t *bytes_read,
     return ESP_FAIL;
 }
 
+static volatile UPLINK_SOURCE uplinkSource = MIC_UPLINK_AFE ? UPLINK_SOURCE_AFE : UPLINK_SOURCE_RAW;
+static volatile vad_state_t uplinkVad = VAD_SPEECH;
+static volatile bool preRollArmed = false;
+static UplinkStats uplinkStats = {};
+static volatile uint32_t preRollMark = 0;
+static volatile unsigned long preRollWakeTime = 0;
+
+void setUplinkSource(UPLINK_SOURCE source) {
+    if (source >= UPLINK_SOURCE_MAX) return;
+    uplinkSource = source;
+}
+
+UPLINK_SOURCE getUplinkSource() {
+    return uplinkSource;
+}
+
+vad_state_t getUplinkVadState() {
+    return uplinkVad;
+}
+
+UplinkStats getUplinkStats() {
+    return uplinkStats;
+}
+
+// Remember where the wake word ended, the next session replays from there
+void armUplinkPreRoll() {
+    if (!afeTap.isReady()) return;
+    preRollMark = afeTap.position();
+    preRollWakeTime = millis();
+    preRollArmed = true;
+}
+
 // AudioFillCallback 
 size_t micAudioCallback(uint8_t* buffer, size_t maxSize) {
     sysActivity->update();
@@ -18,75 +63,142 @@ size_t micAudioCallback(uint8_t* buffer, size_t maxSize) {
         return 0;
     }
 
-    // Get microphone cache data (16kHz PCM16)
-    static unsigned long lastSampleTime = 0;
-    auto cache = microphone->getCache();
-    
-    ESP_LOGD("MicCallback", "Cache: len=%d, time=%lu, lastTime=%lu, hasSample=%d", 
-             cache.lastSampleLen, cache.lastSampleTime, lastSampleTime, cache.lastSample != nullptr);
-    
-    if (cache.lastSampleLen == 0 
-        || !cache.lastSample 
-        || cache.lastSampleTime == 0
-        || cache.lastSampleTime == lastSampleTime) {
-        return 0; // No new data available
+    static PcmRing::Reader rawReader;
+    static AfeTap::Reader afeReader;
+    static UPLINK_SOURCE activeSource = UPLINK_SOURCE_MAX;
+    static unsigned long lastPoll = 0;
+    static uint32_t lastOverruns = 0;
+    static int16_t scratch[MIC_UPLINK_CHUNK];
+    static bool preRollPending = false;
+    static unsigned long lastSent = 0;
+
+    // A long pause between polls means a new session, start from live audio.
+    // The source is only switched here so a session never mixes both paths.
+    if (activeSource == UPLINK_SOURCE_MAX || millis() - lastPoll > 500) {
+        activeSource = (uplinkSource == UPLINK_SOURCE_AFE && afeTap.isReady()) ? UPLINK_SOURCE_AFE : UPLINK_SOURCE_RAW;
+        if (activeSource == UPLINK_SOURCE_AFE) {
+            afeReader = afeTap.reader();
+            if (preRollArmed) {
+                // Queue everything captured since the wake word ahead of live frames
+                size_t since = afeTap.position() - preRollMark;
+                size_t queued = afeReader.rewind(since < AFE_TAP_HISTORY_SAMPLES ? since : AFE_TAP_HISTORY_SAMPLES);
+                preRollPending = queued > 0;
+                if (queued < since) {
+                    ESP_LOGW("MicCallback", "Pre-roll: wake word mark fell out of history, first %d ms lost",
+                        (since - queued) / 16);
+                }
+                ESP_LOGI("MicCallback", "Pre-roll: %d ms queued, session opened %lu ms after wake word",
+                    queued / 16, millis() - preRollWakeTime);
+            }
+        } else {
+            rawReader = microphone->reader();
+        }
+        preRollArmed = false;
+        lastOverruns = 0;
+        upsampler.reset();
+        if (uplinkStats.samplesSent + uplinkStats.samplesSuppressed > 0) {
+            ESP_LOGI("MicCallback", "Previous uplink: %d ms sent, %d ms suppressed, %d keep-alives, %d bytes in %d messages",
+                uplinkStats.samplesSent / 16, uplinkStats.samplesSuppressed / 16, uplinkStats.keepAlives, uplinkStats.bytesSent, uplinkStats.messages);
+        }
+        uplinkStats = {};
+        packetizer.init({UPLINK_FRAME_MIN_MS, UPLINK_FRAME_MAX_MS, UPLINK_FRAME_START_MS, UPLINK_FRAME_STEP_MS});
+        dtx.init({UPLINK_DTX_HANGOVER_MS * 16, UPLINK_DTX_ONSET_MS * 16, (uint32_t)afeTap.frameSamples()});
+        lastSent = millis();
+        ESP_LOGI("MicCallback", "Uplink source: %s", activeSource == UPLINK_SOURCE_AFE ? "AFE" : "raw");
     }
+    lastPoll = millis();
 
-    ESP_LOGD("MicCallback", "Processing %d bytes of audio data", cache.lastSampleLen);
+#if UPLINK_PACKETIZE
+    // Leave audio in the capture history until a whole frame is there, the client
+    // sends every non-empty return as its own message. Suppressed silence is still
+    // drained each poll so speech onsets and keep-alives are not delayed.
+    packetizer.polled(lastPoll);
+    if (!dtx.suppressing()) {
+        size_t pending = activeSource == UPLINK_SOURCE_AFE ? afeReader.available() : rawReader.available();
+        bool speechEnded = uplinkVad == VAD_SPEECH && getAfeState() != VAD_SPEECH;
+        if (!packetizer.ready(pending / 16, speechEnded, lastPoll)) return 0;
+    }
+#endif
 
-    // Input is 16kHz PCM16
-    int16_t* inputBuffer = (int16_t*) heap_caps_malloc(cache.lastSampleLen, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
-    if (!inputBuffer) return 0;
-    memcpy(inputBuffer, cache.lastSample, cache.lastSampleLen);
-    size_t inputSamples = cache.lastSampleLen / sizeof(int16_t);
+    int16_t* output = reinterpret_cast<int16_t*>(buffer);
     size_t maxOutputSamples = maxSize / sizeof(int16_t);
-    lastSampleTime = cache.lastSampleTime;
+    size_t written = 0;
 
-    // For 16kHz to 24kHz conversion (ratio = 1.5), calculate how many input samples we can convert
-    // to fit in the output buffer: inputSamples * 1.5 <= maxOutputSamples
-    size_t maxInputSamples = static_cast<size_t>(maxOutputSamples / 1.5f);
-    if (inputSamples > maxInputSamples) {
-        inputSamples = maxInputSamples; // Limit input to fit output buffer
-    }
+    while (maxOutputSamples - written > 2) {
+        // Input that still fits the output after 16kHz -> 24kHz
+        size_t room = (maxOutputSamples - written - 2) * 2 / 3;
+        if (room > MIC_UPLINK_CHUNK) room = MIC_UPLINK_CHUNK;
+        if (room == 0) break;
 
-    // Calculate actual output size for the limited input
-    size_t requiredOutputSamples = AudioBufferConverter::calculateOutputSize(16, 24, inputSamples);
+        size_t got;
+        if (activeSource == UPLINK_SOURCE_AFE) {
+            // Already noise suppressed and leveled by the AFE, no extra DSP
+            AfeTap::FrameInfo info;
+            got = afeReader.read(scratch, room, &info);
+            if (got == 0) break;
+            uplinkVad = info.vad;
+            if (preRollPending) {
+                preRollPending = false;
+                ESP_LOGI("MicCallback", "Pre-roll: first frame captured %lu ms before it was sent",
+                    millis() - info.timestamp);
+            }
+        } else {
+            got = rawReader.read(scratch, room);
+            if (got == 0) break;
+            uplinkVad = getAfeState();
+        }
 
-    // Allocate temporary buffer for conversion if needed
-    int16_t* tempBuffer = nullptr;
-    int16_t* outputBuffer = reinterpret_cast<int16_t*>(buffer);
+#if UPLINK_DTX
+        // DTX: after the hangover silent frames are read but neither resampled nor sent
+        uint32_t position = activeSource == UPLINK_SOURCE_AFE ? afeReader.position() : rawReader.position();
+        UplinkDtx::ACTION action = dtx.next(uplinkVad, got, position);
+        if (action == UplinkDtx::DTX_REPLAY) {
+            // VAD lags the onset, replay the frames before this one from the history
+            size_t back = dtx.replaySamples();
+            size_t replayed = back - got;
+            uplinkStats.samplesSuppressed -= replayed < uplinkStats.samplesSuppressed ? replayed : uplinkStats.samplesSuppressed;
+            if (activeSource == UPLINK_SOURCE_AFE) afeReader.rewind(afeReader.available() + back);
+            else rawReader.rewind(rawReader.available() + back);
+            upsampler.reset();
+            continue;
+        }
 
-    if (requiredOutputSamples > inputSamples) {
-        // Need upsampling, allocate temp buffer
-        tempBuffer = static_cast<int16_t*>(heap_caps_malloc(requiredOutputSamples * sizeof(int16_t), MALLOC_CAP_SPIRAM));
-        if (!tempBuffer) {
-            ESP_LOGE("MicCallback", "Failed to allocate temp buffer for conversion");
-            return 0;
+        if (action == UplinkDtx::DTX_SUPPRESS) {
+            uplinkStats.samplesSuppressed += got;
+            if (millis() - lastSent >= UPLINK_DTX_KEEPALIVE_MS && maxOutputSamples - written >= UPLINK_DTX_KEEPALIVE_SAMPLES) {
+                // A short block of digital silence keeps the session's audio clock moving
+                memset(output + written, 0, UPLINK_DTX_KEEPALIVE_SAMPLES * sizeof(int16_t));
+                written += UPLINK_DTX_KEEPALIVE_SAMPLES;
+                uplinkStats.keepAlives++;
+                lastSent = millis();
+            }
+            continue;
         }
-        outputBuffer = tempBuffer;
-    }
+#endif
 
-    // Convert from 16kHz to 24kHz
-    int convertedSamples = AudioBufferConverter::convert(16, 24, inputBuffer, inputSamples, outputBuffer, requiredOutputSamples, 15.0f);
-    if (convertedSamples <= 0) {
-        ESP_LOGE("MicCallback", "Audio conversion failed: inputSamples=%d, requiredOutputSamples=%d, maxOutputSamples=%d", 
-                 inputSamples, requiredOutputSamples, maxOutputSamples);
-        if (tempBuffer) heap_caps_free(tempBuffer);
-        if (inputBuffer) heap_caps_free(inputBuffer);
-        return 0;
+        if (activeSource != UPLINK_SOURCE_AFE) AudioDsp::applyGain(scratch, scratch, got, uplinkGain);
+        written += upsampler.process(scratch, got, output + written, maxOutputSamples - written);
+        uplinkStats.samplesSent += got;
+        lastSent = millis();
     }
 
-    if (inputBuffer) heap_caps_free(inputBuffer);
+    uplinkStats.bytesSent += written * sizeof(int16_t);
+    if (written > 0) {
+        uplinkStats.messages++;
+#if UPLINK_PACKETIZE
+        size_t backlog = activeSource == UPLINK_SOURCE_AFE ? afeReader.available() : rawReader.available();
+        packetizer.emitted(backlog / 16, millis());
+        uplinkStats.frameMs = packetizer.targetMs();
+        uplinkStats.sendMs = packetizer.sendMs();
+#endif
+    }
 
-    // If we used a temp buffer, copy to output buffer
-    if (tempBuffer) {
-        size_t copySamples = (convertedSamples < maxOutputSamples) ? convertedSamples : maxOutputSamples;
-        memcpy(buffer, tempBuffer, copySamples * sizeof(int16_t));
-        heap_caps_free(tempBuffer);
-        ESP_LOGD("MicCallback", "Returning %d bytes (with temp buffer)", copySamples * sizeof(int16_t));
-        return copySamples * sizeof(int16_t);
+    uint32_t overruns = activeSource == UPLINK_SOURCE_AFE ? afeReader.overruns() : rawReader.overruns();
+    if (overruns != lastOverruns) {
+        lastOverruns = overruns;
+        ESP_LOGW("MicCallback", "Uplink fell behind, %d overruns", overruns);
     }
 
-    ESP_LOGD("MicCallback", "Returning %d bytes", convertedSamples * sizeof(int16_t));
-    return convertedSamples * sizeof(int16_t);
-}
\ No newline at end of file
+    ESP_LOGD("MicCallback", "Returning %d bytes", written * sizeof(int16_t));
+    return written * sizeof(int16_t);
+}
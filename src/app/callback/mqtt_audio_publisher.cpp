@@ -1,5 +1,14 @@
 #include "app/callbacks.h"
 #include "app/tasks.h"
+#include "app/audio/adpcm.h"
+#include "app/audio/audiopacket.h"
+
+#ifndef MQTT_AUDIO_ADPCM
+#define MQTT_AUDIO_ADPCM 1
+#endif
+
+static ImaAdpcm::State adpcmState = ImaAdpcm::initialState();
+static uint16_t packetSequence = 0;
 
 uint32_t generateKey(uint32_t uniqueId, int index) {
     if (index == 0) return uniqueId * 10000;  // start
@@ -10,8 +19,23 @@ uint32_t generateKey(uint32_t uniqueId, int index) {
 bool audioBrokerPublisher(uint32_t key, uint32_t index, const uint8_t* data, size_t dataSize) {
 	key = generateKey(key, index);
 
-	// Prepare payload: key + data
-	size_t payloadSize = sizeof(uint32_t) + dataSize;
+	// A new stream starts from a fresh codec state
+	if (index == 0) {
+		adpcmState = ImaAdpcm::initialState();
+		packetSequence = 0;
+	}
+
+	size_t samples = data ? dataSize / sizeof(int16_t) : 0;
+	if (samples > UINT16_MAX) samples = UINT16_MAX;
+
+	AudioPacketHeader header = audioPacketHeader(MQTT_AUDIO_ADPCM ? AUDIO_PACKET_CODEC_IMA_ADPCM : AUDIO_PACKET_CODEC_PCM16,
+		packetSequence++, (uint16_t)samples, adpcmState);
+
+	// Prepare payload: key + header + audio
+	size_t audioSize = MQTT_AUDIO_ADPCM ? ImaAdpcm::encodedSize(samples) : samples * sizeof(int16_t);
+	size_t headerOffset = sizeof(uint32_t);
+	size_t audioOffset = headerOffset + sizeof(AudioPacketHeader);
+	size_t payloadSize = audioOffset + audioSize;
 	uint8_t* payload = (uint8_t*)heap_caps_malloc(payloadSize, MALLOC_CAP_SPIRAM);
 	if (!payload) {
 		ESP_LOGE("AudioStreamer", "Failed to allocate payload");
@@ -19,7 +43,11 @@ bool audioBrokerPublisher(uint32_t key, uint32_t index, const uint8_t* data, siz
 	}
 
 	memcpy(payload, &key, sizeof(uint32_t));
-	if (data) memcpy(payload + sizeof(uint32_t), data, dataSize);
+	memcpy(payload + headerOffset, &header, sizeof(AudioPacketHeader));
+	if (samples > 0) {
+		if (MQTT_AUDIO_ADPCM) ImaAdpcm::encode((const int16_t*)data, samples, payload + audioOffset, adpcmState);
+		else memcpy(payload + audioOffset, data, audioSize);
+	}
 
 	// Publish message for NetworkConsumer
 	BaseType_t result;
@@ -5,14 +5,13 @@ void srEventCallback(void *arg, sr_event_t event, int command_id, int phrase_id)
 	ESP_LOGI("srEvent", "SR event detected, id=%d, command=%d, phrase_id=%d", event, command_id, phrase_id);
 	switch (event) {
 		case SR_EVENT_WAKEWORD:
-			aiSts.start(
-				micAudioCallback, 
-				speakerAudioCallback,
-				stsTools,
-				nullptr,
-				stsEvent,
-				srDisconnectCallback
-			);
+#if VOICE_RECORD_MODE
+			if (startMicRecording()) notification->send(NOTIFICATION_DISPLAY, EDISPLAY_MIC);
+			SR::set_mode(SR_MODE_WAKEWORD);
+			break;
+#endif
+			armUplinkPreRoll();
+			startStsSession();
 			notification->send(NOTIFICATION_DISPLAY, EDISPLAY_LOADING);
 			SR::set_mode(SR_MODE_WAKEWORD);
 		break;
@@ -8,10 +8,33 @@ void mqttCallback(char* topic, byte* payload, unsigned int length);
 bool audioBrokerPublisher(uint32_t key, uint32_t index, const uint8_t* data, size_t dataSize);
 bool audioToWavCallback(uint32_t key, uint32_t index, const uint8_t* data, size_t dataSize);
 void audioTalkCallback(const String& key);
+bool audioSttStreamCallback(uint32_t key, uint32_t index, const uint8_t* data, size_t dataSize);
+void audioTalkTextCallback(const String& text);
 
 void aiCallback(const String& payload, const String& response);
 void aiVoiceCallback(const String& text, const uint8_t* audioData, size_t audioSize);
 void aiTranscriptionCallback(const String& filePath, const String& text, const String& usageJson);
 
+enum UPLINK_SOURCE {
+  UPLINK_SOURCE_RAW = 0,
+  UPLINK_SOURCE_AFE,
+  UPLINK_SOURCE_MAX
+};
+
 size_t micAudioCallback(uint8_t* buffer, size_t maxSize);
+void setUplinkSource(UPLINK_SOURCE source);
+UPLINK_SOURCE getUplinkSource();
+vad_state_t getUplinkVadState();
+
+struct UplinkStats {
+  uint32_t samplesSent;       // 16kHz capture samples resampled and sent
+  uint32_t samplesSuppressed; // 16kHz capture samples of silence dropped by DTX
+  uint32_t keepAlives;        // silence blocks sent while suppressed
+  uint32_t bytesSent;
+  uint32_t messages;          // non-empty polls, one realtime message each
+  uint32_t frameMs;           // current packetizer target
+  uint32_t sendMs;            // smoothed time the client spends per message
+};
+UplinkStats getUplinkStats();
+void armUplinkPreRoll();
 void speakerAudioCallback(const uint8_t* audioData, size_t audioSize, bool isLastChunk);
\ No newline at end of file
@@ -29,21 +29,27 @@ void buttonEvent() {
 		case 1:
 		case 2: 
 			{
-				aiSts.start(
-					micAudioCallback, 
-					speakerAudioCallback,
-					stsTools,
-					nullptr,
-					stsEvent,
-					srDisconnectCallback
-				);
+#if VOICE_RECORD_MODE
+				// the endpointer usually ends the recording, a press while it runs ends it early
+				if (getMicEvent().state == AUDIO_STATE_RUNNING) {
+					stopMicRecording();
+					notification->send(NOTIFICATION_DISPLAY, EDISPLAY_NONE);
+					ESP_LOGI("buttonEvent", "Stopped recording");
+				} else if (startMicRecording()) {
+					notification->send(NOTIFICATION_DISPLAY, EDISPLAY_MIC);
+					ESP_LOGI("buttonEvent", "Started microphone for recording");
+				}
+				break;
+#endif
+				startStsSession();
 				notification->send(NOTIFICATION_DISPLAY, EDISPLAY_MIC);
 				needBackTrigger = true;
 				onTriggerBack = []() {
 					notification->send(NOTIFICATION_DISPLAY, EDISPLAY_NONE);
-					aiSts.stop();
+					stopStsSession();
 					delay(10);
-					speaker->clear();
+					speaker->discard();
+					speaker->setSampleRate(SPEAKER_SAMPLE_RATE);
 				};
 
 				ESP_LOGI("buttonEvent", "Started microphone for streaming");
@@ -0,0 +1,10 @@
+#include <app/events.h>
+
+void jobEvent() {
+	// Completions of network jobs run here, on the main task
+	while (notification->has(NOTIFICATION_JOB)) {
+		NetworkJob* job = (NetworkJob*)notification->consume(NOTIFICATION_JOB);
+		if (!job) break;
+		networkJobs.complete(job);
+	}
+}
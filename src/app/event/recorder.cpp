@@ -10,4 +10,39 @@ AudioEvent getMicEvent() {
 void setMicEvent(AudioEvent event) {
 	audioEvent = event;
 	ESP_LOGI("EVENT", "Mic Event: %d, state: %d", event.flag, event.state);
+}
+
+/**
+ * Record a request for the speech-to-text pipeline, the endpointer ends it
+ * With STT_STREAM the audio is uploaded while it is captured, otherwise it
+ * goes to a WAV file that is transcribed once recording stops.
+ * @return false while a recording is still running or being processed
+ */
+bool startMicRecording() {
+	if (audioEvent.state != AUDIO_STATE_IDLE) {
+		ESP_LOGW("EVENT", "Recording busy, state: %d", audioEvent.state);
+		return false;
+	}
+
+	AudioEvent event;
+	event.flag = EMIC_START;
+#if STT_STREAM
+	event.collectorCallback = audioSttStreamCallback;
+	event.executorCallback = audioTalkTextCallback;
+	event.streaming = true;
+#else
+	event.collectorCallback = audioToWavCallback;
+	event.executorCallback = audioTalkCallback;
+	event.streaming = false;
+#endif
+	event.state = AUDIO_STATE_IDLE;
+	setMicEvent(event);
+	return true;
+}
+
+void stopMicRecording() {
+	if (audioEvent.state != AUDIO_STATE_RUNNING) return;
+	AudioEvent event = audioEvent;
+	event.flag = EMIC_STOP;
+	setMicEvent(event);
 }
\ No newline at end of file
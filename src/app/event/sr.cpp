@@ -1,6 +1,22 @@
 #include <app/events.h>
 
 void srEvent() {
+#if REALTIME_CLIENT && REALTIME_PRECONNECT
+	// Speech usually starts before the wake word is recognized, have TLS up by then.
+	// The TLS connect blocks, it runs on the network worker with a short timeout of its
+	// own, so a slow server holds other jobs back for at most twice that.
+	static unsigned long lastPreconnect = 0;
+	if (getAfeState() == VAD_SPEECH && !realtime.running() && wifiManager.isConnected()
+		&& millis() - lastPreconnect >= REALTIME_PRECONNECT_INTERVAL_MS
+		&& !networkJobs.pending(NETWORK_JOB_PRECONNECT)) {
+		lastPreconnect = millis();
+		networkJobs.submit(NETWORK_JOB_PRECONNECT, []() {
+			return realtime.preconnect(REALTIME_PRECONNECT_IDLE_MS, REALTIME_PRECONNECT_TIMEOUT_MS);
+		});
+	}
+	realtime.expirePreconnect();
+#endif
+
 	// Handle any notifications that might be relevant to SR
 	if (notification->has(NOTIFICATION_COMMAND)) {
 		void* event = notification->consume(NOTIFICATION_COMMAND);
@@ -15,6 +31,12 @@ void srEvent() {
 			} else if (strcmp(command, "resume_sr") == 0) {
 				ESP_LOGI("SREvent", "Resuming speech recognition");
 				SR::resume();
+			} else if (strcmp(command, "uplink_raw") == 0) {
+				ESP_LOGI("SREvent", "Uplink source: raw microphone");
+				setUplinkSource(UPLINK_SOURCE_RAW);
+			} else if (strcmp(command, "uplink_afe") == 0) {
+				ESP_LOGI("SREvent", "Uplink source: AFE output");
+				setUplinkSource(UPLINK_SOURCE_AFE);
 			}
 		}
 	}
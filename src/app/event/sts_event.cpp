@@ -1,73 +1,196 @@
 #include <app/events.h>
 
-void stsTools(){
-	aiSts.addTool(GPTStsService::GPTTool{
-		.description = "System weather information, cannot be changed",
-		.name = "weather"
-	});
+typedef std::function<void(const char* output)> StsToolReply;
+
+struct StsTool {
+	const char* name;
+	const char* description;
+	const char* typeDescription; // The "type" string parameter, nullptr for none
+};
 
-	GPTSpiJsonDocument timeParam;
-	timeParam["type"] = "object";
+// Both session clients declare these
+static const StsTool stsToolList[] = {
+	{"weather", "System weather information, cannot be changed", nullptr},
 	// https://platform.openai.com/docs/api-reference/realtime-client-events/session/update
-	timeParam["properties"]["type"]["type"] = "string";
-	timeParam["properties"]["type"]["description"] = "a time type. value is 'date', 'time', 'datetime'";
-	timeParam.shrinkToFit();
-	aiSts.addTool(GPTStsService::GPTTool{
-		.description = "System time",
-		.name = "time",
-		.params = timeParam
-	});
-	aiSts.addTool(GPTStsService::GPTTool{
-		.description = "Close conversation talk",
-		.name = "end_conversation_session"
-	});
-	aiSts.addTool(GPTStsService::GPTTool{
-		.description = "Restart the system",
-		.name = "restart"
-	});
+	{"time", "System time", "a time type. value is 'date', 'time', 'datetime'"},
+	{"end_conversation_session", "Close conversation talk", nullptr},
+	{"restart", "Restart the system", nullptr}
+};
+
+static void stsToolParams(JsonObject params, const StsTool& tool) {
+	params["type"] = "object";
+	params["properties"]["type"]["type"] = "string";
+	params["properties"]["type"]["description"] = tool.typeDescription;
+}
+
+void stsTools(){
+	for (const StsTool& tool : stsToolList) {
+		if (!tool.typeDescription) {
+			aiSts.addTool(GPTStsService::GPTTool{
+				.description = tool.description,
+				.name = tool.name
+			});
+			continue;
+		}
+		GPTSpiJsonDocument params;
+		stsToolParams(params.to<JsonObject>(), tool);
+		params.shrinkToFit();
+		aiSts.addTool(GPTStsService::GPTTool{
+			.description = tool.description,
+			.name = tool.name,
+			.params = params
+		});
+	}
 
 	aiSts.sendTools();
+	speaker->setSampleRate(STS_SAMPLE_RATE);
 	notification->send(NOTIFICATION_DISPLAY, EDISPLAY_FACE);
 	aiSts.Speak();
 }
 
-void stsEvent(const GPTStsService::GPTToolCall& data) {
-	ESP_LOGI("AIFunctionCall", "name: %s, call_id: %s, params: %s", data.name, data.callId, data.params.as<String>().c_str());
+/**
+ * Run a tool call of either session client
+ * @param reply Sends the output back, called at most once and possibly later from the main task
+ */
+static void runStsTool(const char* name, StsToolReply reply) {
 	// need move to command processor
-	if (0 == strcmp(data.name, "weather"))
-		weatherService.getCurrentWeather([&data](weatherData_t wdata, bool success){
-			String resp = 
-				"Temperature: " + String(wdata.temperature)
-				+". Humidity: " + String(wdata.humidity)
-				+". Wind Speed: " + String(wdata.windSpeed)
-				+". Wind Direction: " + String(wdata.windDirection)
-				+". Deskripsi: " + String(wdata.description)
-				+". Last Update: " + String(wdata.lastUpdated);
-			
-			aiSts.sendToolCallback(GPTStsService::GPTToolCallback{
-				.callId = data.callId,
-				.name = data.name,
-				.output = resp.c_str(),
-				.status = "complete"
+	if (0 == strcmp(name, "weather")) {
+		auto resp = std::make_shared<String>();
+		bool queued = networkJobs.submit(NETWORK_JOB_TOOL, [resp]() {
+			bool ok = false;
+			weatherService.getCurrentWeather([&ok, resp](const weatherData_t& wdata, bool success){
+				ok = success;
+				*resp =
+					"Temperature: " + String(wdata.temperature)
+					+". Humidity: " + String(wdata.humidity)
+					+". Wind Speed: " + String(wdata.windSpeed)
+					+". Wind Direction: " + String(wdata.windDirection)
+					+". Deskripsi: " + String(wdata.description)
+					+". Last Update: " + String(wdata.lastUpdated);
 			});
+			return ok;
+		}, [reply, resp](bool ok) {
+			reply(ok ? resp->c_str() : "Weather is not available right now");
 		});
-	else if (0 == strcmp(data.name, "time"))
-		aiSts.sendToolCallback(GPTStsService::GPTToolCallback{
-			.callId = data.callId,
-			.name = data.name,
-			.output = timeManager.getCurrentTime(),
-			.status = "complete"		
-		});
-	else if (0 == strcmp(data.name, "end_conversation_session")){
+		if (!queued) reply("Weather is not available right now");
+	}
+	else if (0 == strcmp(name, "time"))
+		reply(String(timeManager.getCurrentTime()).c_str());
+	else if (0 == strcmp(name, "end_conversation_session")){
 		notification->send(NOTIFICATION_DISPLAY, EDISPLAY_NONE);
-		aiSts.stop();
+		stopStsSession();
 		delay(10);
 		speaker->clear();
+		// Let the goodbye play out at the session rate before switching back
+		speaker->setSampleRate(SPEAKER_SAMPLE_RATE, SPEAKER_BUFFER_MS);
 	}
-	else if (0 == strcmp(data.name, "restart"))
+	else if (0 == strcmp(name, "restart"))
 		ESP.restart();
 }
 
+void stsEvent(const GPTStsService::GPTToolCall& data) {
+	ESP_LOGI("AIFunctionCall", "name: %s, call_id: %s, params: %s", data.name, data.callId, data.params.as<String>().c_str());
+	// The tool call only lives for this callback, the reply keeps its own copies
+	String callId = data.callId;
+	String name = data.name;
+	runStsTool(data.name, [callId, name](const char* output) {
+		aiSts.sendToolCallback(GPTStsService::GPTToolCallback{
+			.callId = callId.c_str(),
+			.name = name.c_str(),
+			.output = output,
+			.status = "complete"
+		});
+	});
+}
+
+bool startStsSession() {
+#if REALTIME_CLIENT
+	return realtime.start(RealtimeSessionCallbacks{
+		.source = micAudioCallback,
+		.sink = speakerAudioCallback,
+		.onOpen = realtimeOpen,
+		.onEvent = realtimeEvent,
+		.onClose = srDisconnectCallback
+	});
+#else
+	aiSts.start(
+		micAudioCallback, 
+		speakerAudioCallback,
+		stsTools,
+		nullptr,
+		stsEvent,
+		srDisconnectCallback
+	);
+	return true;
+#endif
+}
+
+void stopStsSession() {
+#if REALTIME_CLIENT
+	realtime.stop();
+#else
+	aiSts.stop();
+#endif
+}
+
+// On the session task once connected, same setup stsTools does for aiSts
+void realtimeOpen() {
+	GPTSpiJsonDocument doc;
+	doc["type"] = "session.update";
+	doc["session"]["type"] = "realtime";
+	doc["session"]["output_modalities"][0] = "audio";
+	doc["session"]["audio"]["input"]["format"]["type"] = "audio/pcm";
+	doc["session"]["audio"]["input"]["format"]["rate"] = STS_SAMPLE_RATE;
+	doc["session"]["audio"]["input"]["turn_detection"]["type"] = "server_vad";
+	doc["session"]["audio"]["output"]["format"]["type"] = "audio/pcm";
+	doc["session"]["audio"]["output"]["format"]["rate"] = STS_SAMPLE_RATE;
+	doc["session"]["tool_choice"] = "auto";
+	JsonArray tools = doc["session"]["tools"].to<JsonArray>();
+	for (const StsTool& tool : stsToolList) {
+		JsonObject entry = tools.add<JsonObject>();
+		entry["type"] = "function";
+		entry["name"] = tool.name;
+		entry["description"] = tool.description;
+		if (tool.typeDescription) stsToolParams(entry["parameters"].to<JsonObject>(), tool);
+	}
+
+	String config;
+	serializeJson(doc, config);
+	realtime.send(config);
+	realtime.send("{\"type\":\"response.create\"}");
+
+	speaker->setSampleRate(STS_SAMPLE_RATE);
+	notification->send(NOTIFICATION_DISPLAY, EDISPLAY_FACE);
+}
+
+// Server events other than audio deltas, on the session task
+void realtimeEvent(const char* type, const char* json, size_t len, void* arg) {
+	if (0 == strcmp(type, "response.function_call_arguments.done")) {
+		GPTSpiJsonDocument call;
+		if (deserializeJson(call, json, len)) {
+			ESP_LOGW("AIFunctionCall", "Invalid tool call: %s", json);
+			return;
+		}
+		String callId = call["call_id"] | "";
+		const char* name = call["name"] | "";
+		ESP_LOGI("AIFunctionCall", "name: %s, call_id: %s, params: %s", name, callId.c_str(), call["arguments"] | "");
+		runStsTool(name, [callId](const char* output) {
+			GPTSpiJsonDocument item;
+			item["type"] = "conversation.item.create";
+			item["item"]["type"] = "function_call_output";
+			item["item"]["call_id"] = callId;
+			item["item"]["output"] = output;
+			String message;
+			serializeJson(item, message);
+			realtime.send(message);
+			realtime.send("{\"type\":\"response.create\"}");
+		});
+	}
+	else if (0 == strcmp(type, "error"))
+		ESP_LOGE("Realtime", "%s", json);
+}
+
 void srDisconnectCallback() {
 	notification->send(NOTIFICATION_DISPLAY, EDISPLAY_NONE);
+	speaker->setSampleRate(SPEAKER_SAMPLE_RATE, SPEAKER_BUFFER_MS);
 }
\ No newline at end of file
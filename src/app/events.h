@@ -18,6 +18,8 @@ struct AudioEvent {
   AudioCollectorCallback collectorCallback;
   AudioExecutorCallback executorCallback;
   AUDIO_STATE state = AUDIO_STATE_IDLE;
+  bool streaming = false; // collector uploads the audio itself, no WAV is recorded
+
 };
 
 struct AudioData {
@@ -31,9 +33,16 @@ void timeEvent();
 void displayEvent();
 void buttonEvent();
 void srEvent();
+void jobEvent();
 void stsTools();
 void stsEvent(const GPTStsService::GPTToolCall& toolcall);
 void srDisconnectCallback();
+bool startStsSession();
+void stopStsSession();
+void realtimeOpen();
+void realtimeEvent(const char* type, const char* json, size_t len, void* arg);
 
 AudioEvent getMicEvent();
-void setMicEvent(AudioEvent event);
\ No newline at end of file
+void setMicEvent(AudioEvent event);
+bool startMicRecording();
+void stopMicRecording();
\ No newline at end of file
@@ -0,0 +1,372 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef BMKG_VALUE_MAX
+#define BMKG_VALUE_MAX 128 // Longest string value kept, the icon URL is the longest one used
+#endif
+
+static_assert(BMKG_VALUE_MAX <= 256, "BMKG_VALUE_MAX must fit the 8-bit value length");
+
+namespace Services {
+
+// Root "lokasi" object of a BMKG prakiraan-cuaca response
+struct BmkgLocation {
+    char provinsi[40];
+    char kotkab[40];
+    char kecamatan[40];
+    char desa[40];
+    char timezone[24];
+    float longitude;
+    float latitude;
+};
+
+// One 3-hour period of data[0].cuaca[day][n]
+struct BmkgPeriod {
+    uint32_t time;          // "datetime", UTC epoch seconds
+    int temperature;        // "t", Celsius
+    int humidity;           // "hu", percent
+    float windSpeed;        // "ws", m/s
+    int weatherCode;        // "weather"
+    char windDirection[8];  // "wd"
+    char description[32];   // "weather_desc"
+    char image[96];         // "image"
+    char localDatetime[20]; // "local_datetime", YYYY-MM-DD hh:mm:ss
+};
+
+typedef void (*bmkg_period_cb_t)(const BmkgPeriod& period, void* arg);
+
+/**
+ * Extracts the location and forecast periods from a BMKG response as it streams in
+ *
+ * The reader is a write-only Stream, so HTTPClient::writeToStream() feeds
+ * it the body in TCP-sized pieces and takes care of chunked transfer. A
+ * byte-level tokenizer tracks the path of open objects and arrays, keeps
+ * the fields WeatherData needs and drops everything else, so memory use
+ * is this object alone whatever the number of days in the response.
+ */
+class BmkgForecastReader : public Stream {
+public:
+    /**
+     * @param onPeriod Called for every forecast period in order, may be nullptr
+     * @param arg Passed to onPeriod
+     */
+    BmkgForecastReader(bmkg_period_cb_t onPeriod = nullptr, void* arg = nullptr)
+        : _onPeriod(onPeriod), _onPeriodArg(arg) {
+        reset();
+    }
+
+    inline void reset() {
+        memset(&_location, 0, sizeof(_location));
+        memset(&_period, 0, sizeof(_period));
+        memset(&_first, 0, sizeof(_first));
+        _state = STATE_VALUE;
+        _depth = 0;
+        _valueLen = 0;
+        _valueIsKey = false;
+        _unicode = 0;
+        _unicodeDigits = 0;
+        _hasLocation = false;
+        _complete = false;
+        _error = false;
+        _periods = 0;
+        _bytes = 0;
+    }
+
+    size_t write(uint8_t c) override {
+        feed(c);
+        return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t len) override {
+        for (size_t i = 0; i < len; i++) {
+            feed(data[i]);
+        }
+        return len;
+    }
+
+    // Nothing to read back, the reader only consumes
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    // The whole document was seen and it was well formed
+    inline bool ok() const { return _complete && !_error; }
+    inline bool hasLocation() const { return _hasLocation; }
+    inline const BmkgLocation& location() const { return _location; }
+    // Earliest period of the forecast
+    inline const BmkgPeriod& first() const { return _first; }
+    inline size_t periods() const { return _periods; }
+    inline size_t bytes() const { return _bytes; }
+
+    /**
+     * Seconds since the epoch of a BMKG date, read as UTC
+     * @param text YYYY-MM-DDThh:mm:ss or YYYY-MM-DD hh:mm:ss, a trailing zone is ignored
+     * @return 0 when the text is not a date
+     */
+    static uint32_t parseDatetime(const char* text) {
+        int year, month, day, hour, minute, second;
+        if (!text || sscanf(text, "%4d-%2d-%2d%*c%2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6) return 0;
+        if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31) return 0;
+
+        // Days from civil, March-based years keep the leap day at the end
+        year -= month <= 2;
+        int era = year / 400;
+        int yearOfEra = year - era * 400;
+        int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        int32_t days = era * 146097 + dayOfEra - 719468;
+        return (uint32_t)days * 86400 + hour * 3600 + minute * 60 + second;
+    }
+
+private:
+    static const uint8_t MAX_DEPTH = 8;
+
+    enum CONTAINER : uint8_t {
+        CONTAINER_OBJECT = 0,
+        CONTAINER_ARRAY
+    };
+
+    enum STATE : uint8_t {
+        STATE_VALUE = 0,
+        STATE_STRING,
+        STATE_ESCAPE,
+        STATE_UNICODE,
+        STATE_SCALAR
+    };
+
+    struct Level {
+        CONTAINER kind;
+        bool expectKey;
+        uint16_t index;
+        char key[16];
+    };
+
+    bmkg_period_cb_t _onPeriod;
+    void* _onPeriodArg;
+
+    BmkgLocation _location;
+    BmkgPeriod _period;
+    BmkgPeriod _first;
+
+    Level _levels[MAX_DEPTH];
+    uint8_t _depth;
+    STATE _state;
+    char _value[BMKG_VALUE_MAX];
+    uint8_t _valueLen;
+    bool _valueIsKey;
+    uint16_t _unicode;
+    uint8_t _unicodeDigits;
+
+    bool _hasLocation;
+    bool _complete;
+    bool _error;
+    size_t _periods;
+    size_t _bytes;
+
+    inline void feed(uint8_t c) {
+        _bytes++;
+        switch (_state) {
+        case STATE_STRING:
+            if (c == '\\') _state = STATE_ESCAPE;
+            else if (c == '"') endString();
+            else push(c);
+            return;
+        case STATE_ESCAPE:
+            _state = STATE_STRING;
+            switch (c) {
+            case 'n': push('\n'); break;
+            case 't': push('\t'); break;
+            case 'r': push('\r'); break;
+            case 'b': push('\b'); break;
+            case 'f': push('\f'); break;
+            case 'u':
+                _state = STATE_UNICODE;
+                _unicode = 0;
+                _unicodeDigits = 0;
+                break;
+            default: push(c); break; // \" \\ \/
+            }
+            return;
+        case STATE_UNICODE:
+            _unicode = (_unicode << 4) | hexValue(c);
+            if (++_unicodeDigits == 4) {
+                pushUtf8(_unicode);
+                _state = STATE_STRING;
+            }
+            return;
+        case STATE_SCALAR:
+            if (c != ',' && c != '}' && c != ']' && !isspace(c)) {
+                push(c);
+                return;
+            }
+            endScalar();
+            break;
+        default:
+            break;
+        }
+
+        switch (c) {
+        case '{':
+            open(CONTAINER_OBJECT);
+            break;
+        case '[':
+            open(CONTAINER_ARRAY);
+            break;
+        case '}':
+        case ']':
+            close();
+            break;
+        case ',':
+            if (_depth > 0 && _depth <= MAX_DEPTH) {
+                Level& top = _levels[_depth - 1];
+                if (top.kind == CONTAINER_OBJECT) top.expectKey = true;
+                else top.index++;
+            }
+            break;
+        case ':':
+            if (_depth > 0 && _depth <= MAX_DEPTH) _levels[_depth - 1].expectKey = false;
+            break;
+        case '"':
+            _state = STATE_STRING;
+            _valueLen = 0;
+            _valueIsKey = _depth > 0 && _depth <= MAX_DEPTH
+                && _levels[_depth - 1].kind == CONTAINER_OBJECT && _levels[_depth - 1].expectKey;
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            break;
+        default:
+            _state = STATE_SCALAR;
+            _valueLen = 0;
+            push(c);
+            break;
+        }
+    }
+
+    inline void open(CONTAINER kind) {
+        if (_complete) _error = true; // Content after the root value
+        if (_depth < MAX_DEPTH) {
+            Level& level = _levels[_depth];
+            level.kind = kind;
+            level.expectKey = kind == CONTAINER_OBJECT;
+            level.index = 0;
+            level.key[0] = '\0';
+        }
+        if (_depth < UINT8_MAX) _depth++;
+        if (atPeriod()) memset(&_period, 0, sizeof(_period));
+    }
+
+    inline void close() {
+        if (_depth == 0) {
+            _error = true;
+            return;
+        }
+        if (atPeriod()) emitPeriod();
+        if (--_depth == 0) _complete = true;
+    }
+
+    inline void push(uint8_t c) {
+        // Longer values are cut, every field kept has a shorter limit anyway
+        if (_valueLen < sizeof(_value) - 1) _value[_valueLen++] = c;
+    }
+
+    inline void pushUtf8(uint16_t code) {
+        if (code < 0x80) {
+            push(code);
+        } else if (code < 0x800) {
+            push(0xC0 | (code >> 6));
+            push(0x80 | (code & 0x3F));
+        } else {
+            push(0xE0 | (code >> 12));
+            push(0x80 | ((code >> 6) & 0x3F));
+            push(0x80 | (code & 0x3F));
+        }
+    }
+
+    static inline uint8_t hexValue(uint8_t c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return 0;
+    }
+
+    inline void endString() {
+        _state = STATE_VALUE;
+        _value[_valueLen] = '\0';
+        if (_valueIsKey) {
+            // Keys longer than the buffer can never match, keep them empty
+            char* key = _levels[_depth - 1].key;
+            if (_valueLen < sizeof(_levels[0].key)) memcpy(key, _value, _valueLen + 1);
+            else key[0] = '\0';
+            return;
+        }
+        value();
+    }
+
+    inline void endScalar() {
+        _state = STATE_VALUE;
+        _value[_valueLen] = '\0';
+        value();
+    }
+
+    inline bool keyIs(uint8_t level, const char* key) const {
+        return _levels[level].kind == CONTAINER_OBJECT && strcmp(_levels[level].key, key) == 0;
+    }
+
+    // lokasi.<field>
+    inline bool atLocation() const {
+        return _depth == 2 && keyIs(0, "lokasi") && _levels[1].kind == CONTAINER_OBJECT;
+    }
+
+    // data[0].cuaca[day][n], the period object itself
+    inline bool atPeriod() const {
+        return _depth == 6 && keyIs(0, "data")
+            && _levels[1].kind == CONTAINER_ARRAY && _levels[1].index == 0
+            && keyIs(2, "cuaca")
+            && _levels[3].kind == CONTAINER_ARRAY
+            && _levels[4].kind == CONTAINER_ARRAY
+            && _levels[5].kind == CONTAINER_OBJECT;
+    }
+
+    template<size_t N>
+    inline void copyValue(char (&field)[N]) {
+        strncpy(field, _value, N - 1);
+        field[N - 1] = '\0';
+    }
+
+    inline void value() {
+        if (_depth == 0 || _depth > MAX_DEPTH) return;
+        const char* key = _levels[_depth - 1].key;
+
+        if (atLocation()) {
+            _hasLocation = true;
+            if (strcmp(key, "provinsi") == 0) copyValue(_location.provinsi);
+            else if (strcmp(key, "kotkab") == 0) copyValue(_location.kotkab);
+            else if (strcmp(key, "kecamatan") == 0) copyValue(_location.kecamatan);
+            else if (strcmp(key, "desa") == 0) copyValue(_location.desa);
+            else if (strcmp(key, "timezone") == 0) copyValue(_location.timezone);
+            else if (strcmp(key, "lon") == 0) _location.longitude = atof(_value);
+            else if (strcmp(key, "lat") == 0) _location.latitude = atof(_value);
+        } else if (atPeriod()) {
+            if (strcmp(key, "datetime") == 0) _period.time = parseDatetime(_value);
+            else if (strcmp(key, "t") == 0) _period.temperature = atoi(_value);
+            else if (strcmp(key, "hu") == 0) _period.humidity = atoi(_value);
+            else if (strcmp(key, "ws") == 0) _period.windSpeed = atof(_value);
+            else if (strcmp(key, "weather") == 0) _period.weatherCode = atoi(_value);
+            else if (strcmp(key, "wd") == 0) copyValue(_period.windDirection);
+            else if (strcmp(key, "weather_desc") == 0) copyValue(_period.description);
+            else if (strcmp(key, "image") == 0) copyValue(_period.image);
+            else if (strcmp(key, "local_datetime") == 0) copyValue(_period.localDatetime);
+        }
+    }
+
+    inline void emitPeriod() {
+        if (_periods++ == 0) _first = _period;
+        if (_onPeriod) _onPeriod(_period, _onPeriodArg);
+    }
+};
+
+} // namespace Services
@@ -1,6 +1,7 @@
 #pragma once
 #include <NetworkClientSecure.h>
 #include <HTTPClient.h>
+#include "HttpsPool.h"
 
 class CustomWifiClient : public NetworkClientSecure {
 public:
@@ -24,14 +25,73 @@ private:
 
 class CustomHttpClient : public HTTPClient {
 public:
-  CustomHttpClient(){}
-  ~CustomHttpClient(){}
+  CustomHttpClient(): _pooled(nullptr) {}
+  ~CustomHttpClient(){
+    if (_pooled) {
+      end();
+    }
+  }
+
+  /**
+  * begin on a keep-alive connection borrowed from httpsPool
+  * @param url String           https URL, anything else begins normally
+  * @return true if the URL was accepted, falls back to a connection of its own when the pool has none
+  */
+  inline bool beginPooled(const String& url) {
+    if (!url.startsWith("https://")) {
+      return begin(url);
+    }
+
+    int hostStart = 8;
+    int pathStart = url.indexOf('/', hostStart);
+    String authority = url.substring(hostStart, pathStart < 0 ? url.length() : pathStart);
+    int at = authority.indexOf('@');
+    if (at >= 0) {
+      authority = authority.substring(at + 1);
+    }
+    uint16_t port = 443;
+    int colon = authority.indexOf(':');
+    if (colon >= 0) {
+      port = authority.substring(colon + 1).toInt();
+      authority = authority.substring(0, colon);
+    }
+
+    _pooled = httpsPool.acquire(authority.c_str(), port);
+    if (!_pooled) {
+      return begin(url);
+    }
+    _pooledHost = authority;
+    setReuse(true);
+    return begin(*_pooled, url);
+  }
+
+  /**
+  * end the request, a pooled connection goes back to httpsPool still open when the server allows it
+  */
+  inline void end() {
+    NetworkClientSecure *pooled = _pooled;
+    if (!pooled) {
+      HTTPClient::end();
+      return;
+    }
+
+    _pooled = nullptr;
+    // a redirect may have moved the connection to another host
+    bool keep = _canReuse && _host == _pooledHost;
+    HTTPClient::end();
+    // the pool owns the client, keep ~HTTPClient from stopping it
+    _client = nullptr;
+    httpsPool.release(pooled, keep);
+  }
 
   /**
   * sendRequest
   * @param type const char *     "GET", "POST", ....
   * @param stream Stream *       data stream for the message body
-  * @param size size_t           size for the message body if 0 not Content-Length is send
+  * @param size size_t           size for the message body, 0 sends the body with chunked
+  *                              transfer encoding until stream->available() returns -1
+  *                              readBytes() may block while the stream waits for data, a stream
+  *                              that delivers nothing for the TCP timeout (setTimeout) fails the request
   * @return -1 if no info or > 0 when Content-Length is set by server
   */
   inline int sendRequest(const char *type, Stream *stream, size_t size) {
@@ -45,8 +105,11 @@ public:
       return returnError(HTTPC_ERROR_CONNECTION_REFUSED);
     }
 
+    bool chunked = (size == 0);
     if (size > 0) {
       addHeader("Content-Length", String(size));
+    } else {
+      addHeader("Transfer-Encoding", "chunked");
     }
 
     // add cookies to header, if present
@@ -74,85 +137,114 @@ public:
       buff_size = len;
     }
 
+    // room for the chunk size line in front of the data and CRLF behind it
+    const int prefix = chunked ? 6 : 0;
+    const int suffix = chunked ? 2 : 0;
+
     // create buffer for read
-    uint8_t *buff = (uint8_t *) heap_caps_malloc(buff_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+    uint8_t *buff = (uint8_t *) heap_caps_malloc(prefix + buff_size + suffix, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
 
     if (buff) {
+      // the stream going quiet for longer than the TCP timeout ends the upload
+      unsigned long lastData = millis();
+
       // read all data from stream and send it to server
       while (connected() && (stream->available() > -1) && (len > 0 || len == -1)) {
 
-        // get available data size
+        // get available data size, with nothing queued ask for a whole buffer
         int sizeAvailable = stream->available();
+        int readBytes = sizeAvailable > 0 ? sizeAvailable : buff_size;
 
-        if (sizeAvailable) {
-          int readBytes = sizeAvailable;
+        // read only the asked bytes
+        if (len > 0 && readBytes > len) {
+          readBytes = len;
+        }
 
-          // read only the asked bytes
-          if (len > 0 && readBytes > len) {
-            readBytes = len;
-          }
+        // not read more the buffer can handle
+        if (readBytes > buff_size) {
+          readBytes = buff_size;
+        }
 
-          // not read more the buffer can handle
-          if (readBytes > buff_size) {
-            readBytes = buff_size;
+        // read data, the stream waits up to its own timeout for something to arrive
+        int bytesRead = stream->readBytes(buff + prefix, readBytes);
+        if (bytesRead <= 0) {
+          if (millis() - lastData > _tcpTimeout) {
+            log_d("no body data for %lu ms", millis() - lastData);
+            heap_caps_free(buff);
+            return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
           }
+          continue;
+        }
+        lastData = millis();
+
+        // frame it as one chunk so the data goes out in a single write
+        uint8_t *frame = buff + prefix;
+        int frameSize = bytesRead;
+        if (chunked) {
+          char line[8];
+          int lineSize = snprintf(line, sizeof(line), "%x\r\n", bytesRead); // <= prefix while buff_size < 0x10000
+          frame -= lineSize;
+          memcpy(frame, line, lineSize);
+          memcpy(buff + prefix + bytesRead, "\r\n", suffix);
+          frameSize += lineSize + suffix;
+        }
 
-          // read data
-          int bytesRead = stream->readBytes(buff, readBytes);
-
-          // write it to Stream
-          int bytesWrite = _client->write((const uint8_t *)buff, bytesRead);
-          bytesWritten += bytesWrite;
-
-          // are all Bytes a written to stream ?
-          if (bytesWrite != bytesRead) {
-            log_d("short write, asked for %d but got %d retry...", bytesRead, bytesWrite);
+        // write it to Stream
+        int bytesWrite = _client->write((const uint8_t *)frame, frameSize);
 
-            // check for write error
-            if (_client->getWriteError()) {
-              log_d("stream write error %d", _client->getWriteError());
+        // are all Bytes a written to stream ?
+        if (bytesWrite != frameSize) {
+          log_d("short write, asked for %d but got %d retry...", frameSize, bytesWrite);
 
-              //reset write error for retry
-              _client->clearWriteError();
-            }
+          // check for write error
+          if (_client->getWriteError()) {
+            log_d("stream write error %d", _client->getWriteError());
 
-            // some time for the stream
-            delay(1);
+            //reset write error for retry
+            _client->clearWriteError();
+          }
 
-            int leftBytes = (readBytes - bytesWrite);
+          // some time for the stream
+          delay(1);
 
-            // retry to send the missed bytes
-            bytesWrite = _client->write((const uint8_t *)(buff + bytesWrite), leftBytes);
-            bytesWritten += bytesWrite;
+          int leftBytes = (frameSize - bytesWrite);
 
-            if (bytesWrite != leftBytes) {
-              // failed again
-              log_d("short write, asked for %d but got %d failed.", leftBytes, bytesWrite);
-              heap_caps_free(buff);
-              return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
-            }
-          }
+          // retry to send the missed bytes
+          bytesWrite = _client->write((const uint8_t *)(frame + bytesWrite), leftBytes);
 
-          // check for write error
-          if (_client->getWriteError()) {
-            log_d("stream write error %d", _client->getWriteError());
+          if (bytesWrite != leftBytes) {
+            // failed again
+            log_d("short write, asked for %d but got %d failed.", leftBytes, bytesWrite);
             heap_caps_free(buff);
             return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
           }
+        }
 
-          // count bytes to read left
-          if (len > 0) {
-          len -= readBytes;
-          }
+        // check for write error
+        if (_client->getWriteError()) {
+          log_d("stream write error %d", _client->getWriteError());
+          heap_caps_free(buff);
+          return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+        }
 
-          delay(0);
-        } else {
-          delay(1);
+        bytesWritten += bytesRead;
+
+        // count bytes to read left
+        if (len > 0) {
+        len -= bytesRead;
         }
+
+        delay(0);
       }
 
       heap_caps_free(buff);
 
+      // last chunk ends the body
+      if (chunked && _client->write((const uint8_t *)"0\r\n\r\n", 5) != 5) {
+        log_d("failed to write last chunk");
+        return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+      }
+
       if (size && (int)size != bytesWritten) {
       log_d("Stream payload bytesWritten %d and size %d mismatch!.", bytesWritten, size);
       log_d("ERROR SEND PAYLOAD FAILED!");
@@ -288,4 +380,8 @@ public:
 
     return bytesWritten;
   }
+
+private:
+  NetworkClientSecure *_pooled;
+  String _pooledHost;
 };
\ No newline at end of file
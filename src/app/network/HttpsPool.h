@@ -0,0 +1,203 @@
+#pragma once
+#include <Arduino.h>
+#include <NetworkClientSecure.h>
+#include <freertos/semphr.h>
+
+#ifndef HTTPS_POOL_SIZE
+#define HTTPS_POOL_SIZE 3 // TLS connections open at once, each holds mbedTLS buffers
+#endif
+
+#ifndef HTTPS_POOL_IDLE_MS
+#define HTTPS_POOL_IDLE_MS 30000 // Idle connections are closed after this, before servers usually do
+#endif
+
+struct HttpsPoolStats {
+	uint32_t requests;     // acquire() calls that got a connection
+	uint32_t reused;       // of those, served by an idle connection
+	uint32_t evicted;      // idle connections closed for age, health or room
+	uint32_t setupMs;      // total connect time of new connections
+	uint32_t lastSetupMs;  // setup time of the latest request, 0 when reused
+};
+
+/**
+ * Keep-alive HTTPS connections shared by host:port
+ *
+ * A request borrows a connection with acquire() and hands it back with
+ * release(). An idle connection to the same host is reused when it is
+ * still connected and nothing unexpected is waiting on it (a server close
+ * alert), so back-to-back requests skip the TCP and TLS handshakes.
+ * Connections idle longer than HTTPS_POOL_IDLE_MS are closed.
+ */
+class HttpsConnectionPool {
+public:
+	HttpsConnectionPool(): _slots{}, _lock(xSemaphoreCreateMutex()), _stats{} {}
+
+	/**
+	 * Borrow a connected client
+	 * @param host Server name
+	 * @param port Server port
+	 * @param timeoutMs Connect timeout for a new connection
+	 * @return nullptr when every slot is busy or the connect failed
+	 */
+	inline NetworkClientSecure* acquire(const char* host, uint16_t port, uint32_t timeoutMs = 10000) {
+		if (!host || strlen(host) >= sizeof(Slot::host) || !lock()) return nullptr;
+
+		evictLocked(false);
+		Slot* slot = nullptr;
+		for (size_t i = 0; i < HTTPS_POOL_SIZE; i++) {
+			Slot& s = _slots[i];
+			if (s.busy || !s.open || s.port != port || strcmp(s.host, host) != 0) continue;
+			if (!healthy(s)) {
+				close(s);
+				continue;
+			}
+			slot = &s;
+			break;
+		}
+
+		if (slot) {
+			slot->busy = true;
+			_stats.requests++;
+			_stats.reused++;
+			_stats.lastSetupMs = 0;
+			unlock();
+			ESP_LOGD("HttpsPool", "Reusing connection to %s:%d", host, port);
+			return slot->client;
+		}
+
+		// A free slot, otherwise the idle connection unused the longest
+		for (size_t i = 0; i < HTTPS_POOL_SIZE; i++) {
+			Slot& s = _slots[i];
+			if (s.busy) continue;
+			if (!s.open) {
+				slot = &s;
+				break;
+			}
+			if (!slot || s.idleSince < slot->idleSince) slot = &s;
+		}
+		if (!slot) {
+			unlock();
+			ESP_LOGW("HttpsPool", "All %d connections busy", HTTPS_POOL_SIZE);
+			return nullptr;
+		}
+		if (slot->open) close(*slot);
+		if (!slot->client) slot->client = new NetworkClientSecure();
+		slot->busy = true;
+		strcpy(slot->host, host);
+		slot->port = port;
+		unlock();
+
+		// Connect outside the lock, other requests may proceed meanwhile
+		unsigned long start = millis();
+		slot->client->setInsecure();
+		bool ok = slot->client->connect(host, port, timeoutMs);
+		uint32_t elapsed = millis() - start;
+
+		lock();
+		slot->open = ok;
+		if (ok) {
+			_stats.requests++;
+			_stats.setupMs += elapsed;
+			_stats.lastSetupMs = elapsed;
+		} else {
+			slot->busy = false;
+			slot->client->stop();
+		}
+		unlock();
+
+		if (!ok) {
+			ESP_LOGE("HttpsPool", "Failed to connect to %s:%d", host, port);
+			return nullptr;
+		}
+		ESP_LOGI("HttpsPool", "New connection to %s:%d in %d ms", host, port, elapsed);
+		return slot->client;
+	}
+
+	/**
+	 * Return a borrowed client
+	 * @param keep false when the connection must not be reused, e.g. the response was not read to the end
+	 */
+	inline void release(NetworkClientSecure* client, bool keep = true) {
+		if (!client || !lock()) return;
+		for (size_t i = 0; i < HTTPS_POOL_SIZE; i++) {
+			Slot& s = _slots[i];
+			if (s.client != client) continue;
+			s.busy = false;
+			s.idleSince = millis();
+			if (!keep || !client->connected()) {
+				client->stop();
+				s.open = false;
+			}
+			break;
+		}
+		unlock();
+	}
+
+	/**
+	 * Close idle connections past their age, call it from a periodic task
+	 */
+	inline void evictIdle() {
+		if (!lock()) return;
+		evictLocked(false);
+		unlock();
+	}
+
+	/**
+	 * Close every idle connection, e.g. when WiFi went down
+	 */
+	inline void closeIdle() {
+		if (!lock()) return;
+		evictLocked(true);
+		unlock();
+	}
+
+	inline HttpsPoolStats stats() const { return _stats; }
+
+	inline uint32_t reusePercent() const {
+		return _stats.requests ? _stats.reused * 100 / _stats.requests : 0;
+	}
+
+private:
+	struct Slot {
+		NetworkClientSecure* client;
+		char host[64];
+		uint16_t port;
+		unsigned long idleSince;
+		bool busy;
+		bool open;
+	};
+
+	Slot _slots[HTTPS_POOL_SIZE];
+	SemaphoreHandle_t _lock;
+	HttpsPoolStats _stats;
+
+	inline bool lock() {
+		return _lock && xSemaphoreTake(_lock, portMAX_DELAY) == pdTRUE;
+	}
+
+	inline void unlock() {
+		xSemaphoreGive(_lock);
+	}
+
+	// Data on an idle connection is a close alert or a stray response
+	inline bool healthy(Slot& s) {
+		return s.client->connected() && s.client->available() == 0;
+	}
+
+	inline void close(Slot& s) {
+		s.client->stop();
+		s.open = false;
+		_stats.evicted++;
+	}
+
+	inline void evictLocked(bool all) {
+		unsigned long now = millis();
+		for (size_t i = 0; i < HTTPS_POOL_SIZE; i++) {
+			Slot& s = _slots[i];
+			if (s.busy || !s.open) continue;
+			if (all || now - s.idleSince >= HTTPS_POOL_IDLE_MS || !healthy(s)) close(s);
+		}
+	}
+};
+
+extern HttpsConnectionPool httpsPool;
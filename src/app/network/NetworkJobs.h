@@ -0,0 +1,209 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <freertos/queue.h>
+
+#ifndef NETWORK_JOB_QUEUE_DEPTH
+#define NETWORK_JOB_QUEUE_DEPTH 8 // Jobs waiting for the worker, submit() fails beyond this
+#endif
+
+#ifndef NETWORK_JOB_STACK
+#define NETWORK_JOB_STACK (1024 * 8) // HTTPS and TLS run on this stack
+#endif
+
+#ifndef NETWORK_JOB_PRIORITY
+#define NETWORK_JOB_PRIORITY 1
+#endif
+
+enum NETWORK_JOB {
+	NETWORK_JOB_WEATHER = 0,
+	NETWORK_JOB_NTP,
+	NETWORK_JOB_TOOL,
+	NETWORK_JOB_PRECONNECT,
+	NETWORK_JOB_MAX
+};
+
+struct NetworkJob {
+	NETWORK_JOB kind;
+	std::function<bool()> run;          // On the worker, may block
+	std::function<void(bool ok)> done;  // Where completions are drained, may be empty
+	unsigned long queuedAt;
+	uint32_t waitMs;                    // Queued until the worker picked it up
+	uint32_t runMs;
+	bool ok;
+};
+
+struct NetworkJobStats {
+	uint32_t submitted;
+	uint32_t completed;
+	uint32_t failed;      // run() returned false
+	uint32_t rejected;    // Queue full
+	uint32_t lastWaitMs;
+	uint32_t lastRunMs;
+	uint32_t lastLatencyMs; // Submit to completion callback
+	uint32_t maxLatencyMs;
+};
+
+// Hands a finished job to the consumer, false to complete it on the worker instead
+typedef bool (*network_job_deliver_t)(NetworkJob* job);
+
+/**
+ * Bounded queue of blocking network work with a single worker task
+ *
+ * Callers submit a run function and a completion. The worker runs jobs
+ * one at a time, so services behind it (weather, NTP) are never entered
+ * concurrently, and hands each finished job to the deliver hook. The
+ * consumer calls complete() on it, which runs the completion on the
+ * consumer's task and frees the job. Submitters, the worker and the
+ * consumer all update the stats, always under _lock.
+ */
+class NetworkJobQueue {
+public:
+	NetworkJobQueue(): _queue(nullptr), _task(nullptr), _deliver(nullptr), _maxDepth(0), _pending{}, _stats{} {}
+
+	/**
+	 * Create the queue and start the worker, safe to call again
+	 * @param deliver Passes finished jobs to the consumer
+	 */
+	inline bool begin(network_job_deliver_t deliver) {
+		_deliver = deliver;
+		if (_task) return true;
+
+		if (!_queue) _queue = xQueueCreate(NETWORK_JOB_QUEUE_DEPTH, sizeof(NetworkJob*));
+		if (!_queue) {
+			ESP_LOGE("NetworkJob", "Failed to create the job queue");
+			return false;
+		}
+		BaseType_t ret = xTaskCreatePinnedToCoreWithCaps(workerTask, "networkJobs", NETWORK_JOB_STACK, this,
+			NETWORK_JOB_PRIORITY, &_task, 1, MALLOC_CAP_INTERNAL);
+		if (ret != pdPASS) {
+			ESP_LOGE("NetworkJob", "Failed to start the worker");
+			_task = nullptr;
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Queue a job, never blocks
+	 * @return false when the queue is full or not started, done is not called then
+	 */
+	inline bool submit(NETWORK_JOB kind, std::function<bool()> run, std::function<void(bool ok)> done = nullptr) {
+		if (kind >= NETWORK_JOB_MAX) return false;
+		if (!_queue) {
+			taskENTER_CRITICAL(&_lock);
+			_stats[kind].rejected++;
+			taskEXIT_CRITICAL(&_lock);
+			return false;
+		}
+
+		NetworkJob* job = new NetworkJob{kind, run, done, millis(), 0, 0, false};
+		taskENTER_CRITICAL(&_lock);
+		_pending[kind]++;
+		_stats[kind].submitted++;
+		taskEXIT_CRITICAL(&_lock);
+
+		if (xQueueSend(_queue, &job, 0) != pdTRUE) {
+			taskENTER_CRITICAL(&_lock);
+			_pending[kind]--;
+			_stats[kind].submitted--;
+			_stats[kind].rejected++;
+			taskEXIT_CRITICAL(&_lock);
+			ESP_LOGW("NetworkJob", "Queue full, %s rejected", name(kind));
+			delete job;
+			return false;
+		}
+
+		UBaseType_t depth = uxQueueMessagesWaiting(_queue);
+		taskENTER_CRITICAL(&_lock);
+		if (depth > _maxDepth) _maxDepth = depth;
+		taskEXIT_CRITICAL(&_lock);
+		return true;
+	}
+
+	/**
+	 * Run the completion of a delivered job and free it
+	 */
+	inline void complete(NetworkJob* job) {
+		if (!job) return;
+		if (job->done) job->done(job->ok);
+
+		uint32_t latency = millis() - job->queuedAt;
+		taskENTER_CRITICAL(&_lock);
+		NetworkJobStats& stats = _stats[job->kind];
+		stats.lastLatencyMs = latency;
+		if (latency > stats.maxLatencyMs) stats.maxLatencyMs = latency;
+		taskEXIT_CRITICAL(&_lock);
+		ESP_LOGI("NetworkJob", "%s %s in %lu ms (waited %lu ms, ran %lu ms), %d queued",
+			name(job->kind), job->ok ? "done" : "failed", latency, job->waitMs, job->runMs, depth());
+		delete job;
+	}
+
+	// Queued or running
+	inline bool pending(NETWORK_JOB kind) const {
+		return kind < NETWORK_JOB_MAX && _pending[kind] > 0;
+	}
+
+	inline size_t depth() const { return _queue ? uxQueueMessagesWaiting(_queue) : 0; }
+	inline size_t maxDepth() const { return _maxDepth; }
+
+	// A consistent copy, taken under the lock
+	inline NetworkJobStats stats(NETWORK_JOB kind) const {
+		if (kind >= NETWORK_JOB_MAX) return NetworkJobStats{};
+		taskENTER_CRITICAL(&_lock);
+		NetworkJobStats stats = _stats[kind];
+		taskEXIT_CRITICAL(&_lock);
+		return stats;
+	}
+
+	static const char* name(NETWORK_JOB kind) {
+		switch (kind) {
+		case NETWORK_JOB_WEATHER: return "weather";
+		case NETWORK_JOB_NTP: return "ntp";
+		case NETWORK_JOB_TOOL: return "tool";
+		case NETWORK_JOB_PRECONNECT: return "preconnect";
+		default: return "unknown";
+		}
+	}
+
+private:
+	QueueHandle_t _queue;
+	TaskHandle_t _task;
+	network_job_deliver_t _deliver;
+	UBaseType_t _maxDepth;
+	volatile uint8_t _pending[NETWORK_JOB_MAX];
+	NetworkJobStats _stats[NETWORK_JOB_MAX];
+	mutable portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED; // Guards _pending, _stats and _maxDepth
+
+	static void workerTask(void* arg) {
+		NetworkJobQueue* self = static_cast<NetworkJobQueue*>(arg);
+		NetworkJob* job = nullptr;
+
+		while (1) {
+			if (xQueueReceive(self->_queue, &job, portMAX_DELAY) != pdTRUE) continue;
+
+			unsigned long start = millis();
+			job->waitMs = start - job->queuedAt;
+			job->ok = job->run ? job->run() : true;
+			job->runMs = millis() - start;
+
+			// A new job of this kind may be queued from here on
+			taskENTER_CRITICAL(&self->_lock);
+			NetworkJobStats& stats = self->_stats[job->kind];
+			stats.completed++;
+			if (!job->ok) stats.failed++;
+			stats.lastWaitMs = job->waitMs;
+			stats.lastRunMs = job->runMs;
+			self->_pending[job->kind]--;
+			taskEXIT_CRITICAL(&self->_lock);
+
+			if (!self->_deliver || !self->_deliver(job)) {
+				ESP_LOGW("NetworkJob", "Completing %s on the worker, delivery failed", name(job->kind));
+				self->complete(job);
+			}
+		}
+	}
+};
+
+extern NetworkJobQueue networkJobs;
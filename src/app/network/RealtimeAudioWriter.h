@@ -0,0 +1,132 @@
+#pragma once
+#include <Arduino.h>
+
+#ifndef REALTIME_WRITER_BLOCK
+#define REALTIME_WRITER_BLOCK 384 // PCM bytes encoded per write, multiple of 12
+#endif
+
+static_assert(REALTIME_WRITER_BLOCK % 12 == 0, "REALTIME_WRITER_BLOCK must be whole 12-byte groups");
+
+/**
+ * Base64 with a 12-bit table: every 3 input bytes are two lookups of two
+ * output characters each, 12 bytes in make 16 bytes out per kernel step.
+ * The 8 KB table is built at compile time and stays in flash.
+ */
+namespace Base64Kernel {
+	struct Table {
+		uint16_t pairs[4096];
+	};
+
+	constexpr char alphabet(uint32_t v) {
+		return v < 26 ? 'A' + v : v < 52 ? 'a' + v - 26 : v < 62 ? '0' + v - 52 : v == 62 ? '+' : '/';
+	}
+
+	// Entry i holds the characters of sextets i >> 6 and i & 63, first one in the low byte (little-endian)
+	constexpr Table makeTable() {
+		Table table = {};
+		for (uint32_t i = 0; i < 4096; i++) {
+			uint8_t first = alphabet(i >> 6);
+			uint8_t second = alphabet(i & 63);
+			table.pairs[i] = first | (second << 8);
+		}
+		return table;
+	}
+
+	inline constexpr Table table = makeTable();
+
+	constexpr size_t encodedSize(size_t len) { return (len + 2) / 3 * 4; }
+
+	inline void encode3(const uint8_t* in, uint8_t* out) {
+		uint32_t v = (in[0] << 16) | (in[1] << 8) | in[2];
+		uint16_t hi = table.pairs[v >> 12];
+		uint16_t lo = table.pairs[v & 0xFFF];
+		memcpy(out, &hi, 2);
+		memcpy(out + 2, &lo, 2);
+	}
+
+	/**
+	 * Encode whole 12-byte groups
+	 * @param len Multiple of 12
+	 */
+	inline void encode12(const uint8_t* in, size_t len, uint8_t* out) {
+		for (size_t i = 0; i < len; i += 12, in += 12, out += 16) {
+			encode3(in, out);
+			encode3(in + 3, out + 4);
+			encode3(in + 6, out + 8);
+			encode3(in + 9, out + 12);
+		}
+	}
+
+	/**
+	 * Encode any length with padding, out holds encodedSize(len) bytes
+	 */
+	inline size_t encode(const uint8_t* in, size_t len, uint8_t* out) {
+		size_t groups = len / 12 * 12;
+		encode12(in, groups, out);
+		uint8_t* o = out + groups / 3 * 4;
+		size_t i = groups;
+		for (; i + 3 <= len; i += 3, o += 4) encode3(in + i, o);
+		size_t left = len - i;
+		if (left > 0) {
+			uint8_t tail[3] = {in[i], (uint8_t)(left > 1 ? in[i + 1] : 0), 0};
+			encode3(tail, o);
+			o[3] = '=';
+			if (left == 1) o[2] = '=';
+			o += 4;
+		}
+		return o - out;
+	}
+}
+
+// input_audio_buffer.append, the realtime uplink message
+struct RealtimeInputAudioAppend {
+	static constexpr char prefix[] = "{\"type\":\"input_audio_buffer.append\",\"audio\":\"";
+	static constexpr char suffix[] = "\"}";
+};
+
+/**
+ * Writes a one-field JSON message around base64 audio straight into a frame
+ *
+ * Message supplies the constant prefix and suffix, so the frame length is
+ * known before any byte is produced and the payload goes out through the
+ * frame writer's begin/write/end without a document, a base64 String or a
+ * serialized copy. The only buffer is REALTIME_WRITER_BLOCK / 3 * 4 bytes
+ * on the stack.
+ */
+template<typename Message>
+class RealtimeAudioWriter {
+public:
+	static constexpr size_t prefixSize = sizeof(Message::prefix) - 1;
+	static constexpr size_t suffixSize = sizeof(Message::suffix) - 1;
+
+	static constexpr size_t messageSize(size_t pcmBytes) {
+		return prefixSize + Base64Kernel::encodedSize(pcmBytes) + suffixSize;
+	}
+
+	/**
+	 * @param socket Anything with beginFrame(len), write(data, len) and endFrame()
+	 * @param pcm Audio to embed
+	 * @param len Bytes of audio
+	 * @return true if the whole frame was written
+	 */
+	template<typename Socket>
+	static bool send(Socket& socket, const uint8_t* pcm, size_t len) {
+		if (!socket.beginFrame(messageSize(len))) return false;
+		if (!socket.write((const uint8_t*)Message::prefix, prefixSize)) return false;
+
+		uint8_t block[REALTIME_WRITER_BLOCK / 3 * 4];
+		while (len >= REALTIME_WRITER_BLOCK) {
+			Base64Kernel::encode12(pcm, REALTIME_WRITER_BLOCK, block);
+			if (!socket.write(block, sizeof(block))) return false;
+			pcm += REALTIME_WRITER_BLOCK;
+			len -= REALTIME_WRITER_BLOCK;
+		}
+		if (len > 0) {
+			size_t n = Base64Kernel::encode(pcm, len, block);
+			if (!socket.write(block, n)) return false;
+		}
+
+		if (!socket.write((const uint8_t*)Message::suffix, suffixSize)) return false;
+		return socket.endFrame();
+	}
+};
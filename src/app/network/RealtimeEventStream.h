@@ -0,0 +1,314 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+#ifndef REALTIME_AUDIO_CHUNK
+#define REALTIME_AUDIO_CHUNK 1024 // Decoded PCM bytes handed to the sink at a time
+#endif
+
+// Same shape as the speaker callback so speakerAudioCallback plugs in directly
+typedef void (*realtime_audio_sink_t)(const uint8_t* audioData, size_t audioSize, bool isLastChunk);
+typedef void (*realtime_event_cb_t)(const char* type, const char* json, size_t len, void* arg);
+
+/**
+ * Realtime API event reader that never holds an audio delta in memory
+ *
+ * Messages are fed as they come off the socket. A small tokenizer follows
+ * the top-level object, picks up "type" and, for audio deltas, base64
+ * decodes the "delta" string on the fly into REALTIME_AUDIO_CHUNK pieces
+ * for the sink. Every other event is collected and handed to the event
+ * callback whole, those are small. The API sends "type" first; a delta
+ * seen before its type is collected like any other event instead. The
+ * end of a response's audio is passed on to the sink as its last chunk.
+ */
+class RealtimeEventStream {
+public:
+	RealtimeEventStream(): _sink(nullptr), _onEvent(nullptr), _onEventArg(nullptr), _json(nullptr), _jsonCapacity(0) {
+		begin();
+		_audioMessages = 0;
+		_audioBytes = 0;
+		_events = 0;
+		_peakJson = 0;
+	}
+	~RealtimeEventStream() {
+		if (_json) heap_caps_free(_json);
+	}
+
+	/**
+	 * @param sink Receives decoded PCM of audio deltas
+	 * @param onEvent Receives all other events as complete JSON, may be nullptr
+	 * @param arg Passed to onEvent
+	 */
+	inline void setCallbacks(realtime_audio_sink_t sink, realtime_event_cb_t onEvent, void* arg = nullptr) {
+		_sink = sink;
+		_onEvent = onEvent;
+		_onEventArg = arg;
+	}
+
+	/**
+	 * Start a new message
+	 */
+	inline void begin() {
+		_depth = 0;
+		_inString = false;
+		_escape = false;
+		_expectKey = false;
+		_field = FIELD_NONE;
+		_keyLen = 0;
+		_key[0] = '\0';
+		_typeLen = 0;
+		_type[0] = '\0';
+		_audio = false;
+		_audioDone = false;
+		_collect = true;
+		_jsonLen = 0;
+		_quad = 0;
+		_quadCount = 0;
+		_outLen = 0;
+	}
+
+	/**
+	 * Feed the next bytes of the current message
+	 */
+	inline void feed(const uint8_t* data, size_t len) {
+		if (_collect) append(data, len);
+		for (size_t i = 0; i < len; i++) {
+			uint8_t c = data[i];
+			if (_inString) {
+				stringByte(c);
+				continue;
+			}
+			switch (c) {
+			case '{':
+			case '[':
+				_depth++;
+				_expectKey = _depth == 1 && c == '{';
+				break;
+			case '}':
+			case ']':
+				if (_depth > 0) _depth--;
+				break;
+			case ',':
+				if (_depth == 1) _expectKey = true;
+				break;
+			case ':':
+				if (_depth == 1) _expectKey = false;
+				break;
+			case '"':
+				startString();
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	/**
+	 * The current message is complete
+	 */
+	inline void end() {
+		if (_audio) {
+			flushAudio();
+			_audioMessages++;
+		} else if (_collect && _jsonLen > 0) {
+			_events++;
+			if (_onEvent && reserve(_jsonLen + 1)) {
+				_json[_jsonLen] = '\0';
+				_onEvent(_type, (const char*)_json, _jsonLen, _onEventArg);
+			}
+		}
+		if (_audioDone && _sink) _sink(nullptr, 0, true);
+		begin();
+	}
+
+	/**
+	 * Matches ws_fragment_cb_t, pass the stream as arg
+	 */
+	static void onFragment(uint8_t opcode, const uint8_t* data, size_t len, bool first, bool last, void* arg) {
+		RealtimeEventStream* self = static_cast<RealtimeEventStream*>(arg);
+		if (first) self->begin();
+		if (len > 0) self->feed(data, len);
+		if (last) self->end();
+	}
+
+	inline const char* type() const { return _type; }
+	inline uint32_t audioMessages() const { return _audioMessages; }
+	inline uint32_t audioBytes() const { return _audioBytes; }
+	inline uint32_t events() const { return _events; }
+	// Largest JSON collected so far, the only per-message allocation
+	inline size_t peakJson() const { return _peakJson; }
+
+private:
+	enum FIELD {
+		FIELD_NONE = 0,
+		FIELD_KEY,
+		FIELD_TYPE,
+		FIELD_DELTA,
+		FIELD_OTHER
+	};
+
+	realtime_audio_sink_t _sink;
+	realtime_event_cb_t _onEvent;
+	void* _onEventArg;
+
+	uint8_t* _json;
+	size_t _jsonCapacity;
+	size_t _jsonLen;
+	bool _collect;
+
+	uint16_t _depth;
+	bool _inString;
+	bool _escape;
+	bool _expectKey;
+	FIELD _field;
+	char _key[8];
+	uint8_t _keyLen;
+	char _type[48];
+	uint8_t _typeLen;
+	bool _audio;
+	bool _audioDone;
+
+	uint32_t _quad;
+	uint8_t _quadCount;
+	uint8_t _out[REALTIME_AUDIO_CHUNK];
+	size_t _outLen;
+
+	uint32_t _audioMessages;
+	uint32_t _audioBytes;
+	uint32_t _events;
+	size_t _peakJson;
+
+	inline void startString() {
+		_inString = true;
+		_escape = false;
+		if (_depth != 1) {
+			_field = FIELD_OTHER;
+		} else if (_expectKey) {
+			_field = FIELD_KEY;
+			_keyLen = 0;
+		} else if (strcmp(_key, "type") == 0) {
+			_field = FIELD_TYPE;
+			_typeLen = 0;
+		} else if (strcmp(_key, "delta") == 0 && _audio) {
+			_field = FIELD_DELTA;
+			_quad = 0;
+			_quadCount = 0;
+		} else {
+			_field = FIELD_OTHER;
+		}
+	}
+
+	inline void stringByte(uint8_t c) {
+		if (_escape) {
+			// Only \/ can show up inside base64, other escapes are kept as the raw character
+			_escape = false;
+		} else if (c == '\\') {
+			_escape = true;
+			return;
+		} else if (c == '"') {
+			endString();
+			return;
+		}
+
+		switch (_field) {
+		case FIELD_KEY:
+			// Keys longer than the buffer can never match, mark them with an impossible length
+			if (_keyLen < sizeof(_key) - 1) _key[_keyLen++] = c;
+			else _keyLen = sizeof(_key);
+			break;
+		case FIELD_TYPE:
+			if (_typeLen < sizeof(_type) - 1) _type[_typeLen++] = c;
+			break;
+		case FIELD_DELTA:
+			base64Byte(c);
+			break;
+		default:
+			break;
+		}
+	}
+
+	inline void endString() {
+		_inString = false;
+		switch (_field) {
+		case FIELD_KEY:
+			_key[_keyLen < sizeof(_key) ? _keyLen : 0] = '\0';
+			break;
+		case FIELD_TYPE:
+			_type[_typeLen] = '\0';
+			_audio = strcmp(_type, "response.audio.delta") == 0 || strcmp(_type, "response.output_audio.delta") == 0;
+			_audioDone = strcmp(_type, "response.audio.done") == 0 || strcmp(_type, "response.output_audio.done") == 0;
+			// Audio deltas are not collected, drop what was kept of the prefix
+			if (_audio) _collect = false;
+			break;
+		case FIELD_DELTA:
+			finishBase64();
+			break;
+		default:
+			break;
+		}
+		_field = FIELD_NONE;
+	}
+
+	inline void base64Byte(uint8_t c) {
+		uint8_t v;
+		if (c >= 'A' && c <= 'Z') v = c - 'A';
+		else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+		else if (c >= '0' && c <= '9') v = c - '0' + 52;
+		else if (c == '+') v = 62;
+		else if (c == '/') v = 63;
+		else return; // Padding and anything else
+
+		_quad = (_quad << 6) | v;
+		if (++_quadCount < 4) return;
+		_quadCount = 0;
+		if (REALTIME_AUDIO_CHUNK - _outLen < 3) flushAudio();
+		_out[_outLen++] = _quad >> 16;
+		_out[_outLen++] = _quad >> 8;
+		_out[_outLen++] = _quad;
+	}
+
+	inline void finishBase64() {
+		if (REALTIME_AUDIO_CHUNK - _outLen < 2) flushAudio();
+		if (_quadCount == 2) {
+			_out[_outLen++] = _quad >> 4;
+		} else if (_quadCount == 3) {
+			_out[_outLen++] = _quad >> 10;
+			_out[_outLen++] = _quad >> 2;
+		}
+		_quadCount = 0;
+	}
+
+	// Hands over whole samples, an odd byte waits for its partner
+	inline void flushAudio() {
+		size_t even = _outLen & ~(size_t)1;
+		if (even == 0) return;
+		if (_sink) _sink(_out, even, false);
+		_audioBytes += even;
+		if (_outLen > even) _out[0] = _out[even];
+		_outLen -= even;
+	}
+
+	inline void append(const uint8_t* data, size_t len) {
+		if (!reserve(_jsonLen + len + 1)) {
+			_collect = false;
+			return;
+		}
+		memcpy(_json + _jsonLen, data, len);
+		_jsonLen += len;
+		if (_jsonLen > _peakJson) _peakJson = _jsonLen;
+	}
+
+	inline bool reserve(size_t size) {
+		if (size <= _jsonCapacity) return true;
+		size_t capacity = _jsonCapacity ? _jsonCapacity : 512;
+		while (capacity < size) capacity *= 2;
+		uint8_t* json = (uint8_t*)heap_caps_realloc(_json, capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+		if (!json) {
+			ESP_LOGE("RealtimeEvent", "Failed to allocate %d bytes for an event", capacity);
+			return false;
+		}
+		_json = json;
+		_jsonCapacity = capacity;
+		return true;
+	}
+};
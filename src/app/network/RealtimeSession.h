@@ -0,0 +1,274 @@
+#pragma once
+#include <Arduino.h>
+#include <deque>
+#include <esp_heap_caps.h>
+#include <freertos/semphr.h>
+#include <WebSocketClientSSL.h>
+#include "RealtimeEventStream.h"
+#include "RealtimeAudioWriter.h"
+
+#ifndef REALTIME_HOST
+#define REALTIME_HOST "api.openai.com"
+#endif
+
+#ifndef REALTIME_PATH
+#define REALTIME_PATH "/v1/realtime?model=gpt-realtime-mini"
+#endif
+
+#ifndef REALTIME_UPLINK_BYTES
+#define REALTIME_UPLINK_BYTES 9600 // Largest uplink message, 200 ms of 24kHz PCM16
+#endif
+
+#ifndef REALTIME_OUTBOX_DEPTH
+#define REALTIME_OUTBOX_DEPTH 8 // Messages from other tasks waiting for the session task
+#endif
+
+#ifndef REALTIME_POLL_MS
+#define REALTIME_POLL_MS 10
+#endif
+
+#ifndef REALTIME_TASK_STACK
+#define REALTIME_TASK_STACK (1024 * 8) // TLS runs on this stack
+#endif
+
+#ifndef REALTIME_TASK_PRIORITY
+#define REALTIME_TASK_PRIORITY 3
+#endif
+
+// Same shape as micAudioCallback: up to maxSize bytes of 24kHz PCM16, 0 when nothing is due
+typedef size_t (*realtime_audio_source_t)(uint8_t* buffer, size_t maxSize);
+typedef void (*realtime_session_cb_t)();
+
+struct RealtimeSessionCallbacks {
+	realtime_audio_source_t source; // Uplink audio, every non-empty fill is one append message
+	realtime_audio_sink_t sink;     // Decoded audio deltas
+	realtime_session_cb_t onOpen;   // Connected, configure the session from here
+	realtime_event_cb_t onEvent;    // Every other server event as complete JSON
+	realtime_session_cb_t onClose;  // Ended by stop(), the server or a failed connect
+};
+
+struct RealtimeSessionStats {
+	uint32_t connectMs;      // connect() including the upgrade
+	uint32_t uplinkMessages;
+	uint32_t uplinkBytes;    // PCM bytes, before base64
+	uint32_t sent;           // Messages from send()
+	uint32_t dropped;        // send() with a full outbox
+};
+
+/**
+ * Realtime API session over WebSocketClientSSL, owned by one task
+ *
+ * The task connects, then alternates poll() and one uplink fill until the
+ * socket closes or stop() is called. Incoming text is streamed through a
+ * RealtimeEventStream, so audio deltas are decoded into the sink as they
+ * arrive and never held whole. Uplink audio is written straight into the
+ * frame by RealtimeAudioWriter. Other tasks never touch the socket:
+ * send() queues a message and the session task writes it on its next pass.
+ */
+class RealtimeSession {
+public:
+	RealtimeSession(): _lock(nullptr), _task(nullptr), _uplink(nullptr), _callbacks{}, _stopping(false), _stats{} {}
+
+	~RealtimeSession() {
+		if (_uplink) heap_caps_free(_uplink);
+		if (_lock) vSemaphoreDelete(_lock);
+	}
+
+	/**
+	 * Set up the session once the scheduler runs, nothing else works before this
+	 * @param apiKey Sent as a bearer token with every upgrade
+	 * @return false if the lock could not be created
+	 */
+	inline bool begin(const char* apiKey) {
+		if (!_lock) _lock = xSemaphoreCreateMutex();
+		if (!_lock) {
+			ESP_LOGE("Realtime", "Failed to create the session lock");
+			return false;
+		}
+		_auth = String("Bearer ") + apiKey;
+		_ws.setAuthorization(_auth.c_str());
+		return true;
+	}
+
+	/**
+	 * Start the session task
+	 * @return false if a session is already running or the task could not be created
+	 */
+	inline bool start(const RealtimeSessionCallbacks& callbacks) {
+		if (!_lock) {
+			ESP_LOGE("Realtime", "Session not set up, call begin() first");
+			return false;
+		}
+		if (_task) {
+			ESP_LOGW("Realtime", "Session already running");
+			return false;
+		}
+		_callbacks = callbacks;
+		_stopping = false;
+		BaseType_t ret = xTaskCreatePinnedToCoreWithCaps(sessionTask, "realtime", REALTIME_TASK_STACK, this,
+			REALTIME_TASK_PRIORITY, &_task, 1, MALLOC_CAP_INTERNAL);
+		if (ret != pdPASS) {
+			ESP_LOGE("Realtime", "Failed to start the session task");
+			_task = nullptr;
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * End the session, the task closes the socket and calls onClose
+	 */
+	inline void stop() { _stopping = true; }
+	inline bool running() const { return _task != nullptr; }
+
+	/**
+	 * Queue a client event for the session task, safe from any task
+	 * @return false when the outbox is full
+	 */
+	inline bool send(const String& json) {
+		if (!_lock || xSemaphoreTake(_lock, portMAX_DELAY) != pdTRUE) return false;
+		bool queued = _outbox.size() < REALTIME_OUTBOX_DEPTH;
+		if (queued) _outbox.push_back(json);
+		else _stats.dropped++;
+		xSemaphoreGive(_lock);
+		if (!queued) ESP_LOGW("Realtime", "Outbox full, message dropped");
+		return queued;
+	}
+
+	/**
+	 * Open TLS to the API ahead of a session, never while one runs
+	 * @param idleMs Closed again when no session took it within this time
+	 * @param timeoutMs Limit for the TCP connect and the TLS handshake each
+	 */
+	inline bool preconnect(uint32_t idleMs = WSS_PRECONNECT_IDLE_MS, uint32_t timeoutMs = WSS_PRECONNECT_TIMEOUT_MS) {
+		if (!_lock || _task || xSemaphoreTake(_lock, pdMS_TO_TICKS(100)) != pdTRUE) return false;
+		bool ok = !_task && _ws.preconnect(REALTIME_HOST, 443, idleMs, timeoutMs);
+		xSemaphoreGive(_lock);
+		return ok;
+	}
+
+	/**
+	 * Close a pre-opened connection past its budget, call it periodically
+	 */
+	inline void expirePreconnect() {
+		if (!_lock || _task || xSemaphoreTake(_lock, 0) != pdTRUE) return;
+		if (!_task) _ws.expirePreconnect();
+		xSemaphoreGive(_lock);
+	}
+
+	/**
+	 * Connect and hand over to onOpen, the session task starts with this
+	 */
+	inline bool open(const RealtimeSessionCallbacks& callbacks) {
+		if (!_lock) return false;
+		_callbacks = callbacks;
+		_events.begin();
+		_events.setCallbacks(_callbacks.sink, _callbacks.onEvent);
+		_stats = {};
+		if (!_uplink) _uplink = (uint8_t*)heap_caps_malloc(REALTIME_UPLINK_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+		if (!_uplink) {
+			ESP_LOGE("Realtime", "Failed to allocate the uplink buffer");
+			return false;
+		}
+
+		// A preconnect running on another task finishes first, connect() then reuses it
+		xSemaphoreTake(_lock, portMAX_DELAY);
+		_outbox.clear();
+		_ws.onFragment(RealtimeEventStream::onFragment, &_events);
+		unsigned long start = millis();
+		bool ok = _ws.connect(REALTIME_HOST, 443, REALTIME_PATH);
+		_stats.connectMs = millis() - start;
+		xSemaphoreGive(_lock);
+
+		if (!ok) {
+			ESP_LOGE("Realtime", "Failed to connect after %lu ms", _stats.connectMs);
+			return false;
+		}
+		ESP_LOGI("Realtime", "Connected in %lu ms", _stats.connectMs);
+		if (_callbacks.onOpen) _callbacks.onOpen();
+		return true;
+	}
+
+	/**
+	 * One pass of the session task: incoming events, queued messages, then uplink audio
+	 * @return false once the session is over
+	 */
+	inline bool service() {
+		if (_stopping) return false;
+		_ws.poll();
+		if (!_ws.isConnected()) return false;
+		if (!flushOutbox()) return false;
+
+		size_t len = _callbacks.source ? _callbacks.source(_uplink, REALTIME_UPLINK_BYTES) : 0;
+		if (len == 0) return true;
+		if (!RealtimeAudioWriter<RealtimeInputAudioAppend>::send(_ws, _uplink, len)) {
+			ESP_LOGE("Realtime", "Failed to send %d bytes of audio", len);
+			return false;
+		}
+		_stats.uplinkMessages++;
+		_stats.uplinkBytes += len;
+		return true;
+	}
+
+	/**
+	 * Disconnect and report, the session task ends with this
+	 */
+	inline void close() {
+		if (_lock) xSemaphoreTake(_lock, portMAX_DELAY);
+		_ws.disconnect();
+		_outbox.clear();
+		if (_lock) xSemaphoreGive(_lock);
+		_stopping = false;
+		ESP_LOGI("Realtime", "Session closed: %lu audio messages up (%lu bytes), %lu down (%lu bytes), %lu events, largest %d bytes",
+			_stats.uplinkMessages, _stats.uplinkBytes, _events.audioMessages(), _events.audioBytes(), _events.events(), _events.peakJson());
+		if (_callbacks.onClose) _callbacks.onClose();
+	}
+
+	inline RealtimeSessionStats stats() const { return _stats; }
+	inline const RealtimeEventStream& events() const { return _events; }
+	inline uint32_t preconnectsUsed() const { return _ws.preconnectsUsed(); }
+	inline uint32_t preconnectsExpired() const { return _ws.preconnectsExpired(); }
+
+private:
+	WebSocketClientSSL _ws;
+	RealtimeEventStream _events;
+	SemaphoreHandle_t _lock; // Outbox, and the socket while it is not the session task's
+	std::deque<String> _outbox;
+	TaskHandle_t _task;
+	uint8_t* _uplink;
+	String _auth;
+	RealtimeSessionCallbacks _callbacks;
+	volatile bool _stopping;
+	RealtimeSessionStats _stats;
+
+	inline bool flushOutbox() {
+		while (true) {
+			xSemaphoreTake(_lock, portMAX_DELAY);
+			if (_outbox.empty()) {
+				xSemaphoreGive(_lock);
+				return true;
+			}
+			String message = _outbox.front();
+			_outbox.pop_front();
+			xSemaphoreGive(_lock);
+
+			if (!_ws.sendMessage(message)) {
+				ESP_LOGE("Realtime", "Failed to send a %d byte message", message.length());
+				return false;
+			}
+			_stats.sent++;
+		}
+	}
+
+	static void sessionTask(void* arg) {
+		RealtimeSession* self = static_cast<RealtimeSession*>(arg);
+		if (self->open(self->_callbacks)) {
+			while (self->service()) vTaskDelay(pdMS_TO_TICKS(REALTIME_POLL_MS));
+		}
+		self->close();
+		self->_task = nullptr;
+		vTaskDeleteWithCaps(NULL);
+	}
+};
+
+extern RealtimeSession realtime;
@@ -0,0 +1,306 @@
+#pragma once
+#include <Arduino.h>
+#include <app_config.h>
+#include <secret.h>
+#include <freertos/stream_buffer.h>
+#include <ArduinoJson.h>
+#include "CustomHttpClient.h"
+#include "app/audio/wav.h"
+
+#ifndef STT_STREAM_BUFFER_MS
+#define STT_STREAM_BUFFER_MS 10000
+#endif
+
+#ifndef STT_STREAM_WAIT_SLICE_MS
+#define STT_STREAM_WAIT_SLICE_MS 20 // Longest an empty upload buffer is waited on before finish() is checked
+#endif
+
+#ifndef STT_STREAM_SAMPLE_RATE
+#define STT_STREAM_SAMPLE_RATE 16000
+#endif
+
+typedef void (*SttTextCallback)(const String& text);
+
+/**
+ * Multipart/form-data body whose audio part is fed while the request is sent
+ *
+ * Form fields and a streaming WAV header go out first, PCM follows as it is
+ * captured and the closing boundary is emitted once finish() was called and
+ * the buffer ran dry. available() returns -1 at the end of the body, which
+ * ends CustomHttpClient::sendRequest's chunked upload. While the buffer is
+ * empty readBytes() blocks on it for up to the stream timeout, so the
+ * upload sleeps between captured chunks instead of polling.
+ */
+class SttUploadStream : public Stream {
+public:
+	SttUploadStream(): _buffer(nullptr), _stage(STAGE_DONE), _offset(0), _finished(false), _overruns(0) {}
+	~SttUploadStream() {
+		if (_buffer) vStreamBufferDeleteWithCaps(_buffer);
+	}
+
+	/**
+	 * Prepare a new body
+	 * @param boundary Multipart boundary
+	 * @param fields Form fields sent before the audio, already encoded as multipart parts
+	 * @param bufferBytes Audio that may queue up while the upload lags behind capture
+	 * @return true if ready
+	 */
+	inline bool begin(const String& boundary, const String& fields, size_t bufferBytes) {
+		if (!_buffer) {
+			_buffer = xStreamBufferCreateWithCaps(bufferBytes, 1, MALLOC_CAP_SPIRAM);
+			if (!_buffer) {
+				ESP_LOGE("SttStream", "Failed to allocate upload buffer");
+				return false;
+			}
+		}
+		xStreamBufferReset(_buffer);
+
+		wav_hdr& header = _header;
+		memcpy(header.riff, "RIFF", 4);
+		header.file_size = 0xFFFFFFFF;  // Unknown length, decoders read to the end
+		memcpy(header.wave, "WAVE", 4);
+		memcpy(header.fmt, "fmt ", 4);
+		header.fmt_size = 16;
+		header.audio_format = 1;
+		header.num_channels = 1;
+		header.sample_rate = STT_STREAM_SAMPLE_RATE;
+		header.bits_per_sample = 16;
+		header.byte_rate = STT_STREAM_SAMPLE_RATE * 2;
+		header.block_align = 2;
+		memcpy(header.data, "data", 4);
+		header.data_size = 0xFFFFFFFF;
+
+		_prologue = fields;
+		_prologue += "--" + boundary + "\r\n";
+		_prologue += "Content-Disposition: form-data; name=\"file\"; filename=\"audio.wav\"\r\n";
+		_prologue += "Content-Type: audio/wav\r\n\r\n";
+		_epilogue = "\r\n--" + boundary + "--\r\n";
+
+		_stage = STAGE_PROLOGUE;
+		_offset = 0;
+		_overruns = 0;
+		_finished = false;
+		return true;
+	}
+
+	/**
+	 * Queue captured PCM, never blocks
+	 * @return Bytes queued, less than len when the upload fell a whole buffer behind
+	 */
+	inline size_t push(const uint8_t* data, size_t len) {
+		if (!_buffer || _finished) return 0;
+		size_t sent = xStreamBufferSend(_buffer, data, len, 0);
+		if (sent < len) _overruns++;
+		return sent;
+	}
+
+	/**
+	 * No more audio follows, the body ends once the buffer is drained
+	 */
+	inline void finish() { _finished = true; }
+
+	inline uint32_t overruns() const { return _overruns; }
+
+	int available() override {
+		switch (_stage) {
+		case STAGE_PROLOGUE:
+			return _prologue.length() - _offset;
+		case STAGE_HEADER:
+			return sizeof(wav_hdr) - _offset;
+		case STAGE_AUDIO: {
+			size_t queued = xStreamBufferBytesAvailable(_buffer);
+			if (queued > 0) return queued;
+			if (!_finished) return 0;
+			_stage = STAGE_EPILOGUE;
+			_offset = 0;
+			return _epilogue.length();
+		}
+		case STAGE_EPILOGUE:
+			return _epilogue.length() - _offset;
+		default:
+			return -1;
+		}
+	}
+
+	size_t readBytes(char* buffer, size_t length) override {
+		switch (_stage) {
+		case STAGE_PROLOGUE:
+			return copy((const uint8_t*)_prologue.c_str(), _prologue.length(), buffer, length, STAGE_HEADER);
+		case STAGE_HEADER:
+			return copy((const uint8_t*)&_header, sizeof(wav_hdr), buffer, length, STAGE_AUDIO);
+		case STAGE_AUDIO:
+			return receive(buffer, length);
+		case STAGE_EPILOGUE:
+			return copy((const uint8_t*)_epilogue.c_str(), _epilogue.length(), buffer, length, STAGE_DONE);
+		default:
+			return 0;
+		}
+	}
+
+	int read() override {
+		char c;
+		return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+	}
+
+	int peek() override { return -1; }
+	size_t write(uint8_t) override { return 0; }
+
+private:
+	enum STAGE {
+		STAGE_PROLOGUE = 0,
+		STAGE_HEADER,
+		STAGE_AUDIO,
+		STAGE_EPILOGUE,
+		STAGE_DONE
+	};
+
+	StreamBufferHandle_t _buffer;
+	String _prologue;
+	String _epilogue;
+	wav_hdr _header;
+	STAGE _stage;
+	size_t _offset;
+	volatile bool _finished;
+	uint32_t _overruns;
+
+	// Wait for audio in slices, so finish() on an empty buffer is noticed without a push
+	inline size_t receive(char* buffer, size_t length) {
+		unsigned long start = millis();
+		do {
+			size_t got = xStreamBufferReceive(_buffer, buffer, length, pdMS_TO_TICKS(STT_STREAM_WAIT_SLICE_MS));
+			if (got > 0 || _finished) return got;
+		} while (millis() - start < _timeout);
+		return 0;
+	}
+
+	inline size_t copy(const uint8_t* source, size_t size, char* buffer, size_t length, STAGE next) {
+		size_t left = size - _offset;
+		if (length > left) length = left;
+		memcpy(buffer, source + _offset, length);
+		_offset += length;
+		if (_offset == size) {
+			_stage = next;
+			_offset = 0;
+		}
+		return length;
+	}
+};
+
+/**
+ * Speech-to-text upload that overlaps capture
+ *
+ * begin() opens the request in its own task, write() feeds microphone PCM
+ * into the body while the user is still talking and finish() closes it.
+ * The transcript is handed to the callback from the upload task.
+ */
+class SttStreamClient {
+public:
+	SttStreamClient(): _task(nullptr), _callback(nullptr), _bytes(0), _startTime(0), _finishTime(0) {}
+
+	/**
+	 * Start a transcription request
+	 * @param callback Receives the transcript, empty on failure
+	 * @return true if the upload task started
+	 */
+	inline bool begin(SttTextCallback callback) {
+		if (_task) {
+			ESP_LOGW("SttStream", "Upload still running, dropping new request");
+			return false;
+		}
+
+		String boundary = "----pio" + String(millis(), HEX);
+		String fields = field(boundary, "model", STT_STREAM_MODEL);
+		if (strlen(STT_STREAM_LANGUAGE) > 0) fields += field(boundary, "language", STT_STREAM_LANGUAGE);
+
+		size_t bufferBytes = (size_t)STT_STREAM_SAMPLE_RATE * 2 * STT_STREAM_BUFFER_MS / 1000;
+		if (!_body.begin(boundary, fields, bufferBytes)) return false;
+
+		_boundary = boundary;
+		_callback = callback;
+		_bytes = 0;
+		_startTime = millis();
+		_finishTime = 0;
+
+		BaseType_t ret = xTaskCreatePinnedToCore(uploadTask, "sttStream", 1024 * 8, this, 2, &_task, 0);
+		if (ret != pdPASS) {
+			_task = nullptr;
+			ESP_LOGE("SttStream", "Failed to create upload task");
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Queue 16-bit mono PCM at STT_STREAM_SAMPLE_RATE
+	 */
+	inline void write(const uint8_t* data, size_t len) {
+		if (!_task || !data || len == 0) return;
+		_bytes += _body.push(data, len);
+	}
+
+	/**
+	 * End of speech, the request completes once queued audio is sent
+	 */
+	inline void finish() {
+		if (!_task) return;
+		_finishTime = millis();
+		_body.finish();
+	}
+
+	inline bool isRunning() const { return _task != nullptr; }
+
+private:
+	SttUploadStream _body;
+	TaskHandle_t _task;
+	SttTextCallback _callback;
+	String _boundary;
+	size_t _bytes;
+	unsigned long _startTime;
+	volatile unsigned long _finishTime;
+
+	static String field(const String& boundary, const char* name, const char* value) {
+		return "--" + boundary + "\r\nContent-Disposition: form-data; name=\"" + name + "\"\r\n\r\n" + value + "\r\n";
+	}
+
+	static void uploadTask(void* arg) {
+		SttStreamClient* self = static_cast<SttStreamClient*>(arg);
+		String text;
+
+		CustomHttpClient http;
+		http.beginPooled(STT_STREAM_URL);
+		http.setTimeout(15000);
+		http.addHeader("Content-Type", "multipart/form-data; boundary=" + self->_boundary);
+		if (strncmp(STT_STREAM_URL, "https://api.openai.com", 22) == 0) {
+			http.addHeader("Authorization", String("Bearer ") + GPT_API_KEY);
+		}
+
+		int httpCode = http.sendRequest("POST", &self->_body, 0);
+		unsigned long sentTime = millis();
+		if (httpCode == HTTP_CODE_OK) {
+			JsonDocument doc;
+			DeserializationError error = deserializeJson(doc, http.getString());
+			if (error) {
+				ESP_LOGE("SttStream", "JSON parsing failed: %s", error.c_str());
+			} else {
+				text = String(doc["text"] | "");
+			}
+		} else {
+			ESP_LOGE("SttStream", "HTTP error: %d (%s)", httpCode, http.errorToString(httpCode).c_str());
+		}
+		http.end();
+
+		// Latency that matters is from the end of speech, the upload itself overlapped capture
+		unsigned long finished = self->_finishTime ? self->_finishTime : sentTime;
+		ESP_LOGI("SttStream", "Uploaded %d bytes in %lu ms, transcript %lu ms after end of speech, %d overruns",
+			self->_bytes, sentTime - self->_startTime, millis() - finished, self->_body.overruns());
+		ESP_LOGI("SttStream", "Connection setup %d ms, %d%% of pooled requests reused a connection",
+			httpsPool.stats().lastSetupMs, httpsPool.reusePercent());
+
+		SttTextCallback callback = self->_callback;
+		self->_task = nullptr;
+		if (callback) callback(text);
+		vTaskDelete(NULL);
+	}
+};
+
+extern SttStreamClient sttStream;
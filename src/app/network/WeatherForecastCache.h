@@ -0,0 +1,277 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_heap_caps.h>
+#include "BmkgForecastReader.h"
+
+#ifndef WEATHER_FORECAST_MAX_PERIODS
+#define WEATHER_FORECAST_MAX_PERIODS 40 // Five days of 3-hour periods
+#endif
+
+#ifndef WEATHER_FORECAST_PERIOD_S
+#define WEATHER_FORECAST_PERIOD_S (3 * 3600) // Length of the last period, the others end where the next one starts
+#endif
+
+#define WEATHER_FORECAST_MAGIC 0x31434657 // "WFC1"
+#define WEATHER_FORECAST_VERSION 1
+
+namespace Services {
+
+// File layout: header, uint32_t start time per period, then one record per period
+struct __attribute__((packed)) WeatherForecastHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t recordSize;
+    uint16_t count;
+    uint32_t fetchedAt;     // UTC epoch, 0 when the clock was not set
+    int32_t utcOffset;      // Seconds from UTC to the forecast's local time
+    float longitude;
+    float latitude;
+    char location[112];     // "provinsi, kotkab, kecamatan, desa"
+    char timezone[24];
+    char iconBase[72];      // Image URL up to and including the last '/'
+};
+
+struct __attribute__((packed)) WeatherForecastRecord {
+    int8_t temperature;     // Celsius
+    uint8_t humidity;       // percent
+    uint8_t weatherCode;
+    uint8_t windSpeed;      // km/h
+    char windDirection[4];
+    char description[24];
+    char icon[32];          // Image file name, appended to iconBase
+};
+
+static_assert(sizeof(WeatherForecastRecord) == 64, "WeatherForecastRecord must stay packed");
+
+/**
+ * Every forecast period of a BMKG response in a packed binary file
+ *
+ * A fetch streams periods in through onPeriod() and commit() makes them
+ * the current forecast and writes the file. The file is read back whole
+ * on boot, about 3 KB for three days. Lookups are a binary search over
+ * the start time index. A failed or partial fetch leaves the current
+ * forecast untouched.
+ */
+class WeatherForecastCache {
+public:
+    WeatherForecastCache(): _records(nullptr), _build(nullptr) {
+        clear();
+    }
+
+    ~WeatherForecastCache() {
+        if (_records) heap_caps_free(_records);
+        if (_build) heap_caps_free(_build);
+    }
+
+    /**
+     * Forget the current forecast, the file is left alone
+     */
+    inline void clear() {
+        memset(&_header, 0, sizeof(_header));
+        _buildCount = 0;
+    }
+
+    /**
+     * Start collecting periods of a new response
+     * @return false if the record buffer could not be allocated
+     */
+    inline bool beginBuild() {
+        if (!_build) {
+            _build = allocate();
+            if (!_build) {
+                ESP_LOGE("Forecast", "Failed to allocate the forecast buffer");
+                return false;
+            }
+        }
+        _buildCount = 0;
+        _buildOffset = 0;
+        _buildIconBase[0] = '\0';
+        return true;
+    }
+
+    /**
+     * Matches bmkg_period_cb_t, pass the cache as arg
+     */
+    static void onPeriod(const BmkgPeriod& period, void* arg) {
+        static_cast<WeatherForecastCache*>(arg)->add(period);
+    }
+
+    inline void add(const BmkgPeriod& period) {
+        if (!_build || _buildCount >= WEATHER_FORECAST_MAX_PERIODS || period.time == 0) return;
+        // Periods come in time order, anything else would break the index
+        if (_buildCount > 0 && period.time <= _buildIndex[_buildCount - 1]) return;
+
+        if (_buildCount == 0) {
+            uint32_t local = BmkgForecastReader::parseDatetime(period.localDatetime);
+            _buildOffset = local ? (int32_t)(local - period.time) : 0;
+            const char* slash = strrchr(period.image, '/');
+            size_t baseLen = slash ? slash - period.image + 1 : 0;
+            if (baseLen >= sizeof(_buildIconBase)) baseLen = 0;
+            memcpy(_buildIconBase, period.image, baseLen);
+            _buildIconBase[baseLen] = '\0';
+        }
+
+        _buildIndex[_buildCount] = period.time;
+        pack(period, _buildIconBase, _build[_buildCount]);
+        _buildCount++;
+    }
+
+    /**
+     * Make the collected periods the current forecast and write them out
+     * @param location Root lokasi of the same response
+     * @param now UTC epoch of the fetch, 0 when unknown
+     * @return false if nothing was collected; a failed write is only logged
+     */
+    inline bool commit(fs::FS& fs, const char* path, const BmkgLocation& location, uint32_t now) {
+        if (!_build || _buildCount == 0) return false;
+
+        WeatherForecastHeader header = {};
+        header.magic = WEATHER_FORECAST_MAGIC;
+        header.version = WEATHER_FORECAST_VERSION;
+        header.recordSize = sizeof(WeatherForecastRecord);
+        header.count = _buildCount;
+        header.fetchedAt = now;
+        header.utcOffset = _buildOffset;
+        header.longitude = location.longitude;
+        header.latitude = location.latitude;
+        snprintf(header.location, sizeof(header.location), "%s, %s, %s, %s",
+            location.provinsi, location.kotkab, location.kecamatan, location.desa);
+        strncpy(header.timezone, location.timezone, sizeof(header.timezone) - 1);
+        strncpy(header.iconBase, _buildIconBase, sizeof(header.iconBase) - 1);
+
+        _header = header;
+        memcpy(_index, _buildIndex, _buildCount * sizeof(uint32_t));
+        WeatherForecastRecord* previous = _records;
+        _records = _build;
+        _build = previous;
+        _buildCount = 0;
+
+        if (save(fs, path)) {
+            ESP_LOGI("Forecast", "Cached %d periods, %d bytes", _header.count, fileSize(_header.count));
+        }
+        return true;
+    }
+
+    /**
+     * Read a cache file written by commit()
+     */
+    inline bool load(fs::FS& fs, const char* path) {
+        clear();
+        if (!fs.exists(path)) return false;
+        File file = fs.open(path, FILE_READ);
+        if (!file) return false;
+        if (!_records) _records = allocate();
+
+        WeatherForecastHeader header;
+        bool ok = _records
+            && file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)
+            && header.magic == WEATHER_FORECAST_MAGIC
+            && header.version == WEATHER_FORECAST_VERSION
+            && header.recordSize == sizeof(WeatherForecastRecord)
+            && header.count > 0 && header.count <= WEATHER_FORECAST_MAX_PERIODS
+            && file.size() == fileSize(header.count);
+        if (ok) {
+            size_t indexSize = header.count * sizeof(uint32_t);
+            size_t recordsSize = header.count * sizeof(WeatherForecastRecord);
+            ok = file.read((uint8_t*)_index, indexSize) == indexSize
+                && file.read((uint8_t*)_records, recordsSize) == recordsSize;
+        }
+        file.close();
+        if (!ok) {
+            ESP_LOGW("Forecast", "Ignoring invalid cache %s", path);
+            return false;
+        }
+        _header = header;
+        return true;
+    }
+
+    /**
+     * Period covering a time
+     * @param now UTC epoch
+     * @return Slot index, -1 before the first or after the last period
+     */
+    inline int find(uint32_t now) const {
+        if (_header.count == 0 || now < _index[0]) return -1;
+        int low = 0;
+        int high = _header.count - 1;
+        while (low < high) {
+            int mid = (low + high + 1) / 2;
+            if (_index[mid] <= now) low = mid;
+            else high = mid - 1;
+        }
+        return now < periodEnd(low) ? low : -1;
+    }
+
+    inline const WeatherForecastRecord* record(int slot) const {
+        return slot >= 0 && slot < _header.count ? &_records[slot] : nullptr;
+    }
+
+    /**
+     * Pack a parsed period, the icon keeps only what follows iconBase
+     */
+    static void pack(const BmkgPeriod& period, const char* iconBase, WeatherForecastRecord& record) {
+        memset(&record, 0, sizeof(record));
+        record.temperature = constrain(period.temperature, -128, 127);
+        record.humidity = constrain(period.humidity, 0, 255);
+        record.weatherCode = constrain(period.weatherCode, 0, 255);
+        record.windSpeed = constrain((int)(period.windSpeed * 3.6), 0, 255); // m/s to km/h
+        strncpy(record.windDirection, period.windDirection, sizeof(record.windDirection) - 1);
+        strncpy(record.description, period.description, sizeof(record.description) - 1);
+        size_t baseLen = strlen(iconBase);
+        const char* icon = strncmp(period.image, iconBase, baseLen) == 0 ? period.image + baseLen : period.image;
+        strncpy(record.icon, icon, sizeof(record.icon) - 1);
+    }
+
+    inline const WeatherForecastHeader& header() const { return _header; }
+    inline bool loaded() const { return _header.count > 0; }
+    inline uint32_t periodStart(int slot) const { return _index[slot]; }
+    inline uint32_t periodEnd(int slot) const {
+        return slot + 1 < _header.count ? _index[slot + 1] : _index[slot] + WEATHER_FORECAST_PERIOD_S;
+    }
+    // End of the last period, a refetch is due from here on
+    inline uint32_t horizon() const { return _header.count ? periodEnd(_header.count - 1) : 0; }
+
+    static constexpr size_t fileSize(size_t count) {
+        return sizeof(WeatherForecastHeader) + count * (sizeof(uint32_t) + sizeof(WeatherForecastRecord));
+    }
+
+private:
+    WeatherForecastHeader _header;
+    uint32_t _index[WEATHER_FORECAST_MAX_PERIODS];
+    WeatherForecastRecord* _records;
+
+    // Only while a response is being read
+    WeatherForecastRecord* _build;
+    uint32_t _buildIndex[WEATHER_FORECAST_MAX_PERIODS];
+    uint16_t _buildCount;
+    int32_t _buildOffset;
+    char _buildIconBase[sizeof(WeatherForecastHeader::iconBase)];
+
+    static WeatherForecastRecord* allocate() {
+        return (WeatherForecastRecord*)heap_caps_malloc(
+            WEATHER_FORECAST_MAX_PERIODS * sizeof(WeatherForecastRecord), MALLOC_CAP_SPIRAM | MALLOC_CAP_DEFAULT);
+    }
+
+    inline bool save(fs::FS& fs, const char* path) {
+        File file = fs.open(path, FILE_WRITE, true);
+        if (!file) {
+            ESP_LOGE("Forecast", "Failed to open %s for writing", path);
+            return false;
+        }
+        size_t indexSize = _header.count * sizeof(uint32_t);
+        size_t recordsSize = _header.count * sizeof(WeatherForecastRecord);
+        bool ok = file.write((const uint8_t*)&_header, sizeof(_header)) == sizeof(_header)
+            && file.write((const uint8_t*)_index, indexSize) == indexSize
+            && file.write((const uint8_t*)_records, recordsSize) == recordsSize;
+        file.close();
+        if (!ok) {
+            ESP_LOGE("Forecast", "Failed to write %s", path);
+            fs.remove(path);
+        }
+        return ok;
+    }
+};
+
+} // namespace Services
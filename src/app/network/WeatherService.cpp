@@ -4,10 +4,14 @@
 
 namespace Services {
 
-const char* WeatherService::CACHE_FILE_PATH = "/cache/weather_cache.json";
+const char* WeatherService::CACHE_FILE_PATH = "/cache/weather_forecast.bin";
+const char* WeatherService::LEGACY_CACHE_FILE_PATH = "/cache/weather_cache.json";
+
+// Anything earlier means NTP has not set the clock yet
+#define WEATHER_CLOCK_VALID_AFTER 1700000000
 
 WeatherService::WeatherService()
-    : _lastCacheTime(0), _initialized(false) {
+    : _lastCacheTime(0), _initialized(false), _cachedSlot(-1) {
 }
 
 WeatherService::~WeatherService() {
@@ -33,12 +37,16 @@ void WeatherService::getCurrentWeather(WeatherCallback callback, bool forceRefre
         return;
     }
 
-    // Check if we should use cache
+    // Answer from the forecast period covering now, the network is only needed past its horizon
     if (!forceRefresh && isCacheValid()) {
-        if (callback) {
-            callback(_cachedData, true);
+        uint32_t now = getCurrentEpoch();
+        int slot = now ? _forecast.find(now) : -1;
+        if (slot < 0 || selectSlot(slot)) {
+            if (callback) {
+                callback(_cachedData, true);
+            }
+            return;
         }
-        return;
     }
 
     // Fetch from API
@@ -57,6 +65,8 @@ void WeatherService::setCacheExpiry(uint32_t minutes) {
 void WeatherService::clearCache() {
     _cachedData = WeatherData();
     _lastCacheTime = 0;
+    _cachedSlot = -1;
+    _forecast.clear();
 
     if (LittleFS.exists(CACHE_FILE_PATH)) {
         LittleFS.remove(CACHE_FILE_PATH);
@@ -64,6 +74,12 @@ void WeatherService::clearCache() {
 }
 
 bool WeatherService::isCacheValid() const {
+    uint32_t now = getCurrentEpoch();
+    if (now && _forecast.find(now) >= 0) {
+        return true;
+    }
+
+    // Without the clock, or when the last fetch did not reach now, keep the fetched period for the expiry time
     if (_lastCacheTime == 0 || !_cachedData.isValid) {
         return false;
     }
@@ -78,8 +94,7 @@ void WeatherService::fetchFromAPI(WeatherCallback callback) {
     CustomHttpClient http;
     String url = buildAPIUrl();
 
-    http.begin(url);
-    http.setReuse(false);
+    http.beginPooled(url);
     http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
     http.setTimeout(10000); // 10 second timeout
 
@@ -88,8 +103,29 @@ void WeatherService::fetchFromAPI(WeatherCallback callback) {
     int httpCode = http.GET();
 
     if (httpCode == HTTP_CODE_OK) {
-        String response = http.getString();
-        processAPIResponse(response, callback);
+        // Parse while the body streams in instead of buffering it whole
+        if (!_forecast.beginBuild()) {
+            // Without the record buffer nothing could be kept, leave the body unread
+            http.end();
+            if (callback) {
+                WeatherData errorData;
+                callback(errorData, false);
+            }
+            return;
+        }
+        BmkgForecastReader reader(WeatherForecastCache::onPeriod, &_forecast);
+        unsigned long start = millis();
+        int received = http.writeToStream(&reader);
+        if (received < 0) {
+            ESP_LOGE("Weather", "Reading response failed: %s", CustomHttpClient::errorToString(received).c_str());
+            if (callback) {
+                WeatherData errorData;
+                callback(errorData, false);
+            }
+        } else {
+            ESP_LOGI("Weather", "Read %d bytes, %d periods in %lu ms", received, reader.periods(), millis() - start);
+            processAPIResponse(reader, callback);
+        }
     } else {
         ESP_LOGE("Weather", "HTTP error: %d", httpCode);
         if (callback) {
@@ -101,175 +137,105 @@ void WeatherService::fetchFromAPI(WeatherCallback callback) {
     http.end();
 }
 
-void WeatherService::processAPIResponse(const String& response, WeatherCallback callback) {
+void WeatherService::processAPIResponse(const BmkgForecastReader& reader, WeatherCallback callback) {
     if (!callback) {
+        // The forecast is still worth keeping
         ESP_LOGW("Weather", "No callback provided");
-        return;
+        callback = [](const WeatherData&, bool) {};
     }
 
     ESP_LOGI("Weather", "Processing API response");
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, response);
+    WeatherData data;
 
-    if (error) {
-        ESP_LOGE("Weather", "JSON parsing failed: %s", error.c_str());
-        WeatherData errorData;
-        callback(errorData, false);
+    if (!reader.ok()) {
+        ESP_LOGE("Weather", "JSON parsing failed after %d bytes", reader.bytes());
+        callback(data, false);
         return;
     }
 
-    WeatherData data;
-
-    try {
-        if (doc["lokasi"].isUnbound()) {
-            ESP_LOGE("Weather", "No lokasi found in response");
-            callback(data, false);
-            return;
-        }
-
-        JsonObject lokasi = doc["lokasi"];
-        data.location = String(lokasi["provinsi"]) + ", " +
-                       String(lokasi["kotkab"]) + ", " +
-                       String(lokasi["kecamatan"]) + ", " +
-                       String(lokasi["desa"]);
-        data.longitude = lokasi["lon"];
-        data.latitude = lokasi["lat"];
-        data.timezone = String(lokasi["timezone"]);
-
-        ESP_LOGI("Weather", "Location: %s (Lat: %.6f, Lon: %.6f)", data.location.c_str(), data.latitude, data.longitude);
-
-        if (doc["data"].isUnbound() || doc["data"].size() == 0) {
-            ESP_LOGE("Weather", "No data array found");
-            callback(data, false);
-            return;
-        }
-
-        JsonArray dataArray = doc["data"];
-        if (dataArray.size() == 0) {
-            ESP_LOGE("Weather", "Empty data array");
-            callback(data, false);
-            return;
-        }
-
-        JsonObject locationData = dataArray[0];
-        if (locationData["cuaca"].isUnbound() || locationData["cuaca"].size() == 0) {
-            ESP_LOGE("Weather", "No cuaca data found");
-            callback(data, false);
-            return;
-        }
-
-        JsonArray cuacaArray = locationData["cuaca"];
-        if (cuacaArray.size() == 0) {
-            ESP_LOGE("Weather", "No current weather data");
-            callback(data, false);
-            return;
-        }
-
-        JsonArray timePeriod = cuacaArray[0];
-        if (timePeriod.size() == 0) {
-            ESP_LOGE("Weather", "No weather data in time period");
-            callback(data, false);
-            return;
-        }
-
-        JsonObject currentWeather = timePeriod[0];
-
-        data.temperature = currentWeather["t"] | 0;
-        data.humidity = currentWeather["hu"] | 0;
-        data.windSpeed = (int)((currentWeather["ws"] | 0.0) * 3.6); // m/s to km/h
-        data.windDirection = String(currentWeather["wd"] | "");
-        data.description = String(currentWeather["weather_desc"] | "");
-        data.imageUrl = String(currentWeather["image"] | "");
-        data.lastUpdated = String(currentWeather["local_datetime"] | "");
-
-        int weatherCode = currentWeather["weather"] | 0;
-        data.condition = getConditionFromCode(weatherCode);
-
-        ESP_LOGI("Weather", "Weather: %s (Code: %d)", data.description.c_str(), weatherCode);
-        ESP_LOGI("Weather", "Temp: %d°C, Humidity: %d%%, Wind: %d km/h %s",
-                    data.temperature, data.humidity, data.windSpeed, data.windDirection.c_str());
-
-        data.isValid = true;
-
-        // Cache the data
-        _cachedData = data;
-        _lastCacheTime = getCurrentTimestamp();
-        saveCache(data);
-
-        callback(data, true);
-
-    } catch (...) {
-        ESP_LOGE("Weather", "Exception during processing");
-        WeatherData errorData;
-        callback(errorData, false);
+    if (!reader.hasLocation()) {
+        ESP_LOGE("Weather", "No lokasi found in response");
+        callback(data, false);
+        return;
     }
-}
 
-bool WeatherService::loadCache() {
-    if (!LittleFS.exists(CACHE_FILE_PATH)) {
-        return false;
+    uint32_t now = getCurrentEpoch();
+    if (reader.periods() == 0 || !_forecast.commit(LittleFS, CACHE_FILE_PATH, reader.location(), now)) {
+        ESP_LOGE("Weather", "No current weather data");
+        callback(data, false);
+        return;
     }
 
-    File file = LittleFS.open(CACHE_FILE_PATH, "r");
-    if (!file) {
-        return false;
+    // Before the first period or without the clock, the earliest one is the best guess
+    int slot = now ? _forecast.find(now) : -1;
+    _cachedSlot = -1;
+    if (!selectSlot(slot >= 0 ? slot : 0)) {
+        callback(data, false);
+        return;
     }
+    _lastCacheTime = getCurrentTimestamp();
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+    const WeatherForecastHeader& header = _forecast.header();
+    ESP_LOGI("Weather", "Location: %s (Lat: %.6f, Lon: %.6f)", _cachedData.location.c_str(), _cachedData.latitude, _cachedData.longitude);
+    ESP_LOGI("Weather", "Forecast of %d periods until %lu", header.count, (unsigned long)_forecast.horizon());
+    ESP_LOGI("Weather", "Weather: %s (Code: %d)", _cachedData.description.c_str(), _forecast.record(_cachedSlot)->weatherCode);
+    ESP_LOGI("Weather", "Temp: %d°C, Humidity: %d%%, Wind: %d km/h %s",
+                _cachedData.temperature, _cachedData.humidity, _cachedData.windSpeed, _cachedData.windDirection.c_str());
+
+    callback(_cachedData, true);
+}
 
-    if (error) {
+bool WeatherService::selectSlot(int slot) {
+    const WeatherForecastRecord* record = _forecast.record(slot);
+    if (!record) {
         return false;
     }
+    if (slot == _cachedSlot && _cachedData.isValid) {
+        return true;
+    }
 
-    _cachedData.location = String(doc["location"]);
-    _cachedData.description = String(doc["description"]);
-    _cachedData.condition = static_cast<WeatherCondition>((int)doc["condition"]);
-    _cachedData.temperature = doc["temperature"];
-    _cachedData.humidity = doc["humidity"];
-    _cachedData.windSpeed = doc["windSpeed"];
-    _cachedData.windDirection = String(doc["windDirection"]);
-    _cachedData.lastUpdated = String(doc["lastUpdated"]);
-    _cachedData.imageUrl = String(doc["imageUrl"]);
-    _cachedData.longitude = doc["longitude"];
-    _cachedData.latitude = doc["latitude"];
-    _cachedData.timezone = String(doc["timezone"]);
-    _cachedData.isValid = doc["isValid"];
-    _lastCacheTime = doc["cacheTime"];
-
+    const WeatherForecastHeader& header = _forecast.header();
+    WeatherData data;
+    data.location = String(header.location);
+    data.longitude = header.longitude;
+    data.latitude = header.latitude;
+    data.timezone = String(header.timezone);
+
+    data.temperature = record->temperature;
+    data.humidity = record->humidity;
+    data.windSpeed = record->windSpeed;
+    data.windDirection = String(record->windDirection);
+    data.description = String(record->description);
+    data.imageUrl = String(header.iconBase) + record->icon;
+    data.condition = getConditionFromCode(record->weatherCode);
+
+    // Local start of the period, same format as BMKG's local_datetime
+    time_t start = _forecast.periodStart(slot) + header.utcOffset;
+    struct tm local;
+    char text[20];
+    gmtime_r(&start, &local);
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    data.lastUpdated = String(text);
+
+    data.isValid = true;
+    _cachedData = data;
+    _cachedSlot = slot;
+    ESP_LOGD("Weather", "Using forecast period %d: %s, %d°C", slot, text, data.temperature);
     return true;
 }
 
-bool WeatherService::saveCache(const WeatherData& data) {
-    JsonDocument doc;
-
-    doc["location"] = data.location;
-    doc["description"] = data.description;
-    doc["condition"] = static_cast<int>(data.condition);
-    doc["temperature"] = data.temperature;
-    doc["humidity"] = data.humidity;
-    doc["windSpeed"] = data.windSpeed;
-    doc["windDirection"] = data.windDirection;
-    doc["lastUpdated"] = data.lastUpdated;
-    doc["imageUrl"] = data.imageUrl;
-    doc["longitude"] = data.longitude;
-    doc["latitude"] = data.latitude;
-    doc["timezone"] = data.timezone;
-    doc["isValid"] = data.isValid;
-    doc["cacheTime"] = getCurrentTimestamp();
-
-    File file = LittleFS.open(CACHE_FILE_PATH, "w");
-    if (!file) {
-        ESP_LOGE("Weather", "Failed to open cache file for writing");
-        return false;
+bool WeatherService::loadCache() {
+    // The single-entry JSON cache is superseded by the forecast file
+    if (LittleFS.exists(LEGACY_CACHE_FILE_PATH)) {
+        LittleFS.remove(LEGACY_CACHE_FILE_PATH);
     }
 
-    serializeJson(doc, file);
-    file.close();
-
-    ESP_LOGD("Weather", "Weather data cached");
+    unsigned long start = millis();
+    if (!_forecast.load(LittleFS, CACHE_FILE_PATH)) {
+        return false;
+    }
+    ESP_LOGI("Weather", "Loaded %d forecast periods in %lu ms", _forecast.header().count, millis() - start);
     return true;
 }
 
@@ -283,6 +249,11 @@ unsigned long WeatherService::getCurrentTimestamp() const {
     return millis();
 }
 
+uint32_t WeatherService::getCurrentEpoch() {
+    time_t now = time(nullptr);
+    return now > WEATHER_CLOCK_VALID_AFTER ? (uint32_t)now : 0;
+}
+
 WeatherService::WeatherCondition WeatherService::getConditionFromCode(int weatherCode) {
     switch (weatherCode) {
         case 0: return WeatherCondition::CLEAR;
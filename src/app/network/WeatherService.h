@@ -4,6 +4,8 @@
 #include <ArduinoJson.h>
 #include <functional>
 #include <LittleFS.h>
+#include "BmkgForecastReader.h"
+#include "WeatherForecastCache.h"
 
 // BMKG Weather Service for Indonesian weather data
 // API: https://api.bmkg.go.id/publik/prakiraan-cuaca
@@ -86,7 +88,7 @@ public:
 
     struct WeatherConfig {
         String adm4Code;           // Administrative level 4 code (village/kelurahan)
-        uint32_t cacheExpiryMinutes;
+        uint32_t cacheExpiryMinutes; // Only used while the clock is not set, otherwise the forecast horizon decides
 
         WeatherConfig() : adm4Code("31.73.05.1001"), cacheExpiryMinutes(60) {}
     };
@@ -116,15 +118,19 @@ private:
     WeatherData _cachedData;
     unsigned long _lastCacheTime;
     bool _initialized;
+    WeatherForecastCache _forecast;
+    int _cachedSlot;
 
     static const char* CACHE_FILE_PATH;
+    static const char* LEGACY_CACHE_FILE_PATH;
 
     void fetchFromAPI(WeatherCallback callback);
-    void processAPIResponse(const String& response, WeatherCallback callback);
+    void processAPIResponse(const BmkgForecastReader& reader, WeatherCallback callback);
     bool loadCache();
-    bool saveCache(const WeatherData& data);
+    bool selectSlot(int slot);
     String buildAPIUrl() const;
     unsigned long getCurrentTimestamp() const;
+    static uint32_t getCurrentEpoch();
 };
 
 } // namespace Services
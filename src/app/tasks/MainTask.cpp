@@ -31,6 +31,7 @@ void mainTask(void *param) {
 		displayEvent();
 		buttonEvent();
 		srEvent();
+		jobEvent();
 	}
 
 	ESP_LOGE(TAG, "Main task exited unexpectedly");
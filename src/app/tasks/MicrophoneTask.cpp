@@ -1,21 +1,38 @@
 #include "app/tasks.h"
+#include "app/audio/endpointer.h"
+
+struct RecordSink {
+	AudioCollectorCallback collector;
+	uint32_t key;
+	uint32_t* index;
+};
+
+// Endpointer output goes to the collector as numbered chunks
+static void recordSink(const int16_t* samples, size_t count, void* arg) {
+	RecordSink* sink = static_cast<RecordSink*>(arg);
+	sink->collector(sink->key, (*sink->index)++, (const uint8_t*)samples, count * sizeof(int16_t));
+}
 
 void microphoneTask(void* param) {
 	const char* TAG = "microphoneTask";
 
 	TickType_t lastWakeTime = xTaskGetTickCount();
 	TickType_t updateFrequency = 1;
-	uint32_t lastUpdate = millis();
 	uint32_t index = 0;
 	uint32_t key = millis();
 
 	size_t maxSamples = getAfeHandle()->get_feed_chunksize(getAfeData()) * 2; // follow afe chunksize
-	size_t samplesRead;
+	size_t chunkSize = 0;
 	esp_err_t err = ESP_OK;
 
 	QueueHandle_t lock = xSemaphoreCreateMutex();
 	int16_t* readBuffer = (int16_t*)heap_caps_malloc(maxSamples, MALLOC_CAP_SPIRAM);
 
+	PcmRing::Reader reader;
+	AfeTap::Reader afeReader;
+	bool useAfe = false;
+	Endpointer endpointer;
+	endpointer.init({16000, REC_ENDPOINT_HANGOVER_MS, REC_ENDPOINT_PRE_PAD_MS, REC_ENDPOINT_POST_PAD_MS, REC_ENDPOINT_NO_SPEECH_MS});
 	uint8_t* chunk = nullptr;
 	TaskHandle_t recordEventHandle = nullptr;
 	AUDIO_STATE lastState = AUDIO_STATE_IDLE;
@@ -30,20 +47,35 @@ void microphoneTask(void* param) {
 			ESP_LOGI(TAG, "Received audio event: %d", event.flag);
 			key = millis();
 			index = 0;
+			// AFE frames carry their own VAD decision, raw ring frames have none and are all kept
+			useAfe = afeTap.isReady();
+			if (useAfe) {
+				afeReader = afeTap.reader();
+			} else {
+				reader = microphone->reader();
+				ESP_LOGW(TAG, "AFE tap not ready, recording without endpointing");
+			}
+			endpointer.reset();
 			ESP_LOGW(TAG, "status: ON, key: %d", key);
 			
 			// need add support for mqtt
-			if (event.collectorCallback && event.executorCallback)
+			if (event.collectorCallback && event.executorCallback && !event.streaming)
 				xTaskCreatePinnedToCore(recorderTask, "recorderTask", 1024 * 4, nullptr, 0, &recordEventHandle, 1);
 		} 
 		else if (event.state == AUDIO_STATE_RUNNING && event.flag == EMIC_STOP) {
 			ESP_LOGW(TAG, "status: OFF, key: %d, last index: %d", key, index);
+			ESP_LOGI(TAG, "Endpointer kept %d of %d ms", endpointer.keptSamples() / 16, endpointer.totalSamples() / 16);
 			vTaskDelay(pdMS_TO_TICKS(5));
 			index = -1;
+
+			// a streaming collector closes its upload on the end marker
+			if (event.streaming && event.collectorCallback) {
+				event.collectorCallback(key, index, nullptr, 0);
+			}
 			
 			// need add support for mqtt
 			#if MQTT_ENABLE == 0
-			{
+			if (!event.streaming) {
 				AudioData audioSamples = {
 					.key = String(key),
 					.data = nullptr,
@@ -54,7 +86,8 @@ void microphoneTask(void* param) {
 				recordEventHandle = nullptr;
 			}
 			#endif
-			event.state = AUDIO_STATE_STOPPED;
+			// nothing to wait for locally, the upload finishes on its own
+			event.state = event.streaming ? AUDIO_STATE_IDLE : AUDIO_STATE_STOPPED;
 			setMicEvent(event);
 			goto end;
 		}
@@ -75,20 +108,42 @@ void microphoneTask(void* param) {
     // Publish start
 		publish:
 		if (index != 0 && index != -1) {
-			auto cache = microphone->getCache();
-			if (cache.lastSampleLen == 0  // invalid cache data
-				|| cache.lastSampleTime <= lastUpdate // oldest data
-				|| cache.lastSampleTime == 0) goto unlock; // no data
-			memcpy(readBuffer, cache.lastSample, cache.lastSampleLen); // copy new samples to chunk
-			lastUpdate = cache.lastSampleTime;
-			chunk = (uint8_t*)readBuffer;
+			// every sample since start is delivered in order, one AFE frame at a time
+			size_t capacity = maxSamples / sizeof(int16_t);
+			size_t count = 0;
+			bool speech = false;
+			if (useAfe) {
+				AfeTap::FrameInfo info;
+				if (!afeReader.wait(pdMS_TO_TICKS(50))) goto unlock;
+				count = afeReader.read(readBuffer, capacity, &info);
+				speech = info.vad == VAD_SPEECH;
+			} else {
+				if (!reader.wait(pdMS_TO_TICKS(50), capacity)) goto unlock;
+				count = reader.read(readBuffer, capacity);
+				// the AFE state is not aligned with these frames, keep everything and leave the stop to the user
+				speech = true;
+			}
+			if (count == 0) goto unlock;
+#if REC_ENDPOINT == 0
+			speech = true;
+#endif
+
+			// silence outside the padding never reaches the collector
+			RecordSink sink = {event.collectorCallback, key, &index};
+			if (endpointer.process(readBuffer, count, speech, recordSink, &sink) == ENDPOINT_STATE_END) {
+				ESP_LOGI(TAG, "End of %s, stopping capture", endpointer.heardSpeech() ? "speech" : "recording without speech");
+				event.flag = EMIC_STOP;
+				setMicEvent(event);
+			}
+			goto unlock;
 		} else {
 			chunk = nullptr;
+			chunkSize = maxSamples;
 		}
 
 		// send data to callback
 		if (event.collectorCallback)
-			event.collectorCallback(key, index, chunk, maxSamples);
+			event.collectorCallback(key, index, chunk, chunkSize);
 		index++;
 
 		unlock:
@@ -72,26 +72,48 @@ void networkTask(void *param) {
 	weatherConfig.cacheExpiryMinutes = 60;
 	weatherService.init(weatherConfig);
 
+	// Blocking lookups run on the job worker, completions come back to mainTask
+	static volatile bool weatherOk = false;
+	networkJobs.begin([](NetworkJob* job) {
+		return notification->send(NOTIFICATION_JOB, (void*)job);
+	});
+
 	ESP_LOGI(TAG, "Network task started");
 	while(1) {
 		vTaskDelay(updateFrequency);
 		notification->send(TAG, 1);
 
-		if (wifiManager.isConnected() && millis() - timeCheck > 30000){
-			timeManager.syncTime();
-			ESP_LOGI(TAG, "Current Time: %s", timeManager.getCurrentTime());
+		if (wifiManager.isConnected() && millis() - timeCheck > 30000 && !networkJobs.pending(NETWORK_JOB_NTP)){
+			networkJobs.submit(NETWORK_JOB_NTP, []() {
+				return timeManager.syncTime();
+			}, [TAG](bool ok) {
+				if (ok) {
+					ESP_LOGI(TAG, "Current Time: %s", timeManager.getCurrentTime());
+				}
+			});
 			timeCheck = millis();
 		}
 
-		// Periodic weather updates (every 5 minutes)
-		if (wifiManager.isConnected() && millis() - weatherCheck > (weatherService.isCacheValid() ? 300000 : 10000)) {
+		// Periodic weather updates (every 5 minutes), served from the cached forecast until it runs out
+		if (wifiManager.isConnected() && millis() - weatherCheck > (weatherOk ? 300000 : 10000) && !networkJobs.pending(NETWORK_JOB_WEATHER)) {
 			ESP_LOGI(TAG, "Fetching weather update...");
-			weatherService.getCurrentWeather([TAG](const weatherData_t& data, bool success) {
-				if (success) {
+			auto result = std::make_shared<weatherData_t>();
+			networkJobs.submit(NETWORK_JOB_WEATHER, [result]() {
+				bool ok = false;
+				weatherService.getCurrentWeather([&ok, result](const weatherData_t& data, bool success) {
+					ok = success;
+					if (success) {
+						*result = data;
+					}
+				});
+				return ok;
+			}, [TAG, result](bool ok) {
+				weatherOk = ok;
+				if (ok) {
 					// Send weather update event
-					ESP_LOGI(TAG, "Weather updated: %s, %d°C", data.description.c_str(), data.temperature);
-					
-					weatherData_t* newData = new weatherData_t(data);
+					ESP_LOGI(TAG, "Weather updated: %s, %d°C", result->description.c_str(), result->temperature);
+
+					weatherData_t* newData = new weatherData_t(*result);
 					if (!notification->send(NOTIFICATION_WEATHER, (void*)newData)){
 						delete newData;
 					}
@@ -114,6 +136,11 @@ void networkTask(void *param) {
 #endif
 		
 		wifiManager.handle();
+		if (wifiManager.isConnected()) {
+			httpsPool.evictIdle();
+		} else {
+			httpsPool.closeIdle();
+		}
 		if (wifiManager.isConnected()) {
 			ftpServer.handleFTP();
 #if MQTT_ENABLE
@@ -27,6 +27,7 @@ static const char* NOTIFICATION_DISPLAY = "display";
 static const char* NOTIFICATION_WEATHER = "weather";
 static const char* NOTIFICATION_RECORD = "record";
 static const char* NOTIFICATION_COMMAND = "command";
+static const char* NOTIFICATION_JOB = "job";
 
 // Display Events
 enum EVENT_DISPLAY {
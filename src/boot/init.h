@@ -20,10 +20,14 @@
 #include <app/callbacks.h>
 #include <app/events.h>
 #include <app/audio/microphone.h>
+#include <app/audio/afetap.h>
 #include <app/audio/speaker.h>
 #include <app/audio/tts.h>
 #include <app/audio/mp3decoder.h>
 #include <app/network/WeatherService.h>
+#include <app/network/HttpsPool.h>
+#include <app/network/NetworkJobs.h>
+#include <app/network/RealtimeSession.h>
 #include <app/button/button.h>
 
 extern Notification* notification;
@@ -1,11 +1,18 @@
 #include "init.h"
 #include <app/display/ui/boot.h>
+#include <app/network/HttpsPool.h>
+#include <app/network/NetworkJobs.h>
+#include <app/network/RealtimeSession.h>
 
 Notification *notification = nullptr;
 Microphone* microphone = nullptr;
 Speaker* speaker = nullptr;
 Button button;
 Mp3Decoder mp3decoder;
+AfeTap afeTap;
+HttpsConnectionPool httpsPool;
+NetworkJobQueue networkJobs;
+RealtimeSession realtime;
  
 WifiManager wifiManager;
 PubSubClient mqttClient;
@@ -24,6 +31,7 @@ void setupApp(){
   aiTts.setFormat(GPTAudioFormat::GPT_MP3);
   aiStt.init(GPT_API_KEY, LittleFS);
   aiSts.init(GPT_API_KEY);
+  realtime.begin(GPT_API_KEY);
   delay(1000);
 
   setupMicrophone();
@@ -77,6 +85,11 @@ void setupSpeechRecognition() {
   );
 
   if (ret == ESP_OK) {
+    // Tap the processed AFE output for the realtime uplink
+    if (afeTap.init(getAfeHandle()->get_fetch_chunksize(getAfeData()), AFE_TAP_HISTORY_SAMPLES)) {
+      setAfeTap(AfeTap::afeCallback, &afeTap);
+    }
+
     log_i("✅ Speech Recognition started successfully!");
     log_i("🎯 Say 'Hi ESP' to activate");
     log_i("📋 Loaded %d voice commands", sizeof(voice_commands) / sizeof(sr_cmd_t));
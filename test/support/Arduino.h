@@ -0,0 +1,76 @@
+#pragma once
+
+// Just enough of Arduino-ESP32 and ESP-IDF to build the host-clean parts of src/ natively
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "WString.h"
+#include "Stream.h"
+
+#ifndef HOST_LOG_LEVEL
+#define HOST_LOG_LEVEL 2 // 0 = none, 1 = errors, 2 = warnings, 3 = info, 4 = debug
+#endif
+
+#define HOST_LOG(level, letter, tag, fmt, ...) \
+    do { if (HOST_LOG_LEVEL >= level) printf(letter " (%s) " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG(1, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG(2, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG(3, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG(4, "D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) HOST_LOG(5, "V", tag, fmt, ##__VA_ARGS__)
+
+// The core's log_x macros, as used by its HTTPClient
+#define log_e(fmt, ...) ESP_LOGE("core", fmt, ##__VA_ARGS__)
+#define log_w(fmt, ...) ESP_LOGW("core", fmt, ##__VA_ARGS__)
+#define log_i(fmt, ...) ESP_LOGI("core", fmt, ##__VA_ARGS__)
+#define log_d(fmt, ...) ESP_LOGD("core", fmt, ##__VA_ARGS__)
+#define log_v(fmt, ...) ESP_LOGV("core", fmt, ##__VA_ARGS__)
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_TIMEOUT 0x107
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+inline const char* esp_err_to_name(esp_err_t err) { return err == ESP_OK ? "ESP_OK" : "ESP_FAIL"; }
+
+using std::min;
+using std::max;
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+inline unsigned long millis() { return HostClock::ticks(); }
+inline unsigned long micros() { return HostClock::ticks() * 1000UL; }
+inline void delay(uint32_t ms) { HostClock::advance(ms); }
+
+// Deterministic unless a test seeds it differently
+namespace HostRandom {
+inline uint32_t& state() {
+    static uint32_t value = 1;
+    return value;
+}
+} // namespace HostRandom
+
+inline void randomSeed(unsigned long seed) { HostRandom::state() = seed ? seed : 1; }
+inline long random(long low, long high) {
+    if (high <= low) return low;
+    uint32_t& state = HostRandom::state();
+    state = state * 1103515245u + 12345u;
+    return low + (long)((state >> 16) % (uint32_t)(high - low));
+}
+inline long random(long high) { return random(0, high); }
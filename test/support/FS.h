@@ -0,0 +1,155 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include "Stream.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+// What went through an FS, for the benchmarks
+struct FSStats {
+    size_t opens = 0;
+    size_t writes = 0;       // write() calls that reached the file
+    size_t bytesWritten = 0;
+    size_t reads = 0;
+    size_t bytesRead = 0;
+};
+
+/**
+ * Stand-in for fs::File over a host file
+ *
+ * Copies share the open file like the core's File does. Every write and
+ * read goes straight to stdio and is counted in the owning FS's stats.
+ * Writes also sleep for the owning FS's writeLatencyUs.
+ */
+class File : public Stream {
+public:
+    File() {}
+    File(FILE* file, FSStats* stats, const uint32_t* writeLatencyUs = nullptr):
+        _file(file, fclose), _stats(stats), _writeLatencyUs(writeLatencyUs) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!_file) return 0;
+        if (_writeLatencyUs && *_writeLatencyUs) std::this_thread::sleep_for(std::chrono::microseconds(*_writeLatencyUs));
+        size_t n = fwrite(buf, 1, size, _file.get());
+        _stats->writes++;
+        _stats->bytesWritten += n;
+        return n;
+    }
+
+    size_t read(uint8_t* buf, size_t size) {
+        if (!_file) return 0;
+        size_t n = fread(buf, 1, size, _file.get());
+        _stats->reads++;
+        _stats->bytesRead += n;
+        return n;
+    }
+
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int peek() override {
+        if (!_file) return -1;
+        int c = fgetc(_file.get());
+        if (c != EOF) ungetc(c, _file.get());
+        return c == EOF ? -1 : c;
+    }
+
+    int available() override { return _file ? (int)(size() - position()) : 0; }
+
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+        return _file && fseek(_file.get(), pos, mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+    }
+
+    size_t position() const { return _file ? ftell(_file.get()) : 0; }
+
+    size_t size() const {
+        if (!_file) return 0;
+        fflush(_file.get());
+        struct stat st;
+        return fstat(fileno(_file.get()), &st) == 0 ? st.st_size : 0;
+    }
+
+    void flush() override {
+        if (_file) fflush(_file.get());
+    }
+
+    void close() { _file.reset(); }
+
+    operator bool() const { return (bool)_file; }
+
+private:
+    std::shared_ptr<FILE> _file;
+    FSStats* _stats = nullptr;
+    const uint32_t* _writeLatencyUs = nullptr;
+};
+
+/**
+ * Stand-in for fs::FS over a host directory, the "image" a test inspects
+ *
+ * Paths are taken relative to the root; parent directories are created
+ * when a file is opened for writing, as LittleFS does.
+ */
+class FS {
+public:
+    explicit FS(const std::string& root): _root(root) {}
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false) {
+        std::string host = hostPath(path);
+        if (mode[0] != 'r') makeParents(host);
+        FILE* file = fopen(host.c_str(), mode[0] == 'w' ? "wb+" : mode[0] == 'a' ? "ab+" : "rb");
+        if (!file) return File();
+        stats.opens++;
+        return File(file, &stats, &writeLatencyUs);
+    }
+
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+
+    bool exists(const char* path) {
+        struct stat st;
+        return stat(hostPath(path).c_str(), &st) == 0;
+    }
+
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path) { return ::remove(hostPath(path).c_str()) == 0; }
+    bool remove(const String& path) { return remove(path.c_str()); }
+
+    // Test side
+    std::string hostPath(const char* path) const { return _root + (path[0] == '/' ? "" : "/") + path; }
+    FSStats stats;
+    uint32_t writeLatencyUs = 0; // Real time every write() call takes, a stand-in for flash program time
+
+private:
+    std::string _root;
+
+    static void makeParents(const std::string& path) {
+        for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+            mkdir(path.substr(0, slash).c_str(), 0755);
+        }
+    }
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <NetworkClientSecure.h>
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTP_TCP_RX_BUFFER_SIZE (4096)
+#define HTTP_TCP_TX_BUFFER_SIZE (1460)
+
+#define HTTP_CODE_OK 200
+
+/**
+ * Stand-in for the core's HTTPClient
+ *
+ * Keeps the members and protected helpers CustomHttpClient builds on, plus
+ * GET() as WeatherService calls it, and their behaviour on the wire: HTTP/1.1 requests with keep-alive when reuse
+ * is on, responses framed by Content-Length, a connection that ends with
+ * "Connection: close" or an error is stopped. Waiting for the response
+ * moves the simulated clock one tick at a time up to the TCP timeout.
+ */
+class HTTPClient {
+public:
+    HTTPClient() {}
+    ~HTTPClient() {
+        if (_client && _client == _own.get()) _client->stop();
+    }
+
+    bool begin(const String& url) {
+        if (!parse(url)) return false;
+        if (!_own) _own.reset(new NetworkClientSecure());
+        _client = _own.get();
+        return true;
+    }
+
+    bool begin(NetworkClientSecure& client, const String& url) {
+        if (!parse(url)) return false;
+        _client = &client;
+        return true;
+    }
+
+    void end() {
+        if (connected()) {
+            while (_client->available() > 0) _client->read();
+            if (!_reuse || !_canReuse) _client->stop();
+        }
+        _headers = String();
+        _size = -1;
+    }
+
+    bool connected() { return _client && _client->connected(); }
+
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void setTimeout(uint16_t timeout) { _tcpTimeout = timeout; }
+
+    void addHeader(const String& name, const String& value) { _headers += name + ": " + value + "\r\n"; }
+
+    int GET() { return sendRequest("GET"); }
+
+    int sendRequest(const char* type, const uint8_t* payload = nullptr, size_t size = 0) {
+        if (!connect()) return returnError(HTTPC_ERROR_CONNECTION_REFUSED);
+        if (payload && size > 0) addHeader("Content-Length", String(size));
+        if (!sendHeader(type)) return returnError(HTTPC_ERROR_SEND_HEADER_FAILED);
+        if (payload && size > 0 && _client->write(payload, size) != size) {
+            return returnError(HTTPC_ERROR_SEND_PAYLOAD_FAILED);
+        }
+        return returnError(handleHeaderResponse());
+    }
+
+    String getString() {
+        std::string body;
+        unsigned long start = millis();
+        while (connected() && (_size < 0 || (int)body.size() < _size)) {
+            int c = _client->read();
+            if (c >= 0) {
+                body += (char)c;
+                start = millis();
+            } else if (millis() - start > _tcpTimeout) {
+                break;
+            } else {
+                vTaskDelay(1);
+            }
+        }
+        return String(body);
+    }
+
+    static String errorToString(int error) {
+        switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+        case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+        case HTTPC_ERROR_NO_STREAM: return "no stream";
+        case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+        case HTTPC_ERROR_TOO_LESS_RAM: return "too less ram";
+        case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+        case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+        case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+        default: return String();
+        }
+    }
+
+protected:
+    NetworkClientSecure* _client = nullptr;
+    String _host;
+    uint16_t _port = 0;
+    String _uri;
+    bool _reuse = true;
+    bool _canReuse = false;
+    uint16_t _tcpTimeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+    int _size = -1;
+
+    bool connect() {
+        if (connected()) {
+            while (_client->available() > 0) _client->read();
+            return true;
+        }
+        return _client && _client->connect(_host.c_str(), _port, _tcpTimeout);
+    }
+
+    bool sendHeader(const char* type) {
+        if (!connected()) return false;
+        String header = String(type) + " " + _uri + " HTTP/1.1\r\nHost: " + _host;
+        if (_port != 80 && _port != 443) header += String(":") + String(_port);
+        header += String("\r\nConnection: ") + (_reuse ? "keep-alive" : "close") + "\r\n";
+        header += _headers + "\r\n";
+        return _client->write((const uint8_t*)header.c_str(), header.length()) == header.length();
+    }
+
+    int handleHeaderResponse() {
+        if (!connected()) return HTTPC_ERROR_NOT_CONNECTED;
+        _canReuse = _reuse;
+        _size = -1;
+        int code = 0;
+        unsigned long start = millis();
+        while (connected()) {
+            if (_client->available() <= 0) {
+                if (millis() - start > _tcpTimeout) return HTTPC_ERROR_READ_TIMEOUT;
+                vTaskDelay(1);
+                continue;
+            }
+            String line = _client->readStringUntil('\n');
+            line.trim();
+            if (line.startsWith("HTTP/1.")) {
+                _canReuse = _canReuse && line.startsWith("HTTP/1.1");
+                code = line.substring(9, line.indexOf(' ', 9)).toInt();
+            } else if (line.length() > 0) {
+                int colon = line.indexOf(':');
+                String name = line.substring(0, colon);
+                String value = line.substring(colon + 1);
+                value.trim();
+                if (name.equalsIgnoreCase("Content-Length")) _size = value.toInt();
+                if (name.equalsIgnoreCase("Connection") && value.indexOf("close") >= 0 && value.indexOf("keep-alive") < 0) _canReuse = false;
+            } else {
+                return code ? code : HTTPC_ERROR_NO_HTTP_SERVER;
+            }
+        }
+        return HTTPC_ERROR_CONNECTION_LOST;
+    }
+
+    int returnError(int error) {
+        if (error < 0 && connected()) _client->stop();
+        return error;
+    }
+
+    bool generateCookieString(String*) { return false; }
+
+private:
+    std::unique_ptr<NetworkClientSecure> _own;
+    String _headers;
+
+    bool parse(const String& url) {
+        bool https = url.startsWith("https://");
+        if (!https && !url.startsWith("http://")) return false;
+        int hostStart = https ? 8 : 7;
+        int pathStart = url.indexOf('/', hostStart);
+        String authority = url.substring(hostStart, pathStart < 0 ? url.length() : pathStart);
+        _uri = pathStart < 0 ? String("/") : url.substring(pathStart);
+        _port = https ? 443 : 80;
+        int colon = authority.indexOf(':');
+        if (colon >= 0) {
+            _port = authority.substring(colon + 1).toInt();
+            authority = authority.substring(0, colon);
+        }
+        _host = authority;
+        return true;
+    }
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+#include <NetworkClientSecure.h>
+
+/**
+ * Local HTTP/1.1 server on a NetworkClientSecure stand-in
+ *
+ * Reads what the client writes: the request line and headers, then a body
+ * framed by Content-Length or chunked transfer encoding, checking every
+ * chunk's size line and CRLF. Each complete request is recorded and
+ * answered through receive() with the configured status and body, several
+ * requests may follow each other on one connection.
+ */
+class HttpStandIn {
+public:
+    struct Request {
+        std::string method;
+        std::string path;
+        std::map<std::string, std::string> headers; // Lower-case names
+        std::string body;
+        size_t chunks = 0;       // Data chunks of a chunked body
+        bool framingOk = true;   // Every chunk was framed correctly
+        uint32_t connection = 0; // The client's connect() count when it was sent
+    };
+
+    int status = 200;
+    std::string responseBody = "{}";
+    bool keepAlive = true;   // false answers with Connection: close
+    bool respond = true;     // false never answers, the request still gets recorded
+    std::vector<Request> requests;
+
+    void attach(NetworkClientSecure& client) {
+        client.peer = [this](NetworkClientSecure& c) { feed(c); };
+        _connection = 0;
+        _seen = client.written.size(); // Earlier traffic was for someone else
+    }
+
+    // Body bytes of the request in progress
+    size_t partialBody() const { return _request.body.size(); }
+
+private:
+    enum State { HEAD, LENGTH_BODY, CHUNK_SIZE, CHUNK_DATA, CHUNK_END };
+
+    State _state = HEAD;
+    std::string _buf;
+    size_t _seen = 0;
+    size_t _remaining = 0;
+    uint32_t _connection = 0;
+    Request _request;
+
+    void feed(NetworkClientSecure& client) {
+        if (client.connects != _connection) {
+            // A new connection starts a new request
+            _connection = client.connects;
+            _state = HEAD;
+            _buf.clear();
+            _request = Request();
+        }
+        _buf.append(client.written.begin() + _seen, client.written.end());
+        _seen = client.written.size();
+        while (step(client)) {}
+    }
+
+    // Parse what the buffer holds for the current state, false when more is needed
+    bool step(NetworkClientSecure& client) {
+        switch (_state) {
+        case HEAD: {
+            size_t end = _buf.find("\r\n\r\n");
+            if (end == std::string::npos) return false;
+            parseHead(_buf.substr(0, end));
+            _buf.erase(0, end + 4);
+            _request.connection = _connection;
+            if (_request.headers["transfer-encoding"] == "chunked") {
+                _state = CHUNK_SIZE;
+            } else {
+                _remaining = strtoul(_request.headers["content-length"].c_str(), nullptr, 10);
+                _state = LENGTH_BODY;
+            }
+            return true;
+        }
+        case LENGTH_BODY: {
+            size_t n = std::min(_remaining, _buf.size());
+            _request.body.append(_buf, 0, n);
+            _buf.erase(0, n);
+            _remaining -= n;
+            if (_remaining > 0) return false;
+            complete(client);
+            return true;
+        }
+        case CHUNK_SIZE: {
+            size_t end = _buf.find("\r\n");
+            if (end == std::string::npos) return false;
+            std::string line = _buf.substr(0, end);
+            char* stop = nullptr;
+            _remaining = strtoul(line.c_str(), &stop, 16);
+            if (line.empty() || *stop != '\0') _request.framingOk = false;
+            _buf.erase(0, end + 2);
+            _state = _remaining ? CHUNK_DATA : CHUNK_END;
+            if (_remaining) _request.chunks++;
+            return true;
+        }
+        case CHUNK_DATA: {
+            if (_buf.size() < _remaining + 2) return false;
+            _request.body.append(_buf, 0, _remaining);
+            if (_buf.compare(_remaining, 2, "\r\n") != 0) _request.framingOk = false;
+            _buf.erase(0, _remaining + 2);
+            _state = CHUNK_SIZE;
+            return true;
+        }
+        case CHUNK_END: {
+            // No trailers, the last chunk is followed by an empty line
+            if (_buf.size() < 2) return false;
+            if (_buf.compare(0, 2, "\r\n") != 0) _request.framingOk = false;
+            _buf.erase(0, 2);
+            complete(client);
+            return true;
+        }
+        }
+        return false;
+    }
+
+    void parseHead(const std::string& head) {
+        size_t lineEnd = head.find("\r\n");
+        std::string requestLine = head.substr(0, lineEnd);
+        size_t space = requestLine.find(' ');
+        _request.method = requestLine.substr(0, space);
+        _request.path = requestLine.substr(space + 1, requestLine.find(' ', space + 1) - space - 1);
+        while (lineEnd != std::string::npos) {
+            size_t start = lineEnd + 2;
+            lineEnd = head.find("\r\n", start);
+            std::string line = head.substr(start, lineEnd == std::string::npos ? std::string::npos : lineEnd - start);
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon);
+            for (char& c : name) c = tolower((unsigned char)c);
+            size_t value = line.find_first_not_of(' ', colon + 1);
+            _request.headers[name] = value == std::string::npos ? "" : line.substr(value);
+        }
+    }
+
+    void complete(NetworkClientSecure& client) {
+        requests.push_back(_request);
+        _request = Request();
+        _state = HEAD;
+        if (!respond) return;
+        std::string response = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") + "\r\n";
+        response += "Content-Type: application/json\r\n";
+        response += "Content-Length: " + std::to_string(responseBody.size()) + "\r\n";
+        if (!keepAlive) response += "Connection: close\r\n";
+        response += "\r\n" + responseBody;
+        client.receive((const uint8_t*)response.data(), response.size());
+    }
+};
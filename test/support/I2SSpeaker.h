@@ -0,0 +1,189 @@
+#pragma once
+
+#include <Arduino.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pin and port names of the ESP-IDF GPIO and I2S drivers
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_1 = 1,
+    GPIO_NUM_2 = 2,
+    GPIO_NUM_3 = 3,
+    GPIO_NUM_4 = 4,
+    GPIO_NUM_5 = 5,
+    GPIO_NUM_6 = 6,
+    GPIO_NUM_7 = 7,
+    GPIO_NUM_8 = 8,
+    GPIO_NUM_9 = 9,
+    GPIO_NUM_10 = 10,
+    GPIO_NUM_11 = 11,
+    GPIO_NUM_12 = 12,
+    GPIO_NUM_13 = 13,
+    GPIO_NUM_14 = 14,
+    GPIO_NUM_15 = 15,
+    GPIO_NUM_16 = 16,
+    GPIO_NUM_17 = 17,
+    GPIO_NUM_18 = 18,
+    GPIO_NUM_19 = 19,
+    GPIO_NUM_20 = 20,
+    GPIO_NUM_21 = 21,
+    GPIO_NUM_22 = 22,
+    GPIO_NUM_23 = 23,
+    GPIO_NUM_24 = 24,
+    GPIO_NUM_25 = 25,
+    GPIO_NUM_26 = 26,
+    GPIO_NUM_27 = 27,
+    GPIO_NUM_28 = 28,
+    GPIO_NUM_29 = 29,
+    GPIO_NUM_30 = 30,
+    GPIO_NUM_31 = 31,
+    GPIO_NUM_32 = 32,
+    GPIO_NUM_33 = 33,
+    GPIO_NUM_34 = 34,
+    GPIO_NUM_35 = 35,
+    GPIO_NUM_36 = 36,
+    GPIO_NUM_37 = 37,
+    GPIO_NUM_38 = 38,
+    GPIO_NUM_39 = 39,
+    GPIO_NUM_40 = 40,
+    GPIO_NUM_41 = 41,
+    GPIO_NUM_42 = 42,
+    GPIO_NUM_43 = 43,
+    GPIO_NUM_44 = 44,
+    GPIO_NUM_45 = 45,
+    GPIO_NUM_46 = 46,
+    GPIO_NUM_47 = 47,
+    GPIO_NUM_48 = 48
+} gpio_num_t;
+
+typedef enum { I2S_NUM_0 = 0, I2S_NUM_1 = 1 } i2s_port_t;
+typedef enum { I2S_DATA_BIT_WIDTH_16BIT = 16, I2S_DATA_BIT_WIDTH_32BIT = 32 } i2s_data_bit_width_t;
+typedef enum { I2S_SLOT_MODE_MONO = 1, I2S_SLOT_MODE_STEREO = 2 } i2s_slot_mode_t;
+
+/**
+ * Stand-in for the I2S speaker driver
+ *
+ * Keeps everything written in order and paces writes at the sample rate,
+ * so a write of one block takes one block of time like the DMA queue does.
+ * Real time runs faster by Shared::speedup, the simulated clock does not. Tests can make init() or start() fail.
+ */
+class I2SSpeaker {
+public:
+    struct Shared {
+        std::mutex lock;
+        std::vector<int16_t> output;
+        std::vector<uint32_t> rates;  // Rate of every successful init, in order
+        uint32_t clears = 0;
+        uint32_t instances = 0;       // Alive right now
+        uint32_t writesStopped = 0;   // Writes to a stopped or deleted device
+        int failInits = 0;            // The next n init() calls fail
+        uint32_t speedup = 8;         // Real time runs this much faster than audio time
+    };
+
+    static Shared& shared() {
+        static Shared value;
+        return value;
+    }
+
+    static void reset() {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.output.clear();
+        s.rates.clear();
+        s.clears = 0;
+        s.writesStopped = 0;
+        s.failInits = 0;
+    }
+
+    static std::vector<int16_t> output() {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> guard(s.lock);
+        return s.output;
+    }
+
+    static size_t outputSize() {
+        Shared& s = shared();
+        std::lock_guard<std::mutex> guard(s.lock);
+        return s.output.size();
+    }
+
+    I2SSpeaker(gpio_num_t dout, gpio_num_t bclk, gpio_num_t lrc, i2s_port_t port): _rate(0), _running(false), _alive(MAGIC) {
+        std::lock_guard<std::mutex> guard(shared().lock);
+        shared().instances++;
+    }
+
+    I2SSpeaker(): I2SSpeaker(GPIO_NUM_NC, GPIO_NUM_NC, GPIO_NUM_NC, I2S_NUM_0) {}
+
+    ~I2SSpeaker() {
+        std::lock_guard<std::mutex> guard(shared().lock);
+        shared().instances--;
+        _alive = 0;
+    }
+
+    esp_err_t init(uint32_t rate, i2s_data_bit_width_t bits, i2s_slot_mode_t slots) {
+        std::lock_guard<std::mutex> guard(shared().lock);
+        if (shared().failInits > 0) {
+            shared().failInits--;
+            return ESP_FAIL;
+        }
+        _rate = rate;
+        shared().rates.push_back(rate);
+        return ESP_OK;
+    }
+
+    esp_err_t start() {
+        if (_rate == 0) return ESP_FAIL;
+        _running = true;
+        return ESP_OK;
+    }
+
+    esp_err_t stop() {
+        _running = false;
+        return ESP_OK;
+    }
+
+    esp_err_t writeAudioData(const int16_t* data, size_t bytes, size_t* written, TickType_t timeout) {
+        Shared& s = shared();
+        {
+            std::lock_guard<std::mutex> guard(s.lock);
+            if (_alive != MAGIC || !_running) {
+                s.writesStopped++;
+                if (written) *written = 0;
+                return ESP_FAIL;
+            }
+            s.output.insert(s.output.end(), data, data + bytes / sizeof(int16_t));
+        }
+        if (written) *written = bytes;
+        // The DMA queue takes the block as fast as it plays
+        uint32_t us = (uint64_t)bytes / sizeof(int16_t) * 1000000 / _rate;
+        HostClock::advance(us / 1000);
+        std::this_thread::sleep_for(std::chrono::microseconds(us / shared().speedup));
+        return ESP_OK;
+    }
+
+    esp_err_t clear() {
+        std::lock_guard<std::mutex> guard(shared().lock);
+        shared().clears++;
+        return ESP_OK;
+    }
+
+    bool playTone(uint32_t frequency, uint32_t duration, float amplitude) {
+        std::vector<int16_t> tone((size_t)_rate * duration / 1000);
+        for (size_t i = 0; i < tone.size(); i++) {
+            tone[i] = (int16_t)(amplitude * 32767.0f * sinf(2.0f * (float)M_PI * frequency * i / _rate));
+        }
+        size_t written = 0;
+        return writeAudioData(tone.data(), tone.size() * sizeof(int16_t), &written, portMAX_DELAY) == ESP_OK;
+    }
+
+    uint32_t sampleRate() const { return _rate; }
+
+private:
+    static const uint32_t MAGIC = 0x5350524b;
+    uint32_t _rate;
+    bool _running;
+    volatile uint32_t _alive;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Whole-buffer decoder of the esp32-gpt library, only its interface is needed on the host
+class MP3Decoder {
+public:
+    struct MP3Info {
+        int sampleRate;
+        int channels;
+        int bitrate;
+    };
+
+    bool init() { return true; }
+
+    bool decodeData(const uint8_t* data, size_t size, int16_t** pcm, size_t* samples, MP3Info* info) {
+        return false;
+    }
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <vector>
+
+/**
+ * Stand-in for NetworkClientSecure
+ *
+ * Incoming bytes are queued as segments, available() reports only the rest
+ * of the current one, like data that has arrived so far. Everything written
+ * is kept in order unless discard is set. connect() succeeds unless
+ * refuseConnect is set, and the WebSocket upgrade is answered with a 101.
+ * A peer, e.g. a stand-in server, sees every write and may answer through
+ * receive(). The most recently constructed client is reachable through last().
+ */
+class NetworkClientSecure : public Stream {
+public:
+    std::vector<uint8_t> written;
+    size_t writes = 0;
+    bool discard = false;          // Count writes without keeping them, for benchmarks
+    bool refuseConnect = false;
+    bool answerUpgrade = true;
+    uint32_t connects = 0;
+    int32_t connectTimeout = 0;    // Of the last connect(), 0 without one
+    unsigned long handshakeTimeout = 120;
+    std::function<void(NetworkClientSecure&)> peer; // Called after every write
+
+    NetworkClientSecure() { last() = this; }
+    ~NetworkClientSecure() {
+        if (last() == this) last() = nullptr;
+    }
+
+    static NetworkClientSecure*& last() {
+        static NetworkClientSecure* client = nullptr;
+        return client;
+    }
+
+    // Test side: bytes that arrive together
+    inline void receive(const uint8_t* data, size_t len) {
+        if (len > 0) _segments.emplace_back(data, data + len);
+    }
+
+    inline void receive(const std::vector<uint8_t>& data) { receive(data.data(), data.size()); }
+
+    // Test side: bytes that arrive in pieces of random size between 1 and maxPiece
+    inline void dribble(const std::vector<uint8_t>& data, size_t maxPiece, uint32_t seed) {
+        for (size_t pos = 0; pos < data.size();) {
+            seed = seed * 1664525u + 1013904223u;
+            size_t n = 1 + (seed >> 8) % maxPiece;
+            if (n > data.size() - pos) n = data.size() - pos;
+            receive(data.data() + pos, n);
+            pos += n;
+        }
+    }
+
+    inline size_t pendingSegments() const { return _segments.size(); }
+
+    void setInsecure() {}
+    void setHandshakeTimeout(unsigned long seconds) { handshakeTimeout = seconds; }
+
+    int connect(const char* host, uint16_t port, int32_t timeout) {
+        int ok = connect(host, port);
+        connectTimeout = timeout;
+        return ok;
+    }
+
+    int connect(const char* host, uint16_t port) {
+        connects++;
+        connectTimeout = 0;
+        if (refuseConnect) return 0;
+        _connected = true;
+        _segments.clear();
+        _offset = 0;
+        return 1;
+    }
+
+    void stop() {
+        _connected = false;
+        _segments.clear();
+        _offset = 0;
+    }
+
+    uint8_t connected() { return _connected; }
+
+    int available() override {
+        if (!_connected || _segments.empty()) return 0;
+        return _segments.front().size() - _offset;
+    }
+
+    int read(uint8_t* buf, size_t size) {
+        int available = this->available();
+        if (available <= 0) return -1;
+        size_t n = size < (size_t)available ? size : available;
+        memcpy(buf, _segments.front().data() + _offset, n);
+        consume(n);
+        return n;
+    }
+
+    int read() override {
+        uint8_t b;
+        return read(&b, 1) == 1 ? b : -1;
+    }
+
+    int peek() override {
+        return available() > 0 ? _segments.front()[_offset] : -1;
+    }
+
+    size_t readBytes(char* buffer, size_t length) override {
+        int n = read((uint8_t*)buffer, length);
+        return n > 0 ? n : 0;
+    }
+    using Stream::readBytes;
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!_connected) return 0;
+        writes++;
+        if (!discard) written.insert(written.end(), buf, buf + size);
+        if (peer) peer(*this);
+        return size;
+    }
+
+    size_t print(const String& text) {
+        if (!_connected) return 0;
+        write((const uint8_t*)text.c_str(), text.length());
+        if (answerUpgrade && text.startsWith("GET ")) {
+            static const char response[] = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n\r\n";
+            receive((const uint8_t*)response, sizeof(response) - 1);
+        }
+        return text.length();
+    }
+
+    String readStringUntil(char terminator) {
+        std::string line;
+        int c;
+        while ((c = read()) >= 0 && c != terminator) line += (char)c;
+        return String(line);
+    }
+
+private:
+    std::deque<std::vector<uint8_t>> _segments;
+    size_t _offset = 0;
+    bool _connected = false;
+
+    inline void consume(size_t n) {
+        _offset += n;
+        if (_offset == _segments.front().size()) {
+            _segments.pop_front();
+            _offset = 0;
+        }
+    }
+};
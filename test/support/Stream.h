@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "WString.h"
+
+// The Print and Stream interfaces of the Arduino core, without formatting
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t len) {
+        size_t n = 0;
+        while (len-- && write(*data++)) n++;
+        return n;
+    }
+    inline size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+    inline size_t print(const String& text) { return write((const uint8_t*)text.c_str(), text.length()); }
+    inline size_t print(const char* text) { return write(text); }
+    virtual int availableForWrite() { return 0; }
+    inline int getWriteError() const { return _writeError; }
+    inline void clearWriteError() { _writeError = 0; }
+    virtual void flush() {}
+
+protected:
+    int _writeError = 0;
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    inline void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    inline unsigned long getTimeout() const { return _timeout; }
+
+    virtual size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0) buffer[n++] = (char)c;
+        return n;
+    }
+    virtual size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+protected:
+    unsigned long _timeout = 1000;
+};
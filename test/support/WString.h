@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+/**
+ * Arduino String on top of std::string
+ *
+ * Only what the sources built on the host use. Unlike the Arduino class it
+ * may hold NUL bytes, which changes nothing for the text those sources build.
+ */
+class String {
+public:
+    String() {}
+    String(const char* text): _s(text ? text : "") {}
+    String(const std::string& text): _s(text) {}
+    explicit String(char c): _s(1, c) {}
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value>::type>
+    explicit String(T value): _s(std::to_string(value)) {}
+    explicit String(double value, unsigned int decimals = 2) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.*f", decimals, value);
+        _s = text;
+    }
+
+    inline const char* c_str() const { return _s.c_str(); }
+    inline unsigned int length() const { return _s.size(); }
+    inline bool isEmpty() const { return _s.empty(); }
+    inline char operator[](unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+    inline char charAt(unsigned int index) const { return (*this)[index]; }
+
+    inline bool operator==(const String& other) const { return _s == other._s; }
+    inline bool operator==(const char* other) const { return _s == (other ? other : ""); }
+    inline bool operator!=(const String& other) const { return _s != other._s; }
+    inline bool operator!=(const char* other) const { return !(*this == other); }
+
+    inline String& operator+=(const String& other) { _s += other._s; return *this; }
+    inline String& operator+=(const char* other) { if (other) _s += other; return *this; }
+    inline String& operator+=(char c) { _s += c; return *this; }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value>::type>
+    inline String& operator+=(T value) { _s += std::to_string(value); return *this; }
+
+    inline bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    inline bool endsWith(const String& suffix) const {
+        return _s.size() >= suffix._s.size() && _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+    }
+    inline int indexOf(char c, unsigned int from = 0) const { return found(_s.find(c, from)); }
+    inline int indexOf(const String& text, unsigned int from = 0) const { return found(_s.find(text._s, from)); }
+    inline String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    inline String substring(unsigned int from, unsigned int to) const {
+        return from < to && from < _s.size() ? String(_s.substr(from, to - from)) : String();
+    }
+    inline bool equalsIgnoreCase(const String& other) const {
+        if (_s.size() != other._s.size()) return false;
+        for (size_t i = 0; i < _s.size(); i++) {
+            if (tolower((unsigned char)_s[i]) != tolower((unsigned char)other._s[i])) return false;
+        }
+        return true;
+    }
+    inline long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+    inline float toFloat() const { return strtof(_s.c_str(), nullptr); }
+    inline void trim() {
+        size_t start = _s.find_first_not_of(" \t\r\n");
+        size_t end = _s.find_last_not_of(" \t\r\n");
+        _s = start == std::string::npos ? std::string() : _s.substr(start, end - start + 1);
+    }
+    inline void replace(const String& from, const String& to) {
+        if (from._s.empty()) return;
+        for (size_t pos = _s.find(from._s); pos != std::string::npos; pos = _s.find(from._s, pos + to._s.size())) {
+            _s.replace(pos, from._s.size(), to._s);
+        }
+    }
+
+    friend inline String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend inline String operator+(const String& a, const char* b) { return String(a._s + (b ? b : "")); }
+    friend inline String operator+(const char* a, const String& b) { return String((a ? a : "") + b._s); }
+    friend inline String operator+(const String& a, char b) { return String(a._s + b); }
+    template<typename T, typename = typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value>::type>
+    friend inline String operator+(const String& a, T b) { return String(a._s + std::to_string(b)); }
+
+private:
+    std::string _s;
+
+    static inline int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The Arduino-ESP32 base64 helper
+class base64 {
+public:
+    static String encode(const uint8_t* data, size_t length) {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        out.reserve((length + 2) / 3 * 4);
+        for (size_t i = 0; i < length; i += 3) {
+            uint32_t word = data[i] << 16;
+            if (i + 1 < length) word |= data[i + 1] << 8;
+            if (i + 2 < length) word |= data[i + 2];
+            out += alphabet[(word >> 18) & 63];
+            out += alphabet[(word >> 12) & 63];
+            out += i + 1 < length ? alphabet[(word >> 6) & 63] : '=';
+            out += i + 2 < length ? alphabet[word & 63] : '=';
+        }
+        return String(out);
+    }
+
+    static String encode(const String& text) {
+        return encode((const uint8_t*)text.c_str(), text.length());
+    }
+};
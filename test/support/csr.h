@@ -0,0 +1,7 @@
+#pragma once
+
+// The VAD state of ESP-SR's esp_vad.h, the only part of the SR interface host tests need
+typedef enum {
+    VAD_SILENCE = 0,
+    VAD_SPEECH = 1
+} vad_state_t;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_DEFAULT (1 << 12)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+
+// Counts every heap_caps allocation so tests can check a path does not allocate
+namespace HostHeap {
+inline std::atomic<uint32_t>& allocations() {
+    static std::atomic<uint32_t> value(0);
+    return value;
+}
+} // namespace HostHeap
+
+inline void* heap_caps_malloc(size_t size, uint32_t) {
+    HostHeap::allocations()++;
+    return malloc(size);
+}
+inline void* heap_caps_calloc(size_t count, size_t size, uint32_t) {
+    HostHeap::allocations()++;
+    return calloc(count, size);
+}
+inline void* heap_caps_realloc(void* ptr, size_t size, uint32_t) {
+    HostHeap::allocations()++;
+    return realloc(ptr, size);
+}
+inline void* heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t) {
+    HostHeap::allocations()++;
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+inline void heap_caps_free(void* ptr) { free(ptr); }
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * WAV fixtures for the host tests
+ *
+ * Fixtures are scripted from silence and speech-like segments and go
+ * through a real 16-bit PCM WAV file image, so the tests replay the same
+ * bytes a recording on the device would contain. Set FIXTURE_DUMP_DIR to
+ * also write them out for listening.
+ */
+namespace Fixtures {
+
+struct Clip {
+    uint32_t rate = 16000;
+    std::vector<int16_t> pcm;
+
+    inline size_t samplesPerMs() const { return rate / 1000; }
+    inline double seconds() const { return (double)pcm.size() / rate; }
+};
+
+// Where speech was placed in a scripted clip, in samples
+struct Segment {
+    size_t start;
+    size_t end;
+};
+
+struct __attribute__((packed)) WavHeader {
+    char riff[4];
+    uint32_t riffSize;
+    char wave[4];
+    char fmt[4];
+    uint32_t fmtSize;
+    uint16_t format;
+    uint16_t channels;
+    uint32_t rate;
+    uint32_t byteRate;
+    uint16_t blockAlign;
+    uint16_t bitsPerSample;
+    char data[4];
+    uint32_t dataSize;
+};
+
+inline std::vector<uint8_t> encodeWav(const Clip& clip) {
+    WavHeader header;
+    memcpy(header.riff, "RIFF", 4);
+    memcpy(header.wave, "WAVE", 4);
+    memcpy(header.fmt, "fmt ", 4);
+    memcpy(header.data, "data", 4);
+    header.fmtSize = 16;
+    header.format = 1;
+    header.channels = 1;
+    header.rate = clip.rate;
+    header.bitsPerSample = 16;
+    header.blockAlign = 2;
+    header.byteRate = clip.rate * 2;
+    header.dataSize = clip.pcm.size() * 2;
+    header.riffSize = sizeof(header) - 8 + header.dataSize;
+
+    std::vector<uint8_t> bytes(sizeof(header) + header.dataSize);
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), clip.pcm.data(), header.dataSize);
+    return bytes;
+}
+
+/**
+ * Parse a mono 16-bit PCM WAV image, chunks other than fmt and data are skipped
+ * @return false if the image is not such a WAV
+ */
+inline bool decodeWav(const std::vector<uint8_t>& bytes, Clip& clip) {
+    if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) != 0 || memcmp(bytes.data() + 8, "WAVE", 4) != 0) return false;
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= bytes.size()) {
+        const uint8_t* chunk = bytes.data() + pos;
+        uint32_t size;
+        memcpy(&size, chunk + 4, 4);
+        if (pos + 8 + size > bytes.size()) return false;
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uint16_t format, channels, bits;
+            memcpy(&format, chunk + 8, 2);
+            memcpy(&channels, chunk + 10, 2);
+            memcpy(&clip.rate, chunk + 12, 4);
+            memcpy(&bits, chunk + 22, 2);
+            if (format != 1 || channels != 1 || bits != 16) return false;
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0 && haveFormat) {
+            clip.pcm.resize(size / 2);
+            memcpy(clip.pcm.data(), chunk + 8, clip.pcm.size() * 2);
+            return true;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+inline void dump(const char* name, const Clip& clip) {
+    const char* dir = getenv("FIXTURE_DUMP_DIR");
+    if (!dir) return;
+    std::string path = std::string(dir) + "/" + name + ".wav";
+    std::vector<uint8_t> bytes = encodeWav(clip);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return;
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+/**
+ * Builds a clip from silence and speech-like segments
+ *
+ * Speech is a voiced harmonic series with a drifting pitch under a
+ * syllable-rate envelope, silence is a low noise floor. Both are
+ * deterministic for a given seed.
+ */
+class Script {
+public:
+    explicit Script(uint32_t rate = 16000, uint32_t seed = 1): _seed(seed), _phase(0) {
+        _clip.rate = rate;
+    }
+
+    inline Script& silence(uint32_t ms, int16_t floor = 40) {
+        size_t count = ms * _clip.samplesPerMs();
+        for (size_t i = 0; i < count; i++) {
+            _clip.pcm.push_back((int16_t)(noise() * floor));
+        }
+        return *this;
+    }
+
+    inline Script& speech(uint32_t ms, float level = 9000.0f, float pitch = 140.0f) {
+        size_t start = _clip.pcm.size();
+        size_t count = ms * _clip.samplesPerMs();
+        const float rate = (float)_clip.rate;
+        for (size_t i = 0; i < count; i++) {
+            float t = i / rate;
+            float f0 = pitch * (1.0f + 0.08f * sinf(2.0f * (float)M_PI * 0.7f * t));
+            _phase += 2.0 * M_PI * f0 / rate;
+            float voiced = 0.0f;
+            for (int h = 1; h <= 8; h++) {
+                if (h * f0 > rate / 2) break;
+                voiced += sinf((float)(_phase * h)) / h;
+            }
+            // Syllables at about 4 Hz with short ramps at both ends of the segment
+            float syllable = 0.55f + 0.45f * sinf(2.0f * (float)M_PI * 4.0f * t);
+            float edge = std::min(1.0f, std::min(i, count - i) / (0.02f * rate));
+            float value = level * 0.5f * voiced * syllable * edge + 40.0f * noise();
+            _clip.pcm.push_back((int16_t)std::max(-32768.0f, std::min(32767.0f, value)));
+        }
+        _segments.push_back({start, _clip.pcm.size()});
+        return *this;
+    }
+
+    inline const Clip& clip() const { return _clip; }
+    inline const std::vector<Segment>& segments() const { return _segments; }
+
+    // The clip after a trip through a WAV file image
+    inline Clip wav() const {
+        Clip decoded;
+        decodeWav(encodeWav(_clip), decoded);
+        return decoded;
+    }
+
+private:
+    Clip _clip;
+    std::vector<Segment> _segments;
+    uint32_t _seed;
+    double _phase;
+
+    inline float noise() {
+        _seed = _seed * 1664525u + 1013904223u;
+        return (int32_t)_seed / 2147483648.0f;
+    }
+};
+
+} // namespace Fixtures
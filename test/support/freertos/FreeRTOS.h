@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// FreeRTOS on top of the host clock and std::thread, one tick is one millisecond
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t EventBits_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define BIT0 (1 << 0)
+#define BIT1 (1 << 1)
+#define BIT2 (1 << 2)
+#define BIT3 (1 << 3)
+
+/**
+ * Simulated clock behind millis() and the FreeRTOS tick count
+ *
+ * Time only moves when a test advances it or code waits on a stubbed
+ * FreeRTOS primitive, so timing-dependent logic replays deterministically.
+ */
+namespace HostClock {
+inline std::atomic<uint32_t>& ticks() {
+    static std::atomic<uint32_t> value(0);
+    return value;
+}
+inline void set(uint32_t ms) { ticks() = ms; }
+inline void advance(uint32_t ms) { ticks() += ms; }
+} // namespace HostClock
+
+inline TickType_t xTaskGetTickCount() { return HostClock::ticks(); }
+
+typedef struct {
+    std::recursive_mutex mutex;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define taskENTER_CRITICAL(mux) (mux)->mutex.lock()
+#define taskEXIT_CRITICAL(mux) (mux)->mutex.unlock()
+#define portENTER_CRITICAL taskENTER_CRITICAL
+#define portEXIT_CRITICAL taskEXIT_CRITICAL
+
+#include "task.h"
+#include "semphr.h"
+#include "event_groups.h"
+#include "queue.h"
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include "FreeRTOS.h"
+
+struct HostEventGroup {
+    std::mutex lock;
+    std::condition_variable changed;
+    EventBits_t bits = 0;
+};
+
+typedef HostEventGroup* EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() { return new HostEventGroup(); }
+inline void vEventGroupDelete(EventGroupHandle_t group) { delete group; }
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    group->bits |= bits;
+    group->changed.notify_all();
+    return group->bits;
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    EventBits_t value = group->bits;
+    group->bits &= ~bits;
+    return value;
+}
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    return group->bits;
+}
+
+/**
+ * Blocks for real until the bits are set, at most one real millisecond per tick.
+ * A wait that times out moves the simulated clock by its timeout.
+ */
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear,
+    BaseType_t all, TickType_t timeout) {
+    std::unique_lock<std::mutex> guard(group->lock);
+    auto met = [&] { return all ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+    bool ok;
+    if (timeout == portMAX_DELAY) {
+        group->changed.wait(guard, met);
+        ok = true;
+    } else {
+        ok = group->changed.wait_for(guard, std::chrono::milliseconds(timeout), met);
+    }
+    EventBits_t value = group->bits;
+    if (ok && clear) group->bits &= ~bits;
+    if (!ok) HostClock::advance(timeout);
+    return value;
+}
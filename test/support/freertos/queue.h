@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "FreeRTOS.h"
+
+struct HostQueue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    HostQueue* queue = new HostQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+inline void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+// Waits for real like xEventGroupWaitBits(), a wait that times out moves the simulated clock
+inline bool hostQueueWait(HostQueue* queue, std::unique_lock<std::mutex>& guard, TickType_t timeout,
+    const std::function<bool()>& ready) {
+    if (timeout == portMAX_DELAY) {
+        queue->changed.wait(guard, ready);
+        return true;
+    }
+    if (queue->changed.wait_for(guard, std::chrono::milliseconds(timeout), ready)) return true;
+    HostClock::advance(timeout);
+    return false;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t timeout) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!hostQueueWait(queue, guard, timeout, [&] { return queue->items.size() < queue->length; })) return pdFALSE;
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+#define xQueueSendToBack xQueueSend
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t timeout) {
+    std::unique_lock<std::mutex> guard(queue->lock);
+    if (!hostQueueWait(queue, guard, timeout, [&] { return !queue->items.empty(); })) return pdFALSE;
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->items.size();
+}
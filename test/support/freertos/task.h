@@ -0,0 +1,39 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define tskNO_AFFINITY 0x7fffffff
+
+// Waiting advances the simulated clock; other host threads get a chance to run
+inline void vTaskDelay(TickType_t ticks) {
+    HostClock::ticks() += ticks;
+    std::this_thread::yield();
+}
+
+namespace HostTasks {
+// Makes task creation fail, e.g. to exercise fallbacks for a missing worker
+inline std::atomic<bool>& failCreate() {
+    static std::atomic<bool> value(false);
+    return value;
+}
+} // namespace HostTasks
+
+inline BaseType_t xTaskCreatePinnedToCoreWithCaps(TaskFunction_t fn, const char*, uint32_t, void* arg,
+    UBaseType_t, TaskHandle_t* handle, BaseType_t, uint32_t) {
+    if (HostTasks::failCreate()) return pdFAIL;
+    std::thread* thread = new std::thread(fn, arg);
+    thread->detach();
+    if (handle) *handle = thread;
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    return xTaskCreatePinnedToCoreWithCaps(fn, name, stack, arg, priority, handle, core, 0);
+}
+
+// Host tasks end when their function returns
+inline void vTaskDeleteWithCaps(TaskHandle_t) {}
@@ -0,0 +1,91 @@
+#pragma once
+
+// Helix MP3 decoder API on the host. Frames are located with the real header
+// parser and "decoded" into a continuous 440 Hz tone, so tests exercise the
+// framing, windowing and downmix around Helix without the codec itself.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "app/audio/mpegaudio.h"
+
+enum {
+    ERR_MP3_NONE = 0,
+    ERR_MP3_INDATA_UNDERFLOW = -1,
+    ERR_MP3_MAINDATA_UNDERFLOW = -2,
+    ERR_MP3_FREE_BITRATE_SYNC = -3,
+    ERR_MP3_OUT_OF_MEMORY = -4,
+    ERR_MP3_NULL_POINTER = -5,
+    ERR_MP3_INVALID_FRAMEHEADER = -6,
+};
+
+typedef void* HMP3Decoder;
+
+typedef struct _MP3FrameInfo {
+    int bitrate;
+    int nChans;
+    int samprate;
+    int bitsPerSample;
+    int outputSamps;
+    int layer;
+    int version;
+} MP3FrameInfo;
+
+namespace HostHelix {
+struct State {
+    MP3FrameInfo last;
+    double phase;
+    int warmup;   // Frames left that report a bit reservoir underflow
+};
+
+// Frames at the start of every decoder that produce no audio, like a filling bit reservoir
+inline int& warmupFrames() {
+    static int value = 0;
+    return value;
+}
+} // namespace HostHelix
+
+inline HMP3Decoder MP3InitDecoder() {
+    HostHelix::State* state = new HostHelix::State();
+    memset(&state->last, 0, sizeof(state->last));
+    state->phase = 0.0;
+    state->warmup = HostHelix::warmupFrames();
+    return state;
+}
+
+inline void MP3FreeDecoder(HMP3Decoder decoder) {
+    delete static_cast<HostHelix::State*>(decoder);
+}
+
+inline int MP3Decode(HMP3Decoder decoder, unsigned char** inbuf, int* bytesLeft, short* outbuf, int useSize) {
+    HostHelix::State* state = static_cast<HostHelix::State*>(decoder);
+    MpegFrameHeader header;
+    if (!state || !inbuf || !*inbuf || !bytesLeft) return ERR_MP3_NULL_POINTER;
+    if (*bytesLeft < (int)MpegAudio::HEADER_SIZE || !MpegAudio::parseHeader(*inbuf, &header)) return ERR_MP3_INVALID_FRAMEHEADER;
+    if (*bytesLeft < header.size) return ERR_MP3_INDATA_UNDERFLOW;
+
+    *inbuf += header.size;
+    *bytesLeft -= header.size;
+    if (state->warmup > 0) {
+        state->warmup--;
+        return ERR_MP3_MAINDATA_UNDERFLOW;
+    }
+
+    for (int i = 0; i < header.samples; i++) {
+        short value = (short)(12000.0 * sin(state->phase));
+        state->phase += 2.0 * M_PI * 440.0 / header.sampleRate;
+        for (int ch = 0; ch < header.channels; ch++) outbuf[i * header.channels + ch] = value;
+    }
+    state->last.bitrate = header.bitrate;
+    state->last.nChans = header.channels;
+    state->last.samprate = header.sampleRate;
+    state->last.bitsPerSample = 16;
+    state->last.outputSamps = header.samples * header.channels;
+    state->last.layer = header.layer;
+    state->last.version = header.version;
+    return ERR_MP3_NONE;
+}
+
+inline void MP3GetLastFrameInfo(HMP3Decoder decoder, MP3FrameInfo* info) {
+    *info = static_cast<HostHelix::State*>(decoder)->last;
+}
@@ -0,0 +1,180 @@
+#include <unity.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "bench.h"
+#include "fixtures.h"
+#include "app/audio/adpcm.h"
+#include "app/audio/audiopacket.h"
+
+// The vectors in external/app/internal/domain/audio_packet_test.go, the server must parse what this builds
+static const int16_t GOLDEN_PCM[16] = {0, 5653, 8883, 6905, 3179, -1806, -6972, -7359, -4050, 134, 5755, 8905, 6836, 3052, -1931, -7037};
+static const uint8_t GOLDEN_ADPCM[8] = {0x7f, 0x77, 0xf1, 0xcf, 0x32, 0x15, 0xa9, 0xbc};
+static const int16_t GOLDEN_PCM_OUT[16] = {1141, 1340, 1770, 2695, 3092, 1288, -2585, -7566, -4218, 42, 6130, 8561, 6352, 3004, -2475, -7631};
+static const uint8_t GOLDEN_HEADER[16] = {
+    'P', 'A', 'U', 'D', 0x02, 0x10, 0x01, 0x14,
+    0x07, 0x00, 0x10, 0x00, 0xd2, 0x04, 0x8f, 0x76,
+};
+static const ImaAdpcm::State GOLDEN_STATE = {1234, 20};
+
+static const size_t CHUNK = 512; // Samples per published chunk
+
+// speechLike() in audio_packet_test.go: a gliding harmonic tone with a syllable envelope
+static std::vector<int16_t> speechLike(size_t samples, int rate) {
+    std::vector<int16_t> out(samples);
+    double phase = 0;
+    for (size_t i = 0; i < samples; i++) {
+        double t = (double)i / rate;
+        double f0 = 140 + 40 * sin(2 * M_PI * 0.7 * t);
+        phase += 2 * M_PI * f0 / rate;
+        double envelope = 0.5 + 0.5 * sin(2 * M_PI * 4 * t);
+        double value = 0;
+        for (int h = 1; h <= 8; h++) value += sin(h * phase) / h;
+        out[i] = (int16_t)(6000 * envelope * value);
+    }
+    return out;
+}
+
+static double snr(const std::vector<int16_t>& reference, const std::vector<int16_t>& decoded) {
+    double signal = 0, noise = 0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        double s = reference[i];
+        double d = s - decoded[i];
+        signal += s * s;
+        noise += d * d;
+    }
+    return 10 * log10(signal / noise);
+}
+
+/**
+ * Chunk by chunk as audioBrokerPublisher() sends it, every chunk decoded
+ * on its own from the state in its header
+ */
+static std::vector<int16_t> roundTrip(const std::vector<int16_t>& pcm, size_t chunk) {
+    std::vector<int16_t> decoded(pcm.size());
+    std::vector<uint8_t> encoded(ImaAdpcm::encodedSize(chunk));
+    ImaAdpcm::State state = ImaAdpcm::initialState();
+    for (size_t pos = 0; pos < pcm.size(); pos += chunk) {
+        size_t n = std::min(chunk, pcm.size() - pos);
+        AudioPacketHeader header = audioPacketHeader(AUDIO_PACKET_CODEC_IMA_ADPCM, pos / chunk, n, state);
+        ImaAdpcm::encode(pcm.data() + pos, n, encoded.data(), state);
+        ImaAdpcm::State start = {header.predictor, header.stepIndex};
+        ImaAdpcm::decode(encoded.data(), header.samples, decoded.data() + pos, start);
+    }
+    return decoded;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_crc_is_ccitt_false() {
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16Ccitt((const uint8_t*)"123456789", 9));
+}
+
+void test_header_matches_the_server_golden_vector() {
+    AudioPacketHeader header = audioPacketHeader(AUDIO_PACKET_CODEC_IMA_ADPCM, 7, 16, GOLDEN_STATE);
+    TEST_ASSERT_EQUAL(sizeof(GOLDEN_HEADER), sizeof(header));
+    TEST_ASSERT_EQUAL_MEMORY(GOLDEN_HEADER, &header, sizeof(GOLDEN_HEADER));
+    // Version and size sit where the server looks for them before anything else
+    TEST_ASSERT_EQUAL(AUDIO_PACKET_VERSION, GOLDEN_HEADER[4]);
+    TEST_ASSERT_EQUAL(sizeof(AudioPacketHeader), GOLDEN_HEADER[5]);
+    TEST_ASSERT_EQUAL_HEX16(crc16Ccitt(GOLDEN_HEADER, 14), GOLDEN_HEADER[14] | GOLDEN_HEADER[15] << 8);
+}
+
+void test_codec_matches_the_server_golden_vector() {
+    uint8_t encoded[8];
+    ImaAdpcm::State state = GOLDEN_STATE;
+    TEST_ASSERT_EQUAL(sizeof(encoded), ImaAdpcm::encode(GOLDEN_PCM, 16, encoded, state));
+    TEST_ASSERT_EQUAL_MEMORY(GOLDEN_ADPCM, encoded, sizeof(encoded));
+
+    int16_t decoded[16];
+    state = GOLDEN_STATE;
+    TEST_ASSERT_EQUAL(16, ImaAdpcm::decode(GOLDEN_ADPCM, 16, decoded, state));
+    TEST_ASSERT_EQUAL_INT16_ARRAY(GOLDEN_PCM_OUT, decoded, 16);
+}
+
+void test_chunks_decode_like_one_stream() {
+    std::vector<int16_t> pcm = speechLike(16000, 16000);
+    std::vector<uint8_t> encoded(ImaAdpcm::encodedSize(pcm.size()));
+    std::vector<int16_t> whole(pcm.size());
+    ImaAdpcm::State state = ImaAdpcm::initialState();
+    ImaAdpcm::encode(pcm.data(), pcm.size(), encoded.data(), state);
+    state = ImaAdpcm::initialState();
+    ImaAdpcm::decode(encoded.data(), pcm.size(), whole.data(), state);
+
+    // Even chunks only, an odd one leaves a high nibble the stream would have used
+    for (size_t chunk : {(size_t)2, (size_t)160, CHUNK, (size_t)1000}) {
+        std::vector<int16_t> chunked = roundTrip(pcm, chunk);
+        TEST_ASSERT_EQUAL_INT16_ARRAY(whole.data(), chunked.data(), pcm.size());
+    }
+}
+
+void test_round_trip_snr() {
+    std::vector<int16_t> pcm = speechLike(10 * 16000, 16000);
+    double db = snr(pcm, roundTrip(pcm, CHUNK));
+    char line[96];
+    snprintf(line, sizeof(line), "speech-like 10 s: SNR %.1f dB", db);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL(25.0, db);
+
+    // Scripted speech and silence, as the microphone would deliver it
+    Fixtures::Script script(16000, 9);
+    script.silence(500).speech(3000).silence(500).speech(2000);
+    const std::vector<int16_t>& clip = script.clip().pcm;
+    db = snr(clip, roundTrip(clip, CHUNK));
+    snprintf(line, sizeof(line), "scripted 6 s:     SNR %.1f dB", db);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL(20.0, db);
+}
+
+/**
+ * Encode and decode speed over 512-sample chunks, plus the publisher's
+ * header, in samples per second and times real time at 16 kHz
+ */
+void bench_codec() {
+    std::vector<int16_t> pcm = speechLike(60 * 16000, 16000);
+    std::vector<uint8_t> encoded(ImaAdpcm::encodedSize(pcm.size()));
+    std::vector<int16_t> decoded(pcm.size());
+    const int reps = 5;
+    char line[128];
+
+    double start = Bench::seconds();
+    for (int r = 0; r < reps; r++) {
+        ImaAdpcm::State state = ImaAdpcm::initialState();
+        for (size_t pos = 0; pos < pcm.size(); pos += CHUNK) {
+            AudioPacketHeader header = audioPacketHeader(AUDIO_PACKET_CODEC_IMA_ADPCM, pos / CHUNK, CHUNK, state);
+            Bench::keep(header);
+            ImaAdpcm::encode(pcm.data() + pos, CHUNK, encoded.data() + pos / 2, state);
+        }
+        Bench::keep(encoded);
+    }
+    double encodeSeconds = (Bench::seconds() - start) / reps;
+
+    start = Bench::seconds();
+    for (int r = 0; r < reps; r++) {
+        ImaAdpcm::State state = ImaAdpcm::initialState();
+        ImaAdpcm::decode(encoded.data(), pcm.size(), decoded.data(), state);
+        Bench::keep(decoded);
+    }
+    double decodeSeconds = (Bench::seconds() - start) / reps;
+
+    snprintf(line, sizeof(line), "encode: %6.1f Msamples/s, %6.0fx real time, %zu -> %zu bytes",
+        pcm.size() / encodeSeconds / 1e6, 60 / encodeSeconds, pcm.size() * 2, encoded.size());
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "decode: %6.1f Msamples/s, %6.0fx real time",
+        pcm.size() / decodeSeconds / 1e6, 60 / decodeSeconds);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL(25.0, snr(pcm, decoded));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_is_ccitt_false);
+    RUN_TEST(test_header_matches_the_server_golden_vector);
+    RUN_TEST(test_codec_matches_the_server_golden_vector);
+    RUN_TEST(test_chunks_decode_like_one_stream);
+    RUN_TEST(test_round_trip_snr);
+    RUN_TEST(bench_codec);
+    return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// prakiraan-cuaca response for adm4 31.71.03.1001 (Gunung Sahari Selatan, Jakarta Pusat)
+// in the shape api.bmkg.go.id/publik/prakiraan-cuaca returns: compact, escaped slashes,
+// 21 periods over three days starting at 10:00 WIB, every field the reader skips kept in
+static const char BMKG_FIXTURE[] =
+    "{\"lokasi\":{\"adm1\":\"31\",\"adm2\":\"31.71\",\"adm3\":\"31.71.03\",\"adm4\":\"31.71.03.1001\",\"provinsi\":\"DKI Jakar"
+    "ta\",\"kotkab\":\"Kota Adm. Jakarta Pusat\",\"kecamatan\":\"Kemayoran\",\"desa\":\"Gunung Sahari Selatan\",\"lon\":"
+    "106.8403,\"lat\":-6.1664,\"timezone\":\"Asia/Jakarta\"},\"data\":[{\"lokasi\":{\"adm1\":\"31\",\"adm2\":\"31.71\",\"adm"
+    "3\":\"31.71.03\",\"adm4\":\"31.71.03.1001\",\"provinsi\":\"DKI Jakarta\",\"kotkab\":\"Kota Adm. Jakarta Pusat\",\"ke"
+    "camatan\":\"Kemayoran\",\"desa\":\"Gunung Sahari Selatan\",\"lon\":106.8403,\"lat\":-6.1664,\"timezone\":\"Asia/Ja"
+    "karta\",\"type\":\"adm4\"},\"cuaca\":[[{\"datetime\":\"2025-01-20T03:00:00Z\",\"t\":27,\"tcc\":0,\"tp\":5.1,\"weather\""
+    ":1,\"weather_desc\":\"Cerah\",\"weather_desc_en\":\"Sunny\",\"wd_deg\":240,\"wd\":\"NE\",\"wd_to\":\"W\",\"ws\":10.7,\"hu"
+    "\":60,\"vs\":7717,\"vs_text\":\"< 10 km\",\"time_index\":\"0-1\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":"
+    "\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/cerah-am.svg\",\"utc_datetime\":\"2025-01-20 03:00"
+    ":00\",\"local_datetime\":\"2025-01-20 10:00:00\"},{\"datetime\":\"2025-01-20T06:00:00Z\",\"t\":31,\"tcc\":12,\"tp\""
+    ":8.6,\"weather\":2,\"weather_desc\":\"Cerah Berawan\",\"weather_desc_en\":\"Partly Cloudy\",\"wd_deg\":127,\"wd\":"
+    "\"S\",\"wd_to\":\"SW\",\"ws\":12.6,\"hu\":83,\"vs\":5112,\"vs_text\":\"> 9 km\",\"time_index\":\"1-2\",\"analysis_date\":\""
+    "2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/cerah berawan-am."
+    "svg\",\"utc_datetime\":\"2025-01-20 06:00:00\",\"local_datetime\":\"2025-01-20 13:00:00\"},{\"datetime\":\"2025-"
+    "01-20T09:00:00Z\",\"t\":29,\"tcc\":82,\"tp\":5.3,\"weather\":61,\"weather_desc\":\"Hujan Ringan\",\"weather_desc_e"
+    "n\":\"Light Rain\",\"wd_deg\":266,\"wd\":\"SE\",\"wd_to\":\"N\",\"ws\":5.9,\"hu\":62,\"vs\":8319,\"vs_text\":\"< 10 km\",\"t"
+    "ime_index\":\"2-3\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/stora"
+    "ge\\/icon\\/cuaca\\/hujan ringan-am.svg\",\"utc_datetime\":\"2025-01-20 09:00:00\",\"local_datetime\":\"2025-01"
+    "-20 16:00:00\"},{\"datetime\":\"2025-01-20T12:00:00Z\",\"t\":27,\"tcc\":65,\"tp\":0.8,\"weather\":63,\"weather_des"
+    "c\":\"Hujan Sedang\",\"weather_desc_en\":\"Rain\",\"wd_deg\":209,\"wd\":\"W\",\"wd_to\":\"NW\",\"ws\":10.4,\"hu\":93,\"vs\""
+    ":9714,\"vs_text\":\"> 9 km\",\"time_index\":\"3-4\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\"
+    "/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/hujan sedang-pm.svg\",\"utc_datetime\":\"2025-01-20 12:00:00"
+    "\",\"local_datetime\":\"2025-01-20 19:00:00\"},{\"datetime\":\"2025-01-20T15:00:00Z\",\"t\":32,\"tcc\":47,\"tp\":3."
+    "1,\"weather\":61,\"weather_desc\":\"Hujan Ringan\",\"weather_desc_en\":\"Light Rain\",\"wd_deg\":196,\"wd\":\"SW\",\""
+    "wd_to\":\"E\",\"ws\":6.5,\"hu\":92,\"vs\":7449,\"vs_text\":\"< 10 km\",\"time_index\":\"4-5\",\"analysis_date\":\"2025-0"
+    "1-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/hujan ringan-pm.svg\",\"u"
+    "tc_datetime\":\"2025-01-20 15:00:00\",\"local_datetime\":\"2025-01-20 22:00:00\"}],[{\"datetime\":\"2025-01-20"
+    "T18:00:00Z\",\"t\":25,\"tcc\":75,\"tp\":8.2,\"weather\":3,\"weather_desc\":\"Berawan\",\"weather_desc_en\":\"Mostly "
+    "Cloudy\",\"wd_deg\":275,\"wd\":\"N\",\"wd_to\":\"NE\",\"ws\":13.8,\"hu\":75,\"vs\":9748,\"vs_text\":\"> 9 km\",\"time_inde"
+    "x\":\"8-9\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon"
+    "\\/cuaca\\/berawan-pm.svg\",\"utc_datetime\":\"2025-01-20 18:00:00\",\"local_datetime\":\"2025-01-21 01:00:00\""
+    "},{\"datetime\":\"2025-01-20T21:00:00Z\",\"t\":30,\"tcc\":95,\"tp\":8.1,\"weather\":1,\"weather_desc\":\"Cerah\",\"we"
+    "ather_desc_en\":\"Sunny\",\"wd_deg\":238,\"wd\":\"NW\",\"wd_to\":\"S\",\"ws\":7.1,\"hu\":82,\"vs\":8707,\"vs_text\":\"< 10"
+    " km\",\"time_index\":\"9-10\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.i"
+    "d\\/storage\\/icon\\/cuaca\\/cerah-pm.svg\",\"utc_datetime\":\"2025-01-20 21:00:00\",\"local_datetime\":\"2025-0"
+    "1-21 04:00:00\"},{\"datetime\":\"2025-01-21T00:00:00Z\",\"t\":31,\"tcc\":44,\"tp\":10.0,\"weather\":63,\"weather_d"
+    "esc\":\"Hujan Sedang\",\"weather_desc_en\":\"Rain\",\"wd_deg\":45,\"wd\":\"E\",\"wd_to\":\"SE\",\"ws\":7.4,\"hu\":81,\"vs\""
+    ":9446,\"vs_text\":\"> 9 km\",\"time_index\":\"10-11\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\"
+    "/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/hujan sedang-am.svg\",\"utc_datetime\":\"2025-01-21 00:00:"
+    "00\",\"local_datetime\":\"2025-01-21 07:00:00\"},{\"datetime\":\"2025-01-21T03:00:00Z\",\"t\":30,\"tcc\":67,\"tp\":"
+    "5.9,\"weather\":95,\"weather_desc\":\"Hujan Petir\",\"weather_desc_en\":\"Thunderstorm\",\"wd_deg\":32,\"wd\":\"NE\""
+    ",\"wd_to\":\"W\",\"ws\":12.5,\"hu\":80,\"vs\":9773,\"vs_text\":\"< 10 km\",\"time_index\":\"11-12\",\"analysis_date\":\"2"
+    "025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/hujan petir-am.svg"
+    "\",\"utc_datetime\":\"2025-01-21 03:00:00\",\"local_datetime\":\"2025-01-21 10:00:00\"},{\"datetime\":\"2025-01-"
+    "21T06:00:00Z\",\"t\":26,\"tcc\":81,\"tp\":9.4,\"weather\":63,\"weather_desc\":\"Hujan Sedang\",\"weather_desc_en\":"
+    "\"Rain\",\"wd_deg\":79,\"wd\":\"S\",\"wd_to\":\"SW\",\"ws\":9.2,\"hu\":87,\"vs\":7032,\"vs_text\":\"> 9 km\",\"time_index\":"
+    "\"12-13\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\"
+    "/cuaca\\/hujan sedang-am.svg\",\"utc_datetime\":\"2025-01-21 06:00:00\",\"local_datetime\":\"2025-01-21 13:00"
+    ":00\"},{\"datetime\":\"2025-01-21T09:00:00Z\",\"t\":24,\"tcc\":32,\"tp\":5.3,\"weather\":95,\"weather_desc\":\"Hujan"
+    " Petir\",\"weather_desc_en\":\"Thunderstorm\",\"wd_deg\":90,\"wd\":\"SE\",\"wd_to\":\"N\",\"ws\":15.3,\"hu\":70,\"vs\":54"
+    "47,\"vs_text\":\"< 10 km\",\"time_index\":\"13-14\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\"
+    "/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/hujan petir-am.svg\",\"utc_datetime\":\"2025-01-21 09:00:00\""
+    ",\"local_datetime\":\"2025-01-21 16:00:00\"},{\"datetime\":\"2025-01-21T12:00:00Z\",\"t\":29,\"tcc\":17,\"tp\":0.8"
+    ",\"weather\":3,\"weather_desc\":\"Berawan\",\"weather_desc_en\":\"Mostly Cloudy\",\"wd_deg\":105,\"wd\":\"W\",\"wd_to"
+    "\":\"NW\",\"ws\":7.6,\"hu\":81,\"vs\":5850,\"vs_text\":\"> 9 km\",\"time_index\":\"14-15\",\"analysis_date\":\"2025-01-2"
+    "0T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/berawan-pm.svg\",\"utc_datet"
+    "ime\":\"2025-01-21 12:00:00\",\"local_datetime\":\"2025-01-21 19:00:00\"},{\"datetime\":\"2025-01-21T15:00:00Z"
+    "\",\"t\":24,\"tcc\":31,\"tp\":2.3,\"weather\":61,\"weather_desc\":\"Hujan Ringan\",\"weather_desc_en\":\"Light Rain\""
+    ",\"wd_deg\":252,\"wd\":\"SW\",\"wd_to\":\"E\",\"ws\":11.3,\"hu\":68,\"vs\":9529,\"vs_text\":\"< 10 km\",\"time_index\":\"15"
+    "-16\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cu"
+    "aca\\/hujan ringan-pm.svg\",\"utc_datetime\":\"2025-01-21 15:00:00\",\"local_datetime\":\"2025-01-21 22:00:00"
+    "\"}],[{\"datetime\":\"2025-01-21T18:00:00Z\",\"t\":28,\"tcc\":5,\"tp\":7.4,\"weather\":2,\"weather_desc\":\"Cerah Be"
+    "rawan\",\"weather_desc_en\":\"Partly Cloudy\",\"wd_deg\":83,\"wd\":\"N\",\"wd_to\":\"NE\",\"ws\":11.8,\"hu\":79,\"vs\":90"
+    "36,\"vs_text\":\"> 9 km\",\"time_index\":\"16-17\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/"
+    "api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/cerah berawan-pm.svg\",\"utc_datetime\":\"2025-01-21 18:00:00"
+    "\",\"local_datetime\":\"2025-01-22 01:00:00\"},{\"datetime\":\"2025-01-21T21:00:00Z\",\"t\":28,\"tcc\":11,\"tp\":5."
+    "7,\"weather\":1,\"weather_desc\":\"Cerah\",\"weather_desc_en\":\"Sunny\",\"wd_deg\":334,\"wd\":\"NW\",\"wd_to\":\"S\",\"w"
+    "s\":12.7,\"hu\":82,\"vs\":6747,\"vs_text\":\"< 10 km\",\"time_index\":\"17-18\",\"analysis_date\":\"2025-01-20T00:00"
+    ":00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/cerah-pm.svg\",\"utc_datetime\":\"202"
+    "5-01-21 21:00:00\",\"local_datetime\":\"2025-01-22 04:00:00\"},{\"datetime\":\"2025-01-22T00:00:00Z\",\"t\":29,"
+    "\"tcc\":77,\"tp\":8.4,\"weather\":3,\"weather_desc\":\"Berawan\",\"weather_desc_en\":\"Mostly Cloudy\",\"wd_deg\":93"
+    ",\"wd\":\"E\",\"wd_to\":\"SE\",\"ws\":12.8,\"hu\":89,\"vs\":8070,\"vs_text\":\"> 9 km\",\"time_index\":\"18-19\",\"analysis"
+    "_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/berawan-a"
+    "m.svg\",\"utc_datetime\":\"2025-01-22 00:00:00\",\"local_datetime\":\"2025-01-22 07:00:00\"},{\"datetime\":\"202"
+    "5-01-22T03:00:00Z\",\"t\":31,\"tcc\":26,\"tp\":1.1,\"weather\":95,\"weather_desc\":\"Hujan Petir\",\"weather_desc_"
+    "en\":\"Thunderstorm\",\"wd_deg\":128,\"wd\":\"NE\",\"wd_to\":\"W\",\"ws\":6.9,\"hu\":60,\"vs\":9885,\"vs_text\":\"< 10 km\""
+    ",\"time_index\":\"19-20\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/"
+    "storage\\/icon\\/cuaca\\/hujan petir-am.svg\",\"utc_datetime\":\"2025-01-22 03:00:00\",\"local_datetime\":\"202"
+    "5-01-22 10:00:00\"},{\"datetime\":\"2025-01-22T06:00:00Z\",\"t\":31,\"tcc\":86,\"tp\":11.0,\"weather\":63,\"weathe"
+    "r_desc\":\"Hujan Sedang\",\"weather_desc_en\":\"Rain\",\"wd_deg\":263,\"wd\":\"S\",\"wd_to\":\"SW\",\"ws\":4.6,\"hu\":75,"
+    "\"vs\":8536,\"vs_text\":\"> 9 km\",\"time_index\":\"20-21\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"htt"
+    "ps:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/hujan sedang-am.svg\",\"utc_datetime\":\"2025-01-22 06"
+    ":00:00\",\"local_datetime\":\"2025-01-22 13:00:00\"},{\"datetime\":\"2025-01-22T09:00:00Z\",\"t\":29,\"tcc\":37,\""
+    "tp\":11.7,\"weather\":1,\"weather_desc\":\"Cerah\",\"weather_desc_en\":\"Sunny\",\"wd_deg\":338,\"wd\":\"SE\",\"wd_to\""
+    ":\"N\",\"ws\":15.1,\"hu\":70,\"vs\":5343,\"vs_text\":\"< 10 km\",\"time_index\":\"21-22\",\"analysis_date\":\"2025-01-2"
+    "0T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/cerah-am.svg\",\"utc_datetim"
+    "e\":\"2025-01-22 09:00:00\",\"local_datetime\":\"2025-01-22 16:00:00\"},{\"datetime\":\"2025-01-22T12:00:00Z\","
+    "\"t\":27,\"tcc\":57,\"tp\":9.6,\"weather\":63,\"weather_desc\":\"Hujan Sedang\",\"weather_desc_en\":\"Rain\",\"wd_deg"
+    "\":353,\"wd\":\"W\",\"wd_to\":\"NW\",\"ws\":15.0,\"hu\":85,\"vs\":8498,\"vs_text\":\"> 9 km\",\"time_index\":\"22-23\",\"ana"
+    "lysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg.go.id\\/storage\\/icon\\/cuaca\\/huja"
+    "n sedang-pm.svg\",\"utc_datetime\":\"2025-01-22 12:00:00\",\"local_datetime\":\"2025-01-22 19:00:00\"},{\"date"
+    "time\":\"2025-01-22T15:00:00Z\",\"t\":29,\"tcc\":2,\"tp\":3.9,\"weather\":61,\"weather_desc\":\"Hujan Ringan\",\"wea"
+    "ther_desc_en\":\"Light Rain\",\"wd_deg\":140,\"wd\":\"SW\",\"wd_to\":\"E\",\"ws\":8.9,\"hu\":80,\"vs\":5897,\"vs_text\":\""
+    "< 10 km\",\"time_index\":\"23-24\",\"analysis_date\":\"2025-01-20T00:00:00\",\"image\":\"https:\\/\\/api-apps.bmkg"
+    ".go.id\\/storage\\/icon\\/cuaca\\/hujan ringan-pm.svg\",\"utc_datetime\":\"2025-01-22 15:00:00\",\"local_datet"
+    "ime\":\"2025-01-22 22:00:00\"}]]}]}";
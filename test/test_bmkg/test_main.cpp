@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "app/network/BmkgForecastReader.h"
+#include "bmkg_fixture.h"
+
+using Services::BmkgForecastReader;
+using Services::BmkgPeriod;
+
+// Every operator new, so a parse that allocates anything shows up
+static size_t newCalls = 0;
+static size_t newBytes = 0;
+void* operator new(size_t size) {
+    newCalls++;
+    newBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static const size_t FIXTURE_PERIODS = 21;
+static const uint32_t WIB_OFFSET = 7 * 3600;
+
+static std::vector<BmkgPeriod> periods;
+
+static void collect(const BmkgPeriod& period, void* arg) {
+    static_cast<std::vector<BmkgPeriod>*>(arg)->push_back(period);
+}
+
+// The body in pieces of the given size, as writeToStream() hands it over
+static void feed(BmkgForecastReader& reader, const char* body, size_t len, size_t piece) {
+    for (size_t pos = 0; pos < len; pos += piece) {
+        reader.write((const uint8_t*)body + pos, std::min(piece, len - pos));
+    }
+}
+
+void setUp() {
+    periods.clear();
+    periods.reserve(64);
+}
+
+void tearDown() {}
+
+void test_fixture_periods_and_location() {
+    BmkgForecastReader reader(collect, &periods);
+    feed(reader, BMKG_FIXTURE, strlen(BMKG_FIXTURE), 1460);
+
+    TEST_ASSERT_TRUE(reader.ok());
+    TEST_ASSERT_EQUAL(strlen(BMKG_FIXTURE), reader.bytes());
+    TEST_ASSERT_EQUAL(FIXTURE_PERIODS, reader.periods());
+    TEST_ASSERT_EQUAL(FIXTURE_PERIODS, periods.size());
+
+    TEST_ASSERT_TRUE(reader.hasLocation());
+    TEST_ASSERT_EQUAL_STRING("DKI Jakarta", reader.location().provinsi);
+    TEST_ASSERT_EQUAL_STRING("Kota Adm. Jakarta Pusat", reader.location().kotkab);
+    TEST_ASSERT_EQUAL_STRING("Kemayoran", reader.location().kecamatan);
+    TEST_ASSERT_EQUAL_STRING("Gunung Sahari Selatan", reader.location().desa);
+    TEST_ASSERT_EQUAL_STRING("Asia/Jakarta", reader.location().timezone);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 106.8403f, reader.location().longitude);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, -6.1664f, reader.location().latitude);
+
+    const BmkgPeriod& first = reader.first();
+    TEST_ASSERT_EQUAL(BmkgForecastReader::parseDatetime("2025-01-20T03:00:00Z"), first.time);
+    TEST_ASSERT_EQUAL_STRING("2025-01-20 10:00:00", first.localDatetime);
+    // Escaped slashes come out plain
+    TEST_ASSERT_EQUAL_STRING("https://api-apps.bmkg.go.id/storage/icon/cuaca/cerah-am.svg", first.image);
+    TEST_ASSERT_EQUAL_STRING("Cerah", first.description);
+}
+
+void test_periods_are_three_hours_apart_and_local_time_is_wib() {
+    BmkgForecastReader reader(collect, &periods);
+    feed(reader, BMKG_FIXTURE, strlen(BMKG_FIXTURE), 536);
+    TEST_ASSERT_EQUAL(FIXTURE_PERIODS, periods.size());
+    for (size_t i = 0; i < periods.size(); i++) {
+        const BmkgPeriod& p = periods[i];
+        if (i > 0) TEST_ASSERT_EQUAL(3 * 3600, p.time - periods[i - 1].time);
+        // "datetime" is UTC, "local_datetime" the same instant in the location's zone
+        TEST_ASSERT_EQUAL(WIB_OFFSET, BmkgForecastReader::parseDatetime(p.localDatetime) - p.time);
+        TEST_ASSERT_GREATER_OR_EQUAL(24, p.temperature);
+        TEST_ASSERT_LESS_OR_EQUAL(32, p.temperature);
+        TEST_ASSERT_GREATER_OR_EQUAL(60, p.humidity);
+        TEST_ASSERT_NOT_EQUAL(0, p.weatherCode);
+        TEST_ASSERT_NOT_EQUAL(0, strlen(p.windDirection));
+        TEST_ASSERT_NOT_EQUAL(0, strlen(p.description));
+    }
+}
+
+void test_piece_size_does_not_matter() {
+    std::vector<BmkgPeriod> whole;
+    BmkgForecastReader reference(collect, &whole);
+    feed(reference, BMKG_FIXTURE, strlen(BMKG_FIXTURE), strlen(BMKG_FIXTURE));
+    for (size_t piece : {1, 2, 7, 64, 1460}) {
+        periods.clear();
+        BmkgForecastReader reader(collect, &periods);
+        feed(reader, BMKG_FIXTURE, strlen(BMKG_FIXTURE), piece);
+        TEST_ASSERT_TRUE(reader.ok());
+        TEST_ASSERT_EQUAL(whole.size(), periods.size());
+        TEST_ASSERT_EQUAL_MEMORY(whole.data(), periods.data(), whole.size() * sizeof(BmkgPeriod));
+    }
+}
+
+void test_truncated_body_is_not_ok() {
+    size_t len = strlen(BMKG_FIXTURE);
+    BmkgForecastReader reader;
+    for (size_t cut = 0; cut < len; cut++) {
+        reader.reset();
+        feed(reader, BMKG_FIXTURE, cut, 1460);
+        TEST_ASSERT_FALSE(reader.ok());
+    }
+    reader.reset();
+    feed(reader, BMKG_FIXTURE, len, 1460);
+    TEST_ASSERT_TRUE(reader.ok());
+}
+
+void test_content_after_the_document_is_not_ok() {
+    BmkgForecastReader reader;
+    feed(reader, BMKG_FIXTURE, strlen(BMKG_FIXTURE), 1460);
+    feed(reader, "{}", 2, 2);
+    TEST_ASSERT_FALSE(reader.ok());
+}
+
+/**
+ * Parse time and allocations over the fixture in network-sized pieces
+ */
+void bench_parse() {
+    size_t len = strlen(BMKG_FIXTURE);
+    char line[160];
+    snprintf(line, sizeof(line), "reader %zu bytes, fixture %zu bytes, %zu periods", sizeof(BmkgForecastReader), len, FIXTURE_PERIODS);
+    TEST_MESSAGE(line);
+    for (size_t piece : {1, 536, 1460}) {
+        const int reps = 2000;
+        size_t callsBefore = newCalls;
+        size_t bytesBefore = newBytes;
+        size_t heapBefore = HostHeap::allocations();
+        size_t found = 0;
+        double start = Bench::seconds();
+        for (int i = 0; i < reps; i++) {
+            BmkgForecastReader reader;
+            feed(reader, BMKG_FIXTURE, len, piece);
+            found += reader.periods();
+            Bench::keep(reader);
+        }
+        double seconds = Bench::seconds() - start;
+        size_t calls = newCalls - callsBefore + HostHeap::allocations() - heapBefore;
+        snprintf(line, sizeof(line), "%4zu B pieces: %7.1f us/response, %6.1f MB/s, %zu allocations (%zu bytes)",
+            piece, seconds * 1e6 / reps, reps * (double)len / seconds / 1e6, calls, newBytes - bytesBefore);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_EQUAL(reps * FIXTURE_PERIODS, found);
+        TEST_ASSERT_EQUAL(0, calls);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fixture_periods_and_location);
+    RUN_TEST(test_periods_are_three_hours_apart_and_local_time_is_wib);
+    RUN_TEST(test_piece_size_does_not_matter);
+    RUN_TEST(test_truncated_body_is_not_ok);
+    RUN_TEST(test_content_after_the_document_is_not_ok);
+    RUN_TEST(bench_parse);
+    return UNITY_END();
+}
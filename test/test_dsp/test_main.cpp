@@ -0,0 +1,191 @@
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "bench.h"
+#include "app/audio/dsp.h"
+
+static std::vector<int16_t> noise(size_t samples, uint32_t seed = 1) {
+    std::vector<int16_t> pcm(samples);
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        pcm[i] = (int16_t)(seed >> 16);
+    }
+    return pcm;
+}
+
+static int16_t reference(int16_t sample, float gain) {
+    float value = roundf(sample * gain);
+    return (int16_t)std::max(-32768.0f, std::min(32767.0f, value));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_gain_representation() {
+    AudioDsp::Gain half = AudioDsp::gain(0.5f);
+    TEST_ASSERT_EQUAL(16384, half.mul);
+    TEST_ASSERT_EQUAL(15, half.shift);
+
+    AudioDsp::Gain mic = AudioDsp::gain(15.0f);
+    TEST_ASSERT_EQUAL(30720, mic.mul);
+    TEST_ASSERT_EQUAL(11, mic.shift);
+
+    AudioDsp::Gain recorder = AudioDsp::gain(30.0f);
+    TEST_ASSERT_EQUAL(30720, recorder.mul);
+    TEST_ASSERT_EQUAL(10, recorder.shift);
+
+    TEST_ASSERT_TRUE(AudioDsp::isUnity(AudioDsp::gain(1.0f)));
+    TEST_ASSERT_EQUAL(0, AudioDsp::gain(0.0f).mul);
+    TEST_ASSERT_EQUAL(0, AudioDsp::gain(-1.0f).mul);
+}
+
+void test_apply_gain_matches_float() {
+    const float gains[] = {0.0f, 0.1f, 0.5f, 0.7071f, 0.999f, 1.0f, 1.5f, 2.0f, 15.0f, 30.0f};
+    std::vector<int16_t> in = noise(4096);
+    std::vector<int16_t> out(in.size());
+    for (float value : gains) {
+        AudioDsp::Gain g = AudioDsp::gain(value);
+        float exact = (float)g.mul / (float)(1 << g.shift);
+        AudioDsp::applyGain(in.data(), out.data(), in.size(), g);
+        for (size_t i = 0; i < in.size(); i++) {
+            TEST_ASSERT_INT_WITHIN(1, reference(in[i], exact), out[i]);
+        }
+    }
+}
+
+void test_apply_gain_saturates() {
+    int16_t pcm[] = {32767, -32768, 3000, -3000, 2184, -2185};
+    AudioDsp::applyGain(pcm, pcm, 6, AudioDsp::gain(15.0f));
+    TEST_ASSERT_EQUAL(32767, pcm[0]);
+    TEST_ASSERT_EQUAL(-32768, pcm[1]);
+    TEST_ASSERT_EQUAL(32767, pcm[2]);
+    TEST_ASSERT_EQUAL(-32768, pcm[3]);
+    TEST_ASSERT_EQUAL(32760, pcm[4]);
+    TEST_ASSERT_EQUAL(-32768, pcm[5]);
+}
+
+void test_apply_gain_in_place() {
+    std::vector<int16_t> in = noise(1000, 7);
+    std::vector<int16_t> copy = in;
+    std::vector<int16_t> out(in.size());
+    AudioDsp::Gain g = AudioDsp::gain(0.3f);
+    AudioDsp::applyGain(in.data(), out.data(), in.size(), g);
+    AudioDsp::applyGain(copy.data(), copy.data(), copy.size(), g);
+    TEST_ASSERT_EQUAL_MEMORY(out.data(), copy.data(), out.size() * sizeof(int16_t));
+}
+
+void test_mix_saturates() {
+    int16_t dst[] = {30000, -30000, 100, 0};
+    const int16_t src[] = {10000, -10000, 200, 32767};
+    AudioDsp::mix(dst, src, 4, AudioDsp::gain(1.0f));
+    TEST_ASSERT_EQUAL(32767, dst[0]);
+    TEST_ASSERT_EQUAL(-32768, dst[1]);
+    TEST_ASSERT_EQUAL(300, dst[2]);
+    TEST_ASSERT_EQUAL(32767, dst[3]);
+
+    int16_t quiet[] = {1000};
+    const int16_t loud[] = {4000};
+    AudioDsp::mix(quiet, loud, 1, AudioDsp::gain(0.25f));
+    TEST_ASSERT_EQUAL(2000, quiet[0]);
+}
+
+void test_stereo_to_mono() {
+    const int16_t stereo[] = {100, 300, -32768, -32768, 32767, 32767, 1, -2};
+    int16_t mono[4];
+    TEST_ASSERT_EQUAL(4, AudioDsp::stereoToMono(stereo, mono, 4));
+    TEST_ASSERT_EQUAL(200, mono[0]);
+    TEST_ASSERT_EQUAL(-32768, mono[1]);
+    TEST_ASSERT_EQUAL(32767, mono[2]);
+    TEST_ASSERT_EQUAL(-1, mono[3]);
+}
+
+void test_int32_round_trip() {
+    std::vector<int16_t> in = noise(512, 3);
+    std::vector<int32_t> wide(in.size());
+    std::vector<int16_t> back(in.size());
+    AudioDsp::toInt32(in.data(), wide.data(), in.size());
+    TEST_ASSERT_EQUAL((int32_t)in[5] << 16, wide[5]);
+    AudioDsp::toInt16(wide.data(), back.data(), back.size());
+    TEST_ASSERT_EQUAL_MEMORY(in.data(), back.data(), in.size() * sizeof(int16_t));
+
+    const int32_t loud[] = {INT32_MAX, INT32_MIN, 0x00018000};
+    int16_t narrow[3];
+    AudioDsp::toInt16(loud, narrow, 3);
+    TEST_ASSERT_EQUAL(32767, narrow[0]);
+    TEST_ASSERT_EQUAL(-32768, narrow[1]);
+    TEST_ASSERT_EQUAL(2, narrow[2]);
+}
+
+// What the gain loops did before the kernels: float multiply and clamp per sample
+static void floatGain(const int16_t* in, int16_t* out, size_t samples, float gain) {
+    for (size_t i = 0; i < samples; i++) {
+        float value = in[i] * gain;
+        if (value > 32767.0f) value = 32767.0f;
+        else if (value < -32768.0f) value = -32768.0f;
+        out[i] = (int16_t)value;
+    }
+}
+
+template<typename Fn>
+static double cyclesPerSample(size_t samples, Fn fn) {
+    const int rounds = 200;
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < rounds; i++) {
+        uint64_t start = Bench::cycles();
+        fn();
+        best = std::min(best, Bench::cycles() - start);
+    }
+    return (double)best / samples;
+}
+
+static void report(const char* name, double cycles) {
+    char line[96];
+    snprintf(line, sizeof(line), "%-24s %6.2f cycles/sample", name, cycles);
+    TEST_MESSAGE(line);
+}
+
+void bench_cycles_per_sample() {
+    const size_t samples = 4096;
+    std::vector<int16_t> in = noise(samples);
+    std::vector<int16_t> out(samples);
+    std::vector<int16_t> stereo = noise(samples * 2, 5);
+    AudioDsp::Gain q15 = AudioDsp::gain(0.5f);
+    AudioDsp::Gain mic = AudioDsp::gain(15.0f);
+
+    report("float gain 0.5", cyclesPerSample(samples, [&] { floatGain(in.data(), out.data(), samples, 0.5f); Bench::keep(out[0]); }));
+    report("applyGain 0.5 (Q15)", cyclesPerSample(samples, [&] { AudioDsp::applyGain(in.data(), out.data(), samples, q15); Bench::keep(out[0]); }));
+    report("float gain 15", cyclesPerSample(samples, [&] { floatGain(in.data(), out.data(), samples, 15.0f); Bench::keep(out[0]); }));
+    report("applyGain 15", cyclesPerSample(samples, [&] { AudioDsp::applyGain(in.data(), out.data(), samples, mic); Bench::keep(out[0]); }));
+    report("mix 0.5", cyclesPerSample(samples, [&] { AudioDsp::mix(out.data(), in.data(), samples, q15); Bench::keep(out[0]); }));
+    report("stereoToMono", cyclesPerSample(samples, [&] { AudioDsp::stereoToMono(stereo.data(), out.data(), samples); Bench::keep(out[0]); }));
+
+    // The 32-bit conversions against copying the same bytes
+    std::vector<int32_t> wide(samples);
+    std::vector<int32_t> copy(samples);
+    AudioDsp::toInt32(in.data(), wide.data(), samples);
+    report("memcpy int32", cyclesPerSample(samples, [&] { memcpy(copy.data(), wide.data(), samples * sizeof(int32_t)); Bench::keep(copy[0]); }));
+    report("toInt32", cyclesPerSample(samples, [&] { AudioDsp::toInt32(in.data(), copy.data(), samples); Bench::keep(copy[0]); }));
+    report("toInt32 in place +refill", cyclesPerSample(samples, [&] {
+        int16_t* narrow = (int16_t*)copy.data();
+        memcpy(narrow, in.data(), samples * sizeof(int16_t));
+        AudioDsp::toInt32(narrow, copy.data(), samples);
+        Bench::keep(copy[0]);
+    }));
+    report("toInt16", cyclesPerSample(samples, [&] { AudioDsp::toInt16(wide.data(), out.data(), samples); Bench::keep(out[0]); }));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_gain_representation);
+    RUN_TEST(test_apply_gain_matches_float);
+    RUN_TEST(test_apply_gain_saturates);
+    RUN_TEST(test_apply_gain_in_place);
+    RUN_TEST(test_mix_saturates);
+    RUN_TEST(test_stereo_to_mono);
+    RUN_TEST(test_int32_round_trip);
+    RUN_TEST(bench_cycles_per_sample);
+    return UNITY_END();
+}
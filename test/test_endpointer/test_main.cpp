@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <vector>
+#include "fixtures.h"
+#include "app_config.h"
+#include "app/audio/endpointer.h"
+
+static const size_t AFE_FRAME = 512; // AFE fetch chunk, 32 ms at 16 kHz
+static const uint32_t RATE = 16000;
+
+Endpointer endpointer;
+
+struct Kept {
+    std::vector<int16_t> pcm;
+    size_t chunks = 0;
+};
+
+static void collect(const int16_t* samples, size_t count, void* arg) {
+    Kept* kept = static_cast<Kept*>(arg);
+    kept->pcm.insert(kept->pcm.end(), samples, samples + count);
+    kept->chunks++;
+}
+
+// Stands in for the AFE VAD: a frame is speech when most of it lies in a scripted segment
+static bool scriptedVad(const std::vector<Fixtures::Segment>& segments, size_t start, size_t count) {
+    size_t overlap = 0;
+    for (const Fixtures::Segment& segment : segments) {
+        size_t from = std::max(start, segment.start);
+        size_t to = std::min(start + count, segment.end);
+        if (to > from) overlap += to - from;
+    }
+    return overlap * 2 > count;
+}
+
+struct Replay {
+    Kept kept;
+    size_t frames = 0;
+    size_t endedAt = 0;   // Samples read when the endpointer ended, 0 if it never did
+};
+
+// Feeds a WAV fixture frame by frame as microphoneTask does and stops where it would
+static Replay replay(const Fixtures::Clip& clip, const std::vector<Fixtures::Segment>& segments, bool useVad = true, size_t frame = AFE_FRAME) {
+    Replay result;
+    endpointer.reset();
+    for (size_t pos = 0; pos < clip.pcm.size(); pos += frame) {
+        size_t count = std::min(frame, clip.pcm.size() - pos);
+        // Without the AFE tap every frame counts as speech
+        bool speech = useVad ? scriptedVad(segments, pos, count) : true;
+        result.frames++;
+        if (endpointer.process(clip.pcm.data() + pos, count, speech, collect, &result.kept) == ENDPOINT_STATE_END) {
+            result.endedAt = pos + count;
+            break;
+        }
+    }
+    return result;
+}
+
+static inline size_t ms(uint32_t value) { return (size_t)value * RATE / 1000; }
+
+void setUp() {
+    TEST_ASSERT_TRUE(endpointer.init({RATE, REC_ENDPOINT_HANGOVER_MS, REC_ENDPOINT_PRE_PAD_MS, REC_ENDPOINT_POST_PAD_MS, REC_ENDPOINT_NO_SPEECH_MS}));
+}
+
+void tearDown() {}
+
+void test_trims_silence_and_stops_after_speech() {
+    Fixtures::Script script(RATE);
+    script.silence(1500).speech(1200).silence(700).speech(1500).silence(3000);
+    Fixtures::Clip clip = script.wav();
+    Fixtures::dump("endpointer_two_utterances", clip);
+    const std::vector<Fixtures::Segment>& segments = script.segments();
+
+    Replay result = replay(clip, segments);
+    Fixtures::dump("endpointer_two_utterances_kept", Fixtures::Clip{RATE, result.kept.pcm});
+
+    // Capture ends one hangover after the speech, rounded up to the frame
+    TEST_ASSERT_NOT_EQUAL(0, result.endedAt);
+    size_t stopDelay = result.endedAt - segments[1].end;
+    TEST_ASSERT_GREATER_OR_EQUAL(ms(REC_ENDPOINT_HANGOVER_MS) - AFE_FRAME, stopDelay);
+    TEST_ASSERT_LESS_OR_EQUAL(ms(REC_ENDPOINT_HANGOVER_MS) + AFE_FRAME, stopDelay);
+
+    // Speech plus at most the padding around each utterance
+    size_t speech = (segments[0].end - segments[0].start) + (segments[1].end - segments[1].start);
+    size_t padding = 2 * (ms(REC_ENDPOINT_PRE_PAD_MS) + ms(REC_ENDPOINT_POST_PAD_MS));
+    TEST_ASSERT_GREATER_OR_EQUAL(speech, result.kept.pcm.size());
+    TEST_ASSERT_LESS_OR_EQUAL(speech + padding + 2 * AFE_FRAME, result.kept.pcm.size());
+    TEST_ASSERT_EQUAL(result.kept.pcm.size(), endpointer.keptSamples());
+
+    char line[128];
+    snprintf(line, sizeof(line), "kept %.2f of %.2f s, stopped %lu ms after speech instead of %lu ms",
+        (double)result.kept.pcm.size() / RATE, clip.seconds(),
+        (unsigned long)(stopDelay * 1000 / RATE), (unsigned long)((clip.pcm.size() - segments[1].end) * 1000 / RATE));
+    TEST_MESSAGE(line);
+}
+
+void test_kept_audio_is_the_recording_in_order() {
+    Fixtures::Script script(RATE, 7);
+    script.silence(800).speech(900).silence(400).speech(600).silence(2000);
+    Fixtures::Clip clip = script.wav();
+    Replay result = replay(clip, script.segments());
+
+    // Every kept sample comes from the recording, in order, and each utterance is whole
+    size_t pos = 0;
+    for (int16_t sample : result.kept.pcm) {
+        while (pos < clip.pcm.size() && clip.pcm[pos] != sample) pos++;
+        TEST_ASSERT_LESS_THAN(clip.pcm.size(), pos);
+        pos++;
+    }
+    for (const Fixtures::Segment& segment : script.segments()) {
+        auto found = std::search(result.kept.pcm.begin(), result.kept.pcm.end(),
+            clip.pcm.begin() + segment.start + AFE_FRAME, clip.pcm.begin() + segment.end - AFE_FRAME);
+        TEST_ASSERT_TRUE(found != result.kept.pcm.end());
+    }
+}
+
+void test_frame_size_does_not_change_output() {
+    Fixtures::Script script(RATE, 3);
+    script.silence(1000).speech(1000).silence(1500);
+    Fixtures::Clip clip = script.wav();
+
+    // The VAD decides per 512-sample frame, the endpointer may be fed in smaller reads
+    Replay whole = replay(clip, script.segments());
+    Kept split;
+    endpointer.reset();
+    for (size_t pos = 0; pos < clip.pcm.size(); pos += AFE_FRAME) {
+        size_t count = std::min(AFE_FRAME, clip.pcm.size() - pos);
+        bool speech = scriptedVad(script.segments(), pos, count);
+        ENDPOINT_STATE state = ENDPOINT_STATE_WAITING;
+        for (size_t part = 0; part < count; part += 160) {
+            state = endpointer.process(clip.pcm.data() + pos + part, std::min<size_t>(160, count - part), speech, collect, &split);
+        }
+        if (state == ENDPOINT_STATE_END) break;
+    }
+    TEST_ASSERT_EQUAL(whole.kept.pcm.size(), split.pcm.size());
+    TEST_ASSERT_EQUAL_MEMORY(whole.kept.pcm.data(), split.pcm.data(), split.pcm.size() * sizeof(int16_t));
+}
+
+void test_no_speech_gives_up() {
+    Fixtures::Script script(RATE);
+    script.silence(REC_ENDPOINT_NO_SPEECH_MS + 2000, 300);
+    Fixtures::Clip clip = script.wav();
+
+    Replay result = replay(clip, script.segments());
+    TEST_ASSERT_EQUAL(0, result.kept.pcm.size());
+    TEST_ASSERT_FALSE(endpointer.heardSpeech());
+    TEST_ASSERT_GREATER_OR_EQUAL(ms(REC_ENDPOINT_NO_SPEECH_MS), result.endedAt);
+    TEST_ASSERT_LESS_OR_EQUAL(ms(REC_ENDPOINT_NO_SPEECH_MS) + AFE_FRAME, result.endedAt);
+}
+
+void test_without_vad_everything_is_kept() {
+    // The raw ring fallback has no per-frame VAD, nothing may be trimmed or ended
+    Fixtures::Script script(RATE, 5);
+    script.silence(1500).speech(1000).silence(REC_ENDPOINT_NO_SPEECH_MS);
+    Fixtures::Clip clip = script.wav();
+
+    Replay result = replay(clip, script.segments(), false);
+    TEST_ASSERT_EQUAL(0, result.endedAt);
+    TEST_ASSERT_EQUAL(clip.pcm.size(), result.kept.pcm.size());
+    TEST_ASSERT_EQUAL_MEMORY(clip.pcm.data(), result.kept.pcm.data(), clip.pcm.size() * sizeof(int16_t));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_trims_silence_and_stops_after_speech);
+    RUN_TEST(test_kept_audio_is_the_recording_in_order);
+    RUN_TEST(test_frame_size_does_not_change_output);
+    RUN_TEST(test_no_speech_gives_up);
+    RUN_TEST(test_without_vad_everything_is_kept);
+    return UNITY_END();
+}
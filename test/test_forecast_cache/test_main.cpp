@@ -0,0 +1,256 @@
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "app/network/WeatherForecastCache.h"
+
+using namespace Services;
+
+static const char* PATH = "/cache/weather_forecast.bin";
+static const uint32_t PERIOD = 3 * 3600;
+static const uint32_t WIB = 7 * 3600;
+static const uint32_t T0 = 1737342000; // 2025-01-20 03:00 UTC, 10:00 WIB
+
+static FS* flash = nullptr;
+
+static BmkgLocation location() {
+    BmkgLocation l = {};
+    strcpy(l.provinsi, "DKI Jakarta");
+    strcpy(l.kotkab, "Kota Adm. Jakarta Pusat");
+    strcpy(l.kecamatan, "Kemayoran");
+    strcpy(l.desa, "Gunung Sahari Selatan");
+    strcpy(l.timezone, "Asia/Jakarta");
+    l.longitude = 106.8403f;
+    l.latitude = -6.1664f;
+    return l;
+}
+
+static BmkgPeriod period(uint32_t time) {
+    BmkgPeriod p = {};
+    p.time = time;
+    p.temperature = 24 + (time / PERIOD) % 8;
+    p.humidity = 70 + (time / PERIOD) % 20;
+    p.windSpeed = 2.5f;
+    p.weatherCode = 3;
+    strcpy(p.windDirection, "W");
+    strcpy(p.description, "Berawan");
+    strcpy(p.image, "https://api-apps.bmkg.go.id/storage/icon/cuaca/berawan-am.svg");
+    time_t local = time + WIB;
+    strftime(p.localDatetime, sizeof(p.localDatetime), "%Y-%m-%d %H:%M:%S", gmtime(&local));
+    return p;
+}
+
+// What a fetch at now stores: count periods from the 3-hour slot holding now
+static bool fetch(WeatherForecastCache& cache, uint32_t now, size_t count) {
+    if (!cache.beginBuild()) return false;
+    uint32_t start = now / PERIOD * PERIOD;
+    for (size_t i = 0; i < count; i++) WeatherForecastCache::onPeriod(period(start + i * PERIOD), &cache);
+    return cache.commit(*flash, PATH, location(), now);
+}
+
+static std::vector<uint8_t> image() {
+    std::vector<uint8_t> bytes;
+    File file = flash->open(PATH, FILE_READ);
+    bytes.resize(file.size());
+    file.read(bytes.data(), bytes.size());
+    return bytes;
+}
+
+static void writeImage(const std::vector<uint8_t>& bytes) {
+    File file = flash->open(PATH, FILE_WRITE, true);
+    file.write(bytes.data(), bytes.size());
+    file.close();
+}
+
+void setUp() {
+    static char root[] = "/tmp/forecast_cacheXXXXXX";
+    static bool made = false;
+    if (!made) made = mkdtemp(root) != nullptr;
+    delete flash;
+    flash = new FS(root);
+    flash->remove(PATH);
+}
+
+void tearDown() {}
+
+void test_find_picks_the_period_covering_now() {
+    WeatherForecastCache cache;
+    TEST_ASSERT_EQUAL(-1, cache.find(T0));
+    TEST_ASSERT_TRUE(fetch(cache, T0, 4));
+    TEST_ASSERT_EQUAL(-1, cache.find(T0 - 1));
+    for (int slot = 0; slot < 4; slot++) {
+        TEST_ASSERT_EQUAL(slot, cache.find(T0 + slot * PERIOD));
+        TEST_ASSERT_EQUAL(slot, cache.find(T0 + slot * PERIOD + PERIOD / 2));
+        TEST_ASSERT_EQUAL(slot, cache.find(T0 + (slot + 1) * PERIOD - 1));
+    }
+    TEST_ASSERT_EQUAL(-1, cache.find(T0 + 4 * PERIOD));
+}
+
+void test_horizon_is_one_period_past_the_last_start() {
+    WeatherForecastCache cache;
+    TEST_ASSERT_EQUAL(0, cache.horizon());
+    TEST_ASSERT_TRUE(fetch(cache, T0 + 600, 21));
+    TEST_ASSERT_EQUAL(T0 + 20 * PERIOD, cache.periodStart(20));
+    TEST_ASSERT_EQUAL(T0 + 21 * PERIOD, cache.horizon());
+    TEST_ASSERT_EQUAL(20, cache.find(cache.horizon() - 1));
+    TEST_ASSERT_EQUAL(-1, cache.find(cache.horizon()));
+}
+
+void test_file_round_trips() {
+    WeatherForecastCache written;
+    TEST_ASSERT_TRUE(fetch(written, T0, 21));
+    TEST_ASSERT_EQUAL(WeatherForecastCache::fileSize(21), image().size());
+
+    WeatherForecastCache loaded;
+    TEST_ASSERT_TRUE(loaded.load(*flash, PATH));
+    TEST_ASSERT_EQUAL(21, loaded.header().count);
+    TEST_ASSERT_EQUAL(WIB, loaded.header().utcOffset);
+    TEST_ASSERT_EQUAL(T0, loaded.header().fetchedAt);
+    TEST_ASSERT_EQUAL_STRING("DKI Jakarta, Kota Adm. Jakarta Pusat, Kemayoran, Gunung Sahari Selatan", loaded.header().location);
+    TEST_ASSERT_EQUAL_STRING("https://api-apps.bmkg.go.id/storage/icon/cuaca/", loaded.header().iconBase);
+    TEST_ASSERT_EQUAL(written.horizon(), loaded.horizon());
+    for (int slot = 0; slot < 21; slot++) {
+        TEST_ASSERT_EQUAL(written.periodStart(slot), loaded.periodStart(slot));
+        TEST_ASSERT_EQUAL_MEMORY(written.record(slot), loaded.record(slot), sizeof(WeatherForecastRecord));
+    }
+    TEST_ASSERT_EQUAL_STRING("berawan-am.svg", loaded.record(0)->icon);
+}
+
+// A valid image changed by edit, load() must refuse it and leave nothing loaded
+static void assertRejected(const std::vector<uint8_t>& valid, void (*edit)(std::vector<uint8_t>&), const char* what) {
+    std::vector<uint8_t> bytes = valid;
+    edit(bytes);
+    writeImage(bytes);
+    WeatherForecastCache cache;
+    TEST_ASSERT_FALSE_MESSAGE(cache.load(*flash, PATH), what);
+    TEST_ASSERT_FALSE_MESSAGE(cache.loaded(), what);
+    TEST_ASSERT_EQUAL_MESSAGE(-1, cache.find(T0), what);
+}
+
+static WeatherForecastHeader& header(std::vector<uint8_t>& bytes) {
+    return *reinterpret_cast<WeatherForecastHeader*>(bytes.data());
+}
+
+void test_load_validates_size_version_and_count() {
+    WeatherForecastCache cache;
+    TEST_ASSERT_TRUE(fetch(cache, T0, 8));
+    std::vector<uint8_t> valid = image();
+
+    assertRejected(valid, [](std::vector<uint8_t>& b) { b.pop_back(); }, "short by a byte");
+    assertRejected(valid, [](std::vector<uint8_t>& b) { b.push_back(0); }, "a byte too long");
+    assertRejected(valid, [](std::vector<uint8_t>& b) { b.resize(sizeof(WeatherForecastHeader) - 1); }, "header cut");
+    assertRejected(valid, [](std::vector<uint8_t>& b) { b.clear(); }, "empty");
+    assertRejected(valid, [](std::vector<uint8_t>& b) { header(b).magic ^= 1; }, "magic");
+    assertRejected(valid, [](std::vector<uint8_t>& b) { header(b).version++; }, "version");
+    assertRejected(valid, [](std::vector<uint8_t>& b) { header(b).recordSize--; }, "record size");
+    assertRejected(valid, [](std::vector<uint8_t>& b) {
+        header(b).count = 0;
+        b.resize(WeatherForecastCache::fileSize(0));
+    }, "no periods");
+    assertRejected(valid, [](std::vector<uint8_t>& b) {
+        header(b).count = WEATHER_FORECAST_MAX_PERIODS + 1;
+        b.resize(WeatherForecastCache::fileSize(WEATHER_FORECAST_MAX_PERIODS + 1));
+    }, "more periods than fit");
+    assertRejected(valid, [](std::vector<uint8_t>& b) { header(b).count++; }, "count against size");
+
+    writeImage(valid);
+    TEST_ASSERT_TRUE(cache.load(*flash, PATH));
+    TEST_ASSERT_EQUAL(8, cache.header().count);
+}
+
+void test_missing_file_loads_nothing() {
+    WeatherForecastCache cache;
+    TEST_ASSERT_FALSE(cache.load(*flash, PATH));
+    TEST_ASSERT_FALSE(cache.loaded());
+}
+
+void test_fetch_without_commit_keeps_the_forecast() {
+    WeatherForecastCache cache;
+    TEST_ASSERT_TRUE(fetch(cache, T0, 4));
+    TEST_ASSERT_TRUE(cache.beginBuild());
+    WeatherForecastCache::onPeriod(period(T0 + 10 * PERIOD), &cache);
+    TEST_ASSERT_EQUAL(3, cache.find(T0 + 3 * PERIOD));
+    TEST_ASSERT_EQUAL(-1, cache.find(T0 + 10 * PERIOD));
+}
+
+struct Day {
+    size_t fetches;
+    size_t lookups;
+    uint32_t latestFetchMs; // Longest a fetch came after the horizon
+};
+
+/**
+ * getCurrentWeather() stepped through 24 hours a minute at a time
+ *
+ * A lookup answers from the period covering now and only fetches when
+ * find() has nothing, which must not happen before horizon(). Half way
+ * the device restarts and the cache comes back from the file.
+ */
+static void simulateDay(size_t periodsPerFetch, Day& day) {
+    flash->remove(PATH);
+    WeatherForecastCache* cache = new WeatherForecastCache();
+    day = {};
+    uint32_t start = T0 + 7 * 60; // 10:07 WIB
+    for (uint32_t now = start; now < start + 24 * 3600; now += 60) {
+        if (now == start + 12 * 3600) {
+            delete cache;
+            cache = new WeatherForecastCache();
+            TEST_ASSERT_TRUE(cache->load(*flash, PATH));
+        }
+        day.lookups++;
+        if (cache->find(now) >= 0) continue;
+        if (cache->loaded()) {
+            TEST_ASSERT_GREATER_OR_EQUAL(cache->horizon(), now);
+            if ((now - cache->horizon()) * 1000 > day.latestFetchMs) day.latestFetchMs = (now - cache->horizon()) * 1000;
+        }
+        TEST_ASSERT_TRUE(fetch(*cache, now, periodsPerFetch));
+        day.fetches++;
+    }
+    delete cache;
+}
+
+void bench_day_of_lookups() {
+    char line[128];
+    TEST_MESSAGE("periods/fetch  lookups  fetches  latest after horizon  (60 min expiry: 24 fetches)");
+    for (size_t count : {21, 8, 3, 1}) {
+        Day day;
+        simulateDay(count, day);
+        snprintf(line, sizeof(line), "%13zu  %7zu  %7zu  %17lu ms", count, day.lookups, day.fetches, (unsigned long)day.latestFetchMs);
+        TEST_MESSAGE(line);
+        // A fetch at most once per forecast span, plus the first one
+        TEST_ASSERT_LESS_OR_EQUAL(1 + 24 * 3600 / (count * PERIOD) + 1, day.fetches);
+        TEST_ASSERT_LESS_THAN(60 * 1000, day.latestFetchMs);
+    }
+}
+
+void bench_load() {
+    char line[128];
+    for (size_t count : {(size_t)8, (size_t)21, (size_t)WEATHER_FORECAST_MAX_PERIODS}) {
+        WeatherForecastCache written;
+        TEST_ASSERT_TRUE(fetch(written, T0, count));
+        const int reps = 2000;
+        WeatherForecastCache cache;
+        size_t readsBefore = flash->stats.reads;
+        double start = Bench::seconds();
+        for (int i = 0; i < reps; i++) TEST_ASSERT_TRUE(cache.load(*flash, PATH));
+        double seconds = Bench::seconds() - start;
+        snprintf(line, sizeof(line), "load %2zu periods: %5zu byte file, %zu reads, %6.1f us",
+            count, WeatherForecastCache::fileSize(count), (flash->stats.reads - readsBefore) / reps, seconds * 1e6 / reps);
+        TEST_MESSAGE(line);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_find_picks_the_period_covering_now);
+    RUN_TEST(test_horizon_is_one_period_past_the_last_start);
+    RUN_TEST(test_file_round_trips);
+    RUN_TEST(test_load_validates_size_version_and_count);
+    RUN_TEST(test_missing_file_loads_nothing);
+    RUN_TEST(test_fetch_without_commit_keeps_the_forecast);
+    RUN_TEST(bench_day_of_lookups);
+    RUN_TEST(bench_load);
+    return UNITY_END();
+}
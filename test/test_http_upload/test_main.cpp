@@ -0,0 +1,193 @@
+#include <unity.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "HttpStandIn.h"
+#include "app/network/CustomHttpClient.h"
+
+static const char* URL = "https://stt.local/v1/audio/transcriptions";
+static const char* TRANSCRIPT = "{\"text\":\"halo\"}";
+
+HttpsConnectionPool httpsPool;
+
+static HttpStandIn server;
+
+static uint8_t pattern(size_t i) { return (uint8_t)(i * 7 + 3); }
+
+/**
+ * Body that arrives over time, like SttUploadStream fed by the microphone
+ *
+ * Pieces become available at their simulated time. While nothing is there
+ * readBytes() blocks for up to the stream timeout, moving the clock to the
+ * next arrival; available() is -1 once everything was read after the end.
+ */
+class TimedBody : public Stream {
+public:
+    static const uint32_t NEVER = 0xFFFFFFFF;
+
+    size_t availableCalls = 0;
+    size_t readCalls = 0;
+    size_t emptyReads = 0; // readBytes() that timed out with nothing
+
+    void add(uint32_t at, size_t bytes) { _pieces.push_back({at, bytes}); _total += bytes; }
+    void endAt(uint32_t at) { _end = at; }
+    size_t total() const { return _total; }
+
+    int available() override {
+        availableCalls++;
+        size_t pending = arrived() - _read;
+        if (pending > 0) return pending;
+        return _read == _total && millis() >= _end ? -1 : 0;
+    }
+
+    size_t readBytes(char* buffer, size_t length) override {
+        readCalls++;
+        unsigned long start = millis();
+        while (true) {
+            size_t n = std::min(length, arrived() - _read);
+            if (n > 0) {
+                for (size_t i = 0; i < n; i++) buffer[i] = pattern(_read + i);
+                _read += n;
+                return n;
+            }
+            if (_read == _total && millis() >= _end) return 0;
+            if (millis() - start >= _timeout) {
+                emptyReads++;
+                return 0;
+            }
+            uint32_t wake = std::min<uint64_t>(std::min<uint64_t>(nextArrival(), _end), start + _timeout);
+            HostClock::set(std::max<uint32_t>(wake, millis() + 1));
+        }
+    }
+    using Stream::readBytes;
+
+    int read() override {
+        char c;
+        return readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+    }
+    int peek() override { return -1; }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    struct Piece {
+        uint32_t at;
+        size_t bytes;
+    };
+    std::vector<Piece> _pieces;
+    size_t _total = 0;
+    size_t _read = 0;
+    uint32_t _end = NEVER;
+
+    size_t arrived() const {
+        size_t n = 0;
+        for (const Piece& p : _pieces) if (p.at <= millis()) n += p.bytes;
+        return n;
+    }
+
+    uint32_t nextArrival() const {
+        for (const Piece& p : _pieces) if (p.at > millis()) return p.at;
+        return NEVER;
+    }
+};
+
+static bool bodyMatches(const std::string& body, size_t total) {
+    if (body.size() != total) return false;
+    for (size_t i = 0; i < total; i++) {
+        if ((uint8_t)body[i] != pattern(i)) return false;
+    }
+    return true;
+}
+
+// Open the request and put the stand-in on its connection
+static void open(CustomHttpClient& http) {
+    TEST_ASSERT_TRUE(http.beginPooled(URL));
+    server.attach(*NetworkClientSecure::last());
+}
+
+void setUp() {
+    HostClock::set(0);
+    server = HttpStandIn();
+    server.responseBody = TRANSCRIPT;
+}
+
+void tearDown() {}
+
+void test_chunked_upload_sleeps_between_pieces() {
+    // 20 ms of 16 kHz PCM every 20 ms for two seconds, then the end of speech
+    TimedBody body;
+    for (uint32_t at = 0; at < 2000; at += 20) body.add(at, 640);
+    body.endAt(2010);
+
+    CustomHttpClient http;
+    open(http);
+    http.setTimeout(15000);
+    int code = http.sendRequest("POST", &body, 0);
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, code);
+    TEST_ASSERT_EQUAL_STRING(TRANSCRIPT, http.getString().c_str());
+    http.end();
+
+    TEST_ASSERT_EQUAL(1, server.requests.size());
+    const HttpStandIn::Request& request = server.requests[0];
+    TEST_ASSERT_EQUAL_STRING("POST", request.method.c_str());
+    TEST_ASSERT_EQUAL_STRING("/v1/audio/transcriptions", request.path.c_str());
+    TEST_ASSERT_EQUAL_STRING("chunked", request.headers.at("transfer-encoding").c_str());
+    TEST_ASSERT_TRUE(request.framingOk);
+    TEST_ASSERT_EQUAL(100, request.chunks);
+    TEST_ASSERT_TRUE(bodyMatches(request.body, body.total()));
+
+    // One read per piece, where polling every millisecond would have looped about 2000 times
+    TEST_ASSERT_LESS_OR_EQUAL(102, body.readCalls);
+    TEST_ASSERT_LESS_OR_EQUAL(2 * body.readCalls + 2, body.availableCalls);
+    TEST_ASSERT_EQUAL(0, body.emptyReads);
+    TEST_ASSERT_INT_WITHIN(20, 2010, millis());
+}
+
+void test_stalled_body_fails_after_the_tcp_timeout() {
+    // A few pieces, then capture stops without finish()
+    TimedBody body;
+    for (uint32_t at = 0; at < 100; at += 20) body.add(at, 640);
+
+    CustomHttpClient http;
+    open(http);
+    http.setTimeout(3000);
+    int code = http.sendRequest("POST", &body, 0);
+    TEST_ASSERT_EQUAL(HTTPC_ERROR_SEND_PAYLOAD_FAILED, code);
+    // Noticed within one stream timeout of the deadline, not after an endless wait
+    TEST_ASSERT_GREATER_THAN(80 + 3000, millis());
+    TEST_ASSERT_LESS_OR_EQUAL(80 + 3000 + body.getTimeout(), millis());
+    TEST_ASSERT_LESS_OR_EQUAL(5, body.emptyReads);
+
+    // The request never completed and its connection is not handed out again
+    TEST_ASSERT_EQUAL(0, server.requests.size());
+    TEST_ASSERT_EQUAL(body.total(), server.partialBody());
+    TEST_ASSERT_FALSE(NetworkClientSecure::last()->connected());
+    http.end();
+}
+
+void test_sized_upload_waits_for_late_data() {
+    TimedBody body;
+    body.add(0, 1000);
+    body.add(500, 1000);
+    body.add(1500, 2000);
+
+    CustomHttpClient http;
+    open(http);
+    http.setTimeout(15000);
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, http.sendRequest("POST", &body, body.total()));
+    http.end();
+
+    TEST_ASSERT_EQUAL(1, server.requests.size());
+    const HttpStandIn::Request& request = server.requests[0];
+    TEST_ASSERT_EQUAL_STRING("4000", request.headers.at("content-length").c_str());
+    TEST_ASSERT_EQUAL(0, request.chunks);
+    TEST_ASSERT_TRUE(bodyMatches(request.body, body.total()));
+    TEST_ASSERT_EQUAL(1500, millis());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_chunked_upload_sleeps_between_pieces);
+    RUN_TEST(test_stalled_body_fails_after_the_tcp_timeout);
+    RUN_TEST(test_sized_upload_waits_for_late_data);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+#include <unity.h>
+#include <string>
+#include "HttpStandIn.h"
+#include "app/network/CustomHttpClient.h"
+
+static const char* WEATHER_URL = "https://api.bmkg.go.id/publik/prakiraan-cuaca?adm4=31.73.05.1001";
+static const char* STT_URL = "https://stt.local/v1/audio/transcriptions";
+
+HttpsConnectionPool httpsPool;
+
+static HttpStandIn server;
+
+// The connection a request runs on, to put the stand-in on it
+class PooledClient : public CustomHttpClient {
+public:
+    NetworkClientSecure* connection() { return _client; }
+};
+
+// One GET through the pool as WeatherService does it, the client left open for end()
+static int get(PooledClient& http, const char* url) {
+    if (!http.beginPooled(url)) return HTTPC_ERROR_CONNECTION_REFUSED;
+    server.attach(*http.connection());
+    int code = http.GET();
+    http.getString();
+    return code;
+}
+
+void setUp() {
+    httpsPool.closeIdle();
+    HostClock::set(0);
+    server = HttpStandIn();
+}
+
+void tearDown() {}
+
+void test_second_request_to_the_same_host_reuses_the_connection() {
+    HttpsPoolStats before = httpsPool.stats();
+
+    PooledClient first;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(first, WEATHER_URL));
+    NetworkClientSecure* connection = first.connection();
+    uint32_t connects = connection->connects;
+    first.end();
+    TEST_ASSERT_TRUE(connection->connected());
+
+    PooledClient second;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(second, WEATHER_URL));
+    TEST_ASSERT_TRUE(second.connection() == connection);
+    TEST_ASSERT_EQUAL(connects, connection->connects);
+    second.end();
+
+    // Both requests went out on one connection, asking to keep it
+    TEST_ASSERT_EQUAL(2, server.requests.size());
+    TEST_ASSERT_EQUAL(server.requests[0].connection, server.requests[1].connection);
+    TEST_ASSERT_EQUAL_STRING("keep-alive", server.requests[1].headers.at("connection").c_str());
+
+    HttpsPoolStats after = httpsPool.stats();
+    TEST_ASSERT_EQUAL(2, after.requests - before.requests);
+    TEST_ASSERT_EQUAL(1, after.reused - before.reused);
+    TEST_ASSERT_EQUAL(0, after.lastSetupMs);
+}
+
+void test_another_host_gets_its_own_connection() {
+    PooledClient weather;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(weather, WEATHER_URL));
+    NetworkClientSecure* weatherConnection = weather.connection();
+    weather.end();
+
+    PooledClient stt;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(stt, STT_URL));
+    TEST_ASSERT_TRUE(stt.connection() != weatherConnection);
+    stt.end();
+
+    // The first host's connection stayed open for it
+    TEST_ASSERT_TRUE(weatherConnection->connected());
+}
+
+void test_end_without_keep_alive_drops_the_connection() {
+    HttpsPoolStats before = httpsPool.stats();
+    server.keepAlive = false;
+
+    PooledClient first;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(first, WEATHER_URL));
+    NetworkClientSecure* connection = first.connection();
+    uint32_t connects = connection->connects;
+    first.end();
+    TEST_ASSERT_FALSE(connection->connected());
+
+    // The next request connects again instead of writing to a closed socket
+    server.keepAlive = true;
+    PooledClient second;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(second, WEATHER_URL));
+    TEST_ASSERT_EQUAL(connects + 1, second.connection()->connects);
+    second.end();
+
+    HttpsPoolStats after = httpsPool.stats();
+    TEST_ASSERT_EQUAL(2, after.requests - before.requests);
+    TEST_ASSERT_EQUAL(0, after.reused - before.reused);
+}
+
+void test_client_without_reuse_drops_the_connection() {
+    PooledClient http;
+    TEST_ASSERT_TRUE(http.beginPooled(WEATHER_URL));
+    http.setReuse(false);
+    server.attach(*http.connection());
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, http.GET());
+    http.getString();
+    NetworkClientSecure* connection = http.connection();
+    http.end();
+
+    TEST_ASSERT_EQUAL_STRING("close", server.requests[0].headers.at("connection").c_str());
+    TEST_ASSERT_FALSE(connection->connected());
+}
+
+void test_stale_or_idle_connections_are_not_reused() {
+    PooledClient first;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(first, WEATHER_URL));
+    NetworkClientSecure* connection = first.connection();
+    uint32_t connects = connection->connects;
+    first.end();
+
+    // A close alert waiting on the idle connection
+    const uint8_t alert[] = {0x15, 0x03, 0x03, 0x00, 0x02};
+    connection->receive(alert, sizeof(alert));
+    HttpsPoolStats before = httpsPool.stats();
+    PooledClient second;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(second, WEATHER_URL));
+    TEST_ASSERT_EQUAL(connects + 1, second.connection()->connects);
+    TEST_ASSERT_EQUAL(1, httpsPool.stats().evicted - before.evicted);
+    connects = second.connection()->connects;
+    second.end();
+
+    // Idle past HTTPS_POOL_IDLE_MS
+    HostClock::advance(HTTPS_POOL_IDLE_MS);
+    PooledClient third;
+    TEST_ASSERT_EQUAL(HTTP_CODE_OK, get(third, WEATHER_URL));
+    TEST_ASSERT_EQUAL(connects + 1, third.connection()->connects);
+    third.end();
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_second_request_to_the_same_host_reuses_the_connection);
+    RUN_TEST(test_another_host_gets_its_own_connection);
+    RUN_TEST(test_end_without_keep_alive_drops_the_connection);
+    RUN_TEST(test_client_without_reuse_drops_the_connection);
+    RUN_TEST(test_stale_or_idle_connections_are_not_reused);
+    return UNITY_END();
+}
@@ -0,0 +1,230 @@
+#include <unity.h>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "fixtures.h"
+#include "app/audio/mixer.h"
+
+static const uint32_t RATE = 16000;
+static const size_t BLOCK = AudioMixer::BLOCK_SAMPLES;
+
+// Same layout as Speaker::start()
+static const AudioChannel::Config CHANNELS[AUDIO_CHANNEL_MAX] = {
+    /* voice  */ { RATE * 10, RATE / 5, 1.0f, 1, 0.5f },
+    /* earcon */ { RATE, 1, 1.0f, 2, 1.0f },
+    /* music  */ { RATE * 2, RATE / 10, 0.6f, 0, 0.25f },
+};
+
+// The mixer task never ends, so one mixer serves every test
+static I2SSpeaker i2s;
+static AudioMixer mixer;
+
+static bool waitFor(std::function<bool()> done, int realMs = 5000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(realMs);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+static bool idle() {
+    for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+        AudioChannel& ch = mixer.channel((AUDIO_CHANNEL)i);
+        if (ch.isPlaying() || ch.buffered() > 0) return false;
+    }
+    return true;
+}
+
+static void write(AUDIO_CHANNEL channel, const std::vector<int16_t>& pcm, float gain = 1.0f) {
+    size_t queued = mixer.channel(channel).write(pcm.data(), pcm.size(), AudioDsp::gain(gain), portMAX_DELAY);
+    TEST_ASSERT_EQUAL(pcm.size(), queued);
+}
+
+static std::vector<int16_t> dc(int16_t value, size_t samples) {
+    return std::vector<int16_t>(samples, value);
+}
+
+void setUp() {
+    for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+        mixer.channel((AUDIO_CHANNEL)i).discard();
+        mixer.channel((AUDIO_CHANNEL)i).setGain(CHANNELS[i].gain);
+    }
+    TEST_ASSERT_TRUE(waitFor(idle));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    I2SSpeaker::reset();
+}
+
+void tearDown() {}
+
+void test_overload_saturates_without_wrap() {
+    write(AUDIO_CHANNEL_VOICE, dc(20000, RATE / 2));
+    write(AUDIO_CHANNEL_EARCON, dc(30000, RATE / 4));
+    mixer.channel(AUDIO_CHANNEL_VOICE).drain();
+    mixer.channel(AUDIO_CHANNEL_EARCON).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+
+    std::vector<int16_t> out = I2SSpeaker::output();
+    size_t clipped = 0;
+    for (int16_t s : out) {
+        TEST_ASSERT_GREATER_OR_EQUAL(0, s);
+        if (s == 32767) clipped++;
+    }
+    // Voice ducks to half under the earcon, 10000 + 30000 still overloads
+    TEST_ASSERT_GREATER_THAN(RATE / 8, clipped);
+
+    // Same on the negative side
+    I2SSpeaker::reset();
+    write(AUDIO_CHANNEL_VOICE, dc(-20000, RATE / 2));
+    write(AUDIO_CHANNEL_EARCON, dc(-30000, RATE / 4));
+    mixer.channel(AUDIO_CHANNEL_VOICE).drain();
+    mixer.channel(AUDIO_CHANNEL_EARCON).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+    out = I2SSpeaker::output();
+    for (int16_t s : out) TEST_ASSERT_LESS_OR_EQUAL(0, s);
+}
+
+void test_fixtures_mix_without_wrap() {
+    Fixtures::Script voice(RATE, 3);
+    voice.silence(200).speech(1800, 24000.0f).silence(200);
+    Fixtures::Script music(RATE, 4);
+    music.speech(2500, 30000.0f, 330.0f);
+    Fixtures::Clip voiceClip = voice.wav();
+    Fixtures::Clip musicClip = music.wav();
+    std::vector<int16_t> beep(RATE / 5);
+    for (size_t i = 0; i < beep.size(); i++) beep[i] = (int16_t)(32000 * sinf(2.0f * (float)M_PI * 880.0f * i / RATE));
+
+    write(AUDIO_CHANNEL_MUSIC, musicClip.pcm);
+    write(AUDIO_CHANNEL_VOICE, voiceClip.pcm);
+    write(AUDIO_CHANNEL_EARCON, beep);
+    for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) mixer.channel((AUDIO_CHANNEL)i).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+
+    std::vector<int16_t> out = I2SSpeaker::output();
+    Fixtures::Clip mixed;
+    mixed.pcm = out;
+    Fixtures::dump("mixer_fixtures", mixed);
+
+    // A wrapped sum jumps by about 65536, the inputs never move more than this per sample
+    int maxStep = 0;
+    size_t clipped = 0;
+    for (size_t i = 1; i < out.size(); i++) {
+        maxStep = std::max(maxStep, abs((int)out[i] - (int)out[i - 1]));
+        if (out[i] == 32767 || out[i] == -32768) clipped++;
+    }
+    TEST_ASSERT_LESS_THAN(40000, maxStep);
+    TEST_ASSERT_GREATER_OR_EQUAL(musicClip.pcm.size(), out.size());
+
+    char line[96];
+    snprintf(line, sizeof(line), "%.2f s mixed, %d samples at full scale, largest step %d",
+        out.size() / (float)RATE, (int)clipped, maxStep);
+    TEST_MESSAGE(line);
+}
+
+void test_voice_ducks_music_in_ramps() {
+    mixer.channel(AUDIO_CHANNEL_MUSIC).setGain(1.0f);
+    write(AUDIO_CHANNEL_MUSIC, dc(8000, RATE * 3 / 2));
+    TEST_ASSERT_TRUE(waitFor([] { return I2SSpeaker::outputSize() >= RATE / 4; }));
+    write(AUDIO_CHANNEL_VOICE, dc(0, RATE / 2));
+    mixer.channel(AUDIO_CHANNEL_VOICE).drain();
+    mixer.channel(AUDIO_CHANNEL_MUSIC).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+
+    // One gain per block, so compare block starts
+    std::vector<int16_t> out = I2SSpeaker::output();
+    int lowest = 8000;
+    int maxStep = 0;
+    for (size_t i = BLOCK; i < out.size(); i += BLOCK) {
+        lowest = std::min(lowest, (int)out[i]);
+        maxStep = std::max(maxStep, abs((int)out[i] - (int)out[i - BLOCK]));
+    }
+    TEST_ASSERT_INT_WITHIN(2, 2000, lowest);
+    TEST_ASSERT_LESS_OR_EQUAL(1001, maxStep);
+    TEST_ASSERT_INT_WITHIN(2, 8000, out[RATE / 8]);
+    TEST_ASSERT_INT_WITHIN(2, 8000, out[out.size() - BLOCK / 2]);
+}
+
+void test_earcon_latency() {
+    write(AUDIO_CHANNEL_VOICE, dc(1000, RATE * 2));
+    TEST_ASSERT_TRUE(waitFor([] { return I2SSpeaker::outputSize() >= RATE / 2; }));
+
+    size_t at = I2SSpeaker::outputSize();
+    write(AUDIO_CHANNEL_EARCON, dc(20000, BLOCK * 4));
+    mixer.channel(AUDIO_CHANNEL_EARCON).drain();
+    mixer.channel(AUDIO_CHANNEL_VOICE).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+
+    std::vector<int16_t> out = I2SSpeaker::output();
+    size_t first = at;
+    while (first < out.size() && out[first] < 10000) first++;
+    TEST_ASSERT_LESS_THAN(out.size(), first);
+    // The block being written when the earcon arrived plays first, then the earcon
+    TEST_ASSERT_LESS_OR_EQUAL(BLOCK, first - at);
+
+    char line[64];
+    snprintf(line, sizeof(line), "earcon mixed in %d samples after the block in flight", (int)(first - at));
+    TEST_MESSAGE(line);
+}
+
+void test_start_watermark() {
+    // Below the 200 ms watermark nothing plays until the stream is drained
+    write(AUDIO_CHANNEL_VOICE, dc(500, RATE / 10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    TEST_ASSERT_EQUAL(0, I2SSpeaker::outputSize());
+    mixer.channel(AUDIO_CHANNEL_VOICE).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+    TEST_ASSERT_GREATER_OR_EQUAL(RATE / 10, I2SSpeaker::outputSize());
+    TEST_ASSERT_EQUAL(0, mixer.channel(AUDIO_CHANNEL_VOICE).dropped());
+}
+
+void test_discard_keeps_other_channels() {
+    mixer.channel(AUDIO_CHANNEL_MUSIC).setGain(1.0f);
+    write(AUDIO_CHANNEL_MUSIC, dc(4000, RATE));
+    write(AUDIO_CHANNEL_VOICE, dc(100, RATE * 4));
+    TEST_ASSERT_TRUE(waitFor([] { return I2SSpeaker::outputSize() >= RATE / 2; }));
+    TEST_ASSERT_TRUE(mixer.channel(AUDIO_CHANNEL_VOICE).isPlaying());
+    mixer.channel(AUDIO_CHANNEL_VOICE).discard();
+    mixer.channel(AUDIO_CHANNEL_MUSIC).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+
+    // Music came back to full level after the voice was cut and played to its end
+    std::vector<int16_t> out = I2SSpeaker::output();
+    size_t full = 0;
+    size_t ducked = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (abs(out[i] - 4000) <= 2) full = i;
+        if (abs(out[i] - 1100) <= 2) ducked = i;
+    }
+    TEST_ASSERT_GREATER_THAN(0, ducked);
+    TEST_ASSERT_GREATER_THAN(ducked, full);
+    TEST_ASSERT_LESS_THAN(RATE * 2, out.size());
+    TEST_ASSERT_EQUAL(0, mixer.channel(AUDIO_CHANNEL_MUSIC).dropped());
+}
+
+void test_no_allocation_per_block() {
+    uint32_t before = HostHeap::allocations();
+    write(AUDIO_CHANNEL_VOICE, dc(1000, RATE));
+    write(AUDIO_CHANNEL_MUSIC, dc(1000, RATE));
+    mixer.channel(AUDIO_CHANNEL_VOICE).drain();
+    mixer.channel(AUDIO_CHANNEL_MUSIC).drain();
+    TEST_ASSERT_TRUE(waitFor(idle));
+    TEST_ASSERT_GREATER_OR_EQUAL(RATE, I2SSpeaker::outputSize());
+    TEST_ASSERT_EQUAL(before, HostHeap::allocations());
+}
+
+int main(int argc, char** argv) {
+    i2s.init(RATE, I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO);
+    i2s.start();
+    if (!mixer.begin(&i2s, RATE, CHANNELS, 10, 1)) return 1;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_overload_saturates_without_wrap);
+    RUN_TEST(test_fixtures_mix_without_wrap);
+    RUN_TEST(test_voice_ducks_music_in_ramps);
+    RUN_TEST(test_earcon_latency);
+    RUN_TEST(test_start_watermark);
+    RUN_TEST(test_discard_keeps_other_channels);
+    RUN_TEST(test_no_allocation_per_block);
+    return UNITY_END();
+}
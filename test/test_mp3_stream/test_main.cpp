@@ -0,0 +1,151 @@
+#include <unity.h>
+#include <cstdio>
+#include <vector>
+#include "app/audio/mp3decoder.h"
+
+// Relative to the project root, where pio test runs the program
+static const char* FIXTURE = "external/whisper/sample/audio.mp3";
+
+Mp3Decoder mp3decoder;
+static std::vector<uint8_t> mp3;
+
+static bool loadFixture() {
+    if (!mp3.empty()) return true;
+    FILE* file = fopen(FIXTURE, "rb");
+    if (!file) return false;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) mp3.insert(mp3.end(), chunk, chunk + n);
+    fclose(file);
+    return !mp3.empty();
+}
+
+struct Collected {
+    std::vector<int16_t> pcm;
+    int rate = 0;
+    size_t calls = 0;
+    unsigned long firstAt = 0;
+};
+
+static void collect(const int16_t* pcm, size_t samples, int rate, void* arg) {
+    Collected* out = static_cast<Collected*>(arg);
+    if (out->calls++ == 0) out->firstAt = millis();
+    out->pcm.insert(out->pcm.end(), pcm, pcm + samples);
+    out->rate = rate;
+}
+
+void setUp() {
+    HostHelix::warmupFrames() = 0;
+    HostClock::set(0);
+    if (!loadFixture()) TEST_IGNORE_MESSAGE("MP3 fixture not found, run from the project root");
+}
+
+void tearDown() {}
+
+void test_counts_frames_while_decoding() {
+    uint32_t totalSamples = 0;
+    size_t indexed = MpegAudio::buildIndex(mp3.data(), mp3.size(), nullptr, 0, &totalSamples);
+    TEST_ASSERT_GREATER_THAN(0, indexed);
+
+    Collected out;
+    size_t delivered = mp3decoder.stream(mp3.data(), mp3.size(), collect, &out);
+    TEST_ASSERT_EQUAL(indexed, mp3decoder.framesDecoded());
+    TEST_ASSERT_EQUAL(indexed, out.calls);
+    TEST_ASSERT_EQUAL(totalSamples, delivered);
+    TEST_ASSERT_EQUAL(delivered, out.pcm.size());
+}
+
+void test_warmup_frames_are_not_counted() {
+    uint32_t totalSamples = 0;
+    size_t indexed = MpegAudio::buildIndex(mp3.data(), mp3.size(), nullptr, 0, &totalSamples);
+
+    // The warm-up count is taken when a decoder is created
+    HostHelix::warmupFrames() = 2;
+    Mp3Decoder decoder;
+    Collected out;
+    size_t delivered = decoder.stream(mp3.data(), mp3.size(), collect, &out);
+    TEST_ASSERT_EQUAL(indexed - 2, decoder.framesDecoded());
+    TEST_ASSERT_EQUAL(totalSamples - 2 * (totalSamples / indexed), delivered);
+}
+
+void test_network_chunks_match_whole_buffer() {
+    // Helix state carries across streams, give each run its own decoder
+    Mp3Decoder reference;
+    Collected whole;
+    reference.stream(mp3.data(), mp3.size(), collect, &whole);
+
+    Mp3Decoder chunkedDecoder;
+    Collected chunked;
+    TEST_ASSERT_TRUE(chunkedDecoder.begin());
+    size_t offset = 0;
+    size_t chunk = 1;
+    while (offset < mp3.size()) {
+        size_t n = std::min(chunk, mp3.size() - offset);
+        size_t accepted = chunkedDecoder.feed(mp3.data() + offset, n);
+        offset += accepted;
+        chunkedDecoder.decodeAvailable(collect, &chunked, offset >= mp3.size());
+        chunk = (chunk * 13 + 7) % 4000 + 1;
+    }
+    TEST_ASSERT_EQUAL(whole.pcm.size(), chunked.pcm.size());
+    TEST_ASSERT_EQUAL_MEMORY(whole.pcm.data(), chunked.pcm.data(), whole.pcm.size() * 2);
+    TEST_ASSERT_EQUAL(reference.framesDecoded(), chunkedDecoder.framesDecoded());
+    TEST_ASSERT_LESS_OR_EQUAL(16 * 1024, chunkedDecoder.peakWindow());
+}
+
+/**
+ * Time to first sample and peak memory, streaming versus download-then-decode
+ *
+ * The fixture arrives in 1460-byte TCP segments at the link rate on the
+ * simulated clock. Helix decode time is not modelled: the host stand-in
+ * only frames the stream, so times are network bound.
+ */
+void bench_time_to_first_sample() {
+    const uint32_t linkKbps[] = {256, 1000, 4000};
+    const size_t SEGMENT = 1460;
+
+    for (uint32_t kbps : linkKbps) {
+        const double bytesPerMs = kbps * 1000.0 / 8 / 1000;
+
+        // Streaming: decode as segments arrive
+        HostClock::set(0);
+        Collected streamed;
+        TEST_ASSERT_TRUE(mp3decoder.begin());
+        double clock = 0;
+        for (size_t offset = 0; offset < mp3.size();) {
+            size_t n = std::min(SEGMENT, mp3.size() - offset);
+            clock += n / bytesPerMs;
+            HostClock::set((uint32_t)clock);
+            size_t accepted = 0;
+            while (accepted < n) {
+                size_t got = mp3decoder.feed(mp3.data() + offset + accepted, n - accepted);
+                accepted += got;
+                mp3decoder.decodeAvailable(collect, &streamed, offset + accepted >= mp3.size());
+                if (got == 0) break;
+            }
+            offset += accepted;
+        }
+
+        // Previous path: the whole download first, then every frame into one PCM buffer
+        uint32_t downloadMs = (uint32_t)(mp3.size() / bytesPerMs);
+        size_t pcmBytes = streamed.pcm.size() * sizeof(int16_t);
+        size_t resampledBytes = (size_t)((double)pcmBytes * 16000 / streamed.rate);
+        size_t bufferedPeak = mp3.size() + 2 * pcmBytes + resampledBytes;
+        size_t streamedPeak = mp3decoder.peakWindow() + 1152 * 10 * sizeof(int16_t);
+
+        char line[160];
+        snprintf(line, sizeof(line), "%4lu kbps: first sample %4lu ms streamed vs %5lu ms buffered, peak %5lu B vs %7lu B, %d frames",
+            (unsigned long)kbps, streamed.firstAt, (unsigned long)downloadMs,
+            (unsigned long)streamedPeak, (unsigned long)bufferedPeak, (int)mp3decoder.framesDecoded());
+        TEST_MESSAGE(line);
+        TEST_ASSERT_LESS_THAN(downloadMs, streamed.firstAt);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_counts_frames_while_decoding);
+    RUN_TEST(test_warmup_frames_are_not_counted);
+    RUN_TEST(test_network_chunks_match_whole_buffer);
+    RUN_TEST(bench_time_to_first_sample);
+    return UNITY_END();
+}
@@ -0,0 +1,284 @@
+#include <unity.h>
+#include <cstdio>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "bench.h"
+#include "app/audio/mpegaudio.h"
+
+// Relative to the project root, where pio test runs the program
+static const char* FIXTURE = "external/whisper/sample/audio.mp3";
+
+/**
+ * Bytes placed right against an inaccessible page
+ *
+ * With tail set the data ends where the guard page starts, otherwise it
+ * starts where the guard page ends, so reading one byte past either end
+ * of the buffer faults instead of passing silently.
+ */
+class Guarded {
+public:
+    Guarded(): _page(sysconf(_SC_PAGESIZE)) {}
+    ~Guarded() { release(); }
+
+    const uint8_t* place(const uint8_t* data, size_t length, bool tail) {
+        release();
+        size_t pages = (length + _page - 1) / _page + 1;
+        _size = (pages + 1) * _page;
+        _map = (uint8_t*)mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        uint8_t* start;
+        if (tail) {
+            mprotect(_map + pages * _page, _page, PROT_NONE);
+            start = _map + pages * _page - length;
+        } else {
+            mprotect(_map, _page, PROT_NONE);
+            start = _map + _page;
+        }
+        memcpy(start, data, length);
+        return start;
+    }
+
+private:
+    size_t _page;
+    uint8_t* _map = nullptr;
+    size_t _size = 0;
+
+    void release() {
+        if (_map) munmap(_map, _size);
+        _map = nullptr;
+    }
+};
+
+static uint32_t lcg = 1;
+static uint32_t nextRandom() {
+    lcg = lcg * 1664525u + 1013904223u;
+    return lcg >> 8;
+}
+
+struct Stream {
+    std::vector<uint8_t> bytes;
+    std::vector<uint32_t> offsets;
+    uint32_t samples = 0;
+};
+
+/**
+ * Frames of one stream with random bitrates and padding, as a VBR encoder
+ * writes them, and random payload bytes
+ * @param b1 Second header byte: version, layer and no CRC
+ * @param rateIndex Sample rate index
+ */
+static Stream frames(uint8_t b1, uint8_t rateIndex, size_t count) {
+    Stream s;
+    for (size_t i = 0; i < count; i++) {
+        uint8_t header[4] = {0xFF, b1, (uint8_t)((nextRandom() % 14 + 1) << 4 | rateIndex << 2 | (nextRandom() & 1) << 1), 0x44};
+        MpegFrameHeader h;
+        MpegAudio::parseHeader(header, &h);
+        s.offsets.push_back(s.bytes.size());
+        s.samples += h.samples;
+        s.bytes.insert(s.bytes.end(), header, header + 4);
+        for (size_t j = 4; j < h.size; j++) s.bytes.push_back(nextRandom());
+    }
+    return s;
+}
+
+// MPEG-2 Layer III at 24 kHz, what the TTS endpoint sends
+static Stream tts(size_t count) { return frames(0xF3, 1, count); }
+
+void setUp() { lcg = 1; }
+
+void tearDown() {}
+
+void test_known_headers() {
+    const uint8_t mpeg1[4] = {0xFF, 0xFB, 0x90, 0x64};
+    const uint8_t mpeg2[4] = {0xFF, 0xF3, 0x64, 0xC4};
+    MpegFrameHeader h;
+    TEST_ASSERT_TRUE(MpegAudio::parseHeader(mpeg1, &h));
+    TEST_ASSERT_EQUAL(10, h.version);
+    TEST_ASSERT_EQUAL(3, h.layer);
+    TEST_ASSERT_EQUAL(128000, h.bitrate);
+    TEST_ASSERT_EQUAL(44100, h.sampleRate);
+    TEST_ASSERT_EQUAL(1152, h.samples);
+    TEST_ASSERT_EQUAL(417, h.size);
+    TEST_ASSERT_EQUAL(2, h.channels);
+
+    TEST_ASSERT_TRUE(MpegAudio::parseHeader(mpeg2, &h));
+    TEST_ASSERT_EQUAL(20, h.version);
+    TEST_ASSERT_EQUAL(48000, h.bitrate);
+    TEST_ASSERT_EQUAL(24000, h.sampleRate);
+    TEST_ASSERT_EQUAL(576, h.samples);
+    TEST_ASSERT_EQUAL(144, h.size);
+    TEST_ASSERT_EQUAL(1, h.channels);
+}
+
+void test_every_header_is_rejected_or_sane() {
+    // All 2^21 headers behind an 11-bit sync
+    size_t valid = 0;
+    uint8_t data[4] = {0xFF};
+    for (uint32_t bits = 0; bits < (1u << 21); bits++) {
+        data[1] = 0xE0 | (bits >> 16);
+        data[2] = bits >> 8;
+        data[3] = bits;
+        MpegFrameHeader h;
+        if (!MpegAudio::parseHeader(data, &h)) continue;
+        valid++;
+        TEST_ASSERT_GREATER_THAN(MpegAudio::HEADER_SIZE, h.size);
+        TEST_ASSERT_LESS_OR_EQUAL(2881, h.size); // MPEG-2.5 Layer II at 160 kbps and 8 kHz, padded
+        TEST_ASSERT_TRUE(h.samples == 384 || h.samples == 576 || h.samples == 1152);
+        TEST_ASSERT_TRUE(h.sampleRate >= 8000 && h.sampleRate <= 48000);
+    }
+    // Versions, layers, bitrates and rates, then CRC, padding, private, mode, extension, copyright, original and emphasis
+    TEST_ASSERT_EQUAL(3 * 3 * 14 * 3 * (2 * 2 * 2 * 4 * 4 * 2 * 2 * 3), valid);
+}
+
+void test_random_bytes_do_not_over_read() {
+    Guarded guard;
+    std::vector<uint8_t> data;
+    for (int round = 0; round < 4000; round++) {
+        size_t length = nextRandom() % 3000;
+        data.resize(length);
+        // Mostly sync-like bytes, so the parser gets deep into every path
+        for (size_t i = 0; i < length; i++) data[i] = nextRandom() % 3 == 0 ? 0xFF : nextRandom();
+        for (bool tail : {true, false}) {
+            const uint8_t* p = guard.place(data.data(), length, tail);
+            int sync = MpegAudio::findSync(p, length);
+            TEST_ASSERT_TRUE(sync == MpegAudio::NOT_FOUND || (size_t)sync + 1 < length);
+            MpegAudio::id3v2Size(p, length);
+            for (bool final : {true, false}) {
+                MpegFrameHeader h;
+                size_t skipped = length + 1;
+                int offset = MpegAudio::findFrame(p, length, &h, final, &skipped);
+                TEST_ASSERT_LESS_OR_EQUAL(length, skipped);
+                if (offset >= 0) TEST_ASSERT_LESS_OR_EQUAL(length, offset + h.size);
+            }
+            uint32_t offsets[64];
+            size_t found = MpegAudio::buildIndex(p, length, offsets, 64);
+            for (size_t i = 1; i < found && i < 64; i++) TEST_ASSERT_GREATER_THAN(offsets[i - 1], offsets[i]);
+        }
+    }
+}
+
+void test_truncated_stream_at_every_length() {
+    Stream s = tts(40);
+    Guarded guard;
+    size_t complete = 0;
+    for (size_t length = 0; length <= s.bytes.size(); length++) {
+        while (complete < s.offsets.size() && (complete + 1 < s.offsets.size() ? s.offsets[complete + 1] : s.bytes.size()) <= length) complete++;
+        const uint8_t* p = guard.place(s.bytes.data(), length, true);
+        // A final buffer holds every frame that ends inside it
+        TEST_ASSERT_EQUAL(complete, MpegAudio::buildIndex(p, length, nullptr, 0));
+        // A streaming one waits for the next header before trusting the first
+        MpegFrameHeader h;
+        size_t skipped;
+        int offset = MpegAudio::findFrame(p, length, &h, false, &skipped);
+        if (length < s.offsets[1] + MpegAudio::HEADER_SIZE) {
+            TEST_ASSERT_EQUAL(MpegAudio::NEED_MORE, offset);
+            TEST_ASSERT_EQUAL(0, skipped);
+        } else {
+            TEST_ASSERT_EQUAL(0, offset);
+        }
+    }
+}
+
+void test_resyncs_after_garbage_and_cut_frames() {
+    Stream s = tts(60);
+    std::vector<uint8_t> damaged;
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < s.offsets.size(); i++) {
+        size_t end = i + 1 < s.offsets.size() ? s.offsets[i + 1] : s.bytes.size();
+        if (i % 10 != 3) {
+            expected.push_back(damaged.size());
+            damaged.insert(damaged.end(), s.bytes.begin() + s.offsets[i], s.bytes.begin() + end);
+            continue;
+        }
+        // A frame cut short, then garbage with a lone sync and a header whose successor is not there
+        const uint8_t junk[] = {0x12, 0xFF, 0xFF, 0xF3, 0x64, 0xC4, 0x00, 0xFF, 0xE0};
+        damaged.insert(damaged.end(), s.bytes.begin() + s.offsets[i], s.bytes.begin() + (s.offsets[i] + end) / 2);
+        damaged.insert(damaged.end(), junk, junk + sizeof(junk));
+    }
+
+    std::vector<uint32_t> offsets(expected.size() + 8);
+    size_t found = MpegAudio::buildIndex(damaged.data(), damaged.size(), offsets.data(), offsets.size());
+    TEST_ASSERT_EQUAL(expected.size(), found);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected.data(), offsets.data(), found);
+
+    // The same frames when the stream arrives in pieces, dropping what findFrame() says holds no frame
+    std::vector<uint8_t> window;
+    std::vector<uint32_t> streamed;
+    size_t dropped = 0;
+    size_t fed = 0;
+    while (true) {
+        bool final = fed == damaged.size();
+        MpegFrameHeader h;
+        size_t skipped = 0;
+        int offset = MpegAudio::findFrame(window.data(), window.size(), &h, final, &skipped);
+        if (offset >= 0) {
+            streamed.push_back(dropped + offset);
+            window.erase(window.begin(), window.begin() + offset + h.size);
+            dropped += offset + h.size;
+            continue;
+        }
+        window.erase(window.begin(), window.begin() + skipped);
+        dropped += skipped;
+        if (final) break;
+        size_t n = std::min<size_t>(nextRandom() % 700 + 1, damaged.size() - fed);
+        window.insert(window.end(), damaged.begin() + fed, damaged.begin() + fed + n);
+        fed += n;
+    }
+    TEST_ASSERT_EQUAL(expected.size(), streamed.size());
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected.data(), streamed.data(), streamed.size());
+}
+
+/**
+ * Frames indexed per second: the fixture when it is there, a TTS-like
+ * stream and the same stream with every fourth header broken. Clean
+ * streams are walked header to header, MB/s only says something where
+ * a resync has to scan.
+ */
+void bench_frames() {
+    char line[160];
+    std::vector<uint8_t> fixture;
+    FILE* file = fopen(FIXTURE, "rb");
+    if (file) {
+        uint8_t chunk[4096];
+        size_t n;
+        while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) fixture.insert(fixture.end(), chunk, chunk + n);
+        fclose(file);
+    }
+
+    Stream s = tts(2000);
+    std::vector<uint8_t> noisy = s.bytes;
+    // A broken header also costs the frame before it, whose successor no longer checks out
+    for (size_t i = 1; i < s.offsets.size(); i += 4) noisy[s.offsets[i]] = 0xFE;
+
+    struct Case {
+        const char* name;
+        const std::vector<uint8_t>* bytes;
+    } cases[] = {{"fixture", &fixture}, {"tts stream", &s.bytes}, {"1/4 damaged", &noisy}};
+
+    for (const Case& c : cases) {
+        if (c.bytes->empty()) continue;
+        const int reps = 200;
+        size_t frames = 0;
+        double start = Bench::seconds();
+        for (int i = 0; i < reps; i++) {
+            frames += MpegAudio::buildIndex(c.bytes->data(), c.bytes->size(), nullptr, 0);
+            Bench::keep(frames);
+        }
+        double seconds = Bench::seconds() - start;
+        snprintf(line, sizeof(line), "%-12s %7zu bytes %5zu frames: %6.2f Mframes/s, %7.1f MB/s",
+            c.name, c.bytes->size(), frames / reps, frames / seconds / 1e6, reps * (double)c.bytes->size() / seconds / 1e6);
+        TEST_MESSAGE(line);
+    }
+    TEST_ASSERT_EQUAL(s.offsets.size(), MpegAudio::buildIndex(s.bytes.data(), s.bytes.size(), nullptr, 0));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_known_headers);
+    RUN_TEST(test_every_header_is_rejected_or_sane);
+    RUN_TEST(test_random_bytes_do_not_over_read);
+    RUN_TEST(test_truncated_stream_at_every_length);
+    RUN_TEST(test_resyncs_after_garbage_and_cut_frames);
+    RUN_TEST(bench_frames);
+    return UNITY_END();
+}
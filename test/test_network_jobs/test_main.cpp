@@ -0,0 +1,255 @@
+#include <unity.h>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "app/network/NetworkJobs.h"
+
+NetworkJobQueue networkJobs;
+
+/**
+ * Stand-in for mainTask: the deliver hook queues finished jobs like
+ * notification->send(NOTIFICATION_JOB), a consumer thread completes them
+ */
+static QueueHandle_t delivered = nullptr;
+static std::thread::id consumerId;
+
+static bool deliver(NetworkJob* job) {
+    return xQueueSend(delivered, &job, 0) == pdTRUE;
+}
+
+static void consumer() {
+    NetworkJob* job = nullptr;
+    while (1) {
+        if (xQueueReceive(delivered, &job, portMAX_DELAY) == pdTRUE) networkJobs.complete(job);
+    }
+}
+
+// Holds jobs on the worker until the test opens it
+class Gate {
+public:
+    void close() { std::lock_guard<std::mutex> guard(_lock); _open = false; _entered = 0; }
+    void open() { std::lock_guard<std::mutex> guard(_lock); _open = true; _changed.notify_all(); }
+
+    void pass() {
+        std::unique_lock<std::mutex> guard(_lock);
+        _entered++;
+        _changed.notify_all();
+        _changed.wait(guard, [this] { return _open; });
+    }
+
+    bool waitEntered(int count) {
+        std::unique_lock<std::mutex> guard(_lock);
+        return _changed.wait_for(guard, std::chrono::seconds(5), [&] { return _entered >= count; });
+    }
+
+private:
+    std::mutex _lock;
+    std::condition_variable _changed;
+    bool _open = true;
+    int _entered = 0;
+};
+
+// Completions in the order the consumer ran them
+class Completions {
+public:
+    void clear() { std::lock_guard<std::mutex> guard(_lock); order.clear(); threads.clear(); }
+
+    void add(int id) {
+        std::lock_guard<std::mutex> guard(_lock);
+        order.push_back(id);
+        threads.push_back(std::this_thread::get_id());
+        _changed.notify_all();
+    }
+
+    bool waitFor(size_t count) {
+        std::unique_lock<std::mutex> guard(_lock);
+        return _changed.wait_for(guard, std::chrono::seconds(10), [&] { return order.size() >= count; });
+    }
+
+    std::vector<int> order;
+    std::vector<std::thread::id> threads;
+
+private:
+    std::mutex _lock;
+    std::condition_variable _changed;
+};
+
+static Gate gate;
+static Completions completions;
+
+void setUp() {
+    gate.open();
+    completions.clear();
+}
+
+void tearDown() {
+    gate.open();
+}
+
+void test_jobs_complete_in_submit_order_on_the_consumer() {
+    std::vector<int> ran;
+    std::mutex ranLock;
+    const int jobs = 6; // Fits the queue while the first one is held
+    NetworkJobStats before = networkJobs.stats(NETWORK_JOB_TOOL);
+
+    gate.close();
+    for (int i = 0; i < jobs; i++) {
+        TEST_ASSERT_TRUE(networkJobs.submit(NETWORK_JOB_TOOL, [&, i]() {
+            if (i == 0) gate.pass();
+            std::lock_guard<std::mutex> guard(ranLock);
+            ran.push_back(i);
+            return i % 2 == 0;
+        }, [i](bool) { completions.add(i); }));
+    }
+    TEST_ASSERT_TRUE(gate.waitEntered(1));
+    TEST_ASSERT_TRUE(networkJobs.pending(NETWORK_JOB_TOOL));
+    gate.open();
+    TEST_ASSERT_TRUE(completions.waitFor(jobs));
+
+    for (int i = 0; i < jobs; i++) {
+        TEST_ASSERT_EQUAL(i, ran[i]);
+        TEST_ASSERT_EQUAL(i, completions.order[i]);
+        // Completions run where the consumer drains them, never on the worker
+        TEST_ASSERT_TRUE(completions.threads[i] == consumerId);
+    }
+    NetworkJobStats after = networkJobs.stats(NETWORK_JOB_TOOL);
+    TEST_ASSERT_EQUAL(jobs, after.submitted - before.submitted);
+    TEST_ASSERT_EQUAL(jobs, after.completed - before.completed);
+    TEST_ASSERT_EQUAL(jobs / 2, after.failed - before.failed);
+    TEST_ASSERT_FALSE(networkJobs.pending(NETWORK_JOB_TOOL));
+}
+
+void test_rejects_jobs_past_the_queue_depth() {
+    NetworkJobStats before = networkJobs.stats(NETWORK_JOB_WEATHER);
+
+    // The worker holds the first job, so the queue itself takes NETWORK_JOB_QUEUE_DEPTH more
+    gate.close();
+    TEST_ASSERT_TRUE(networkJobs.submit(NETWORK_JOB_WEATHER, []() { gate.pass(); return true; },
+        [](bool) { completions.add(0); }));
+    TEST_ASSERT_TRUE(gate.waitEntered(1));
+    for (int i = 1; i <= NETWORK_JOB_QUEUE_DEPTH; i++) {
+        TEST_ASSERT_TRUE(networkJobs.submit(NETWORK_JOB_WEATHER, []() { return true; },
+            [i](bool) { completions.add(i); }));
+    }
+    TEST_ASSERT_EQUAL(NETWORK_JOB_QUEUE_DEPTH, networkJobs.depth());
+
+    bool calledRejected = false;
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_FALSE(networkJobs.submit(NETWORK_JOB_WEATHER, []() { return true; },
+            [&](bool) { calledRejected = true; }));
+    }
+    NetworkJobStats held = networkJobs.stats(NETWORK_JOB_WEATHER);
+    TEST_ASSERT_EQUAL(3, held.rejected - before.rejected);
+    TEST_ASSERT_EQUAL(NETWORK_JOB_QUEUE_DEPTH + 1, held.submitted - before.submitted);
+    TEST_ASSERT_EQUAL(NETWORK_JOB_QUEUE_DEPTH, networkJobs.maxDepth());
+
+    gate.open();
+    TEST_ASSERT_TRUE(completions.waitFor(NETWORK_JOB_QUEUE_DEPTH + 1));
+    for (int i = 0; i <= NETWORK_JOB_QUEUE_DEPTH; i++) TEST_ASSERT_EQUAL(i, completions.order[i]);
+    TEST_ASSERT_FALSE(calledRejected);
+    TEST_ASSERT_EQUAL(NETWORK_JOB_QUEUE_DEPTH + 1, networkJobs.stats(NETWORK_JOB_WEATHER).completed - before.completed);
+
+    // Space again once the worker caught up
+    TEST_ASSERT_TRUE(networkJobs.submit(NETWORK_JOB_WEATHER, []() { return true; },
+        [](bool) { completions.add(-1); }));
+    TEST_ASSERT_TRUE(completions.waitFor(NETWORK_JOB_QUEUE_DEPTH + 2));
+}
+
+/**
+ * networkTask's loop keeps its tick while a lookup blocks for 300 ms,
+ * run inline as before the worker it stalls for the whole lookup
+ */
+static double longestGap(bool offload) {
+    const int ticks = 40;
+    const auto tick = std::chrono::milliseconds(10);
+    std::atomic<bool> done(false);
+    auto lookup = []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        return true;
+    };
+
+    double longest = 0;
+    double last = Bench::seconds();
+    for (int i = 0; i < ticks; i++) {
+        std::this_thread::sleep_for(tick);
+        if (i == 2) {
+            if (offload) {
+                networkJobs.submit(NETWORK_JOB_NTP, lookup, [&done](bool) { done = true; });
+            } else {
+                lookup();
+                done = true;
+            }
+        }
+        double now = Bench::seconds();
+        if (now - last > longest) longest = now - last;
+        last = now;
+    }
+    while (!done) std::this_thread::sleep_for(tick);
+    return longest * 1000;
+}
+
+void test_loop_keeps_its_tick_while_a_job_blocks() {
+    double inlineGap = longestGap(false);
+    double offloadedGap = longestGap(true);
+
+    char line[128];
+    snprintf(line, sizeof(line), "longest loop gap, 10 ms tick, 300 ms lookup: inline %.0f ms, on the worker %.0f ms",
+        inlineGap, offloadedGap);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_GREATER_OR_EQUAL(300.0, inlineGap);
+    TEST_ASSERT_LESS_THAN(100.0, offloadedGap);
+}
+
+// Submitters on several threads, the worker and the consumer all touch the stats
+void test_stats_add_up_under_concurrent_submit_and_complete() {
+    const int threads = 4, perThread = 500;
+    NetworkJobStats before = networkJobs.stats(NETWORK_JOB_PRECONNECT);
+    std::atomic<int> accepted(0), refused(0), failed(0);
+
+    std::vector<std::thread> submitters;
+    for (int t = 0; t < threads; t++) {
+        submitters.emplace_back([&]() {
+            for (int i = 0; i < perThread; i++) {
+                bool ok = networkJobs.submit(NETWORK_JOB_PRECONNECT, [i]() {
+                    HostClock::advance(1);
+                    return i % 3 != 0;
+                }, [&failed](bool ok) {
+                    if (!ok) failed++;
+                    completions.add(0);
+                });
+                (ok ? accepted : refused)++;
+                if (i % 16 == 0) std::this_thread::yield();
+            }
+        });
+    }
+    for (std::thread& thread : submitters) thread.join();
+    TEST_ASSERT_TRUE(completions.waitFor(accepted));
+    TEST_ASSERT_FALSE(networkJobs.pending(NETWORK_JOB_PRECONNECT));
+
+    NetworkJobStats after = networkJobs.stats(NETWORK_JOB_PRECONNECT);
+    TEST_ASSERT_EQUAL(threads * perThread, accepted + refused);
+    TEST_ASSERT_EQUAL(accepted, after.submitted - before.submitted);
+    TEST_ASSERT_EQUAL(refused, after.rejected - before.rejected);
+    TEST_ASSERT_EQUAL(accepted, after.completed - before.completed);
+    TEST_ASSERT_EQUAL(failed, after.failed - before.failed);
+    TEST_ASSERT_GREATER_OR_EQUAL(after.lastLatencyMs, after.maxLatencyMs);
+    TEST_ASSERT_LESS_OR_EQUAL(NETWORK_JOB_QUEUE_DEPTH, networkJobs.maxDepth());
+}
+
+int main(int argc, char** argv) {
+    delivered = xQueueCreate(32, sizeof(NetworkJob*));
+    std::thread thread(consumer);
+    consumerId = thread.get_id();
+    thread.detach();
+    networkJobs.begin(deliver);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_jobs_complete_in_submit_order_on_the_consumer);
+    RUN_TEST(test_rejects_jobs_past_the_queue_depth);
+    RUN_TEST(test_loop_keeps_its_tick_while_a_job_blocks);
+    RUN_TEST(test_stats_add_up_under_concurrent_submit_and_complete);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+#include <unity.h>
+#include <cstdio>
+#include <utility>
+#include "app_config.h"
+#include "app/audio/packetizer.h"
+
+static const uint32_t AFE_FRAME_MS = 32;
+
+UplinkPacketizer packetizer;
+
+static const UplinkPacketizer::Config CONFIG = {UPLINK_FRAME_MIN_MS, UPLINK_FRAME_MAX_MS, UPLINK_FRAME_START_MS, UPLINK_FRAME_STEP_MS};
+
+void setUp() {
+    packetizer.init(CONFIG);
+}
+
+void tearDown() {}
+
+void test_waits_for_a_whole_frame() {
+    TEST_ASSERT_EQUAL(UPLINK_FRAME_START_MS, packetizer.targetMs());
+    TEST_ASSERT_FALSE(packetizer.ready(0, false, 100));
+    TEST_ASSERT_FALSE(packetizer.ready(UPLINK_FRAME_START_MS - 1, false, 110));
+    TEST_ASSERT_TRUE(packetizer.ready(UPLINK_FRAME_START_MS, false, 120));
+}
+
+void test_speech_end_flushes() {
+    TEST_ASSERT_FALSE(packetizer.ready(10, false, 100));
+    TEST_ASSERT_TRUE(packetizer.ready(10, true, 101));
+    TEST_ASSERT_FALSE(packetizer.ready(0, true, 102));
+}
+
+void test_never_holds_longer_than_max() {
+    TEST_ASSERT_FALSE(packetizer.ready(10, false, 1000));
+    TEST_ASSERT_FALSE(packetizer.ready(10, false, 1000 + UPLINK_FRAME_MAX_MS - 1));
+    TEST_ASSERT_TRUE(packetizer.ready(10, false, 1000 + UPLINK_FRAME_MAX_MS));
+}
+
+void test_slow_sends_grow_the_frame() {
+    unsigned long now = 1000;
+    for (int i = 0; i < 20; i++) {
+        packetizer.polled(now);
+        packetizer.emitted(0, now);
+        now += packetizer.targetMs(); // Every send takes as long as the audio it carries
+    }
+    TEST_ASSERT_EQUAL(UPLINK_FRAME_MAX_MS, packetizer.targetMs());
+}
+
+void test_backlog_grows_the_frame() {
+    unsigned long now = 1000;
+    packetizer.polled(now);
+    packetizer.emitted(3 * UPLINK_FRAME_START_MS, now);
+    TEST_ASSERT_EQUAL(UPLINK_FRAME_START_MS + UPLINK_FRAME_STEP_MS, packetizer.targetMs());
+}
+
+void test_fast_link_shrinks_to_min() {
+    unsigned long now = 1000;
+    packetizer.emitted(0, now);
+    for (int i = 0; i < 40; i++) {
+        now += 1;
+        packetizer.polled(now);
+        packetizer.emitted(0, now);
+    }
+    TEST_ASSERT_EQUAL(UPLINK_FRAME_MIN_MS, packetizer.targetMs());
+    TEST_ASSERT_EQUAL(41, packetizer.messages());
+}
+
+// Framing of one append message: JSON, a masked WebSocket frame and TLS records.
+// base64 is left out, it adds a fixed 33% whatever the frame size.
+static size_t framing(size_t pcmBytes) {
+    size_t base64 = (pcmBytes + 2) / 3 * 4;
+    size_t json = 48 + base64; // {"type":"input_audio_buffer.append","audio":"..."}
+    size_t ws = 2 + 4 + (json > 125 ? (json > 65535 ? 8 : 2) : 0);
+    size_t tls = (json + ws + 16383) / 16384 * 29;
+    return 48 + ws + tls;
+}
+
+struct Loopback {
+    double messages;   // Per second
+    double framing;    // Bytes per second
+    double holdMs;     // Average age of the oldest audio in a message
+    uint32_t targetMs; // Frame target at the end
+};
+
+/**
+ * Loopback model of micAudioCallback and the realtime client
+ *
+ * The AFE delivers 32 ms chunks. The client polls every 5 ms; a non-empty
+ * poll is sent as one message, which takes a quarter of the RTT plus the
+ * base64 payload at the link rate, and the client polls again afterwards.
+ */
+static Loopback loopback(const UplinkPacketizer::Config& config, double rttMs, double kbps, bool adaptive) {
+    UplinkPacketizer model;
+    model.init(config);
+    const unsigned long duration = 60000;
+    unsigned long now = 1;
+    unsigned long nextFrame = AFE_FRAME_MS;
+    unsigned long oldest = 0;
+    uint32_t pending = 0;
+    double messages = 0;
+    double bytes = 0;
+    double hold = 0;
+
+    auto capture = [&]() {
+        while (nextFrame <= now) {
+            if (pending == 0) oldest = nextFrame;
+            pending += AFE_FRAME_MS;
+            nextFrame += AFE_FRAME_MS;
+        }
+    };
+
+    while (now < duration) {
+        capture();
+        model.polled(now);
+        bool send = adaptive ? model.ready(pending, false, now) : pending >= config.startMs;
+        if (!send) {
+            now += 5;
+            continue;
+        }
+        size_t pcmBytes = pending * (STS_SAMPLE_RATE / 1000) * sizeof(int16_t);
+        messages++;
+        bytes += framing(pcmBytes);
+        hold += now - oldest;
+        pending = 0;
+
+        double sendMs = rttMs / 4 + (pcmBytes * 4.0 / 3 * 8) / kbps;
+        now += (unsigned long)sendMs + 1;
+        capture();
+        if (adaptive) model.emitted(pending, now);
+    }
+    return {messages * 1000 / duration, bytes * 1000 / duration, hold / messages, model.targetMs()};
+}
+
+void bench_loopback() {
+    char line[128];
+    TEST_MESSAGE("fixed frame  msgs/s  framing B/s");
+    for (uint32_t frame : {20u, 32u, 60u, 100u, 200u}) {
+        Loopback result = loopback({frame, frame, frame, UPLINK_FRAME_STEP_MS}, 40, 2000, false);
+        snprintf(line, sizeof(line), "  %4lu ms    %6.1f  %9.0f", (unsigned long)frame, result.messages, result.framing);
+        TEST_MESSAGE(line);
+    }
+
+    TEST_MESSAGE("adaptive     rtt ms  kbps  msgs/s  framing B/s  hold ms  target ms");
+    const std::pair<double, double> links[] = {{20, 4000}, {80, 2000}, {250, 1000}, {400, 600}};
+    uint32_t lastTarget = 0;
+    for (const std::pair<double, double>& link : links) {
+        Loopback result = loopback(CONFIG, link.first, link.second, true);
+        snprintf(line, sizeof(line), "             %6.0f %5.0f  %6.1f  %11.0f  %7.1f  %9lu",
+            link.first, link.second, result.messages, result.framing, result.holdMs, (unsigned long)result.targetMs);
+        TEST_MESSAGE(line);
+        // Slower links never end up with smaller frames
+        TEST_ASSERT_GREATER_OR_EQUAL(lastTarget, result.targetMs);
+        lastTarget = result.targetMs;
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_waits_for_a_whole_frame);
+    RUN_TEST(test_speech_end_flushes);
+    RUN_TEST(test_never_holds_longer_than_max);
+    RUN_TEST(test_slow_sends_grow_the_frame);
+    RUN_TEST(test_backlog_grows_the_frame);
+    RUN_TEST(test_fast_link_shrinks_to_min);
+    RUN_TEST(bench_loopback);
+    return UNITY_END();
+}
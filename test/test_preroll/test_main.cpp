@@ -0,0 +1,171 @@
+#include <unity.h>
+#include <vector>
+#include "fixtures.h"
+#include "app_config.h"
+#include "app/audio/afetap.h"
+
+static const size_t AFE_FRAME = 512; // AFE fetch chunk, 32 ms at 16 kHz
+
+// Pushes a clip into the tap frame by frame with the frame's capture time
+class Capture {
+public:
+    Capture(AfeTap& tap, const Fixtures::Clip& clip): _tap(tap), _clip(clip), _pos(0) {}
+
+    inline bool frame() {
+        if (_pos >= _clip.pcm.size()) return false;
+        size_t n = std::min(AFE_FRAME, _clip.pcm.size() - _pos);
+        HostClock::advance(n / 16);
+        _tap.push(_clip.pcm.data() + _pos, n, VAD_SPEECH);
+        _pos += n;
+        return true;
+    }
+
+    inline void run(uint32_t ms) {
+        for (uint32_t elapsed = 0; elapsed < ms && frame(); elapsed += AFE_FRAME / 16) {}
+    }
+
+    inline size_t position() const { return _pos; }
+
+private:
+    AfeTap& _tap;
+    const Fixtures::Clip& _clip;
+    size_t _pos;
+};
+
+// The pre-roll step of micAudioCallback: rewind to the wake word mark, bounded by the history
+static size_t replay(AfeTap& tap, AfeTap::Reader& reader, uint32_t mark) {
+    size_t since = tap.position() - mark;
+    return reader.rewind(since < AFE_TAP_HISTORY_SAMPLES ? since : AFE_TAP_HISTORY_SAMPLES);
+}
+
+// Read everything the session would send while capture continues to the end of the clip
+static std::vector<int16_t> drain(Capture& capture, AfeTap::Reader& reader, unsigned long* firstTimestamp) {
+    std::vector<int16_t> sent;
+    int16_t chunk[300]; // Not a multiple of the AFE frame, like the uplink's resampler passes
+    bool first = true;
+    do {
+        size_t got;
+        AfeTap::FrameInfo info;
+        while ((got = reader.read(chunk, 300, &info)) > 0) {
+            if (first && firstTimestamp) *firstTimestamp = info.timestamp;
+            first = false;
+            sent.insert(sent.end(), chunk, chunk + got);
+        }
+    } while (capture.frame());
+    return sent;
+}
+
+static Fixtures::Clip utterance() {
+    Fixtures::Script script(16000, 11);
+    script.speech(700, 8000.0f, 180.0f) // The wake word
+        .silence(150)
+        .speech(1400)
+        .silence(300)
+        .speech(900, 7000.0f, 120.0f)
+        .silence(500);
+    return script.wav();
+}
+
+void setUp() { HostClock::set(0); }
+void tearDown() {}
+
+void test_wav_fixture_round_trip() {
+    Fixtures::Script script;
+    script.silence(100).speech(250);
+    Fixtures::Clip decoded;
+    TEST_ASSERT_TRUE(Fixtures::decodeWav(Fixtures::encodeWav(script.clip()), decoded));
+    TEST_ASSERT_EQUAL(16000, decoded.rate);
+    TEST_ASSERT_EQUAL(script.clip().pcm.size(), decoded.pcm.size());
+    TEST_ASSERT_EQUAL_MEMORY(script.clip().pcm.data(), decoded.pcm.data(), decoded.pcm.size() * 2);
+}
+
+void test_no_samples_lost_across_handoff() {
+    const uint32_t connectDelays[] = {0, 96, 350, 800, 1500, 1900};
+    Fixtures::Clip clip = utterance();
+    Fixtures::dump("preroll_utterance", clip);
+
+    for (uint32_t connectMs : connectDelays) {
+        HostClock::set(0);
+        AfeTap tap;
+        TEST_ASSERT_TRUE(tap.init(AFE_FRAME, AFE_TAP_HISTORY_SAMPLES));
+        Capture capture(tap, clip);
+
+        // Wake word fires at the end of the first segment
+        capture.run(704);
+        uint32_t mark = tap.position();
+        unsigned long wakeTime = millis();
+        size_t markSample = capture.position();
+
+        // The session connects while capture goes on
+        capture.run(connectMs);
+        AfeTap::Reader reader = tap.reader();
+        size_t queued = replay(tap, reader, mark);
+        TEST_ASSERT_EQUAL(tap.position() - mark, queued);
+
+        unsigned long firstTimestamp = 0;
+        std::vector<int16_t> sent = drain(capture, reader, &firstTimestamp);
+
+        // Exactly the audio after the wake word, once, in order
+        TEST_ASSERT_EQUAL(clip.pcm.size() - markSample, sent.size());
+        TEST_ASSERT_EQUAL_MEMORY(clip.pcm.data() + markSample, sent.data(), sent.size() * 2);
+        TEST_ASSERT_EQUAL(0, reader.overruns());
+
+        // The first frame sent is the one captured right after the wake word
+        if (queued > 0) TEST_ASSERT_UINT_WITHIN(AFE_FRAME / 16, wakeTime, firstTimestamp);
+
+        char line[96];
+        snprintf(line, sizeof(line), "connect %4lu ms: %5d samples replayed, %d sent",
+            (unsigned long)connectMs, (int)queued, (int)sent.size());
+        TEST_MESSAGE(line);
+    }
+}
+
+void test_mark_older_than_history_keeps_newest() {
+    Fixtures::Script script(16000, 5);
+    script.speech(600).speech(4000, 6000.0f, 200.0f);
+    Fixtures::Clip clip = script.wav();
+
+    AfeTap tap;
+    TEST_ASSERT_TRUE(tap.init(AFE_FRAME, AFE_TAP_HISTORY_SAMPLES));
+    Capture capture(tap, clip);
+    capture.run(608);
+    uint32_t mark = tap.position();
+
+    // Connecting took longer than the history holds
+    capture.run(2600);
+    size_t since = tap.position() - mark;
+    AfeTap::Reader reader = tap.reader();
+    size_t queued = replay(tap, reader, mark);
+    TEST_ASSERT_LESS_THAN(since, queued);
+    TEST_ASSERT_GREATER_OR_EQUAL(AFE_TAP_HISTORY_SAMPLES - AFE_FRAME, queued);
+    TEST_ASSERT_LESS_OR_EQUAL(AFE_TAP_HISTORY_SAMPLES, queued);
+
+    // What is sent is the newest history followed by live audio, without gaps
+    size_t start = capture.position() - queued;
+    std::vector<int16_t> sent = drain(capture, reader, nullptr);
+    TEST_ASSERT_EQUAL(clip.pcm.size() - start, sent.size());
+    TEST_ASSERT_EQUAL_MEMORY(clip.pcm.data() + start, sent.data(), sent.size() * 2);
+}
+
+void test_reader_without_mark_starts_live() {
+    Fixtures::Clip clip = utterance();
+    AfeTap tap;
+    TEST_ASSERT_TRUE(tap.init(AFE_FRAME, AFE_TAP_HISTORY_SAMPLES));
+    Capture capture(tap, clip);
+    capture.run(1000);
+
+    size_t live = capture.position();
+    AfeTap::Reader reader = tap.reader();
+    std::vector<int16_t> sent = drain(capture, reader, nullptr);
+    TEST_ASSERT_EQUAL(clip.pcm.size() - live, sent.size());
+    TEST_ASSERT_EQUAL_MEMORY(clip.pcm.data() + live, sent.data(), sent.size() * 2);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wav_fixture_round_trip);
+    RUN_TEST(test_no_samples_lost_across_handoff);
+    RUN_TEST(test_mark_older_than_history_keeps_newest);
+    RUN_TEST(test_reader_without_mark_starts_live);
+    return UNITY_END();
+}
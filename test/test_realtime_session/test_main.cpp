@@ -0,0 +1,451 @@
+#include <unity.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "app/network/RealtimeSession.h"
+
+RealtimeSession session;
+static NetworkClientSecure* sessionSocket = nullptr;
+
+static NetworkClientSecure& socket() { return *sessionSocket; }
+
+typedef std::vector<uint8_t> Bytes;
+
+// Server text frame, unmasked
+static Bytes frame(const std::string& text, uint8_t opcode = WS_OPCODE_TEXT) {
+    Bytes out;
+    out.push_back(0x80 | opcode);
+    size_t len = text.size();
+    if (len > 65535) {
+        out.push_back(127);
+        for (int i = 7; i >= 0; i--) out.push_back((uint64_t)len >> (i * 8));
+    } else if (len >= 126) {
+        out.push_back(126);
+        out.push_back(len >> 8);
+        out.push_back(len);
+    } else {
+        out.push_back(len);
+    }
+    out.insert(out.end(), text.begin(), text.end());
+    return out;
+}
+
+// Text payloads of the client frames written so far, unmasked
+static std::vector<std::string> sentMessages() {
+    std::vector<std::string> messages;
+    const Bytes& out = socket().written;
+    size_t pos = 0;
+    while (pos + 2 <= out.size()) {
+        uint64_t len = out[pos + 1] & 0x7F;
+        pos += 2;
+        if (len == 126) {
+            len = (out[pos] << 8) | out[pos + 1];
+            pos += 2;
+        } else if (len == 127) {
+            len = 0;
+            for (int i = 0; i < 8; i++) len = (len << 8) | out[pos + i];
+            pos += 8;
+        }
+        const uint8_t* key = &out[pos];
+        pos += 4;
+        std::string message(len, '\0');
+        for (size_t i = 0; i < len; i++) message[i] = out[pos + i] ^ key[i & 3];
+        pos += len;
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+// 24kHz tone, what a response.output_audio.delta carries
+static Bytes tone(size_t samples, size_t offset) {
+    Bytes pcm(samples * 2);
+    for (size_t i = 0; i < samples; i++) {
+        int16_t s = (int16_t)(8000 * sin(2 * PI * 440 * (i + offset) / 24000.0));
+        pcm[2 * i] = s;
+        pcm[2 * i + 1] = s >> 8;
+    }
+    return pcm;
+}
+
+static std::string base64Of(const Bytes& data) { return base64::encode(data.data(), data.size()).c_str(); }
+
+static std::string audioDelta(const Bytes& pcm) {
+    return "{\"type\":\"response.output_audio.delta\",\"event_id\":\"event_1\",\"response_id\":\"resp_1\",\"item_id\":\"item_1\","
+        "\"output_index\":0,\"content_index\":0,\"delta\":\"" + base64Of(pcm) + "\"}";
+}
+
+/**
+ * Server side of a recorded session: per response a few small events,
+ * transcript deltas and the audio in deltas of 50 to 400 ms
+ */
+struct Transcript {
+    std::vector<std::string> messages;
+    std::vector<bool> audio;
+    Bytes pcm;
+    size_t events = 0;
+
+    void add(const std::string& message, bool isAudio) {
+        messages.push_back(message);
+        audio.push_back(isAudio);
+        if (!isAudio) events++;
+    }
+
+    static Transcript record(size_t responses) {
+        Transcript t;
+        t.add("{\"type\":\"session.created\",\"event_id\":\"event_0\",\"session\":{\"type\":\"realtime\",\"model\":\"gpt-realtime-mini\"}}", false);
+        uint32_t seed = 3;
+        for (size_t r = 0; r < responses; r++) {
+            t.add("{\"type\":\"response.created\",\"response\":{\"id\":\"resp_1\",\"status\":\"in_progress\"}}", false);
+            for (int i = 0; i < 6; i++) {
+                seed = seed * 1664525u + 1013904223u;
+                size_t samples = 1200 + (seed >> 8) % 8400;
+                Bytes pcm = tone(samples, t.pcm.size() / 2);
+                t.add(audioDelta(pcm), true);
+                t.pcm.insert(t.pcm.end(), pcm.begin(), pcm.end());
+                t.add("{\"type\":\"response.output_audio_transcript.delta\",\"delta\":\"Halo, \\\"apa\\\" kabar?\"}", false);
+            }
+            t.add("{\"type\":\"response.output_audio.done\",\"response_id\":\"resp_1\"}", false);
+            t.add("{\"type\":\"response.done\",\"response\":{\"id\":\"resp_1\",\"status\":\"completed\",\"output\":[]}}", false);
+        }
+        return t;
+    }
+};
+
+static Bytes received;
+static size_t sinkCalls = 0;
+static size_t lastChunks = 0;
+static bool endedWithLastChunk = false;
+static std::vector<std::string> eventTypes;
+static std::vector<std::string> eventJson;
+static int opened = 0;
+static int closed = 0;
+
+static void sink(const uint8_t* audioData, size_t audioSize, bool isLastChunk) {
+    if (audioData) received.insert(received.end(), audioData, audioData + audioSize);
+    sinkCalls++;
+    if (isLastChunk) lastChunks++;
+    endedWithLastChunk = isLastChunk;
+}
+
+static void onEvent(const char* type, const char* json, size_t len, void* arg) {
+    eventTypes.push_back(type);
+    eventJson.push_back(std::string(json, len));
+}
+
+static void onOpen() { opened++; }
+static void onClose() { closed++; }
+
+static std::vector<Bytes> uplink;
+static size_t uplinkNext = 0;
+
+static size_t source(uint8_t* buffer, size_t maxSize) {
+    if (uplinkNext >= uplink.size()) return 0;
+    const Bytes& chunk = uplink[uplinkNext++];
+    size_t n = chunk.size() < maxSize ? chunk.size() : maxSize;
+    memcpy(buffer, chunk.data(), n);
+    return n;
+}
+
+static const RealtimeSessionCallbacks callbacks = {source, sink, onOpen, onEvent, onClose};
+
+static void serviceUntilDrained() {
+    while (socket().pendingSegments() > 0 || socket().available() > 0) {
+        if (!session.service()) break;
+    }
+}
+
+void setUp() {
+    received.clear();
+    sinkCalls = 0;
+    lastChunks = 0;
+    endedWithLastChunk = false;
+    eventTypes.clear();
+    eventJson.clear();
+    uplink.clear();
+    uplinkNext = 0;
+    opened = 0;
+    closed = 0;
+    socket().refuseConnect = false;
+    socket().discard = false;
+    TEST_ASSERT_TRUE(session.begin("sk-test"));
+    session.close();
+    closed = 0;
+}
+
+void tearDown() {}
+
+// The test plays the session task
+static void openSession() {
+    TEST_ASSERT_TRUE(session.open(callbacks));
+    socket().written.clear();
+}
+
+void test_open_connects_and_calls_on_open() {
+    TEST_ASSERT_TRUE(session.open(callbacks));
+    TEST_ASSERT_EQUAL(1, opened);
+    std::string request(socket().written.begin(), socket().written.end());
+    TEST_ASSERT_TRUE(request.find("GET " REALTIME_PATH " HTTP/1.1") == 0);
+    TEST_ASSERT_TRUE(request.find("Authorization: Bearer sk-test\r\n") != std::string::npos);
+}
+
+void test_failed_connect_skips_on_open() {
+    socket().refuseConnect = true;
+    TEST_ASSERT_FALSE(session.open(callbacks));
+    TEST_ASSERT_EQUAL(0, opened);
+    session.close();
+    TEST_ASSERT_EQUAL(1, closed);
+}
+
+void test_uplink_fills_become_append_events() {
+    openSession();
+    const size_t sizes[] = {960, 1920, 4800, 9600, 7, 1};
+    for (size_t size : sizes) uplink.push_back(tone(size / 2, 0));
+    uplink.back().resize(1);
+    uplink.insert(uplink.begin() + 2, Bytes()); // Nothing due on that pass
+
+    for (size_t i = 0; i < uplink.size(); i++) TEST_ASSERT_TRUE(session.service());
+
+    std::vector<std::string> sent = sentMessages();
+    TEST_ASSERT_EQUAL(6, sent.size());
+    size_t pcmBytes = 0;
+    for (size_t i = 0, u = 0; i < sent.size(); i++, u++) {
+        if (uplink[u].empty()) u++;
+        std::string expected = "{\"type\":\"input_audio_buffer.append\",\"audio\":\"" + base64Of(uplink[u]) + "\"}";
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), sent[i].c_str());
+        pcmBytes += uplink[u].size();
+    }
+    TEST_ASSERT_EQUAL(6, session.stats().uplinkMessages);
+    TEST_ASSERT_EQUAL(pcmBytes, session.stats().uplinkBytes);
+}
+
+void test_uplink_writes_no_heap() {
+    openSession();
+    for (int i = 0; i < 50; i++) uplink.push_back(tone(2400, i * 2400));
+    session.service(); // First pass allocates the frame buffer
+    uint32_t before = HostHeap::allocations();
+    while (uplinkNext < uplink.size()) TEST_ASSERT_TRUE(session.service());
+    TEST_ASSERT_EQUAL(before, HostHeap::allocations());
+}
+
+void test_deltas_stream_into_the_sink() {
+    openSession();
+    Transcript t = Transcript::record(3);
+    Bytes script;
+    for (const std::string& message : t.messages) {
+        Bytes f = frame(message);
+        script.insert(script.end(), f.begin(), f.end());
+    }
+    socket().dribble(script, 1460, 21);
+    serviceUntilDrained();
+
+    TEST_ASSERT_TRUE(received == t.pcm);
+    TEST_ASSERT_GREATER_THAN(t.messages.size(), sinkCalls);
+    // One end of stream per response, after its audio
+    TEST_ASSERT_EQUAL(3, lastChunks);
+    TEST_ASSERT_TRUE(endedWithLastChunk);
+    TEST_ASSERT_EQUAL(t.events, eventJson.size());
+    for (size_t i = 0, e = 0; i < t.messages.size(); i++) {
+        if (t.audio[i]) continue;
+        TEST_ASSERT_EQUAL_STRING(t.messages[i].c_str(), eventJson[e].c_str());
+        e++;
+    }
+    TEST_ASSERT_EQUAL_STRING("session.created", eventTypes[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("response.done", eventTypes.back().c_str());
+    TEST_ASSERT_EQUAL(18, session.events().audioMessages());
+    // Only small events were ever held whole, a delta at most until its type was read
+    TEST_ASSERT_LESS_OR_EQUAL(WSS_RX_CHUNK, session.events().peakJson());
+}
+
+void test_send_from_another_task_goes_out_on_the_next_pass() {
+    openSession();
+    std::thread other([] {
+        TEST_ASSERT_TRUE(session.send("{\"type\":\"response.create\"}"));
+    });
+    other.join();
+    TEST_ASSERT_EQUAL(0, socket().written.size());
+
+    TEST_ASSERT_TRUE(session.service());
+    std::vector<std::string> sent = sentMessages();
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL_STRING("{\"type\":\"response.create\"}", sent[0].c_str());
+    TEST_ASSERT_EQUAL(1, session.stats().sent);
+}
+
+void test_full_outbox_drops() {
+    openSession();
+    for (int i = 0; i < REALTIME_OUTBOX_DEPTH; i++) TEST_ASSERT_TRUE(session.send("{}"));
+    TEST_ASSERT_FALSE(session.send("{}"));
+    TEST_ASSERT_EQUAL(1, session.stats().dropped);
+    TEST_ASSERT_TRUE(session.service());
+    TEST_ASSERT_EQUAL(REALTIME_OUTBOX_DEPTH, sentMessages().size());
+}
+
+void test_stop_ends_the_session() {
+    openSession();
+    TEST_ASSERT_TRUE(session.service());
+    session.stop();
+    TEST_ASSERT_FALSE(session.service());
+    session.close();
+    TEST_ASSERT_EQUAL(1, closed);
+    TEST_ASSERT_FALSE(socket().connected());
+}
+
+void test_server_close_ends_the_session() {
+    openSession();
+    socket().receive(frame(std::string("\x03\xE8", 2), WS_OPCODE_CLOSE));
+    TEST_ASSERT_FALSE(session.service());
+}
+
+void test_preconnect_is_reused_by_open() {
+    uint32_t connects = socket().connects;
+    uint32_t used = session.preconnectsUsed();
+    TEST_ASSERT_TRUE(session.preconnect(1000));
+    TEST_ASSERT_EQUAL(connects + 1, socket().connects);
+    TEST_ASSERT_TRUE(session.open(callbacks));
+    TEST_ASSERT_EQUAL(connects + 1, socket().connects);
+    TEST_ASSERT_EQUAL(used + 1, session.preconnectsUsed());
+}
+
+void test_preconnect_has_its_own_timeout() {
+    TEST_ASSERT_TRUE(session.preconnect(1000, 1500));
+    TEST_ASSERT_EQUAL(1500, socket().connectTimeout);
+    TEST_ASSERT_EQUAL(WSS_HANDSHAKE_TIMEOUT_S, socket().handshakeTimeout);
+    socket().stop(); // Server went away
+
+    socket().refuseConnect = true;
+    TEST_ASSERT_FALSE(session.preconnect(1000, 1500));
+    socket().refuseConnect = false;
+    TEST_ASSERT_EQUAL(WSS_HANDSHAKE_TIMEOUT_S, socket().handshakeTimeout);
+}
+
+void test_unused_preconnect_expires() {
+    uint32_t expired = session.preconnectsExpired();
+    TEST_ASSERT_TRUE(session.preconnect(1000));
+    session.expirePreconnect();
+    TEST_ASSERT_TRUE(socket().connected());
+    delay(1000);
+    session.expirePreconnect();
+    TEST_ASSERT_FALSE(socket().connected());
+    TEST_ASSERT_EQUAL(expired + 1, session.preconnectsExpired());
+}
+
+// The route before streaming: reassemble the message, copy the delta string out
+// as a JsonDocument would, then decode it whole
+static size_t wholeMessagePeak = 0;
+static Bytes wholeMessagePcm;
+
+static void decodeWhole(uint8_t opcode, const uint8_t* data, size_t len, void* arg) {
+    std::string message((const char*)data, len);
+    size_t peak = len + 1;
+    size_t start = message.find("\"delta\":\"");
+    if (message.find("output_audio.delta") != std::string::npos && start != std::string::npos) {
+        size_t end = message.find('"', start + 9);
+        std::string delta = message.substr(start + 9, end - start - 9);
+        peak += delta.size() + 1;
+        static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        Bytes pcm;
+        uint32_t quad = 0;
+        int count = 0;
+        for (char c : delta) {
+            size_t v = alphabet.find(c);
+            if (v == std::string::npos) continue;
+            quad = (quad << 6) | v;
+            if (++count == 4) {
+                pcm.push_back(quad >> 16);
+                pcm.push_back(quad >> 8);
+                pcm.push_back(quad);
+                count = 0;
+            }
+        }
+        if (count == 2) pcm.push_back(quad >> 4);
+        else if (count == 3) {
+            pcm.push_back(quad >> 10);
+            pcm.push_back(quad >> 2);
+        }
+        peak += pcm.size();
+        wholeMessagePcm.insert(wholeMessagePcm.end(), pcm.begin(), pcm.end());
+    }
+    if (peak > wholeMessagePeak) wholeMessagePeak = peak;
+}
+
+/**
+ * Replays a recorded session one TCP segment per pass, against the whole-message route
+ */
+void test_replay_benchmark() {
+    Transcript t = Transcript::record(20);
+    openSession();
+
+    // Streaming: bytes of each delta that had to arrive before its first audio
+    size_t audioMessages = 0;
+    size_t firstAudioBytes = 0;
+    size_t largestDelta = 0;
+    size_t deltaBytes = 0;
+    double streamSeconds = 0;
+    for (size_t i = 0; i < t.messages.size(); i++) {
+        Bytes f = frame(t.messages[i]);
+        size_t before = received.size();
+        size_t firstAt = 0;
+        double start = Bench::seconds();
+        for (size_t pos = 0; pos < f.size(); pos += 1460) {
+            size_t n = f.size() - pos < 1460 ? f.size() - pos : 1460;
+            socket().receive(f.data() + pos, n);
+            TEST_ASSERT_TRUE(session.service());
+            if (!firstAt && received.size() > before) firstAt = pos + n;
+        }
+        streamSeconds += Bench::seconds() - start;
+        if (t.audio[i]) {
+            audioMessages++;
+            firstAudioBytes += firstAt;
+            deltaBytes += f.size();
+            if (f.size() > largestDelta) largestDelta = f.size();
+        }
+    }
+    TEST_ASSERT_TRUE(received == t.pcm);
+    size_t streamPeak = session.events().peakJson() + REALTIME_AUDIO_CHUNK + WSS_RX_CHUNK;
+
+    // Whole message: onMessage gets the reassembled payload
+    WebSocketClientSSL whole;
+    NetworkClientSecure& wholeSocket = *NetworkClientSecure::last();
+    whole.onMessage(decodeWhole);
+    TEST_ASSERT_TRUE(whole.connect("realtime.test", 443, "/"));
+    double wholeSeconds = 0;
+    for (size_t i = 0; i < t.messages.size(); i++) {
+        Bytes f = frame(t.messages[i]);
+        double start = Bench::seconds();
+        for (size_t pos = 0; pos < f.size(); pos += 1460) {
+            wholeSocket.receive(f.data() + pos, f.size() - pos < 1460 ? f.size() - pos : 1460);
+            whole.poll();
+        }
+        wholeSeconds += Bench::seconds() - start;
+    }
+    TEST_ASSERT_TRUE(wholeMessagePcm == t.pcm);
+    wholeMessagePeak += largestDelta; // The reassembly buffer grows to the largest message and stays
+
+    double audioSeconds = t.pcm.size() / 2 / 24000.0;
+    printf("Replayed %zu messages, %zu audio deltas, %.1f s of audio\n", t.messages.size(), audioMessages, audioSeconds);
+    printf("  streamed:      peak %6zu bytes, first audio after %5zu bytes of a delta on average, %.2f ms CPU\n",
+        streamPeak, firstAudioBytes / audioMessages, streamSeconds * 1000);
+    printf("  whole message: peak %6zu bytes, first audio after %5zu bytes (the whole delta), %.2f ms CPU\n",
+        wholeMessagePeak, deltaBytes / audioMessages, wholeSeconds * 1000);
+    TEST_ASSERT_LESS_THAN(wholeMessagePeak / 10, streamPeak);
+}
+
+int main(int argc, char** argv) {
+    sessionSocket = NetworkClientSecure::last();
+    UNITY_BEGIN();
+    RUN_TEST(test_open_connects_and_calls_on_open);
+    RUN_TEST(test_failed_connect_skips_on_open);
+    RUN_TEST(test_uplink_fills_become_append_events);
+    RUN_TEST(test_uplink_writes_no_heap);
+    RUN_TEST(test_deltas_stream_into_the_sink);
+    RUN_TEST(test_send_from_another_task_goes_out_on_the_next_pass);
+    RUN_TEST(test_full_outbox_drops);
+    RUN_TEST(test_stop_ends_the_session);
+    RUN_TEST(test_server_close_ends_the_session);
+    RUN_TEST(test_preconnect_is_reused_by_open);
+    RUN_TEST(test_preconnect_has_its_own_timeout);
+    RUN_TEST(test_unused_preconnect_expires);
+    RUN_TEST(test_replay_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,168 @@
+#include <unity.h>
+#include <new>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "WebSocketClientSSL.h"
+#include "app/network/RealtimeAudioWriter.h"
+
+// Every operator new, String and std::string included
+static size_t newCalls = 0;
+void* operator new(size_t size) {
+    newCalls++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+WebSocketClientSSL ws;
+
+static NetworkClientSecure& socket() { return *NetworkClientSecure::last(); }
+
+typedef RealtimeAudioWriter<RealtimeInputAudioAppend> AppendWriter;
+
+// Plain per-character encoder, the shape of the Arduino base64 helper
+static std::string referenceBase64(const uint8_t* data, size_t len) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += alphabet[(v >> 6) & 63];
+        out += alphabet[v & 63];
+    }
+    if (len - i == 1) {
+        uint32_t v = data[i] << 16;
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += "==";
+    } else if (len - i == 2) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8);
+        out += alphabet[v >> 18];
+        out += alphabet[(v >> 12) & 63];
+        out += alphabet[(v >> 6) & 63];
+        out += '=';
+    }
+    return out;
+}
+
+/**
+ * The route before the writer: a document holding the base64 String,
+ * serialized into another String, then copied into the frame. The
+ * ArduinoJson document is stood in for by a key/value list, it is not
+ * available to the host build; its own allocations would only add up.
+ */
+static bool jsonRoute(const uint8_t* pcm, size_t len) {
+    String audio = base64::encode(pcm, len);
+    std::vector<std::pair<String, String>> doc;
+    doc.reserve(2);
+    doc.push_back({"type", "input_audio_buffer.append"});
+    doc.push_back({"audio", audio});
+    String message;
+    for (auto& field : doc) {
+        message += message.length() ? "," : "{";
+        message += "\"" + field.first + "\":\"" + field.second + "\"";
+    }
+    message += "}";
+    return ws.sendMessage(message);
+}
+
+static std::vector<uint8_t> pcmOf(size_t len) {
+    std::vector<uint8_t> pcm(len);
+    uint32_t seed = 17;
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        pcm[i] = seed >> 24;
+    }
+    return pcm;
+}
+
+void setUp() {
+    if (!ws.isConnected()) TEST_ASSERT_TRUE(ws.connect("realtime.test", 443, "/v1/realtime"));
+    socket().written.clear();
+    socket().discard = false;
+}
+
+void tearDown() {}
+
+void test_kernel_matches_reference_for_every_tail() {
+    std::vector<uint8_t> pcm = pcmOf(100);
+    for (size_t len = 0; len < pcm.size(); len++) {
+        std::vector<uint8_t> out(Base64Kernel::encodedSize(len));
+        size_t n = Base64Kernel::encode(pcm.data(), len, out.data());
+        TEST_ASSERT_EQUAL(out.size(), n);
+        TEST_ASSERT_EQUAL_STRING(referenceBase64(pcm.data(), len).c_str(), std::string(out.begin(), out.end()).c_str());
+    }
+}
+
+void test_frames_match_the_json_route() {
+    std::vector<uint8_t> pcm = pcmOf(9600);
+    const size_t sizes[] = {0, 1, 2, 383, 384, 385, 960, 1920, 4800, 9600};
+    for (size_t len : sizes) {
+        socket().written.clear();
+        randomSeed(5);
+        TEST_ASSERT_TRUE(jsonRoute(pcm.data(), len));
+        std::vector<uint8_t> expected = socket().written;
+
+        socket().written.clear();
+        randomSeed(5);
+        TEST_ASSERT_TRUE(AppendWriter::send(ws, pcm.data(), len));
+        TEST_ASSERT_EQUAL(expected.size(), socket().written.size());
+        TEST_ASSERT_TRUE(expected == socket().written);
+        size_t payload = AppendWriter::messageSize(len);
+        TEST_ASSERT_EQUAL(payload + (payload < 126 ? 6 : payload <= 65535 ? 8 : 14), expected.size());
+    }
+}
+
+void test_writer_does_not_allocate() {
+    std::vector<uint8_t> pcm = pcmOf(9600);
+    socket().discard = true;
+    TEST_ASSERT_TRUE(AppendWriter::send(ws, pcm.data(), pcm.size()));
+    size_t heapBefore = HostHeap::allocations();
+    size_t newBefore = newCalls;
+    for (int i = 0; i < 100; i++) TEST_ASSERT_TRUE(AppendWriter::send(ws, pcm.data(), 960 * (1 + i % 10)));
+    TEST_ASSERT_EQUAL(heapBefore, HostHeap::allocations());
+    TEST_ASSERT_EQUAL(newBefore, newCalls);
+}
+
+/**
+ * Append messages of 20 to 200 ms at 24kHz, writer against the JSON route
+ */
+void test_benchmark_against_the_json_route() {
+    std::vector<uint8_t> pcm = pcmOf(9600);
+    socket().discard = true;
+    TEST_ASSERT_TRUE(AppendWriter::send(ws, pcm.data(), 0)); // Frame buffer allocated up front
+    const size_t sizes[] = {960, 1920, 4800, 9600};
+    const int reps = 5000;
+    for (size_t len : sizes) {
+        size_t allocBefore = newCalls + HostHeap::allocations();
+        double start = Bench::seconds();
+        for (int i = 0; i < reps; i++) jsonRoute(pcm.data(), len);
+        double jsonSeconds = Bench::seconds() - start;
+        double jsonAllocs = (double)(newCalls + HostHeap::allocations() - allocBefore) / reps;
+
+        allocBefore = newCalls + HostHeap::allocations();
+        start = Bench::seconds();
+        for (int i = 0; i < reps; i++) AppendWriter::send(ws, pcm.data(), len);
+        double writerSeconds = Bench::seconds() - start;
+        double writerAllocs = (double)(newCalls + HostHeap::allocations() - allocBefore) / reps;
+
+        printf("%5zu B PCM: JSON route %6.0f MB/s, %4.1f allocations/message | writer %6.0f MB/s, %4.1f allocations/message\n",
+            len, reps * (double)len / jsonSeconds / 1e6, jsonAllocs, reps * (double)len / writerSeconds / 1e6, writerAllocs);
+        TEST_ASSERT_EQUAL(0, (int)writerAllocs);
+        TEST_ASSERT_GREATER_THAN(0, (int)jsonAllocs);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_kernel_matches_reference_for_every_tail);
+    RUN_TEST(test_frames_match_the_json_route);
+    RUN_TEST(test_writer_does_not_allocate);
+    RUN_TEST(test_benchmark_against_the_json_route);
+    return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "bench.h"
+#include "app/audio/converter.h"
+#include "app/audio/resampler.h"
+
+struct RatePair {
+    uint32_t in;
+    uint32_t out;
+};
+
+static const RatePair RATES[] = {
+    {16000, 24000}, {24000, 16000}, {22050, 16000}, {44100, 16000}, {16000, 44100}
+};
+
+static std::vector<int16_t> tone(uint32_t rate, float hz, float amplitude, size_t samples) {
+    std::vector<int16_t> pcm(samples);
+    for (size_t i = 0; i < samples; i++) {
+        pcm[i] = (int16_t)lroundf(amplitude * sinf(2.0f * (float)M_PI * hz * i / rate));
+    }
+    return pcm;
+}
+
+static size_t whole(AudioResampler& rs, const std::vector<int16_t>& in, std::vector<int16_t>& out) {
+    out.resize(rs.maxOutputSize(in.size()));
+    return rs.process(in.data(), in.size(), out.data(), out.size());
+}
+
+// Peak of the second half, past the filter warm-up
+static int steadyPeak(const std::vector<int16_t>& pcm, size_t n) {
+    int peak = 0;
+    for (size_t i = n / 2; i < n; i++) peak = std::max(peak, abs((int)pcm[i]));
+    return peak;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_chunked_matches_whole() {
+    for (const RatePair& rate : RATES) {
+        std::vector<int16_t> in = tone(rate.in, 440.0f, 12000.0f, 48000);
+        AudioResampler a(rate.in, rate.out);
+        AudioResampler b(rate.in, rate.out);
+        TEST_ASSERT_TRUE(a.isReady());
+        TEST_ASSERT_TRUE(b.isReady());
+
+        std::vector<int16_t> expected;
+        size_t n = whole(a, in, expected);
+
+        // Uneven chunks, including single samples
+        std::vector<int16_t> chunked(n + 64);
+        size_t produced = 0;
+        size_t pos = 0;
+        size_t chunk = 37;
+        while (pos < in.size()) {
+            size_t len = std::min(chunk, in.size() - pos);
+            size_t consumed = 0;
+            produced += b.process(in.data() + pos, len, chunked.data() + produced, chunked.size() - produced, &consumed);
+            TEST_ASSERT_EQUAL(len, consumed);
+            pos += consumed;
+            chunk = (chunk * 7) % 500 + 1;
+        }
+
+        TEST_ASSERT_EQUAL(n, produced);
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), chunked.data(), n * sizeof(int16_t));
+    }
+}
+
+void test_output_length_follows_ratio() {
+    for (const RatePair& rate : RATES) {
+        AudioResampler rs(rate.in, rate.out);
+        std::vector<int16_t> in(rate.in); // One second
+        std::vector<int16_t> out;
+        size_t n = whole(rs, in, out);
+        TEST_ASSERT_INT_WITHIN(2, rate.out, n);
+    }
+}
+
+void test_passband_amplitude_kept() {
+    for (const RatePair& rate : RATES) {
+        AudioResampler rs(rate.in, rate.out);
+        std::vector<int16_t> in = tone(rate.in, 440.0f, 12000.0f, 48000);
+        std::vector<int16_t> out;
+        size_t n = whole(rs, in, out);
+        // Within 0.5 dB of the input peak
+        TEST_ASSERT_INT_WITHIN(12000 * 6 / 100, 12000, steadyPeak(out, n));
+    }
+}
+
+void test_stopband_attenuated() {
+    // 11 kHz is above the 8 kHz Nyquist of the 16k output
+    AudioResampler rs(44100, 16000);
+    std::vector<int16_t> in = tone(44100, 11000.0f, 16000.0f, 44100);
+    std::vector<int16_t> out;
+    size_t n = whole(rs, in, out);
+    // At least 30 dB down
+    TEST_ASSERT_LESS_THAN(16000 / 31, steadyPeak(out, n));
+}
+
+void test_reset_restarts_stream() {
+    AudioResampler rs(16000, 24000);
+    std::vector<int16_t> in = tone(16000, 1000.0f, 8000.0f, 4000);
+    std::vector<int16_t> first;
+    std::vector<int16_t> second;
+    size_t n1 = whole(rs, in, first);
+    rs.reset();
+    size_t n2 = whole(rs, in, second);
+    TEST_ASSERT_EQUAL(n1, n2);
+    TEST_ASSERT_EQUAL_MEMORY(first.data(), second.data(), n1 * sizeof(int16_t));
+}
+
+void test_passthrough_copies() {
+    AudioResampler rs(16000, 16000);
+    TEST_ASSERT_TRUE(rs.isPassthrough());
+    std::vector<int16_t> in = tone(16000, 440.0f, 10000.0f, 1000);
+    std::vector<int16_t> out;
+    size_t n = whole(rs, in, out);
+    TEST_ASSERT_EQUAL(in.size(), n);
+    TEST_ASSERT_EQUAL_MEMORY(in.data(), out.data(), n * sizeof(int16_t));
+}
+
+void test_small_output_buffer_stops_early() {
+    AudioResampler rs(16000, 24000);
+    std::vector<int16_t> in = tone(16000, 440.0f, 10000.0f, 320);
+    int16_t out[100];
+    size_t consumed = 0;
+    size_t n = rs.process(in.data(), in.size(), out, 100, &consumed);
+    TEST_ASSERT_LESS_OR_EQUAL(100, n);
+    TEST_ASSERT_LESS_THAN(in.size(), consumed);
+}
+
+void bench_throughput() {
+    const int rounds = 20;
+    for (const RatePair& rate : RATES) {
+        AudioResampler rs(rate.in, rate.out);
+        std::vector<int16_t> in = tone(rate.in, 440.0f, 12000.0f, 48000);
+        std::vector<int16_t> out(rs.maxOutputSize(in.size()));
+
+        double start = Bench::seconds();
+        for (int i = 0; i < rounds; i++) {
+            rs.reset();
+            Bench::keep(rs.process(in.data(), in.size(), out.data(), out.size()));
+        }
+        double elapsed = Bench::seconds() - start;
+
+        char line[96];
+        snprintf(line, sizeof(line), "%5lu -> %5lu: %.1f Msamples/s in",
+            (unsigned long)rate.in, (unsigned long)rate.out, rounds * in.size() / elapsed / 1e6);
+        TEST_MESSAGE(line);
+    }
+}
+
+// The paths before AudioResampler called the converter once per chunk, with rates in whole kHz
+static size_t converterChunks(const RatePair& rate, const std::vector<int16_t>& in, size_t chunk, std::vector<int16_t>& out) {
+    uint32_t inKhz = rate.in / 1000, outKhz = rate.out / 1000;
+    out.resize(AudioBufferConverter::calculateOutputSize(inKhz, outKhz, in.size()) + in.size() / chunk + 1);
+    size_t n = 0;
+    for (size_t pos = 0; pos < in.size(); pos += chunk) {
+        size_t len = std::min(chunk, in.size() - pos);
+        int written = AudioBufferConverter::convert(inKhz, outKhz, in.data() + pos, len, out.data() + n, out.size() - n);
+        if (written > 0) n += written;
+    }
+    return n;
+}
+
+// Largest difference to a reference, over the samples both hold
+static int largestError(const std::vector<int16_t>& pcm, size_t n, const std::vector<int16_t>& reference, size_t m) {
+    int error = 0;
+    for (size_t i = 0; i < std::min(n, m); i++) error = std::max(error, abs(pcm[i] - reference[i]));
+    return error;
+}
+
+/**
+ * AudioResampler against the AudioBufferConverter path it replaced, both
+ * fed 20 ms chunks: throughput, how far the chunked output strays from a
+ * single call over the whole tone (the converter stretches every chunk
+ * onto its endpoints) and the level of an 11 kHz tone folded below the
+ * 8 kHz Nyquist of 44.1k -> 16k
+ */
+void bench_against_converter() {
+    const int rounds = 20;
+    char line[128];
+    for (const RatePair& rate : RATES) {
+        size_t chunk = rate.in / 50;
+        std::vector<int16_t> in = tone(rate.in, 440.0f, 12000.0f, 48000);
+        std::vector<int16_t> resampled(AudioResampler(rate.in, rate.out).maxOutputSize(chunk) * (in.size() / chunk + 1));
+        std::vector<int16_t> converted;
+
+        AudioResampler rs(rate.in, rate.out);
+        size_t resampledCount = 0;
+        double start = Bench::seconds();
+        for (int r = 0; r < rounds; r++) {
+            rs.reset();
+            resampledCount = 0;
+            for (size_t pos = 0; pos < in.size(); pos += chunk) {
+                size_t len = std::min(chunk, in.size() - pos);
+                resampledCount += rs.process(in.data() + pos, len, resampled.data() + resampledCount, resampled.size() - resampledCount);
+            }
+            Bench::keep(resampled);
+        }
+        double resamplerSeconds = Bench::seconds() - start;
+
+        size_t convertedCount = 0;
+        start = Bench::seconds();
+        for (int r = 0; r < rounds; r++) {
+            convertedCount = converterChunks(rate, in, chunk, converted);
+            Bench::keep(converted);
+        }
+        double converterSeconds = Bench::seconds() - start;
+
+        AudioResampler once(rate.in, rate.out);
+        std::vector<int16_t> resampledOnce;
+        size_t resampledOnceCount = whole(once, in, resampledOnce);
+        std::vector<int16_t> convertedOnce;
+        size_t convertedOnceCount = converterChunks(rate, in, in.size(), convertedOnce);
+        int resamplerSeams = largestError(resampled, resampledCount, resampledOnce, resampledOnceCount);
+        int converterSeams = largestError(converted, convertedCount, convertedOnce, convertedOnceCount);
+
+        snprintf(line, sizeof(line), "%5lu -> %5lu: resampler %5.1f, converter %5.1f Msamples/s in; seams %5d vs %5d",
+            (unsigned long)rate.in, (unsigned long)rate.out,
+            rounds * in.size() / resamplerSeconds / 1e6, rounds * in.size() / converterSeconds / 1e6,
+            resamplerSeams, converterSeams);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_EQUAL(0, resamplerSeams);
+        TEST_ASSERT_GREATER_THAN(0, converterSeams);
+    }
+
+    RatePair down = {44100, 16000};
+    std::vector<int16_t> alias = tone(down.in, 11000.0f, 16000.0f, 44100);
+    std::vector<int16_t> resampled;
+    AudioResampler rs(down.in, down.out);
+    size_t resampledCount = whole(rs, alias, resampled);
+    std::vector<int16_t> converted;
+    size_t convertedCount = converterChunks(down, alias, down.in / 50, converted);
+    int resampledPeak = steadyPeak(resampled, resampledCount);
+    int convertedPeak = steadyPeak(converted, convertedCount);
+    snprintf(line, sizeof(line), "11 kHz at 44.1k -> 16k: resampler %.1f dB, converter %.1f dB",
+        20 * log10(std::max(resampledPeak, 1) / 16000.0), 20 * log10(std::max(convertedPeak, 1) / 16000.0));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN(convertedPeak, resampledPeak);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_chunked_matches_whole);
+    RUN_TEST(test_output_length_follows_ratio);
+    RUN_TEST(test_passband_amplitude_kept);
+    RUN_TEST(test_stopband_attenuated);
+    RUN_TEST(test_reset_restarts_stream);
+    RUN_TEST(test_passthrough_copies);
+    RUN_TEST(test_small_output_buffer_stops_early);
+    RUN_TEST(bench_throughput);
+    RUN_TEST(bench_against_converter);
+    return UNITY_END();
+}
@@ -0,0 +1,157 @@
+#define ESP32S3_DEVKITC1_N16R8
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "app/audio/speaker.h"
+
+// Mixer tasks never end, so both speakers live for the whole run
+static Speaker mixed;
+static Speaker direct;
+
+static bool waitFor(std::function<bool()> done, int realMs = 5000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(realMs);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+static std::vector<uint32_t> rates() {
+    std::lock_guard<std::mutex> guard(I2SSpeaker::shared().lock);
+    return I2SSpeaker::shared().rates;
+}
+
+static std::vector<int16_t> tone(uint32_t rate, float hz, size_t samples) {
+    std::vector<int16_t> pcm(samples);
+    for (size_t i = 0; i < samples; i++) pcm[i] = (int16_t)(10000 * sinf(2.0f * (float)M_PI * hz * i / rate));
+    return pcm;
+}
+
+static size_t zeroCrossings(const std::vector<int16_t>& pcm) {
+    size_t count = 0;
+    for (size_t i = 1; i < pcm.size(); i++) {
+        if ((pcm[i - 1] < 0) != (pcm[i] < 0)) count++;
+    }
+    return count;
+}
+
+static bool idle() {
+    AudioMixer& mixer = mixed.getMixer();
+    for (int i = 0; i < AUDIO_CHANNEL_MAX; i++) {
+        if (mixer.channel((AUDIO_CHANNEL)i).isPlaying() || mixer.channel((AUDIO_CHANNEL)i).buffered() > 0) return false;
+    }
+    return true;
+}
+
+void setUp() {
+    I2SSpeaker::reset();
+}
+
+void tearDown() {}
+
+void test_failed_reopen_keeps_old_clock() {
+    TEST_ASSERT_EQUAL(SPEAKER_SAMPLE_RATE, mixed.getSampleRate());
+    I2SSpeaker::shared().failInits = 1;
+    mixed.setSampleRate(24000, 0);
+
+    // The 24 kHz open fails, 16 kHz is opened again
+    TEST_ASSERT_TRUE(waitFor([] { return rates().size() == 1; }));
+    TEST_ASSERT_EQUAL(16000, rates()[0]);
+    TEST_ASSERT_TRUE(waitFor([] { return mixed.getSampleRate() == 16000; }));
+    TEST_ASSERT_EQUAL(1, I2SSpeaker::shared().instances - 1); // The direct speaker holds the other one
+
+    // Audio still plays, at the right speed
+    std::vector<int16_t> pcm = tone(16000, 500.0f, 8000);
+    size_t written = 0;
+    TEST_ASSERT_TRUE(mixed.writeSamples(pcm.data(), pcm.size() * 2, &written));
+    mixed.clear();
+    TEST_ASSERT_TRUE(waitFor(idle));
+    TEST_ASSERT_INT_WITHIN(AudioMixer::BLOCK_SAMPLES, 8000, I2SSpeaker::outputSize());
+}
+
+void test_switch_follows_source_rate() {
+    mixed.setSampleRate(24000, 0);
+    TEST_ASSERT_TRUE(waitFor([] { return rates().size() == 1; }));
+    TEST_ASSERT_EQUAL(24000, rates()[0]);
+    TEST_ASSERT_EQUAL(24000, mixed.getSampleRate());
+
+    std::vector<int16_t> pcm = tone(24000, 500.0f, 12000);
+    TEST_ASSERT_TRUE(mixed.writeSamples(pcm.data(), pcm.size() * 2, nullptr, 1.0f, portMAX_DELAY, AUDIO_CHANNEL_VOICE, 24000));
+    mixed.clear();
+    TEST_ASSERT_TRUE(waitFor(idle));
+    TEST_ASSERT_INT_WITHIN(AudioMixer::BLOCK_SAMPLES, 12000, I2SSpeaker::outputSize());
+
+    mixed.setSampleRate(16000, 0);
+    TEST_ASSERT_TRUE(waitFor([] { return rates().size() == 2; }));
+}
+
+void test_stop_start_during_switches() {
+    std::atomic<bool> running(true);
+    std::thread switcher([&] {
+        for (int i = 0; i < 200 && running; i++) {
+            mixed.setSampleRate(i % 2 ? 16000 : 24000, 0);
+            std::this_thread::sleep_for(std::chrono::microseconds(300));
+        }
+        running = false;
+    });
+
+    // Every call lands on a live device, a deleted one would be counted
+    while (running) {
+        mixed.stop();
+        mixed.start();
+    }
+    switcher.join();
+    TEST_ASSERT_GREATER_THAN(10, rates().size());
+    mixed.setSampleRate(16000, 0);
+    TEST_ASSERT_TRUE(waitFor([] { return mixed.getSampleRate() == 16000; }));
+    TEST_ASSERT_EQUAL(0, I2SSpeaker::shared().writesStopped);
+    TEST_ASSERT_EQUAL(2, I2SSpeaker::shared().instances);
+}
+
+void test_direct_path_resamples() {
+    TEST_ASSERT_FALSE(direct.getMixer().isRunning());
+    std::vector<int16_t> pcm = tone(24000, 600.0f, 24000);
+    std::vector<int16_t> copy = pcm;
+    size_t written = 0;
+    TEST_ASSERT_TRUE(direct.writeSamples(pcm.data(), pcm.size() * 2, &written, 0.5f, portMAX_DELAY, AUDIO_CHANNEL_VOICE, 24000));
+    TEST_ASSERT_EQUAL(pcm.size() * 2, written);
+    TEST_ASSERT_EQUAL_MEMORY(copy.data(), pcm.data(), pcm.size() * 2);
+
+    // One second in, one second out at 16 kHz with the pitch kept
+    std::vector<int16_t> out = I2SSpeaker::output();
+    TEST_ASSERT_INT_WITHIN(2, 16000, out.size());
+    TEST_ASSERT_INT_WITHIN(zeroCrossings(pcm) / 100, zeroCrossings(pcm), zeroCrossings(out));
+    int peak = 0;
+    for (size_t i = out.size() / 2; i < out.size(); i++) peak = std::max(peak, abs((int)out[i]));
+    TEST_ASSERT_INT_WITHIN(300, 5000, peak);
+}
+
+void test_direct_path_same_rate() {
+    std::vector<int16_t> pcm = tone(16000, 600.0f, 1000);
+    size_t written = 0;
+    TEST_ASSERT_TRUE(direct.writeSamples(pcm.data(), pcm.size() * 2, &written));
+    TEST_ASSERT_EQUAL(pcm.size() * 2, written);
+    std::vector<int16_t> out = I2SSpeaker::output();
+    TEST_ASSERT_EQUAL(pcm.size(), out.size());
+    TEST_ASSERT_EQUAL_MEMORY(pcm.data(), out.data(), out.size() * 2);
+}
+
+int main(int argc, char** argv) {
+    I2SSpeaker::shared().speedup = 64;
+    if (!mixed.init() || !mixed.start()) return 1;
+    HostTasks::failCreate() = true;
+    if (!direct.init() || !direct.start()) return 1;
+    HostTasks::failCreate() = false;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_failed_reopen_keeps_old_clock);
+    RUN_TEST(test_switch_follows_source_rate);
+    RUN_TEST(test_stop_start_during_switches);
+    RUN_TEST(test_direct_path_resamples);
+    RUN_TEST(test_direct_path_same_rate);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <cstdio>
+#include <vector>
+#include "bench.h"
+#include "fixtures.h"
+#include "app_config.h"
+#include "app/audio/afetap.h"
+#include "app/audio/dtx.h"
+#include "app/audio/resampler.h"
+
+static const size_t AFE_FRAME = 512; // AFE fetch chunk, 32 ms at 16 kHz
+static const uint32_t VAD_LAG_MS = 96; // The AFE VAD reports speech this long after it starts
+
+static const UplinkDtx::Config CONFIG = {UPLINK_DTX_HANGOVER_MS * 16, UPLINK_DTX_ONSET_MS * 16, AFE_FRAME};
+
+UplinkDtx dtx;
+
+void setUp() {
+    HostClock::set(0);
+    dtx.init(CONFIG);
+}
+
+void tearDown() {}
+
+// Silence frames until suppression starts, returns the position after the last one
+static uint32_t suppress(uint32_t position) {
+    while (!dtx.suppressing()) {
+        position += AFE_FRAME;
+        dtx.next(VAD_SILENCE, AFE_FRAME, position);
+    }
+    return position;
+}
+
+void test_silence_is_sent_for_the_hangover() {
+    uint32_t position = 0;
+    size_t sent = 0;
+    for (int i = 0; i < 100; i++) {
+        position += AFE_FRAME;
+        if (dtx.next(VAD_SILENCE, AFE_FRAME, position) == UplinkDtx::DTX_SEND) sent += AFE_FRAME;
+    }
+    // Suppression starts with the frame that completes the hangover
+    TEST_ASSERT_EQUAL((CONFIG.hangoverSamples + AFE_FRAME - 1) / AFE_FRAME - 1, sent / AFE_FRAME);
+    TEST_ASSERT_TRUE(dtx.suppressing());
+}
+
+void test_onset_replay_starts_on_a_frame() {
+    uint32_t position = suppress(AFE_FRAME * 40);
+    // Speech shows up part way into a frame, as when the reader has caught up with capture
+    for (size_t got : {AFE_FRAME, (size_t)200, (size_t)1}) {
+        uint32_t after = suppress(position) + got;
+        TEST_ASSERT_EQUAL(UplinkDtx::DTX_REPLAY, dtx.next(VAD_SPEECH, got, after));
+        uint32_t start = after - dtx.replaySamples();
+        TEST_ASSERT_EQUAL(0, start % AFE_FRAME);
+        TEST_ASSERT_GREATER_OR_EQUAL(CONFIG.onsetSamples + got, dtx.replaySamples());
+        TEST_ASSERT_LESS_THAN(CONFIG.onsetSamples + got + 2 * AFE_FRAME, dtx.replaySamples());
+        position = after;
+    }
+}
+
+void test_replay_does_not_suppress_again() {
+    uint32_t after = suppress(AFE_FRAME * 40) + AFE_FRAME;
+    TEST_ASSERT_EQUAL(UplinkDtx::DTX_REPLAY, dtx.next(VAD_SPEECH, AFE_FRAME, after));
+    // The replayed padding reads as silence again, all of it is sent
+    for (uint32_t position = after - dtx.replaySamples() + AFE_FRAME; position < after; position += AFE_FRAME) {
+        TEST_ASSERT_EQUAL(UplinkDtx::DTX_SEND, dtx.next(VAD_SILENCE, AFE_FRAME, position));
+    }
+    TEST_ASSERT_EQUAL(UplinkDtx::DTX_SEND, dtx.next(VAD_SPEECH, AFE_FRAME, after));
+}
+
+void test_replay_stops_at_the_start_of_the_stream() {
+    dtx.init({AFE_FRAME, CONFIG.onsetSamples, AFE_FRAME});
+    dtx.next(VAD_SILENCE, AFE_FRAME, AFE_FRAME);
+    TEST_ASSERT_TRUE(dtx.suppressing());
+    TEST_ASSERT_EQUAL(UplinkDtx::DTX_REPLAY, dtx.next(VAD_SPEECH, AFE_FRAME, 2 * AFE_FRAME));
+    TEST_ASSERT_EQUAL(2 * AFE_FRAME, dtx.replaySamples());
+}
+
+struct Replay {
+    size_t captured;     // 16 kHz samples
+    size_t sent;         // 16 kHz samples resampled and sent
+    size_t bytes;        // 24 kHz PCM16 bytes handed to the client
+    size_t keepAlives;
+    double cpuSeconds;   // Uplink path: DTX and resampling
+    bool onsetsCovered;  // Every speech segment went out whole, with what is left of the padding
+};
+
+/**
+ * The AFE side of micAudioCallback over a scripted conversation
+ *
+ * Frames go into an AfeTap with a VAD that reports speech VAD_LAG_MS after
+ * it starts and holds it for as long after it ends. After every frame the
+ * uplink reads all that is available, like a client polling faster than
+ * the AFE, rewinding on a replay and resampling what is sent to 24 kHz.
+ */
+static Replay replay(const Fixtures::Script& script, bool enabled) {
+    const Fixtures::Clip& clip = script.clip();
+    const std::vector<Fixtures::Segment>& segments = script.segments();
+    AfeTap tap;
+    tap.init(AFE_FRAME, AFE_TAP_HISTORY_SAMPLES);
+    AfeTap::Reader reader = tap.reader();
+    AudioResampler upsampler(16000, STS_SAMPLE_RATE);
+    UplinkDtx model;
+    model.init(CONFIG);
+
+    Replay result = {};
+    std::vector<bool> sentAt(clip.pcm.size(), false);
+    int16_t chunk[AFE_FRAME];
+    int16_t out[AFE_FRAME * 2];
+    unsigned long lastSent = 0;
+    double cpu = 0;
+
+    for (size_t pos = 0; pos + AFE_FRAME <= clip.pcm.size(); pos += AFE_FRAME) {
+        bool speech = false;
+        for (const Fixtures::Segment& s : segments) {
+            speech |= pos >= s.start + VAD_LAG_MS * 16 && pos < s.end + VAD_LAG_MS * 16;
+        }
+        HostClock::advance(AFE_FRAME / 16);
+        tap.push(clip.pcm.data() + pos, AFE_FRAME, speech ? VAD_SPEECH : VAD_SILENCE);
+        result.captured += AFE_FRAME;
+
+        double start = Bench::seconds();
+        size_t got;
+        AfeTap::FrameInfo info;
+        while ((got = reader.read(chunk, AFE_FRAME, &info)) > 0) {
+            uint32_t after = reader.position();
+            UplinkDtx::ACTION action = enabled ? model.next(info.vad, got, after) : UplinkDtx::DTX_SEND;
+            if (action == UplinkDtx::DTX_REPLAY) {
+                reader.rewind(reader.available() + model.replaySamples());
+                upsampler.reset();
+                continue;
+            }
+            if (action == UplinkDtx::DTX_SUPPRESS) {
+                if (millis() - lastSent >= UPLINK_DTX_KEEPALIVE_MS) {
+                    result.keepAlives++;
+                    result.bytes += 480 * sizeof(int16_t);
+                    lastSent = millis();
+                }
+                continue;
+            }
+            size_t n = upsampler.process(chunk, got, out, sizeof(out) / sizeof(out[0]));
+            Bench::keep(out);
+            result.bytes += n * sizeof(int16_t);
+            result.sent += got;
+            for (size_t i = after - got; i < after; i++) sentAt[i] = true;
+            lastSent = millis();
+        }
+        cpu += Bench::seconds() - start;
+    }
+
+    result.cpuSeconds = cpu;
+    result.onsetsCovered = true;
+    for (const Fixtures::Segment& s : segments) {
+        // The padding is counted back from the frame where the VAD noticed, its lag eats into it
+        size_t padding = CONFIG.onsetSamples - VAD_LAG_MS * 16 - AFE_FRAME;
+        size_t from = s.start > padding ? s.start - padding : 0;
+        for (size_t i = from; i < s.end && i < result.captured; i++) result.onsetsCovered &= sentAt[i];
+    }
+    return result;
+}
+
+// A minute of turn taking: short and long utterances with pauses of half a second to eight seconds
+static Fixtures::Script conversation(uint32_t seed) {
+    Fixtures::Script script(16000, seed);
+    uint32_t state = seed;
+    auto next = [&state](uint32_t lo, uint32_t hi) {
+        state = state * 1664525u + 1013904223u;
+        return lo + (state >> 8) % (hi - lo);
+    };
+    script.silence(1000);
+    for (uint32_t ms = 1000; ms < 60000;) {
+        uint32_t talk = next(400, 4000);
+        uint32_t pause = next(500, 8000);
+        script.speech(talk).silence(pause);
+        ms += talk + pause;
+    }
+    return script;
+}
+
+void bench_replay() {
+    char line[160];
+    TEST_MESSAGE("seed  audio s  sent %  uplink B/s (off -> on)  keep-alives  uplink CPU us/s (off -> on)");
+    for (uint32_t seed : {3u, 7u, 11u}) {
+        Fixtures::Script script = conversation(seed);
+        Replay off = replay(script, false);
+        Replay on = replay(script, true);
+        double seconds = off.captured / 16000.0;
+        snprintf(line, sizeof(line), "%4lu  %7.1f  %6.1f  %8.0f -> %8.0f  %11zu  %10.1f -> %6.1f",
+            (unsigned long)seed, seconds, 100.0 * on.sent / on.captured, off.bytes / seconds, on.bytes / seconds,
+            on.keepAlives, off.cpuSeconds * 1e6 / seconds, on.cpuSeconds * 1e6 / seconds);
+        TEST_MESSAGE(line);
+
+        TEST_ASSERT_EQUAL(off.captured, off.sent);
+        TEST_ASSERT_TRUE(on.onsetsCovered);
+        TEST_ASSERT_LESS_THAN(off.bytes, on.bytes);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_silence_is_sent_for_the_hangover);
+    RUN_TEST(test_onset_replay_starts_on_a_frame);
+    RUN_TEST(test_replay_does_not_suppress_again);
+    RUN_TEST(test_replay_stops_at_the_start_of_the_stream);
+    RUN_TEST(bench_replay);
+    return UNITY_END();
+}
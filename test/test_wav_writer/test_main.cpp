@@ -0,0 +1,200 @@
+#include <unity.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "fixtures.h"
+#include "app/audio/wav.h"
+
+static const size_t CHUNK = 512; // Samples per audioSamples entry, as RecorderTask gets them
+
+static FS* flash = nullptr;
+
+// Recorders own a writer task that never ends, so they live for the whole run
+static WavRecorder recorder;
+static WavRecorder resampling;
+
+static Fixtures::Clip speech(uint32_t ms) {
+    Fixtures::Script script(16000, 5);
+    script.silence(200).speech(ms - 400).silence(200);
+    return script.clip();
+}
+
+static void record(WavRecorder& target, const Fixtures::Clip& clip, size_t chunk) {
+    for (size_t pos = 0; pos < clip.pcm.size(); pos += chunk) {
+        size_t n = std::min(chunk, clip.pcm.size() - pos);
+        target.processChunk((const uint8_t*)(clip.pcm.data() + pos), n * sizeof(int16_t));
+    }
+}
+
+static std::vector<uint8_t> readImage(const char* path) {
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(flash->hostPath(path).c_str(), "rb");
+    if (!file) return bytes;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), file)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+    fclose(file);
+    return bytes;
+}
+
+void setUp() {
+    static char root[] = "/tmp/wav_writerXXXXXX";
+    static bool made = false;
+    if (!made) made = mkdtemp(root) != nullptr;
+    if (!flash) flash = new FS(root);
+    flash->stats = fs::FSStats();
+    flash->writeLatencyUs = 0;
+    recorder.init(*flash);
+    recorder.setVolume(1.0f);
+    resampling.init(*flash);
+    resampling.setVolume(1.0f);
+}
+
+void tearDown() {}
+
+void test_recording_round_trips_in_block_writes() {
+    Fixtures::Clip clip = speech(3000);
+    TEST_ASSERT_TRUE(recorder.start("/audio/round_trip.wav"));
+    // Odd chunk sizes, blocks fill up part way through a chunk
+    record(recorder, clip, 333);
+    recorder.stop();
+
+    size_t bytes = clip.pcm.size() * sizeof(int16_t);
+    TEST_ASSERT_EQUAL(bytes, recorder.getRecordedBytes());
+    std::vector<uint8_t> image = readImage("/audio/round_trip.wav");
+    TEST_ASSERT_EQUAL(sizeof(wav_hdr) + bytes, image.size());
+
+    Fixtures::Clip decoded;
+    TEST_ASSERT_TRUE(Fixtures::decodeWav(image, decoded));
+    TEST_ASSERT_EQUAL(16000, decoded.rate);
+    TEST_ASSERT_EQUAL(clip.pcm.size(), decoded.pcm.size());
+    TEST_ASSERT_EQUAL_MEMORY(clip.pcm.data(), decoded.pcm.data(), bytes);
+
+    // Whole blocks with the header leading the first, then the header rewrite
+    size_t blocks = (image.size() + WAV_BLOCK_SIZE - 1) / WAV_BLOCK_SIZE;
+    TEST_ASSERT_EQUAL(blocks, recorder.getWriteCalls());
+    TEST_ASSERT_EQUAL(blocks + 1, flash->stats.writes);
+    TEST_ASSERT_EQUAL(image.size() + sizeof(wav_hdr), flash->stats.bytesWritten);
+}
+
+void test_resampled_recording_has_the_output_rate() {
+    Fixtures::Clip clip = speech(2000);
+    TEST_ASSERT_TRUE(resampling.start("/audio/resampled.wav", 16, 24));
+    record(resampling, clip, CHUNK);
+    resampling.stop();
+
+    Fixtures::Clip decoded;
+    TEST_ASSERT_TRUE(Fixtures::decodeWav(readImage("/audio/resampled.wav"), decoded));
+    TEST_ASSERT_EQUAL(24000, decoded.rate);
+    TEST_ASSERT_EQUAL(resampling.getRecordedBytes(), decoded.pcm.size() * sizeof(int16_t));
+    // The resampler holds back a few samples of history
+    TEST_ASSERT_INT_WITHIN(64, clip.pcm.size() * 3 / 2, decoded.pcm.size());
+}
+
+void test_next_recording_reuses_blocks_and_writer() {
+    Fixtures::Clip clip = speech(1000);
+    TEST_ASSERT_TRUE(recorder.start("/audio/first.wav"));
+    record(recorder, clip, CHUNK);
+    recorder.stop();
+
+    uint32_t before = HostHeap::allocations();
+    TEST_ASSERT_TRUE(recorder.start("/audio/second.wav"));
+    record(recorder, clip, CHUNK);
+    recorder.stop();
+    TEST_ASSERT_EQUAL(before, HostHeap::allocations());
+
+    Fixtures::Clip decoded;
+    TEST_ASSERT_TRUE(Fixtures::decodeWav(readImage("/audio/second.wav"), decoded));
+    TEST_ASSERT_EQUAL_MEMORY(clip.pcm.data(), decoded.pcm.data(), clip.pcm.size() * sizeof(int16_t));
+}
+
+struct Run {
+    double seconds;       // Wall time for the whole recording
+    double callerSeconds; // Of that, time the recording task spent in the write path
+    size_t writes;        // write() calls that reached the file
+    size_t bytes;         // Bytes in the file
+};
+
+/**
+ * The path before the writer task: every chunk resampled and written on its own
+ */
+static Run recordPerChunk(const Fixtures::Clip& clip, const char* path) {
+    flash->stats = fs::FSStats();
+    AudioResampler upsampler(16000, 24000);
+    std::vector<int16_t> out(CHUNK * 2);
+    Run run = {};
+    double start = Bench::seconds();
+    File file = flash->open(path, "w");
+    wav_hdr header = {};
+    file.write((const uint8_t*)&header, sizeof(header));
+    for (size_t pos = 0; pos + CHUNK <= clip.pcm.size(); pos += CHUNK) {
+        size_t n = upsampler.process(clip.pcm.data() + pos, CHUNK, out.data(), out.size());
+        file.write((const uint8_t*)out.data(), n * sizeof(int16_t));
+    }
+    file.seek(0);
+    file.write((const uint8_t*)&header, sizeof(header));
+    run.bytes = file.size();
+    file.close();
+    run.seconds = run.callerSeconds = Bench::seconds() - start;
+    run.writes = flash->stats.writes;
+    return run;
+}
+
+static Run recordBlocks(const Fixtures::Clip& clip, const char* path) {
+    flash->stats = fs::FSStats();
+    Run run = {};
+    double start = Bench::seconds();
+    resampling.start(path, 16, 24);
+    for (size_t pos = 0; pos + CHUNK <= clip.pcm.size(); pos += CHUNK) {
+        double t0 = Bench::seconds();
+        resampling.processChunk((const uint8_t*)(clip.pcm.data() + pos), CHUNK * sizeof(int16_t));
+        run.callerSeconds += Bench::seconds() - t0;
+    }
+    resampling.stop();
+    run.seconds = Bench::seconds() - start;
+    run.writes = flash->stats.writes;
+    run.bytes = sizeof(wav_hdr) + resampling.getRecordedBytes();
+    return run;
+}
+
+/**
+ * Twenty seconds of 16 kHz capture recorded at 24 kHz into the file-backed
+ * image, fed back to back. writeLatencyUs charges every write() call a
+ * fixed cost, 0 is the host page cache, 2 ms a rough per-call LittleFS
+ * program cost; with it the recorder's caller waits only when it gets a
+ * whole block ahead of the writer.
+ */
+void bench_storage() {
+    Fixtures::Clip clip = speech(20000);
+    double audioSeconds = clip.seconds();
+    char line[160];
+    TEST_MESSAGE("write cost   path         MB/s   writes  writes/s audio  caller us/s audio");
+    for (uint32_t latency : {0u, 2000u}) {
+        flash->writeLatencyUs = latency;
+        Run chunked = recordPerChunk(clip, "/audio/bench_chunked.wav");
+        Run blocks = recordBlocks(clip, "/audio/bench_blocks.wav");
+        const Run* runs[] = {&chunked, &blocks};
+        const char* names[] = {"per chunk", "32 KB blocks"};
+        for (int i = 0; i < 2; i++) {
+            snprintf(line, sizeof(line), "%5lu us     %-12s %6.1f  %6zu  %14.1f  %17.1f",
+                (unsigned long)latency, names[i], runs[i]->bytes / runs[i]->seconds / 1e6, runs[i]->writes,
+                runs[i]->writes / audioSeconds, runs[i]->callerSeconds * 1e6 / audioSeconds);
+            TEST_MESSAGE(line);
+        }
+        TEST_ASSERT_EQUAL(chunked.bytes, blocks.bytes);
+        TEST_ASSERT_LESS_THAN(chunked.writes / 16, blocks.writes);
+        if (latency) TEST_ASSERT_LESS_THAN(chunked.callerSeconds, blocks.callerSeconds);
+    }
+    flash->writeLatencyUs = 0;
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_recording_round_trips_in_block_writes);
+    RUN_TEST(test_resampled_recording_has_the_output_rate);
+    RUN_TEST(test_next_recording_reuses_blocks_and_writer);
+    RUN_TEST(bench_storage);
+    return UNITY_END();
+}
@@ -0,0 +1,290 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "WebSocketClientSSL.h"
+
+WebSocketClientSSL ws;
+
+static NetworkClientSecure& socket() { return *NetworkClientSecure::last(); }
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Message {
+    uint8_t opcode;
+    Bytes data;
+};
+
+static Bytes bytes(const std::string& text) { return Bytes(text.begin(), text.end()); }
+
+static Bytes randomBytes(size_t len, uint32_t seed) {
+    Bytes out(len);
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        out[i] = seed >> 24;
+    }
+    return out;
+}
+
+// A server frame, unmasked unless a key is given
+static Bytes frame(uint8_t opcode, const Bytes& payload, bool fin = true, const uint8_t* mask = nullptr, bool force64 = false) {
+    Bytes out;
+    out.push_back((fin ? 0x80 : 0) | opcode);
+    uint8_t maskBit = mask ? 0x80 : 0;
+    size_t len = payload.size();
+    if (force64 || len > 65535) {
+        out.push_back(maskBit | 127);
+        for (int i = 7; i >= 0; i--) out.push_back((uint64_t)len >> (i * 8));
+    } else if (len >= 126) {
+        out.push_back(maskBit | 126);
+        out.push_back(len >> 8);
+        out.push_back(len);
+    } else {
+        out.push_back(maskBit | len);
+    }
+    if (mask) out.insert(out.end(), mask, mask + 4);
+    for (size_t i = 0; i < len; i++) out.push_back(mask ? payload[i] ^ mask[i & 3] : payload[i]);
+    return out;
+}
+
+static void append(Bytes& script, const Bytes& more) { script.insert(script.end(), more.begin(), more.end()); }
+
+// Client frames in what the socket got, unmasked; every client frame must be masked
+static void sentFrames(std::vector<Message>& frames) {
+    frames.clear();
+    const Bytes& out = socket().written;
+    size_t pos = 0;
+    while (pos + 2 <= out.size()) {
+        uint8_t opcode = out[pos] & 0x0F;
+        TEST_ASSERT_TRUE_MESSAGE(out[pos + 1] & 0x80, "client frame not masked");
+        uint64_t len = out[pos + 1] & 0x7F;
+        pos += 2;
+        if (len == 126) {
+            len = (out[pos] << 8) | out[pos + 1];
+            pos += 2;
+        } else if (len == 127) {
+            len = 0;
+            for (int i = 0; i < 8; i++) len = (len << 8) | out[pos + i];
+            pos += 8;
+        }
+        const uint8_t* key = &out[pos];
+        pos += 4;
+        Message message = {opcode, Bytes(len)};
+        for (size_t i = 0; i < len; i++) message.data[i] = out[pos + i] ^ key[i & 3];
+        pos += len;
+        frames.push_back(message);
+    }
+    TEST_ASSERT_EQUAL(out.size(), pos);
+}
+
+static std::vector<Message> received;
+
+static void echo(uint8_t opcode, const uint8_t* data, size_t len, void* arg) {
+    TEST_ASSERT_EQUAL_MESSAGE(0, data[len], "message not NUL terminated");
+    received.push_back({opcode, Bytes(data, data + len)});
+    ws.sendFrame(data, len, opcode);
+}
+
+struct Streamed {
+    std::vector<Message> messages;
+    size_t pieces = 0;
+    size_t largest = 0;
+};
+
+static void collectFragment(uint8_t opcode, const uint8_t* data, size_t len, bool first, bool last, void* arg) {
+    Streamed* out = static_cast<Streamed*>(arg);
+    if (first) out->messages.push_back({opcode, Bytes()});
+    out->messages.back().data.insert(out->messages.back().data.end(), data, data + len);
+    out->pieces++;
+    if (len > out->largest) out->largest = len;
+}
+
+// Polls until the socket is drained, each poll takes only what has arrived
+static size_t drain() {
+    size_t polls = 0;
+    while (ws.isConnected() && (socket().pendingSegments() > 0 || socket().available() > 0)) {
+        ws.poll();
+        polls++;
+    }
+    return polls;
+}
+
+void setUp() {
+    ws.onMessage(nullptr);
+    ws.onFragment(nullptr);
+    if (!ws.isConnected()) TEST_ASSERT_TRUE(ws.connect("realtime.test", 443, "/v1/realtime"));
+    socket().written.clear();
+    received.clear();
+}
+
+void tearDown() {}
+
+void test_scripted_session_in_random_pieces() {
+    const uint8_t serverMask[4] = {0x12, 0x34, 0x56, 0x78};
+    Bytes big = randomBytes(200000, 7);
+    Bytes audio = bytes("{\"type\":\"response.audio.delta\",\"delta\":\"" + std::string(base64::encode(randomBytes(30000, 9).data(), 30000).c_str()) + "\"}");
+
+    std::vector<Message> expected;
+    Bytes script;
+    append(script, frame(WS_OPCODE_TEXT, bytes("hello")));
+    expected.push_back({WS_OPCODE_TEXT, bytes("hello")});
+
+    // A ping between the fragments of a message
+    append(script, frame(WS_OPCODE_TEXT, bytes("frag"), false));
+    append(script, frame(WS_OPCODE_PING, bytes("ping-1")));
+    append(script, frame(WS_OPCODE_CONTINUATION, bytes("mented "), false));
+    append(script, frame(WS_OPCODE_CONTINUATION, bytes("text")));
+    expected.push_back({WS_OPCODE_TEXT, bytes("fragmented text")});
+
+    // 200 KB in seven fragments, one with a 64-bit length, a pong and an empty ping in between
+    for (size_t i = 0, pos = 0; pos < big.size(); i++, pos += 30000) {
+        Bytes part(big.begin() + pos, big.begin() + std::min(big.size(), pos + 30000));
+        append(script, frame(i == 0 ? WS_OPCODE_BINARY : WS_OPCODE_CONTINUATION, part, pos + 30000 >= big.size(), nullptr, i == 2));
+        if (i == 3) {
+            append(script, frame(WS_OPCODE_PONG, bytes("unsolicited")));
+            append(script, frame(WS_OPCODE_PING, Bytes()));
+        }
+    }
+    expected.push_back({WS_OPCODE_BINARY, big});
+
+    append(script, frame(WS_OPCODE_TEXT, Bytes()));
+    expected.push_back({WS_OPCODE_TEXT, Bytes()});
+    append(script, frame(WS_OPCODE_TEXT, bytes("tail"), false));
+    append(script, frame(WS_OPCODE_CONTINUATION, Bytes()));
+    expected.push_back({WS_OPCODE_TEXT, bytes("tail")});
+    append(script, frame(WS_OPCODE_TEXT, bytes("masked by server"), true, serverMask));
+    expected.push_back({WS_OPCODE_TEXT, bytes("masked by server")});
+    append(script, frame(WS_OPCODE_TEXT, audio));
+    expected.push_back({WS_OPCODE_TEXT, audio});
+    append(script, frame(WS_OPCODE_CLOSE, Bytes{0x03, 0xE8}));
+
+    ws.onMessage(echo);
+    socket().dribble(script, 9000, 11);
+    size_t polls = drain();
+    TEST_ASSERT_FALSE(ws.isConnected());
+    TEST_ASSERT_GREATER_THAN(expected.size(), polls);
+
+    TEST_ASSERT_EQUAL(expected.size(), received.size());
+    std::vector<Message> echoes;
+    std::vector<Bytes> pongs;
+    Bytes close;
+    std::vector<Message> sent;
+    sentFrames(sent);
+    for (const Message& frame : sent) {
+        if (frame.opcode == WS_OPCODE_PONG) pongs.push_back(frame.data);
+        else if (frame.opcode == WS_OPCODE_CLOSE) close = frame.data;
+        else echoes.push_back(frame);
+    }
+    TEST_ASSERT_EQUAL(expected.size(), echoes.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        TEST_ASSERT_EQUAL(expected[i].opcode, received[i].opcode);
+        TEST_ASSERT_TRUE(expected[i].data == received[i].data);
+        TEST_ASSERT_EQUAL(expected[i].opcode, echoes[i].opcode);
+        TEST_ASSERT_TRUE(expected[i].data == echoes[i].data);
+    }
+    TEST_ASSERT_EQUAL(2, pongs.size());
+    TEST_ASSERT_TRUE(pongs[0] == bytes("ping-1"));
+    TEST_ASSERT_EQUAL(0, pongs[1].size());
+    TEST_ASSERT_TRUE(close == (Bytes{0x03, 0xE8}));
+}
+
+void test_every_split_of_a_fragmented_message() {
+    Bytes script;
+    append(script, frame(WS_OPCODE_TEXT, bytes("ab"), false));
+    append(script, frame(WS_OPCODE_PING, bytes("p")));
+    append(script, frame(WS_OPCODE_CONTINUATION, bytes("cd")));
+
+    // Two arrivals, split at every byte
+    for (size_t split = 1; split < script.size(); split++) {
+        received.clear();
+        socket().written.clear();
+        ws.onMessage(echo);
+        socket().receive(script.data(), split);
+        socket().receive(script.data() + split, script.size() - split);
+        drain();
+        TEST_ASSERT_EQUAL(1, received.size());
+        TEST_ASSERT_TRUE(received[0].data == bytes("abcd"));
+        std::vector<Message> sent;
+        sentFrames(sent);
+        TEST_ASSERT_EQUAL(2, sent.size());
+        TEST_ASSERT_EQUAL(WS_OPCODE_PONG, sent[0].opcode);
+    }
+}
+
+void test_streamed_fragments_stay_small() {
+    Bytes big = randomBytes(100000, 3);
+    Bytes script;
+    append(script, frame(WS_OPCODE_BINARY, Bytes(big.begin(), big.begin() + 40000), false));
+    append(script, frame(WS_OPCODE_CONTINUATION, Bytes(big.begin() + 40000, big.end())));
+    append(script, frame(WS_OPCODE_TEXT, bytes("after")));
+
+    Streamed streamed;
+    ws.onFragment(collectFragment, &streamed);
+    socket().dribble(script, 9000, 5);
+    drain();
+
+    TEST_ASSERT_EQUAL(2, streamed.messages.size());
+    TEST_ASSERT_EQUAL(WS_OPCODE_BINARY, streamed.messages[0].opcode);
+    TEST_ASSERT_TRUE(streamed.messages[0].data == big);
+    TEST_ASSERT_TRUE(streamed.messages[1].data == bytes("after"));
+    TEST_ASSERT_LESS_OR_EQUAL(WSS_RX_CHUNK, streamed.largest);
+}
+
+static void expectClose(const Bytes& script, uint16_t code) {
+    socket().receive(script);
+    drain();
+    TEST_ASSERT_FALSE(ws.isConnected());
+    std::vector<Message> sent;
+    sentFrames(sent);
+    TEST_ASSERT_EQUAL(1, sent.size());
+    TEST_ASSERT_EQUAL(WS_OPCODE_CLOSE, sent[0].opcode);
+    TEST_ASSERT_EQUAL(code, (sent[0].data[0] << 8) | sent[0].data[1]);
+}
+
+void test_continuation_without_a_message_closes() {
+    expectClose(frame(WS_OPCODE_CONTINUATION, bytes("x")), 1002);
+}
+
+void test_new_message_inside_a_fragmented_one_closes() {
+    Bytes script = frame(WS_OPCODE_TEXT, bytes("a"), false);
+    append(script, frame(WS_OPCODE_TEXT, bytes("b")));
+    expectClose(script, 1002);
+}
+
+void test_unknown_opcode_closes() {
+    expectClose(frame(0x3, bytes("?")), 1002);
+}
+
+void test_fragmented_ping_closes() {
+    expectClose(frame(WS_OPCODE_PING, bytes("p"), false), 1002);
+}
+
+void test_oversized_message_closes() {
+    // Only the header is needed, the length alone is refused
+    Bytes header = {0x82, 127};
+    uint64_t len = (uint64_t)WSS_RX_MAX_MESSAGE + 1;
+    for (int i = 7; i >= 0; i--) header.push_back(len >> (i * 8));
+    expectClose(header, 1009);
+}
+
+void test_receive_message_copies_text() {
+    socket().receive(frame(WS_OPCODE_TEXT, bytes("{\"type\":\"session.created\"}")));
+    uint8_t* message = ws.receiveMessage();
+    TEST_ASSERT_NOT_NULL(message);
+    TEST_ASSERT_EQUAL_STRING("{\"type\":\"session.created\"}", (const char*)message);
+    heap_caps_free(message);
+    TEST_ASSERT_NULL(ws.receiveMessage());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_scripted_session_in_random_pieces);
+    RUN_TEST(test_every_split_of_a_fragmented_message);
+    RUN_TEST(test_streamed_fragments_stay_small);
+    RUN_TEST(test_continuation_without_a_message_closes);
+    RUN_TEST(test_new_message_inside_a_fragmented_one_closes);
+    RUN_TEST(test_unknown_opcode_closes);
+    RUN_TEST(test_fragmented_ping_closes);
+    RUN_TEST(test_oversized_message_closes);
+    RUN_TEST(test_receive_message_copies_text);
+    return UNITY_END();
+}
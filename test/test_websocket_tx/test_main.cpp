@@ -0,0 +1,181 @@
+#include <unity.h>
+#include <vector>
+#include "bench.h"
+#include "WebSocketClientSSL.h"
+
+WebSocketClientSSL ws;
+
+static NetworkClientSecure& socket() { return *NetworkClientSecure::last(); }
+
+/**
+ * The writer before frames were streamed: the whole frame in one buffer,
+ * masked a byte at a time, one socket write. Kept as the reference.
+ */
+static size_t legacyFrame(const uint8_t* data, size_t len, std::vector<uint8_t>& frame) {
+    frame.resize(len + 14);
+    frame[0] = 0x81;
+    size_t headerSize = 6;
+    if (len < 126) {
+        frame[1] = len | 0x80;
+    } else if (len <= 65535) {
+        frame[1] = 126 | 0x80;
+        frame[2] = (len >> 8) & 0xFF;
+        frame[3] = len & 0xFF;
+        headerSize = 8;
+    } else {
+        frame[1] = 127 | 0x80;
+        frame[2] = 0; frame[3] = 0; frame[4] = 0; frame[5] = 0;
+        frame[6] = (len >> 24) & 0xFF;
+        frame[7] = (len >> 16) & 0xFF;
+        frame[8] = (len >> 8) & 0xFF;
+        frame[9] = len & 0xFF;
+        headerSize = 14;
+    }
+    uint8_t maskKey[4];
+    for (int i = 0; i < 4; i++) {
+        maskKey[i] = random(0, 256);
+    }
+    memcpy(&frame[headerSize - 4], maskKey, 4);
+    uint8_t* payload = &frame[headerSize];
+    memcpy(payload, data, len);
+    for (size_t i = 0; i < len; i++) {
+        payload[i] ^= maskKey[i % 4];
+    }
+    return headerSize + len;
+}
+
+static std::vector<uint8_t> payloadOf(size_t len) {
+    std::vector<uint8_t> payload(len);
+    for (size_t i = 0; i < len; i++) payload[i] = i * 7 + 3;
+    return payload;
+}
+
+void setUp() {
+    if (!ws.isConnected()) TEST_ASSERT_TRUE(ws.connect("realtime.test", 443, "/v1/realtime"));
+    socket().written.clear();
+    socket().writes = 0;
+    socket().discard = false;
+}
+
+void tearDown() {}
+
+void test_frames_match_the_previous_writer() {
+    const size_t lengths[] = {0, 1, 3, 5, 125, 126, 127, 1000, 2047, 2048, 2049, 2063, 2064, 2065, 4200, 65535, 65536, 100001};
+    std::vector<uint8_t> expected;
+    for (size_t len : lengths) {
+        std::vector<uint8_t> payload = payloadOf(len);
+
+        randomSeed(len + 1);
+        size_t size = legacyFrame(payload.data(), len, expected);
+        expected.resize(size);
+
+        randomSeed(len + 1);
+        socket().written.clear();
+        TEST_ASSERT_TRUE(ws.sendFrame(payload.data(), len, WS_OPCODE_TEXT));
+        TEST_ASSERT_EQUAL(expected.size(), socket().written.size());
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), socket().written.data(), expected.size());
+
+        // The same frame from uneven scatter/gather slices
+        std::vector<WsSlice> slices;
+        for (size_t pos = 0, n = 1; pos < len; pos += n, n = n * 3 + 1) {
+            slices.push_back({payload.data() + pos, std::min(n, len - pos)});
+        }
+        randomSeed(len + 1);
+        socket().written.clear();
+        TEST_ASSERT_TRUE(ws.sendFrame(slices.data(), slices.size(), WS_OPCODE_TEXT));
+        TEST_ASSERT_EQUAL(expected.size(), socket().written.size());
+        TEST_ASSERT_EQUAL_MEMORY(expected.data(), socket().written.data(), expected.size());
+    }
+}
+
+void test_large_frames_go_out_in_buffer_sized_writes() {
+    std::vector<uint8_t> payload = payloadOf(48 * 1024);
+    TEST_ASSERT_TRUE(ws.sendBinary(payload.data(), payload.size()));
+    TEST_ASSERT_EQUAL((payload.size() + WSS_TX_BUFFER_SIZE - 1) / WSS_TX_BUFFER_SIZE, socket().writes);
+    TEST_ASSERT_EQUAL(0x82, socket().written[0]);
+}
+
+void test_continuation_frames() {
+    std::vector<uint8_t> payload = payloadOf(10);
+    TEST_ASSERT_TRUE(ws.beginFrame(4, WS_OPCODE_TEXT, false));
+    TEST_ASSERT_TRUE(ws.write(payload.data(), 4));
+    TEST_ASSERT_TRUE(ws.endFrame());
+    TEST_ASSERT_TRUE(ws.beginFrame(6, WS_OPCODE_CONTINUATION, true));
+    TEST_ASSERT_TRUE(ws.write(payload.data() + 4, 6));
+    TEST_ASSERT_TRUE(ws.endFrame());
+
+    const std::vector<uint8_t>& out = socket().written;
+    TEST_ASSERT_EQUAL(2 + 4 + 4 + 2 + 4 + 6, out.size());
+    TEST_ASSERT_EQUAL(0x01, out[0]);
+    TEST_ASSERT_EQUAL(0x80 | 4, out[1]);
+    TEST_ASSERT_EQUAL(0x80, out[10]);
+    TEST_ASSERT_EQUAL(0x80 | 6, out[11]);
+}
+
+void test_frame_started_inside_a_frame_is_refused() {
+    TEST_ASSERT_TRUE(ws.beginFrame(2));
+    TEST_ASSERT_FALSE(ws.beginFrame(2));
+    TEST_ASSERT_TRUE(ws.write("ok", 2));
+    TEST_ASSERT_TRUE(ws.endFrame());
+    TEST_ASSERT_TRUE(ws.isConnected());
+}
+
+void test_wrong_length_drops_the_connection() {
+    TEST_ASSERT_TRUE(ws.beginFrame(3));
+    TEST_ASSERT_FALSE(ws.write("four", 4));
+    TEST_ASSERT_FALSE(ws.isConnected());
+
+    TEST_ASSERT_TRUE(ws.connect("realtime.test", 443, "/v1/realtime"));
+    TEST_ASSERT_TRUE(ws.beginFrame(3));
+    TEST_ASSERT_TRUE(ws.write("ab", 2));
+    TEST_ASSERT_FALSE(ws.endFrame());
+    TEST_ASSERT_FALSE(ws.isConnected());
+}
+
+void test_sending_does_not_allocate() {
+    std::vector<uint8_t> payload = payloadOf(20000);
+    TEST_ASSERT_TRUE(ws.sendBinary(payload.data(), payload.size())); // TX buffer exists from here on
+    uint32_t before = HostHeap::allocations();
+    for (int i = 0; i < 10; i++) TEST_ASSERT_TRUE(ws.sendBinary(payload.data(), payload.size()));
+    TEST_ASSERT_EQUAL(before, HostHeap::allocations());
+}
+
+// Masking and copying a 48 KB audio append, the socket only counts bytes
+void bench_mask_throughput() {
+    std::vector<uint8_t> payload(48 * 1024, 0x41);
+    std::vector<uint8_t> frame;
+    socket().discard = true;
+    const int reps = 4000;
+
+    double start = Bench::seconds();
+    for (int i = 0; i < reps; i++) {
+        size_t size = legacyFrame(payload.data(), payload.size(), frame);
+        socket().write(frame.data(), size);
+    }
+    double legacy = Bench::seconds() - start;
+    size_t legacyWrites = socket().writes / reps;
+
+    socket().writes = 0;
+    start = Bench::seconds();
+    for (int i = 0; i < reps; i++) ws.sendBinary(payload.data(), payload.size());
+    double streamed = Bench::seconds() - start;
+    size_t streamedWrites = socket().writes / reps;
+
+    double mb = reps * payload.size() / 1048576.0;
+    char line[160];
+    snprintf(line, sizeof(line), "48 KB frame: previous %.0f MB/s in %lu write, streamed %.0f MB/s in %lu writes of %d B",
+        mb / legacy, (unsigned long)legacyWrites, mb / streamed, (unsigned long)streamedWrites, WSS_TX_BUFFER_SIZE);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_match_the_previous_writer);
+    RUN_TEST(test_large_frames_go_out_in_buffer_sized_writes);
+    RUN_TEST(test_continuation_frames);
+    RUN_TEST(test_frame_started_inside_a_frame_is_refused);
+    RUN_TEST(test_wrong_length_drops_the_connection);
+    RUN_TEST(test_sending_does_not_allocate);
+    RUN_TEST(bench_mask_throughput);
+    return UNITY_END();
+}
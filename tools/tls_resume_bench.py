@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Cold against resumed TLS handshake times against a local openssl s_server.
+
+The same comparison TlsSessionClient logs on the device (TlsHandshakeStats),
+made on the host so the server side is known: a full handshake per
+connection, then connections that offer the session of the previous one.
+
+    python3 tools/tls_resume_bench.py [--count 200] [--key rsa:2048|ec]
+
+Needs the openssl command line tool. Times include the TCP connect, like
+TlsSessionClient::connect(). On loopback they are the cryptography alone;
+the device adds its slower public key operations and the network round
+trips, which is where a resumed handshake saves most.
+"""
+import argparse
+import os
+import socket
+import ssl
+import statistics
+import subprocess
+import tempfile
+import time
+
+PORT = 44330
+
+
+def start_server(workdir, key, version):
+    cert = os.path.join(workdir, "cert.pem")
+    keyfile = os.path.join(workdir, "key.pem")
+    if key == "ec":
+        keyargs = ["-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:prime256v1"]
+    else:
+        keyargs = ["-newkey", key]
+    subprocess.run(["openssl", "req", "-x509", "-nodes", "-days", "1", "-subj", "/CN=localhost",
+                    "-keyout", keyfile, "-out", cert] + keyargs, check=True, capture_output=True)
+    server = subprocess.Popen(["openssl", "s_server", "-quiet", "-www", "-accept", str(PORT),
+                               "-cert", cert, "-key", keyfile, "-" + version],
+                              stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    for _ in range(100):
+        try:
+            socket.create_connection(("127.0.0.1", PORT), timeout=0.1).close()
+            return server
+        except OSError:
+            time.sleep(0.05)
+    server.kill()
+    raise RuntimeError("s_server did not come up")
+
+
+def handshake(context, session):
+    start = time.perf_counter()
+    raw = socket.create_connection(("127.0.0.1", PORT))
+    tls = context.wrap_socket(raw, server_hostname="localhost", session=session)
+    elapsed = time.perf_counter() - start
+    # TLS 1.3 tickets follow the handshake, read a response so they arrive
+    tls.sendall(b"GET / HTTP/1.0\r\n\r\n")
+    while tls.recv(4096):
+        pass
+    reused = tls.session_reused
+    session = tls.session
+    tls.close()
+    return elapsed * 1000, reused, session
+
+
+def run(version, count, key):
+    with tempfile.TemporaryDirectory() as workdir:
+        server = start_server(workdir, key, version)
+        try:
+            context = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+            context.check_hostname = False
+            context.verify_mode = ssl.CERT_NONE  # As setInsecure()
+            pinned = ssl.TLSVersion.TLSv1_2 if version == "tls1_2" else ssl.TLSVersion.TLSv1_3
+            context.minimum_version = context.maximum_version = pinned
+
+            cold = [handshake(context, None)[0] for _ in range(count)]
+            resumed, misses = [], 0
+            _, _, session = handshake(context, None)
+            for _ in range(count):
+                ms, reused, session = handshake(context, session)
+                if reused:
+                    resumed.append(ms)
+                else:
+                    misses += 1
+        finally:
+            server.terminate()
+            server.wait()
+
+    def summary(times):
+        return "median %6.3f ms, p90 %6.3f ms" % (statistics.median(times), sorted(times)[int(len(times) * 0.9)])
+
+    print("%s %-8s cold    %s" % (version, key, summary(cold)))
+    if resumed:
+        print("%s %-8s resumed %s, %d of %d resumed, %.1fx faster" % (version, key, summary(resumed), len(resumed),
+              count, statistics.median(cold) / statistics.median(resumed)))
+    else:
+        print("%s %-8s resumed none of %d" % (version, key, count))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=200)
+    parser.add_argument("--key", default="rsa:2048", help="rsa:2048 or ec (P-256)")
+    args = parser.parse_args()
+    for version in ("tls1_2", "tls1_3"):
+        run(version, args.count, args.key)
+
+
+if __name__ == "__main__":
+    main()